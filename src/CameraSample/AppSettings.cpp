@@ -69,6 +69,75 @@ AppSettings::AppSettings() //: QSettings(QSettings::SystemScope, QCoreApplicatio
     localeName = settings.value(QStringLiteral("LocaleName"), defaultLocaleName).toString();//
 
     fixBadPixels = settings.value(QStringLiteral("FixBadPixels"), false).toBool();
+
+    genTLBufferCount = settings.value(QStringLiteral("GenTL/BufferCount"), 16).toInt();
+    genTLBufferCount = qBound<int>(0, genTLBufferCount, 1024);
+    genTLBufferMemory = BufferMemory(settings.value(QStringLiteral("GenTL/BufferMemory"), bmPinned).toInt());
+    if(genTLBufferMemory < bmProducer || genTLBufferMemory > bmHugePages)
+        genTLBufferMemory = bmProducer;
+
+    pipelineCameras = settings.value(QStringLiteral("Pipelines/Cameras"), 2).toInt();
+    pipelineCameras = qBound<int>(1, pipelineCameras, 16);
+    for(const QString& s : settings.value(QStringLiteral("Pipelines/CudaDevices"), QStringLiteral("0")).toString().split(QChar(','), QString::SkipEmptyParts))
+        pipelineCudaDevices.append(s.trimmed().toInt());
+    if(pipelineCudaDevices.isEmpty())
+        pipelineCudaDevices.append(0);
+    for(const QString& s : settings.value(QStringLiteral("Pipelines/CpuCores"), QString()).toString().split(QChar(','), QString::SkipEmptyParts))
+        pipelineCpuCores.append(s.trimmed().toInt());
+    pipelineSync = settings.value(QStringLiteral("Pipelines/Sync"), false).toBool();
+    pipelineSyncToleranceUs = settings.value(QStringLiteral("Pipelines/SyncToleranceUs"), 1000).toInt();
+    pipelineSyncToleranceUs = qMax(1, pipelineSyncToleranceUs);
+    pipelineSyncPtp = settings.value(QStringLiteral("Pipelines/SyncPtp"), false).toBool();
+    for(const QString& s : settings.value(QStringLiteral("Pipelines/TimestampOffsetsNs"), QString()).toString().split(QChar(','), QString::SkipEmptyParts))
+        pipelineTimestampOffsetsNs.append(s.trimmed().toLongLong());
+
+    burstPreFrames = qMax(0, settings.value(QStringLiteral("Burst/PreFrames"), 0).toInt());
+    burstPostFrames = qMax(0, settings.value(QStringLiteral("Burst/PostFrames"), 0).toInt());
+
+    recordingContainer = settings.value(QStringLiteral("Recording/Container"), QStringLiteral("avi")).toString().toLower();
+    if(recordingContainer != QLatin1String("mp4") && recordingContainer != QLatin1String("mkv"))
+        recordingContainer = QStringLiteral("avi");
+    recordingMaxFileSizeMB = qMax(0, settings.value(QStringLiteral("Recording/MaxFileSizeMB"), int(Globals::MaxFileSize >> 20)).toInt());
+    recordingMaxDurationSec = qMax(0, settings.value(QStringLiteral("Recording/MaxDurationSec"), 0).toInt());
+    recordingFlushIntervalMs = qMax(100, settings.value(QStringLiteral("Recording/FlushIntervalMs"), 1000).toInt());
+
+    dngCompression = settings.value(QStringLiteral("Dng/Compression"), true).toBool();
+    dngTileSize = qBound(16, settings.value(QStringLiteral("Dng/TileSize"), 256).toInt(), 4096) / 16 * 16;
+
+    jpegRateControl = settings.value(QStringLiteral("JpegRate/Enabled"), false).toBool();
+    jpegRateMinQuality = qBound(1, settings.value(QStringLiteral("JpegRate/MinQuality"), 30).toInt(), 100);
+    jpegRateMaxQuality = qBound(jpegRateMinQuality, settings.value(QStringLiteral("JpegRate/MaxQuality"), 95).toInt(), 100);
+
+    playbackMaxSpeed = settings.value(QStringLiteral("Playback/MaxSpeed"), false).toBool();
+    playbackLoop = settings.value(QStringLiteral("Playback/Loop"), true).toBool();
+
+    for(int i = 0; i < trCount; i++)
+    {
+        const QString group = QStringLiteral("Threads/%1/").arg(QLatin1String(threadRoleName(ThreadRole(i))));
+        ThreadSettings& t = threads[i];
+        for(const QString& s : settings.value(group + QStringLiteral("Cores"), QString()).toString().split(QChar(','), QString::SkipEmptyParts))
+            t.cores.append(s.trimmed().toInt());
+        t.numaNode = settings.value(group + QStringLiteral("NumaNode"), -1).toInt();
+        t.realtime = settings.value(group + QStringLiteral("Realtime"), false).toBool();
+        t.priority = settings.value(group + QStringLiteral("Priority"), 0).toInt();
+    }
+}
+
+const char* AppSettings::threadRoleName(ThreadRole role)
+{
+    switch(role)
+    {
+    case trCamera:
+        return "Camera";
+    case trProcessing:
+        return "Processing";
+    case trWriter:
+        return "Writer";
+    case trNetwork:
+        return "Network";
+    default:
+        return "Unknown";
+    }
 }
 
 void AppSettings::save()
@@ -95,5 +164,55 @@ void AppSettings::save()
 
     settings.setValue(QStringLiteral("FixBadPixels"), fixBadPixels);
 
+    settings.setValue(QStringLiteral("GenTL/BufferCount"), genTLBufferCount);
+    settings.setValue(QStringLiteral("GenTL/BufferMemory"), int(genTLBufferMemory));
+
+    QStringList list;
+    for(int v : pipelineCudaDevices)
+        list.append(QString::number(v));
+    settings.setValue(QStringLiteral("Pipelines/Cameras"), pipelineCameras);
+    settings.setValue(QStringLiteral("Pipelines/CudaDevices"), list.join(QChar(',')));
+    list.clear();
+    for(int v : pipelineCpuCores)
+        list.append(QString::number(v));
+    settings.setValue(QStringLiteral("Pipelines/CpuCores"), list.join(QChar(',')));
+    list.clear();
+    for(qint64 v : pipelineTimestampOffsetsNs)
+        list.append(QString::number(v));
+    settings.setValue(QStringLiteral("Pipelines/Sync"), pipelineSync);
+    settings.setValue(QStringLiteral("Pipelines/SyncToleranceUs"), pipelineSyncToleranceUs);
+    settings.setValue(QStringLiteral("Pipelines/SyncPtp"), pipelineSyncPtp);
+    settings.setValue(QStringLiteral("Pipelines/TimestampOffsetsNs"), list.join(QChar(',')));
+
+    settings.setValue(QStringLiteral("Burst/PreFrames"), burstPreFrames);
+    settings.setValue(QStringLiteral("Burst/PostFrames"), burstPostFrames);
+
+    settings.setValue(QStringLiteral("Recording/Container"), recordingContainer);
+    settings.setValue(QStringLiteral("Recording/MaxFileSizeMB"), recordingMaxFileSizeMB);
+    settings.setValue(QStringLiteral("Recording/MaxDurationSec"), recordingMaxDurationSec);
+    settings.setValue(QStringLiteral("Recording/FlushIntervalMs"), recordingFlushIntervalMs);
+
+    settings.setValue(QStringLiteral("Dng/Compression"), dngCompression);
+    settings.setValue(QStringLiteral("Dng/TileSize"), dngTileSize);
+    settings.setValue(QStringLiteral("JpegRate/Enabled"), jpegRateControl);
+    settings.setValue(QStringLiteral("JpegRate/MinQuality"), jpegRateMinQuality);
+    settings.setValue(QStringLiteral("JpegRate/MaxQuality"), jpegRateMaxQuality);
+
+    settings.setValue(QStringLiteral("Playback/MaxSpeed"), playbackMaxSpeed);
+    settings.setValue(QStringLiteral("Playback/Loop"), playbackLoop);
+
+    for(int i = 0; i < trCount; i++)
+    {
+        const QString group = QStringLiteral("Threads/%1/").arg(QLatin1String(threadRoleName(ThreadRole(i))));
+        const ThreadSettings& t = threads[i];
+        list.clear();
+        for(int v : t.cores)
+            list.append(QString::number(v));
+        settings.setValue(group + QStringLiteral("Cores"), list.join(QChar(',')));
+        settings.setValue(group + QStringLiteral("NumaNode"), t.numaNode);
+        settings.setValue(group + QStringLiteral("Realtime"), t.realtime);
+        settings.setValue(group + QStringLiteral("Priority"), t.priority);
+    }
+
     settings.sync();
 }
@@ -73,6 +73,73 @@ public:
     int jpegQty;
 
     bool fixBadPixels;
+
+    //GenTL stream buffers
+    typedef enum {
+        bmProducer = 0, ///Allocated by the GenTL producer
+        bmPinned,       ///Page-locked, GPU mapped host memory
+        bmHugePages     ///Huge pages, page-locked for the GPU
+    } BufferMemory;
+
+    int genTLBufferCount;
+    BufferMemory genTLBufferMemory;
+
+    //Multi-camera pipelines. Camera N runs on the N-th entry of the lists,
+    //wrapping around when the list is shorter than the number of cameras.
+    int pipelineCameras;
+    QVector<int> pipelineCudaDevices;
+    QVector<int> pipelineCpuCores; ///Empty or -1 - no pinning
+    //Process frames of all cameras in sets matched by device timestamp
+    bool pipelineSync;
+    int pipelineSyncToleranceUs;
+    bool pipelineSyncPtp; ///Enable PTP on the cameras, timestamps share one clock
+    QVector<qint64> pipelineTimestampOffsetsNs; ///Per camera, PTP mode only
+
+    //Triggered burst recording, frames kept before and written after the trigger.
+    //Both 0 - burst mode off. The ring takes (pre + post + 4) raw frames of pinned memory.
+    int burstPreFrames;
+    int burstPostFrames;
+
+    //Motion JPEG recording: "avi", "mp4" (fragmented) or "mkv".
+    //Files roll over to name_001.ext... at the size or capture time limit, 0 - no limit.
+    QString recordingContainer;
+    int recordingMaxFileSizeMB; ///Globals::MaxFileSize by default
+    int recordingMaxDurationSec;
+    int recordingFlushIntervalMs; ///MP4 fragments and MKV clusters are flushed that often
+
+    //DNG raw export: lossless JPEG compressed tiles, tile size multiple of 16
+    bool dngCompression;
+    int dngTileSize;
+
+    //Motion JPEG rate control: quality of every frame is chosen to hold the selected bitrate
+    bool jpegRateControl;
+    int jpegRateMinQuality;
+    int jpegRateMaxQuality;
+
+    //Raw sequence playback: recorded timing or as fast as processed, restart at the end
+    bool playbackMaxSpeed;
+    bool playbackLoop;
+
+    //Scheduling of the application threads by role, applied by ThreadPolicy
+    typedef enum {
+        trCamera = 0,   ///Camera acquisition loops
+        trProcessing,   ///CUDA submission (RawProcessor)
+        trWriter,       ///File writers and encoders
+        trNetwork,      ///RTSP server
+        trCount
+    } ThreadRole;
+
+    struct ThreadSettings
+    {
+        QVector<int> cores;  ///Allowed CPU cores, empty - any
+        int numaNode = -1;   ///Restrict to the cores of the node, -1 - any
+        bool realtime = false; ///SCHED_FIFO (time critical priority on Windows)
+        int priority = 0;    ///SCHED_FIFO priority, 0 - middle of the range
+    };
+
+    ThreadSettings threads[trCount];
+
+    static const char* threadRoleName(ThreadRole role);
 };
 
 #endif // APPSETTINGS_H
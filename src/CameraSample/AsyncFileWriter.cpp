@@ -28,6 +28,8 @@
 
 #include "AsyncFileWriter.h"
 #include "MJPEGEncoder.h"
+#include "Tracer.h"
+#include "ThreadPolicy.h"
 
 #include <QTimer>
 #include <QFile>
@@ -75,8 +77,12 @@ void AsyncWriter::initBuffers(unsigned bufferSize)
 
 unsigned char* AsyncWriter::getBuffer()
 {
+    //No buffers, the frame is lost
     if(mBuffers.empty())
+    {
+        mDropped++;
         return nullptr;
+    }
 
     unsigned char* ret = mBuffers[mCurrentBuffer].get();
 
@@ -107,10 +113,12 @@ void AsyncWriter::setMaxSize(int sz)
 void AsyncWriter::startWriting()
 {
     mWriting = true;
+    ThreadPolicy::apply(AppSettings::trWriter);
     QMutex mut;
 
     mProcessed = 0;
     mDropped = 0;
+    mFailed = 0;
 
     while(!mCancel)
     {
@@ -123,7 +131,10 @@ void AsyncWriter::startWriting()
             FileWriterTask* task = mTasks.pop();
             if(task)
             {
-                processTask(task);
+                {
+                    TRACE_SCOPE("writer", "processTask");
+                    processTask(task);
+                }
                 mProcessed++;
                 if(mMaxSize >= 0)
                 {
@@ -155,6 +166,15 @@ void AsyncWriter::stop()
     wake();
 }
 
+QString AsyncWriter::numberedFileName(const QString& fileName, int index)
+{
+    QFileInfo info(fileName);
+    return QStringLiteral("%1/%2_%3.%4").
+            arg(info.path(), info.completeBaseName()).
+            arg(index, 3, 10, QLatin1Char('0')).
+            arg(info.suffix());
+}
+
 void AsyncWriter::clear()
 {
     QMutexLocker lock(&mLock);
@@ -183,14 +203,17 @@ void AsyncFileWriter::processTask(FileWriterTask* task)
     if(!dir.exists())
     {
         if(!dir.mkpath(path))
+        {
+            mFailed++;
             return;
+        }
     }
 
     QFile f(task->fileName);
-    if(f.open(QFile::WriteOnly))
+    if(!f.open(QFile::WriteOnly) || f.write((char*)task->data, task->size) != qint64(task->size))
     {
-        f.write((char*)task->data, task->size);
-        f.close();
+        qDebug("Cannot write %s", qPrintable(task->fileName));
+        mFailed++;
     }
 }
 
@@ -206,7 +229,8 @@ AsyncMJPEGWriter::AsyncMJPEGWriter(int size, QObject *parent):
     start();
 }
 
-bool AsyncMJPEGWriter::open(int width, int height, int fps, fastJpegFormat_t fmt, const QString& outFileName)
+bool AsyncMJPEGWriter::open(int width, int height, int fps, fastJpegFormat_t fmt, const QString& outFileName,
+                            int flushIntervalMs)
 {
     if(!QFileInfo::exists(QFileInfo(outFileName).path()))
         return false;
@@ -214,11 +238,44 @@ bool AsyncMJPEGWriter::open(int width, int height, int fps, fastJpegFormat_t fmt
     if(mEncoderPtr)
         mEncoderPtr->close();
 
-    mEncoderPtr.reset(new MJPEGEncoder(width, height, fps, fmt, outFileName));
+    mWidth = width;
+    mHeight = height;
+    mFps = fps;
+    mFormat = fmt;
+    mFlushIntervalMs = flushIntervalMs;
+    mFileName = outFileName;
+    mFileIndex = 0;
+    mRolloverRetry.invalidate();
+
+    mEncoderPtr.reset(new MJPEGEncoder(width, height, fps, fmt, outFileName, flushIntervalMs));
     return mEncoderPtr->isOpened();
 
 }
 
+void AsyncMJPEGWriter::setRollover(qint64 maxBytes, int maxDurationSec)
+{
+    mMaxBytes = qMax<qint64>(0, maxBytes);
+    mMaxDurationUs = qint64(qMax(0, maxDurationSec)) * 1000000;
+}
+
+void AsyncMJPEGWriter::rollover()
+{
+    const QString fileName = numberedFileName(mFileName, mFileIndex + 1);
+    QScopedPointer<MJPEGEncoder> next(new MJPEGEncoder(mWidth, mHeight, mFps, mFormat, fileName, mFlushIntervalMs));
+    if(!next->isOpened())
+    {
+        //Frames keep going to the current file, the limit is exceeded rather than frames lost
+        qDebug("Cannot open next recording file %s, retrying in %d ms", qPrintable(fileName), rolloverRetryMs);
+        mRolloverRetry.start();
+        return;
+    }
+
+    mFileIndex++;
+    mRolloverRetry.invalidate();
+    mEncoderPtr->close();
+    mEncoderPtr.swap(next);
+}
+
 void AsyncMJPEGWriter::close()
 {
     if(!mEncoderPtr)
@@ -232,8 +289,183 @@ void AsyncMJPEGWriter::processTask(FileWriterTask* task)
     if(task == nullptr)
         return;
 
-    if(!mEncoderPtr)
+    if(!mEncoderPtr || !mEncoderPtr->isOpened())
+    {
+        mFailed++;
         return;
+    }
+
+    //Next file is opened on this thread, new frames wait in the queue meanwhile
+    if(((mMaxBytes > 0 && mEncoderPtr->bytesWritten() + task->size > mMaxBytes) ||
+        (mMaxDurationUs > 0 && mEncoderPtr->durationUs() >= mMaxDurationUs)) &&
+       (!mRolloverRetry.isValid() || mRolloverRetry.hasExpired(rolloverRetryMs)))
+        rollover();
+
+    if(!mEncoderPtr->addJPEGFrame(task->data, int(task->size), qint64(task->meta.hostTimestampUs)))
+        mFailed++;
+}
 
-    mEncoderPtr->addJPEGFrame(task->data, int(task->size));
+
+AsyncRawWriter::AsyncRawWriter(int size, QObject *parent):
+    AsyncWriter(size, parent)
+{
+    mMaxSize = size;
+    mWorkThread.setObjectName(QStringLiteral("Raw Writer Thread"));
+    moveToThread(&mWorkThread);
+
+    mWorkThread.start();
+    start();
+}
+
+bool AsyncRawWriter::open(unsigned width, unsigned height, unsigned bytesPerSample,
+                          unsigned bitDepth, unsigned bayerPattern, const QString& outFileName)
+{
+    if(!QFileInfo::exists(QFileInfo(outFileName).path()))
+        return false;
+
+    mWidth = width;
+    mHeight = height;
+    mBytesPerSample = bytesPerSample;
+    mBitDepth = bitDepth;
+    mBayerPattern = bayerPattern;
+    mFileName = outFileName;
+    mFileIndex = 0;
+    mRawBytes = 0;
+    mEncodedBytes = 0;
+    mRolloverRetry.invalidate();
+    mEncoded.resize(RawCodec::maxEncodedSize(width, height, bytesPerSample));
+
+    QMutexLocker l(&mSequenceLock);
+    return mSequence->open(outFileName, width, height, bitDepth, bayerPattern);
+}
+
+void AsyncRawWriter::setRollover(qint64 maxBytes, int maxDurationSec)
+{
+    mMaxBytes = qMax<qint64>(0, maxBytes);
+    mMaxDurationUs = qint64(qMax(0, maxDurationSec)) * 1000000;
+}
+
+double AsyncRawWriter::compressionRatio() const
+{
+    return mEncodedBytes > 0 ? double(mRawBytes) / double(mEncodedBytes) : 0.;
+}
+
+bool AsyncRawWriter::canRollover() const
+{
+    return !mRolloverRetry.isValid() || mRolloverRetry.hasExpired(rolloverRetryMs);
+}
+
+void AsyncRawWriter::rollover(unsigned width, unsigned height)
+{
+    const QString fileName = numberedFileName(mFileName, mFileIndex + 1);
+    QScopedPointer<RawSequenceWriter> next(new RawSequenceWriter());
+    if(!next->open(fileName, width, height, mBitDepth, mBayerPattern))
+    {
+        //Frames keep going to the current file, the limit is exceeded rather than frames lost
+        qDebug("Cannot open next recording file %s, retrying in %d ms", qPrintable(fileName), rolloverRetryMs);
+        mRolloverRetry.start();
+        return;
+    }
+
+    mFileIndex++;
+    mRolloverRetry.invalidate();
+    mSequence->close();
+    mSequence.swap(next);
+    if(width != mWidth || height != mHeight)
+    {
+        mWidth = width;
+        mHeight = height;
+        mEncoded.resize(RawCodec::maxEncodedSize(width, height, mBytesPerSample));
+    }
+}
+
+void AsyncRawWriter::close()
+{
+    //Called from the processing thread while a frame may be written
+    QMutexLocker l(&mSequenceLock);
+    mSequence->close();
+}
+
+void AsyncRawWriter::processTask(FileWriterTask* task)
+{
+    if(task == nullptr || task->height == 0)
+        return;
+
+    //A sequence file holds frames of one size, ROI or binning changes start the next file
+    if(task->width != mWidth || task->height != mHeight)
+    {
+        QMutexLocker l(&mSequenceLock);
+        if(mSequence->isOpened() && canRollover())
+            rollover(task->width, task->height);
+    }
+    if(task->width != mWidth || task->height != mHeight)
+    {
+        mFailed++;
+        return;
+    }
+
+    size_t size = mCodec.encode(task->data, mWidth, mHeight, task->pitch, mBytesPerSample,
+                                mEncoded.data(), mEncoded.size());
+    if(size == 0)
+    {
+        mFailed++;
+        return;
+    }
+
+    QMutexLocker l(&mSequenceLock);
+    if(!mSequence->isOpened())
+    {
+        mFailed++;
+        return;
+    }
+
+    if(((mMaxBytes > 0 && mSequence->bytesWritten() + qint64(size) > mMaxBytes) ||
+        (mMaxDurationUs > 0 && mSequence->durationUs() >= mMaxDurationUs)) && canRollover())
+        rollover(mWidth, mHeight);
+
+    if(mSequence->addFrame(mEncoded.data(), unsigned(size), task->meta))
+    {
+        mRawBytes += qint64(mWidth) * mHeight * mBytesPerSample;
+        mEncodedBytes += qint64(size);
+    }
+    else
+        mFailed++;
+}
+
+
+AsyncDngWriter::AsyncDngWriter(int size, QObject *parent):
+    AsyncWriter(size, parent)
+{
+    mMaxSize = size;
+    mWorkThread.setObjectName(QStringLiteral("DNG Writer Thread"));
+    moveToThread(&mWorkThread);
+
+    mWorkThread.start();
+    start();
+}
+
+void AsyncDngWriter::setParams(const DngWriter::Params& params)
+{
+    mDng.setParams(params);
+}
+
+void AsyncDngWriter::processTask(FileWriterTask* task)
+{
+    if(task == nullptr || task->height == 0)
+        return;
+
+    //Every file has its own size, ROI or binning may change between frames
+    if(task->width != mDng.params().width || task->height != mDng.params().height)
+    {
+        DngWriter::Params params = mDng.params();
+        params.width = task->width;
+        params.height = task->height;
+        mDng.setParams(params);
+    }
+
+    if(!mDng.write(task->fileName, task->data, task->pitch, task->meta))
+    {
+        qDebug("Cannot write %s", qPrintable(task->fileName));
+        mFailed++;
+    }
 }
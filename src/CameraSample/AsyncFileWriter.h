@@ -33,10 +33,15 @@
 #include <QWaitCondition>
 #include <QMutex>
 #include <QThread>
+#include <QElapsedTimer>
 
 #include "AsyncQueue.h"
 #include "FastAllocator.h"
 #include "MJPEGEncoder.h"
+#include "RawCodec.h"
+#include "RawSequence.h"
+#include "DngWriter.h"
+#include "FrameMetadata.h"
 #include <memory>
 
 
@@ -45,6 +50,11 @@ struct FileWriterTask
     unsigned char* data;
     unsigned int size{};
     QString fileName;
+    FrameMetadata meta;
+    ///Raw and DNG writers: frame geometry, it changes with ROI and binning
+    unsigned width{};
+    unsigned height{};
+    unsigned pitch{};
 };
 
 class AsyncWriter : public QObject
@@ -64,8 +74,11 @@ public:
     void waitFinish();
     void setMaxSize(int sz);
     int  queueSize(){return mTasks.count();}
+    int  maxQueueSize() const {return int(maxQueuSize);}
     int  getProcessedFrames(){return mProcessed;}
     int  getDroppedFrames(){return mDropped;}
+    ///Frames taken from the queue but not written, e.g. no file could be opened
+    int  getFailedFrames(){return mFailed;}
     unsigned bufferSize() {return mBufferSize;}
 
 signals:
@@ -77,6 +90,8 @@ protected:
     virtual void processTask(FileWriterTask* task) = 0;
 
     void startWriting();
+    ///name_001.ext for index 1 of name.ext
+    static QString numberedFileName(const QString& fileName, int index);
 
     bool mCancel {false};
     bool mWriting {false};
@@ -94,6 +109,7 @@ protected:
     int mMaxSize = -1;
     int mProcessed = 0;
     int mDropped = 0;
+    int mFailed = 0;
 
     const uint maxQueuSize = 32;
 };
@@ -115,13 +131,102 @@ class AsyncMJPEGWriter : public AsyncWriter
     Q_OBJECT
 public:
     explicit AsyncMJPEGWriter(int size = -1, QObject *parent = nullptr);
-    bool open(int width, int height, int fps, fastJpegFormat_t fmt, const QString& outFileName);
+    bool open(int width, int height, int fps, fastJpegFormat_t fmt, const QString& outFileName,
+              int flushIntervalMs = 1000);
     void close();
+    ///Continue in name_001.ext, name_002.ext... when the file reaches maxBytes
+    ///or maxDurationSec of capture time, 0 - no limit
+    void setRollover(qint64 maxBytes, int maxDurationSec);
 
 protected:
     virtual void processTask(FileWriterTask* task);
 
 private:
     QScopedPointer<MJPEGEncoder> mEncoderPtr;
+    int mWidth = 0;
+    int mHeight = 0;
+    int mFps = 25;
+    fastJpegFormat_t mFormat = FAST_JPEG_420;
+    int mFlushIntervalMs = 1000;
+    QString mFileName;
+    int mFileIndex = 0;
+    qint64 mMaxBytes = 0;
+    qint64 mMaxDurationUs = 0;
+    QElapsedTimer mRolloverRetry;
+
+    //The current file goes on growing while the next one cannot be opened
+    static const int rolloverRetryMs = 1000;
+
+    void rollover();
+};
+
+
+///Compresses raw frames with RawCodec on the writer thread and appends
+///them to a raw sequence file. Task data are task->height rows of
+///task->width samples, task->pitch bytes apart. A frame of another size
+///continues in the next file.
+///Encoding is CPU bound (about 15 ns per sample on one core, strips are
+///coded in parallel), full frame rate of large sensors is not sustained on
+///small machines. Frames the writer cannot keep up with are dropped and
+///counted in getDroppedFrames().
+class AsyncRawWriter : public AsyncWriter
+{
+    Q_OBJECT
+public:
+    explicit AsyncRawWriter(int size = -1, QObject *parent = nullptr);
+    bool open(unsigned width, unsigned height, unsigned bytesPerSample,
+              unsigned bitDepth, unsigned bayerPattern, const QString& outFileName);
+    void close();
+    ///Continue in name_001.fvr, name_002.fvr... when the file reaches maxBytes
+    ///or maxDurationSec of capture time, 0 - no limit
+    void setRollover(qint64 maxBytes, int maxDurationSec);
+    ///Raw to encoded bytes of the written frames
+    double compressionRatio() const;
+
+protected:
+    virtual void processTask(FileWriterTask* task);
+
+private:
+    QScopedPointer<RawSequenceWriter> mSequence {new RawSequenceWriter()};
+    QMutex mSequenceLock;
+    RawCodec mCodec;
+    std::vector<unsigned char> mEncoded;
+    unsigned mWidth = 0;
+    unsigned mHeight = 0;
+    unsigned mBytesPerSample = 2;
+    unsigned mBitDepth = 0;
+    unsigned mBayerPattern = 0;
+    QString mFileName;
+    int mFileIndex = 0;
+    qint64 mMaxBytes = 0;
+    qint64 mMaxDurationUs = 0;
+    qint64 mRawBytes = 0;
+    qint64 mEncodedBytes = 0;
+    QElapsedTimer mRolloverRetry;
+
+    //The current file goes on growing while the next one cannot be opened
+    static const int rolloverRetryMs = 1000;
+
+    ///Continue in the next file with frames of width x height
+    void rollover(unsigned width, unsigned height);
+    bool canRollover() const;
+};
+
+
+///Writes raw frames as DNG files, tiles are compressed on the writer
+///thread. Task data are rows of samples as for AsyncRawWriter.
+class AsyncDngWriter : public AsyncWriter
+{
+    Q_OBJECT
+public:
+    explicit AsyncDngWriter(int size = -1, QObject *parent = nullptr);
+    ///Set before frames are queued
+    void setParams(const DngWriter::Params& params);
+
+protected:
+    virtual void processTask(FileWriterTask* task);
+
+private:
+    DngWriter mDng;
 };
 #endif // ASYNCJPEGWRITER_H
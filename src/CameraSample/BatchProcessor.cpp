@@ -0,0 +1,289 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "BatchProcessor.h"
+#include "PipelineManager.h"
+#include "RawProcessor.h"
+#include "SequenceCamera.h"
+#include "AsyncFileWriter.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+
+#include <cuda_runtime.h>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+//Finish when sources are done and nothing was written for that long,
+//frames which failed to load or process never come
+const qint64 kIdleTimeoutMs = 5000;
+
+bool parsePattern(const QString& name, fastBayerPattern_t& pattern, bool& isColor)
+{
+    const QString s = name.toUpper();
+    isColor = true;
+    if(s == QLatin1String("RGGB"))
+        pattern = FAST_BAYER_RGGB;
+    else if(s == QLatin1String("BGGR"))
+        pattern = FAST_BAYER_BGGR;
+    else if(s == QLatin1String("GRBG"))
+        pattern = FAST_BAYER_GRBG;
+    else if(s == QLatin1String("GBRG"))
+        pattern = FAST_BAYER_GBRG;
+    else if(s == QLatin1String("GRAY"))
+    {
+        pattern = FAST_BAYER_NONE;
+        isColor = false;
+    }
+    else
+        return false;
+    return true;
+}
+
+bool parseCodec(const QString& name, CUDAProcessorOptions::VideoCodec& codec)
+{
+    const QString s = name.toLower();
+    if(s == QLatin1String("jpg") || s == QLatin1String("jpeg"))
+        codec = CUDAProcessorOptions::vcJPG;
+    else if(s == QLatin1String("tif") || s == QLatin1String("tiff"))
+        codec = CUDAProcessorOptions::vcTIFF;
+    else if(s == QLatin1String("mjpg"))
+        codec = CUDAProcessorOptions::vcMJPG;
+    else if(s == QLatin1String("dng"))
+        codec = CUDAProcessorOptions::vcDNG;
+    else if(s == QLatin1String("fvr"))
+        codec = CUDAProcessorOptions::vcRAW;
+    else
+        return false;
+    return true;
+}
+}
+
+bool BatchProcessor::run(const Params& params, Result& result)
+{
+    result = Result();
+    if(!QDir().mkpath(params.outputPath))
+    {
+        fprintf(stderr, "Cannot create %s\n", qPrintable(params.outputPath));
+        return false;
+    }
+
+    const int workers = qMax(1, params.workers);
+    int part = 0;
+    auto factory = [&params, &part, workers]() -> GPUCameraBase* {
+        SequenceCamera* camera = new SequenceCamera(params.input, params.pattern, params.isColor);
+        camera->setPlayback(SequenceCamera::pmMaxSpeed, false);
+        camera->setSubset(part++, workers);
+        return camera;
+    };
+
+    PipelineManager pipelines;
+    if(pipelines.open(factory, workers, params.cudaDevices) == 0)
+    {
+        fprintf(stderr, "Cannot read %s\n", qPrintable(params.input));
+        return false;
+    }
+
+    CUDAProcessorOptions opts(params.options);
+    opts.Codec = params.codec;
+    opts.ShowPicture = false;
+
+    //Writing starts before the first frame is read
+    pipelines.start(opts, nullptr, false);
+    QVector<int> active;
+    for(int i = 0; i < pipelines.count(); i++)
+    {
+        const PipelineManager::Pipeline& p = pipelines.pipeline(i);
+        if(!p.camera || !p.processor)
+            continue;
+        p.processor->setNameByFrameId(true);
+        p.processor->setWaitForWriter(true);
+        result.frames += static_cast<SequenceCamera*>(p.camera.data())->frameCount();
+        active.append(i);
+    }
+    if(active.isEmpty())
+    {
+        fprintf(stderr, "Cannot initialize processing\n");
+        return false;
+    }
+    pipelines.startWriting(opts, params.outputPath, params.prefix);
+
+    QElapsedTimer timer;
+    timer.start();
+    for(int i : active)
+        pipelines.pipeline(i).camera->start();
+
+    int processed = -1;
+    qint64 lastChange = 0;
+    qint64 lastReport = 0;
+    while(true)
+    {
+        QCoreApplication::processEvents();
+        QThread::msleep(20);
+
+        //Failed frames are done too, the source does not resend them
+        int count = 0;
+        bool streaming = false;
+        for(int i : active)
+        {
+            const PipelineManager::Pipeline& p = pipelines.pipeline(i);
+            if(p.processor->fileWriter())
+                count += p.processor->fileWriter()->getProcessedFrames();
+            if(p.camera->state() == GPUCameraBase::cstStreaming)
+                streaming = true;
+        }
+
+        const qint64 now = timer.elapsed();
+        if(count != processed)
+        {
+            processed = count;
+            lastChange = now;
+        }
+        if(processed >= result.frames || (!streaming && now - lastChange > kIdleTimeoutMs))
+            break;
+
+        if(now - lastReport >= 1000)
+        {
+            lastReport = now;
+            printf("%d/%d frames, %.1f frames/s\r", processed, result.frames, processed * 1000. / double(qMax<qint64>(now, 1)));
+            fflush(stdout);
+        }
+    }
+
+    pipelines.stopWriting(opts);
+    result.seconds = double(timer.nsecsElapsed()) / 1e9;
+
+    printf("\n");
+    for(int i : active)
+    {
+        const PipelineManager::Pipeline& p = pipelines.pipeline(i);
+        AsyncWriter* writer = p.processor->fileWriter();
+        const int failed = writer ? writer->getFailedFrames() : 0;
+        const int done = writer ? writer->getProcessedFrames() - failed : 0;
+        result.written += done;
+        result.failed += failed;
+        printf("Pipeline %d, CUDA device %d: %d frames, %d failed\n", i, p.cudaDevice, done, failed);
+    }
+    pipelines.close();
+    return result.written > 0 && result.failed == 0;
+}
+
+int BatchProcessor::exec(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Process recorded raw frames without the GUI"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("input"), QStringLiteral("Raw sequence (.fvr), PGM directory or a PGM file of it"));
+
+    QCommandLineOption batchOpt(QStringLiteral("batch"), QStringLiteral("Batch mode"));
+    QCommandLineOption outOpt(QStringList() << QStringLiteral("o") << QStringLiteral("output"),
+                              QStringLiteral("Output directory"), QStringLiteral("dir"));
+    QCommandLineOption formatOpt(QStringLiteral("format"),
+                                 QStringLiteral("jpg, tif, dng (Dng/*), mjpg (Recording/Container) or fvr, default jpg"), QStringLiteral("format"),
+                                 QStringLiteral("jpg"));
+    QCommandLineOption workersOpt(QStringLiteral("workers"), QStringLiteral("Pipelines processing in parallel, default 1"),
+                                  QStringLiteral("count"), QStringLiteral("1"));
+    QCommandLineOption devicesOpt(QStringLiteral("devices"), QStringLiteral("CUDA devices of the pipelines, e.g. 0,1"),
+                                  QStringLiteral("list"));
+    QCommandLineOption bayerOpt(QStringLiteral("bayer"), QStringLiteral("RGGB, BGGR, GRBG, GBRG or gray for PGM input, default RGGB"),
+                                QStringLiteral("pattern"), QStringLiteral("RGGB"));
+    QCommandLineOption qualityOpt(QStringLiteral("quality"), QStringLiteral("JPEG quality, default 90"),
+                                  QStringLiteral("value"), QStringLiteral("90"));
+    QCommandLineOption wbOpt(QStringLiteral("wb"), QStringLiteral("White balance gains r,g,b"), QStringLiteral("gains"));
+    QCommandLineOption evOpt(QStringLiteral("ev"), QStringLiteral("Exposure correction in stops"), QStringLiteral("value"));
+    QCommandLineOption denoiseOpt(QStringLiteral("denoise"), QStringLiteral("Enable wavelet denoise"));
+    QCommandLineOption prefixOpt(QStringLiteral("prefix"), QStringLiteral("Output file prefix, default Frame_"),
+                                 QStringLiteral("prefix"), QStringLiteral("Frame_"));
+    parser.addOptions({batchOpt, outOpt, formatOpt, workersOpt, devicesOpt, bayerOpt,
+                       qualityOpt, wbOpt, evOpt, denoiseOpt, prefixOpt});
+    parser.process(arguments);
+
+    if(parser.positionalArguments().size() != 1 || !parser.isSet(outOpt))
+    {
+        fprintf(stderr, "%s", qPrintable(parser.helpText()));
+        return 1;
+    }
+
+    int devCount = 0;
+    if(cudaGetDeviceCount(&devCount) != cudaSuccess || devCount == 0)
+    {
+        fprintf(stderr, "No CUDA device found\n");
+        return 1;
+    }
+
+    Params params;
+    params.input = QFileInfo(parser.positionalArguments().first()).absoluteFilePath();
+    params.outputPath = QFileInfo(parser.value(outOpt)).absoluteFilePath();
+    params.prefix = parser.value(prefixOpt);
+    params.workers = qMax(1, parser.value(workersOpt).toInt());
+    for(const QString& s : parser.value(devicesOpt).split(QChar(','), QString::SkipEmptyParts))
+    {
+        int dev = s.trimmed().toInt();
+        if(dev >= 0 && dev < devCount)
+            params.cudaDevices.append(dev);
+    }
+    if(!parseCodec(parser.value(formatOpt), params.codec))
+    {
+        fprintf(stderr, "Unknown format %s\n", qPrintable(parser.value(formatOpt)));
+        return 1;
+    }
+    if(!parsePattern(parser.value(bayerOpt), params.pattern, params.isColor))
+    {
+        fprintf(stderr, "Unknown bayer pattern %s\n", qPrintable(parser.value(bayerOpt)));
+        return 1;
+    }
+
+    CUDAProcessorOptions& opts = params.options;
+    opts.JpegQuality = unsigned(qBound(1, parser.value(qualityOpt).toInt(), 100));
+    opts.EnableDenoise = parser.isSet(denoiseOpt);
+    if(parser.isSet(wbOpt))
+    {
+        QStringList gains = parser.value(wbOpt).split(QChar(','));
+        if(gains.size() == 3)
+        {
+            opts.Red = gains[0].toFloat();
+            opts.Green = gains[1].toFloat();
+            opts.Blue = gains[2].toFloat();
+        }
+    }
+    if(parser.isSet(evOpt))
+        opts.eV = float(pow(2., parser.value(evOpt).toDouble()));
+
+    Result result;
+    bool ok = run(params, result);
+    printf("%d of %d frames in %.2f s, %.1f frames/s\n", result.written, result.frames, result.seconds, result.fps());
+    if(result.failed > 0)
+        fprintf(stderr, "%d frames could not be written\n", result.failed);
+    return ok ? 0 : 2;
+}
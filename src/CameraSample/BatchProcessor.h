@@ -0,0 +1,79 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "CUDAProcessorOptions.h"
+
+///Offline re-processing of recorded raw frames without the GUI.
+///A raw sequence (.fvr) or a directory of PGM files is split into
+///contiguous ranges of frames between pipelines (SequenceCamera +
+///RawProcessor, see PipelineManager), each on its own CUDA device from the
+///list. Container outputs (mjpg, fvr) are written one file per pipeline,
+///each holding consecutive frames. Reading, upload, processing and file
+///writing of a pipeline run on separate threads, sources wait for the
+///processing and processing waits for the writer, no frame is dropped.
+class BatchProcessor
+{
+public:
+    struct Params
+    {
+        QString input;
+        QString outputPath;
+        QString prefix = QStringLiteral("Frame_");
+        CUDAProcessorOptions::VideoCodec codec = CUDAProcessorOptions::vcJPG;
+        int workers = 1;
+        QVector<int> cudaDevices;  ///Empty - Pipelines/CudaDevices of the settings
+        fastBayerPattern_t pattern = FAST_BAYER_RGGB;
+        bool isColor = true;
+        CUDAProcessorOptions options;
+    };
+
+    struct Result
+    {
+        int frames = 0;     ///Frames in the input
+        int written = 0;    ///Frames written to the output
+        int failed = 0;     ///Frames processed but not written
+        double seconds = 0;
+        double fps() const {return seconds > 0 ? written / seconds : 0;}
+    };
+
+    ///Process the whole input, false if nothing could be processed or
+    ///any frame failed to be written
+    static bool run(const Params& params, Result& result);
+
+    ///--batch command line mode, return the process exit code
+    static int exec(const QStringList& arguments);
+};
+
+#endif // BATCHPROCESSOR_H
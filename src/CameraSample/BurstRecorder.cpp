@@ -0,0 +1,333 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "BurstRecorder.h"
+#include "SurfaceTraits.hpp"
+#include "ppm.h"
+#include "ThreadPolicy.h"
+
+#include <QTimer>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include <algorithm>
+
+BurstRecorder::BurstRecorder(int preFrames, int postFrames, QObject* parent) :
+    QObject(parent),
+    mPreFrames(qMax(preFrames, 0)),
+    mPostFrames(qMax(postFrames, 0))
+{
+    mThread.setObjectName(QStringLiteral("Burst Writer Thread"));
+    moveToThread(&mThread);
+    connect(&mThread, &QThread::started, [](){ThreadPolicy::apply(AppSettings::trWriter);});
+    mThread.start();
+}
+
+BurstRecorder::~BurstRecorder()
+{
+    {
+        //Post-trigger frames that did not arrive are missing from the burst
+        QMutexLocker l(&mLock);
+        if(mActive && mPostLeft > 0)
+        {
+            mPostLeft = 0;
+            flush();
+        }
+        //The queued write runs on the recorder thread, it quits afterwards
+        while(mActive)
+            mIdle.wait(&mLock);
+    }
+    mThread.quit();
+    mThread.wait();
+    release();
+}
+
+void BurstRecorder::setOutput(const QString& path, const QString& prefix)
+{
+    QMutexLocker l(&mLock);
+    mPath = path;
+    mPrefix = prefix;
+}
+
+void BurstRecorder::setPacking(RawPacking packing)
+{
+    QMutexLocker l(&mLock);
+    mPacking = packing;
+}
+
+bool BurstRecorder::allocate(size_t slotSize)
+{
+    release();
+
+    if(mStream == nullptr)
+    {
+        //Stream and events belong to the device of the processing thread
+        cudaGetDevice(&mDevice);
+        if(cudaStreamCreateWithFlags(&mStream, cudaStreamNonBlocking) != cudaSuccess)
+        {
+            mStream = nullptr;
+            return false;
+        }
+    }
+
+    const int count = mPreFrames + mPostFrames + spareSlots;
+    if(cudaHostAlloc((void**)&mMemory, slotSize * size_t(count), cudaHostAllocPortable) != cudaSuccess)
+    {
+        qDebug() << "Cannot allocate burst ring of" << count << "frames";
+        mMemory = nullptr;
+        return false;
+    }
+
+    mSlots.resize(count);
+    for(int i = 0; i < count; i++)
+    {
+        mSlots[i].data = mMemory + slotSize * size_t(i);
+        cudaEventCreateWithFlags(&mSlots[i].copied, cudaEventDisableTiming);
+    }
+    mSlotSize = slotSize;
+    mHead = 0;
+    return true;
+}
+
+void BurstRecorder::release()
+{
+    if(mStream)
+        cudaStreamSynchronize(mStream);
+
+    for(Slot& s : mSlots)
+    {
+        if(s.copied)
+            cudaEventDestroy(s.copied);
+    }
+    mSlots.clear();
+
+    if(mMemory)
+        cudaFreeHost(mMemory);
+    mMemory = nullptr;
+    mSlotSize = 0;
+}
+
+void BurstRecorder::push(const GPUImage_t* img)
+{
+    if(img == nullptr || !img->data)
+        return;
+
+    const size_t sz = size_t(img->wPitch) * img->h;
+
+    QMutexLocker l(&mLock);
+    //Same frame processed again after an options change
+    if(mSeq > 0 && img->meta.frameId == mLastFrameId)
+        return;
+
+    if(sz > mSlotSize)
+    {
+        //Slots of a burst in progress cannot be moved
+        if(std::any_of(mSlots.begin(), mSlots.end(), [](const Slot& s){return s.busy;}))
+        {
+            mStats.dropped++;
+            return;
+        }
+        if(!allocate(sz))
+            return;
+    }
+
+    int idx = -1;
+    for(int i = 0; i < mSlots.size(); i++)
+    {
+        int n = (mHead + i) % mSlots.size();
+        if(!mSlots[n].busy)
+        {
+            idx = n;
+            break;
+        }
+    }
+    if(idx < 0)
+    {
+        mStats.dropped++;
+        return;
+    }
+    mHead = (idx + 1) % mSlots.size();
+
+    //The camera refills img once the processing thread is done with it,
+    //so the copy has to finish here
+    Slot& s = mSlots[idx];
+    cudaMemcpyAsync(s.data, img->data.get(), sz, cudaMemcpyDeviceToHost, mStream);
+    cudaEventRecord(s.copied, mStream);
+    cudaEventSynchronize(s.copied);
+    s.w = img->w;
+    s.h = img->h;
+    s.pitch = img->wPitch;
+    s.surfaceFmt = img->surfaceFmt;
+    s.packing = mPacking;
+    s.meta = img->meta;
+    s.seq = ++mSeq;
+    mLastFrameId = img->meta.frameId;
+
+    if(mPostLeft > 0)
+    {
+        s.busy = true;
+        mBurst.append(idx);
+        if(--mPostLeft == 0)
+            flush();
+    }
+}
+
+bool BurstRecorder::trigger()
+{
+    QMutexLocker l(&mLock);
+    if(mActive)
+    {
+        mStats.ignored++;
+        return false;
+    }
+
+    //Latest frames before the trigger, oldest first
+    QVector<int> pre;
+    for(int i = 0; i < mSlots.size(); i++)
+    {
+        if(mSlots[i].seq > 0)
+            pre.append(i);
+    }
+    std::sort(pre.begin(), pre.end(), [this](int a, int b){return mSlots[a].seq < mSlots[b].seq;});
+    if(pre.size() > mPreFrames)
+        pre = pre.mid(pre.size() - mPreFrames);
+
+    for(int i : pre)
+        mSlots[i].busy = true;
+
+    mBurst = pre;
+    mPreCount = pre.size();
+    mPostLeft = mPostFrames;
+    mActive = true;
+    if(mPostLeft == 0)
+        flush();
+
+    return true;
+}
+
+void BurstRecorder::flush()
+{
+    const QVector<int> burst = mBurst;
+    const int preCount = mPreCount;
+    const QString dir = QDir::toNativeSeparators(
+                QStringLiteral("%1/%2burst_%3").
+                arg(mPath, mPrefix).
+                arg(QDateTime::currentDateTime().toString(QStringLiteral("dd_MM_yyyy_hh_mm_ss_zzz"))));
+    mBurst.clear();
+
+    QTimer::singleShot(0, this, [this, burst, preCount, dir](){writeBurst(burst, preCount, dir);});
+}
+
+void BurstRecorder::writeBurst(const QVector<int>& burst, int preCount, const QString& dir)
+{
+    //Events were recorded on the device of the processing thread
+    cudaSetDevice(mDevice);
+
+    int written = 0;
+    QDir().mkpath(dir);
+    QVector<uint16_t> unpacked;
+
+    QFile index(QStringLiteral("%1/frames.csv").arg(dir));
+    if(index.open(QFile::WriteOnly))
+        index.write("file,frameId,deviceTimestamp,hostTimestampUs,postTrigger\n");
+
+    for(int i = 0; i < burst.size(); i++)
+    {
+        Slot s;
+        {
+            QMutexLocker l(&mLock);
+            s = mSlots[burst[i]];
+        }
+        cudaEventSynchronize(s.copied);
+
+        //Packed frames hold the camera bit stream with rows back to back
+        const unsigned char* src = s.data;
+        unsigned srcPitch = s.pitch;
+        if(s.packing != rpNone)
+        {
+            unpacked.resize(int(s.w * s.h));
+            if(!unpackRaw(s.packing, s.data, rawPackedRowBytes(s.packing, s.w),
+                          unpacked.data(), s.w * sizeof(uint16_t), s.w, s.h))
+                continue;
+            src = reinterpret_cast<const unsigned char*>(unpacked.constData());
+            srcPitch = s.w * sizeof(uint16_t);
+        }
+
+        //Not 8 bit pgm requires big endian byte order
+        const int bpc = GetBitsPerChannelFromSurface(s.surfaceFmt);
+        const unsigned rowBytes = s.w * (bpc > 8 ? 2 : 1);
+        QByteArray pgm = QStringLiteral("P5\n%1 %2\n%3\n").arg(s.w).arg(s.h).arg((1 << bpc) - 1).toLatin1();
+        const int headerSize = pgm.size();
+        pgm.resize(headerSize + int(rowBytes * s.h));
+        unsigned char* dst = (unsigned char*)pgm.data() + headerSize;
+        if(bpc > 8)
+            swapBytes16Rows(dst, rowBytes, src, srcPitch, rowBytes, s.h);
+        else
+        {
+            for(unsigned y = 0; y < s.h; y++)
+                memcpy(dst + y * rowBytes, src + y * srcPitch, rowBytes);
+        }
+
+        const QString fileName = QStringLiteral("frame_%1.pgm").arg(i, 4, 10, QChar('0'));
+        QFile f(QStringLiteral("%1/%2").arg(dir, fileName));
+        if(f.open(QFile::WriteOnly) && f.write(pgm) == pgm.size())
+            written++;
+
+        if(index.isOpen())
+        {
+            index.write(QStringLiteral("%1,%2,%3,%4,%5\n").
+                        arg(fileName).
+                        arg(qulonglong(s.meta.frameId)).
+                        arg(qulonglong(s.meta.deviceTimestamp)).
+                        arg(qlonglong(s.meta.hostTimestampUs)).
+                        arg(i >= preCount ? 1 : 0).toLatin1());
+        }
+    }
+
+    {
+        QMutexLocker l(&mLock);
+        for(int i : burst)
+            mSlots[i].busy = false;
+        mStats.bursts++;
+        mStats.written += uint64_t(written);
+        mActive = false;
+        mIdle.wakeAll();
+    }
+
+    emit burstWritten(dir);
+}
+
+BurstRecorder::Stats BurstRecorder::stats()
+{
+    QMutexLocker l(&mLock);
+    Stats ret = mStats;
+    ret.active = mActive;
+    return ret;
+}
@@ -0,0 +1,130 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef BURSTRECORDER_H
+#define BURSTRECORDER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <cuda_runtime.h>
+
+#include "FrameBuffer.h"
+#include "RawUnpack.h"
+
+///Keeps the latest raw frames in a page-locked host ring. trigger() takes the
+///frames captured before it and the given number of frames after it and
+///writes them as PGM files on the recorder thread. Frames keep entering the
+///ring while a burst is written, slots of the burst are skipped until then.
+class BurstRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        uint64_t bursts = 0;
+        uint64_t written = 0;
+        uint64_t dropped = 0;   ///No free slot in the ring
+        uint64_t ignored = 0;   ///Triggers while the previous burst was in progress
+        bool active = false;
+    };
+
+    BurstRecorder(int preFrames, int postFrames, QObject* parent = nullptr);
+    ///Writes the burst in progress before returning
+    ~BurstRecorder();
+
+    int preFrames() const {return mPreFrames;}
+    int postFrames() const {return mPostFrames;}
+    ///Directory and file prefix of the next burst
+    void setOutput(const QString& path, const QString& prefix);
+    ///Packing of the pushed frames, rpNone if they are unpacked.
+    ///Packed frames are unpacked on the recorder thread before writing.
+    void setPacking(RawPacking packing);
+    ///Copy the frame into the ring, called from the processing thread.
+    ///Returns when the copy is done, img can be reused by the camera then.
+    void push(const GPUImage_t* img);
+    ///Start a burst, the next pushed frame is the first post-trigger one.
+    ///Can be called from any thread, e.g. on a camera line event.
+    bool trigger();
+    Stats stats();
+
+signals:
+    void burstWritten(const QString& dir);
+
+private:
+    struct Slot
+    {
+        unsigned char* data = nullptr;
+        cudaEvent_t copied = nullptr;
+        unsigned w = 0;
+        unsigned h = 0;
+        unsigned pitch = 0;
+        fastSurfaceFormat_t surfaceFmt = FAST_I16;
+        RawPacking packing = rpNone;
+        FrameMetadata meta;
+        uint64_t seq = 0;   ///0 - empty
+        bool busy = false;  ///Part of a burst in progress
+    };
+
+    //Frames that keep arriving while a burst is written
+    static const int spareSlots = 4;
+
+    int mPreFrames = 0;
+    int mPostFrames = 0;
+    QString mPath;
+    QString mPrefix;
+    RawPacking mPacking = rpNone;
+
+    QMutex mLock;
+    QWaitCondition mIdle;   ///A burst is written, mActive is cleared
+    QVector<Slot> mSlots;
+    unsigned char* mMemory = nullptr;
+    size_t mSlotSize = 0;
+    cudaStream_t mStream = nullptr;
+    int mDevice = 0;
+    uint64_t mSeq = 0;
+    uint64_t mLastFrameId = 0;
+    int mHead = 0;
+
+    QVector<int> mBurst;
+    int mPreCount = 0;
+    int mPostLeft = 0;
+    bool mActive = false;
+    Stats mStats;
+
+    QThread mThread;
+
+    bool allocate(size_t slotSize);
+    void release();
+    void flush();
+    void writeBurst(const QVector<int>& burst, int preCount, const QString& dir);
+};
+
+#endif // BURSTRECORDER_H
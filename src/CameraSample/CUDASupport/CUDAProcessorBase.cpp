@@ -56,8 +56,8 @@ CUDAProcessorBase::CUDAProcessorBase(QObject* parent) :
     size_t freeMem  = 0;
     size_t totalMem = 0;
     cudaMemGetInfo(&freeMem, &totalMem);
-    stats.insert(QStringLiteral("totalMem"),  totalMem);
-    stats.insert(QStringLiteral("freeMem"), freeMem);
+    telemetry.setGauge(PipelineTelemetry::gTotalMem, int64_t(totalMem));
+    telemetry.setGauge(PipelineTelemetry::gFreeMem, int64_t(freeMem));
     //    fastTraceCreate("/tmp/CUDAProcessorBase.log");
 }
 
@@ -79,7 +79,7 @@ void CUDAProcessorBase::freeFilters()
         qDebug("CUDAProcessorBase::freeFilters");
 
     Close();
-
+    mGpuTrace.release();
 
     if( hDeviceToDeviceAdapter != nullptr )
     {
@@ -296,7 +296,9 @@ fastStatus_t CUDAProcessorBase::Init(CUDAProcessorOptions &options)
     mLastError = FAST_OK;
     mErrString = QString();
 
-    ret = fastInit(1U << 0, false);
+    //Device memory is allocated on the current device of the calling thread
+    cudaSetDevice(int(options.cudaDevice()));
+    ret = fastInit(1U << options.cudaDevice(), false);
     if(ret != FAST_OK)
         InitFailed("fastInit failed", ret);
 
@@ -316,8 +318,7 @@ fastStatus_t CUDAProcessorBase::Init(CUDAProcessorOptions &options)
         fastEnableInterfaceSynchronization(true);
     }
 
-    stats[QStringLiteral("inputWidth")] = -1;
-    stats[QStringLiteral("inputHeight")] = -1;
+    telemetry.reset();
 
     fastSurfaceFormat_t srcSurfaceFmt  = options.SurfaceFmt;
 
@@ -328,11 +329,14 @@ fastStatus_t CUDAProcessorBase::Init(CUDAProcessorOptions &options)
 
     if(options.Packed)
     {
+        fastRawFormat_t rawFormat = FAST_RAW_XIMEA12;
+        rawPackingGpuFormat(options.Packing, rawFormat);
+
         fastSDIRaw12Import_t p = {false};
         ret = fastRawImportFromDeviceCreate(
                     &hRawUnpacker,
 
-                    FAST_RAW_XIMEA12,
+                    rawFormat,
                     &p,
 
                     maxWidth,
@@ -776,7 +780,7 @@ fastStatus_t CUDAProcessorBase::Init(CUDAProcessorOptions &options)
         hGLBuffer = nullptr;
         return InitFailed("cudaMalloc failed",ret);
     }
-    stats["totalViewportMemory"] = bufferSize;
+    telemetry.setGauge(PipelineTelemetry::gViewportMem, bufferSize);
     cudaMemoryInfo("Created hGLBuffer");
 
     //JPEG Stuff
@@ -965,11 +969,12 @@ fastStatus_t CUDAProcessorBase::Init(CUDAProcessorOptions &options)
     size_t totalMem = 0;
     cudaMemGetInfo(&freeMem, &totalMem);
 
-    stats[QStringLiteral("totalMem")] = totalMem;
-    stats[QStringLiteral("freeMem")] = freeMem;
-    stats[QStringLiteral("allocatedMem")] = requestedMemSpace;
+    telemetry.setGauge(PipelineTelemetry::gTotalMem, int64_t(totalMem));
+    telemetry.setGauge(PipelineTelemetry::gFreeMem, int64_t(freeMem));
+    telemetry.setGauge(PipelineTelemetry::gAllocatedMem, int64_t(requestedMemSpace));
 
     emit initialized(QString());
+    mInitOptions = options;
     mInitialised = true;
 
     mut.unlock();
@@ -977,6 +982,29 @@ fastStatus_t CUDAProcessorBase::Init(CUDAProcessorOptions &options)
     return FAST_OK;
 }
 
+bool CUDAProcessorBase::needsInit(const CUDAProcessorOptions& options) const
+{
+    if(!mInitialised)
+        return true;
+
+    const CUDAProcessorOptions& init = mInitOptions;
+    if(options.MaxWidth > init.MaxWidth || options.MaxHeight > init.MaxHeight)
+        return true;
+
+    //Baked into filter handles and device buffers
+    if(options.SurfaceFmt != init.SurfaceFmt ||
+       options.Packed != init.Packed ||
+       options.Packing != init.Packing ||
+       options.cudaDevice() != init.cudaDevice() ||
+       options.BayerType != init.BayerType ||
+       options.MatrixA != init.MatrixA ||
+       options.MatrixB != init.MatrixB)
+        return true;
+
+    return hDenoise != nullptr &&
+           memcmp(&options.DenoiseStaticParams, &init.DenoiseStaticParams, sizeof(fastDenoiseStaticParameters_t)) != 0;
+}
+
 fastStatus_t CUDAProcessorBase::InitFailed(const char *errStr, fastStatus_t ret)
 {
     mErrString = errStr;
@@ -1020,55 +1048,46 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
     }
 
     float fullTime = 0.;
-    float elapsedTimeGpu = 0.;
 
     if(!mInitialised)
         return mLastError;
 
+    telemetry.beginFrame();
+    telemetry.setGauge(PipelineTelemetry::gFrameId, int64_t(image->meta.frameId));
+    mGpuTrace.begin(int64_t(image->meta.frameId));
+    TRACE_SCOPE_FRAME("cuda", "Transform", int64_t(image->meta.frameId));
+
     mErrString = QString();
     mLastError = FAST_OK;
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
 
-    stats[QStringLiteral("hHostToDeviceAdapter")] = -1;
-    stats[QStringLiteral("hRawUnpacker")] = -1;
-    stats[QStringLiteral("hSam")] = -1;
-    stats[QStringLiteral("hBpc")] = -1;
-    stats[QStringLiteral("hWhiteBalance")] = -1;
-    stats[QStringLiteral("hDebayer")] = -1;
-    stats[QStringLiteral("hDenoise")] = -1;
-
-    stats[QStringLiteral("hOutLut")] = -1;
-    stats[QStringLiteral("h16to8Transform")] = -1;
-    stats[QStringLiteral("hCrop")] = -1;
-    stats[QStringLiteral("hDeviceToHostAdapter")] = -1;
-    stats[QStringLiteral("hExportToDevice")] = -1;
-    //stats[QStringLiteral("hMjpegEncoder")] = -1;
-    stats[QStringLiteral("totalTime")] = -1;
-    stats[QStringLiteral("totalFps")] = -1;
-    stats[QStringLiteral("totalGPUTime")] = -1;
-    stats[QStringLiteral("totalGPUCPUTime")] = -1;
 
     fastStatus_t ret = FAST_OK;
     unsigned imgWidth  = image->w;
     unsigned imgHeight = image->h;
 
-    if(imgWidth > opts.MaxWidth || imgHeight > opts.MaxHeight )
-        return TransformFailed("Unsupported image size",FAST_INVALID_FORMAT,profileTimer);
+    //Filters take any frame size up to the one they were created for
+    if(imgWidth > mInitOptions.MaxWidth || imgHeight > mInitOptions.MaxHeight )
+        return TransformFailed("Unsupported image size",FAST_INVALID_FORMAT,profileTimer,PipelineTelemetry::stHostToDevice);
 
-    stats[QStringLiteral("inputWidth")] = imgWidth;
-    stats[QStringLiteral("inputHeight")] = imgHeight;
+    //Encoder is created for the maximum size only, the sampling is per frame
+    jfifInfo.restartInterval = opts.JpegRestartInterval;
+    jfifInfo.jpegFmt = opts.JpegSamplingFmt;
+
+    telemetry.setGauge(PipelineTelemetry::gInputWidth, imgWidth);
+    telemetry.setGauge(PipelineTelemetry::gInputHeight, imgHeight);
 
     QElapsedTimer cpuTimer;
     cpuTimer.start();
 
     if(info)
         fastGpuTimerStart(profileTimer);
-    QString key;
+    PipelineTelemetry::Stage stage = PipelineTelemetry::stHostToDevice;
     if(hDeviceToDeviceAdapter != nullptr)
     {
-        key = QStringLiteral("hHostToDeviceAdapter");
+        stage = PipelineTelemetry::stHostToDevice;
         ret = fastImportFromDeviceCopy(
                     hDeviceToDeviceAdapter,
 
@@ -1079,11 +1098,11 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("fastImportFromHostCopy failed", ret, profileTimer);
+            return TransformFailed("fastImportFromHostCopy failed", ret, profileTimer, PipelineTelemetry::stHostToDevice);
     }
     else if(hRawUnpacker != nullptr)
     {
-        key = QStringLiteral("hRawUnpacker");
+        stage = PipelineTelemetry::stRawUnpacker;
         ret = fastRawImportFromDeviceDecode(
                     hRawUnpacker,
 
@@ -1094,17 +1113,10 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("fastRawUnpackerDecode failed", ret, profileTimer);
+            return TransformFailed("fastRawUnpackerDecode failed", ret, profileTimer, PipelineTelemetry::stRawUnpacker);
     }
 
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-        fullTime += elapsedTimeGpu;
-        stats[key] = elapsedTimeGpu;
-    }
+    recordStage(stage, profileTimer, &fullTime);
 
     if(hSam && hSamMux)
     {
@@ -1140,22 +1152,14 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                             );
             }
             if(ret != FAST_OK && info)
-                return TransformFailed("fastImageFiltersTransform for SAM failed",ret,profileTimer);
-
-            if(info)
-            {
-                fastGpuTimerStop(profileTimer);
-                fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
+                return TransformFailed("fastImageFiltersTransform for SAM failed",ret,profileTimer,PipelineTelemetry::stSAM);
 
-                fullTime += elapsedTimeGpu;
-                stats[QStringLiteral("hSAM")] = elapsedTimeGpu;
-            }
+            recordStage(PipelineTelemetry::stSAM, profileTimer, &fullTime);
 
             fastMuxSelect(hSamMux, 1);
         }
         else
         {
-            stats[QStringLiteral("hSAM")] = -1;
             fastMuxSelect(hSamMux, 0);
         }
     }
@@ -1228,16 +1232,9 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                         );
         }
         if(ret != FAST_OK && info)
-            return TransformFailed("fastImageFiltersTransform for Linearization Lut failed",ret,profileTimer);
-
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
+            return TransformFailed("fastImageFiltersTransform for Linearization Lut failed",ret,profileTimer,PipelineTelemetry::stLinearizationLut);
 
-            stats[QStringLiteral("hLinearizationLut")] = elapsedTimeGpu;
-            fullTime += elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stLinearizationLut, profileTimer, &fullTime);
     }
 
     //White balance
@@ -1263,15 +1260,9 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK && info)
-            return TransformFailed("fastImageFiltersTransform for white balance failed",ret,profileTimer);
+            return TransformFailed("fastImageFiltersTransform for white balance failed",ret,profileTimer,PipelineTelemetry::stWhiteBalance);
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("hWhiteBalance")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stWhiteBalance, profileTimer, &fullTime);
     }
 
     if(hBpc && hBpcMux)
@@ -1294,22 +1285,14 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                         );
 
             if(ret != FAST_OK && info)
-                return TransformFailed("fastImageFiltersTransform for BPC failed", ret, profileTimer);
+                return TransformFailed("fastImageFiltersTransform for BPC failed", ret, profileTimer, PipelineTelemetry::stBPC);
 
-            if(info)
-            {
-                fastGpuTimerStop(profileTimer);
-                fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-                fullTime += elapsedTimeGpu;
-                stats[QStringLiteral("hBpc")] = elapsedTimeGpu;
-            }
+            recordStage(PipelineTelemetry::stBPC, profileTimer, &fullTime);
 
             fastMuxSelect(hBpcMux, 1);
         }
         else
         {
-            stats[QStringLiteral("hBpc")] = -1;
             fastMuxSelect(hBpcMux, 0);
         }
     }
@@ -1331,17 +1314,10 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                     ) );
     }
 
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-        fullTime += elapsedTimeGpu;
-        stats[QStringLiteral("hDebayer")] = elapsedTimeGpu;
-    }
+    recordStage(PipelineTelemetry::stDebayer, profileTimer, &fullTime);
 
     if(ret != FAST_OK && info)
-        return TransformFailed("fastDebayerTransform failed",ret,profileTimer);
+        return TransformFailed("fastDebayerTransform failed",ret,profileTimer,PipelineTelemetry::stDebayer);
 
     //Denoise
     if(hDenoise && hDenoiseMux)
@@ -1361,22 +1337,14 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                         imgHeight
                         );
             if(ret != FAST_OK && info)
-                return TransformFailed("fastDenoiseTransform failed",ret,profileTimer);
+                return TransformFailed("fastDenoiseTransform failed",ret,profileTimer,PipelineTelemetry::stDenoise);
 
             fastMuxSelect(hDenoiseMux, 1);
 
-            if(info)
-            {
-                fastGpuTimerStop(profileTimer);
-                fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-                fullTime += elapsedTimeGpu;
-                stats[QStringLiteral("hDenoise")] = elapsedTimeGpu;
-            }
+            recordStage(PipelineTelemetry::stDenoise, profileTimer, &fullTime);
         }
         else
         {
-            stats[QStringLiteral("hDenoise")] = -1;
             fastMuxSelect(hDenoiseMux, 0);
         }
     }
@@ -1397,16 +1365,9 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("fastImageFiltersTransform for output Lut failed",ret,profileTimer);
+            return TransformFailed("fastImageFiltersTransform for output Lut failed",ret,profileTimer,PipelineTelemetry::stOutLut);
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("hOutLut")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stOutLut, profileTimer, &fullTime);
     }
 
     //16-bit to 8 bit transform
@@ -1427,16 +1388,9 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("h16to8Transform transform failed",ret,profileTimer);
+            return TransformFailed("h16to8Transform transform failed",ret,profileTimer,PipelineTelemetry::st16to8Transform);
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("h16to8Transform")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::st16to8Transform, profileTimer, &fullTime);
     }
 
     if(hExportToDevice)
@@ -1461,23 +1415,18 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
             qDebug("fastExportToDeviceCopy failed, ret = %d", ret);
 
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("hExportToDevice")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stExportToDevice, profileTimer, &fullTime);
     }
 
     if(info)
     {
         cudaDeviceSynchronize();
         float mcs = float(cpuTimer.nsecsElapsed()) / 1000000.f;
-        stats[QStringLiteral("totalGPUCPUTime")] = mcs;
-        stats[QStringLiteral("totalGPUTime")] = fullTime;
+        telemetry.record(PipelineTelemetry::stTotalGPUCPU, mcs);
+        telemetry.record(PipelineTelemetry::stTotalGPU, fullTime);
     }
+    else
+        telemetry.record(PipelineTelemetry::stTotalGPU);
 
     if(profileTimer)
     {
@@ -1488,18 +1437,20 @@ fastStatus_t CUDAProcessorBase::Transform(GPUImage_t *image, CUDAProcessorOption
     locker.unlock();
 
     // to minimize delay in main thread
-    mut2.lock();
-    stats2 = stats;
-    mut2.unlock();
 
     emit finished();
     return FAST_OK;
 }
 
-fastStatus_t CUDAProcessorBase::TransformFailed(const char *errStr, fastStatus_t ret, fastGpuTimerHandle_t profileTimer)
+fastStatus_t CUDAProcessorBase::TransformFailed(const char *errStr, fastStatus_t ret, fastGpuTimerHandle_t profileTimer,
+                                                PipelineTelemetry::Stage stage)
 {
     mLastError = ret;
     mErrString = errStr;
+    telemetry.drop(stage);
+    //Stages of Transform() lose the whole frame, export failures only that output
+    if(stage <= PipelineTelemetry::stExportToDevice)
+        telemetry.drop(PipelineTelemetry::stTotalGPU);
     if(profileTimer)
     {
         fastGpuTimerDestroy(profileTimer);
@@ -1509,6 +1460,35 @@ fastStatus_t CUDAProcessorBase::TransformFailed(const char *errStr, fastStatus_t
     return ret;
 }
 
+void CUDAProcessorBase::recordStage(PipelineTelemetry::Stage stage, fastGpuTimerHandle_t profileTimer, float* fullTime)
+{
+    mGpuTrace.mark(PipelineTelemetry::stageName(stage));
+
+    if(profileTimer == nullptr)
+    {
+        telemetry.record(stage);
+        return;
+    }
+
+    float elapsedTimeGpu = 0.;
+    fastGpuTimerStop(profileTimer);
+    fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
+    if(fullTime)
+        *fullTime += elapsedTimeGpu;
+    telemetry.record(stage, elapsedTimeGpu);
+}
+
+void CUDAProcessorBase::recordDeviceToHost(const QElapsedTimer& timer, fastStatus_t ret)
+{
+    //Host exports are synchronous, wall time covers the transfer
+    if(ret != FAST_OK)
+    {
+        telemetry.drop(PipelineTelemetry::stDeviceToHost);
+        return;
+    }
+    telemetry.record(PipelineTelemetry::stDeviceToHost, float(timer.nsecsElapsed()) / 1000000.f);
+}
+
 fastStatus_t CUDAProcessorBase::Close()
 {
     QMutexLocker locker(&mut);
@@ -1517,8 +1497,8 @@ fastStatus_t CUDAProcessorBase::Close()
     size_t totalMem = 0;
     cudaMemGetInfo(&freeMem, &totalMem);
 
-    stats[QStringLiteral("totalMem")] = totalMem;
-    stats[QStringLiteral("freeMem")] = freeMem;
+    telemetry.setGauge(PipelineTelemetry::gTotalMem, int64_t(totalMem));
+    telemetry.setGauge(PipelineTelemetry::gFreeMem, int64_t(freeMem));
 
     return FAST_OK;
 }
@@ -1541,6 +1521,8 @@ fastStatus_t CUDAProcessorBase::exportRawData(void* dstPtr, unsigned int &w, uns
     p.convert = FAST_CONVERT_NONE;
     fastStatus_t ret = FAST_OK;
 
+    QElapsedTimer downloadTimer;
+    downloadTimer.start();
     ret = (fastExportToHostCopy(
                hDeviceToHostRawAdapter,
                dstPtr,
@@ -1549,6 +1531,7 @@ fastStatus_t CUDAProcessorBase::exportRawData(void* dstPtr, unsigned int &w, uns
                bufferInfo.height,
                &p
                ) );
+    recordDeviceToHost(downloadTimer, ret);
 
     if(ret != FAST_OK)
     {
@@ -1576,6 +1559,8 @@ fastStatus_t CUDAProcessorBase::exportLinearizedRaw(void* dstPtr, unsigned int&
     fastExportParameters_t p;
     p.convert = FAST_CONVERT_NONE;
 
+    QElapsedTimer downloadTimer;
+    downloadTimer.start();
     fastStatus_t ret = ( fastExportToHostCopy(
                              hDeviceToHostLinRawAdapter,
                              dstPtr,
@@ -1584,6 +1569,7 @@ fastStatus_t CUDAProcessorBase::exportLinearizedRaw(void* dstPtr, unsigned int&
                              bufferInfo.height,
                              &p
                              ) );
+    recordDeviceToHost(downloadTimer, ret);
 
     if(ret != FAST_OK)
     {
@@ -1616,6 +1602,8 @@ fastStatus_t  CUDAProcessorBase::export16bitData(void* dstPtr, unsigned int &w,
     p.convert = FAST_CONVERT_NONE;
     fastStatus_t ret = FAST_OK;
 
+    QElapsedTimer downloadTimer;
+    downloadTimer.start();
     ret = (fastExportToHostCopy(
                hDeviceToHost16Adapter,
                dstPtr,
@@ -1624,6 +1612,7 @@ fastStatus_t  CUDAProcessorBase::export16bitData(void* dstPtr, unsigned int &w,
                bufferInfo.height,
                &p
                ) );
+    recordDeviceToHost(downloadTimer, ret);
 
     if(ret != FAST_OK)
     {
@@ -1637,7 +1626,6 @@ fastStatus_t  CUDAProcessorBase::export16bitData(void* dstPtr, unsigned int &w,
 
 fastStatus_t CUDAProcessorBase::exportJPEGData(void* dstPtr, unsigned jpegQuality, unsigned& size)
 {
-    stats[QStringLiteral("hMjpegEncoder")] = -1;
 
     if(!mInitialised || hJpegEncoder == nullptr)
     {
@@ -1646,7 +1634,9 @@ fastStatus_t CUDAProcessorBase::exportJPEGData(void* dstPtr, unsigned jpegQualit
     }
 
     fastStatus_t ret = FAST_OK;
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportJPEGData");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1668,23 +1658,24 @@ fastStatus_t CUDAProcessorBase::exportJPEGData(void* dstPtr, unsigned jpegQualit
                 &jfifInfo
                 );
     if(ret != FAST_OK)
-        return TransformFailed("fastJpegEncode failed", ret, profileTimer);
-
-    ret = fastJfifStoreToMemory(reinterpret_cast<unsigned char*>(dstPtr), &size, &jfifInfo);
-    if(ret != FAST_OK)
-        return TransformFailed("fastJpegEncode failed", ret, profileTimer);
+        return TransformFailed("fastJpegEncode failed", ret, profileTimer, PipelineTelemetry::stJpegEncoder);
 
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("hMjpegEncoder")] = elapsedTimeGpu;
-    }
-    else
     {
-        stats[QStringLiteral("hMjpegEncoder")] = -1;
+        //Frames differ in the entropy coded data only, the header is cached
+        const std::vector<unsigned char>& header = jpegHeader(jpegQuality);
+        if(header.empty())
+            return TransformFailed("fastJfifHeaderStoreToMemory failed", FAST_INTERNAL_ERROR, profileTimer, PipelineTelemetry::stJpegEncoder);
+        if(header.size() + jfifInfo.bytestreamSize > size)
+            return TransformFailed("JPEG output buffer is too small", FAST_INSUFFICIENT_HOST_MEMORY, profileTimer, PipelineTelemetry::stJpegEncoder);
+
+        auto* dst = reinterpret_cast<unsigned char*>(dstPtr);
+        memcpy(dst, header.data(), header.size());
+        memcpy(dst + header.size(), jfifInfo.h_Bytestream, jfifInfo.bytestreamSize);
+        size = unsigned(header.size()) + jfifInfo.bytestreamSize;
     }
 
+    recordStage(PipelineTelemetry::stJpegEncoder, profileTimer);
+
     if(profileTimer)
     {
         fastGpuTimerDestroy(profileTimer);
@@ -1702,7 +1693,9 @@ fastStatus_t CUDAProcessorBase::exportNV12Data(void *dstPtr)
 
     fastStatus_t ret;
 
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportNV12Data");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1720,19 +1713,10 @@ fastStatus_t CUDAProcessorBase::exportNV12Data(void *dstPtr)
     ret = fastSDIExportToHostCopy(hSdiExportToHost, dstPtr, &width, &height);
 
     if(ret != FAST_OK){
-        return TransformFailed("fastExportToHostCopy failed", ret, profileTimer);
+        return TransformFailed("fastExportToHostCopy failed", ret, profileTimer, PipelineTelemetry::stExportNV12);
     }
 
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("fastSDIExportToHostCopy")] = elapsedTimeGpu;
-    }
-    else
-    {
-        stats[QStringLiteral("fastSDIExportToHostCopy")] = -1;
-    }
+    recordStage(PipelineTelemetry::stExportNV12, profileTimer);
 
     if(profileTimer)
     {
@@ -1751,7 +1735,9 @@ fastStatus_t CUDAProcessorBase::exportP010Data(void *dstPtr)
 
     fastStatus_t ret;
 
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportP010Data");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1769,19 +1755,10 @@ fastStatus_t CUDAProcessorBase::exportP010Data(void *dstPtr)
     ret = fastSDIExportToHostCopy3(hSdiExportToHost10bit, &d[0], &d[1], &d[2]);
 
     if(ret != FAST_OK){
-        return TransformFailed("fastExportToHostCopy P010 failed", ret, profileTimer);
+        return TransformFailed("fastExportToHostCopy P010 failed", ret, profileTimer, PipelineTelemetry::stExportP010);
     }
 
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("fastSDIExportToHostCopyP010")] = elapsedTimeGpu;
-    }
-    else
-    {
-        stats[QStringLiteral("fastSDIExportToHostCopyP010")] = -1;
-    }
+    recordStage(PipelineTelemetry::stExportP010, profileTimer);
 
     if(profileTimer)
     {
@@ -1800,7 +1777,9 @@ fastStatus_t CUDAProcessorBase::exportYuv8Data(void *dstPtr)
 
     fastStatus_t ret;
 
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportYuv8Data");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1818,20 +1797,11 @@ fastStatus_t CUDAProcessorBase::exportYuv8Data(void *dstPtr)
     ret = fastSDIExportToHostCopy3(hSdiExportToHostYuv8bit, &d[0], &d[1], &d[2]);
 
     if(ret != FAST_OK){
-        return TransformFailed("fastSDIExportToHostCopy3 Yuv failed", ret, profileTimer);
+        return TransformFailed("fastSDIExportToHostCopy3 Yuv failed", ret, profileTimer, PipelineTelemetry::stExportYuv8);
     }
 
     cudaDeviceSynchronize();
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("exportYuv8DataHost")] = elapsedTimeGpu;
-    }
-    else
-    {
-        stats[QStringLiteral("exportYuv8DataHost")] = -1;
-    }
+    recordStage(PipelineTelemetry::stExportYuv8, profileTimer);
 
     if(profileTimer)
     {
@@ -1850,7 +1820,9 @@ fastStatus_t CUDAProcessorBase::exportNV12DataDevice(void *dstPtr)
 
     fastStatus_t ret;
 
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportNV12DataDevice");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1868,20 +1840,11 @@ fastStatus_t CUDAProcessorBase::exportNV12DataDevice(void *dstPtr)
     ret = fastSDIExportToDeviceCopy3(hSdiExportToDevice, &d[0], &d[1], &d[2]);
 
     if(ret != FAST_OK){
-        return TransformFailed("fastExportToHostDevice failed", ret, profileTimer);
+        return TransformFailed("fastExportToHostDevice failed", ret, profileTimer, PipelineTelemetry::stExportNV12);
     }
 
     cudaDeviceSynchronize();
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("fastSDIExportToDeviceCopy")] = elapsedTimeGpu;
-    }
-    else
-    {
-        stats[QStringLiteral("fastSDIExportToDeviceCopy")] = -1;
-    }
+    recordStage(PipelineTelemetry::stExportNV12, profileTimer);
 
     if(profileTimer)
     {
@@ -1900,7 +1863,9 @@ fastStatus_t CUDAProcessorBase::exportP010DataDevice(void *dstPtr)
 
     fastStatus_t ret;
 
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportP010DataDevice");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1918,20 +1883,11 @@ fastStatus_t CUDAProcessorBase::exportP010DataDevice(void *dstPtr)
     ret = fastSDIExportToDeviceCopy3(hSdiExportToDevice10bit, &d[0], &d[1], &d[2]);
 
     if(ret != FAST_OK){
-        return TransformFailed("fastExportToDeviceCopy P010 failed", ret, profileTimer);
+        return TransformFailed("fastExportToDeviceCopy P010 failed", ret, profileTimer, PipelineTelemetry::stExportP010);
     }
 
     cudaDeviceSynchronize();
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("fastSDIExportToDeviceCopyP010")] = elapsedTimeGpu;
-    }
-    else
-    {
-        stats[QStringLiteral("fastSDIExportToDeviceCopyP010")] = -1;
-    }
+    recordStage(PipelineTelemetry::stExportP010, profileTimer);
 
     if(profileTimer)
     {
@@ -1950,7 +1906,9 @@ fastStatus_t CUDAProcessorBase::exportYuv8DataDevice(void *dstPtr)
 
     fastStatus_t ret;
 
-    float elapsedTimeGpu = 0.;
+    TRACE_SCOPE("cuda", "exportYuv8DataDevice");
+    mGpuTrace.gap();
+
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
@@ -1968,20 +1926,11 @@ fastStatus_t CUDAProcessorBase::exportYuv8DataDevice(void *dstPtr)
     ret = fastSDIExportToDeviceCopy3(hSdiExportToDeviceYuv8bit, &d[0], &d[1], &d[2]);
 
     if(ret != FAST_OK){
-        return TransformFailed("fastExportToDeviceCopy Yuv failed", ret, profileTimer);
+        return TransformFailed("fastExportToDeviceCopy Yuv failed", ret, profileTimer, PipelineTelemetry::stExportYuv8);
     }
 
     cudaDeviceSynchronize();
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-        stats[QStringLiteral("exportYuv8DataDevice")] = elapsedTimeGpu;
-    }
-    else
-    {
-        stats[QStringLiteral("exportYuv8DataDevice")] = -1;
-    }
+    recordStage(PipelineTelemetry::stExportYuv8, profileTimer);
 
     if(profileTimer)
     {
@@ -2004,6 +1953,8 @@ fastStatus_t CUDAProcessorBase::export8bitData(void* dstPtr, bool forceRGB)
     fastExportParameters_t p;
     p.convert = FAST_CONVERT_NONE;
 
+    QElapsedTimer downloadTimer;
+    downloadTimer.start();
     fastStatus_t ret = ( fastExportToHostCopy(
                              hDeviceToHostAdapter,
                              dstPtr,
@@ -2012,6 +1963,7 @@ fastStatus_t CUDAProcessorBase::export8bitData(void* dstPtr, bool forceRGB)
                              bufferInfo.height,
                              &p
                              ) );
+    recordDeviceToHost(downloadTimer, ret);
 
     if(ret != FAST_OK)
     {
@@ -2031,8 +1983,39 @@ void* CUDAProcessorBase::GetFrameBuffer()
         return hGLBuffer;
 }
 
+const std::vector<unsigned char>& CUDAProcessorBase::jpegHeader(unsigned jpegQuality)
+{
+    JpegHeader& header = mJpegHeaders[jpegQuality];
+    const fastJfifInfo_t& info = header.info;
+    if(!header.data.empty() &&
+       info.width == jfifInfo.width &&
+       info.height == jfifInfo.height &&
+       info.bitsPerChannel == jfifInfo.bitsPerChannel &&
+       info.jpegFmt == jfifInfo.jpegFmt &&
+       info.restartInterval == jfifInfo.restartInterval &&
+       info.exifSections == jfifInfo.exifSections &&
+       info.exifSectionsCount == jfifInfo.exifSectionsCount &&
+       memcmp(&info.scanMap, &jfifInfo.scanMap, sizeof(jfifInfo.scanMap)) == 0 &&
+       memcmp(&info.quantState, &jfifInfo.quantState, sizeof(jfifInfo.quantState)) == 0 &&
+       memcmp(&info.huffmanState, &jfifInfo.huffmanState, sizeof(jfifInfo.huffmanState)) == 0)
+        return header.data;
+
+    unsigned size = JPEG_HEADER_SIZE;
+    for(unsigned i = 0; i < jfifInfo.exifSectionsCount; i++)
+        size += unsigned(jfifInfo.exifSections[i].exifLength) + 4;
+    header.data.resize(size);
+    if(fastJfifHeaderStoreToMemory(header.data.data(), &size, &jfifInfo) != FAST_OK)
+        size = 0;
+    header.data.resize(size);
+    header.info = jfifInfo;
+    return header.data;
+}
+
 void CUDAProcessorBase::clearExifSections()
 {
+    //Freed sections may be reallocated at the same address
+    mJpegHeaders.clear();
+
     if(jfifInfo.exifSections != nullptr)
     {
         for(unsigned i = 0; i < jfifInfo.exifSectionsCount; i++)
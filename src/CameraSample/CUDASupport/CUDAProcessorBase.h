@@ -60,12 +60,17 @@
 #include <QElapsedTimer>
 #include <QDebug>
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include "timing.hpp"
 #include "helper_image/helper_ppm.hpp"
 #include "Image.h"
 #include "helper_jpeg.hpp"
 #include "FrameBuffer.h"
+#include "PipelineTelemetry.h"
+#include "GpuTraceTimeline.h"
+#include "Tracer.h"
 
 #include "Globals.h"
 
@@ -84,7 +89,9 @@ public:
     virtual fastStatus_t InitFailed(const char *errStr, fastStatus_t ret);
 
     virtual fastStatus_t Transform(GPUImage_t *image, CUDAProcessorOptions& opts);
-    virtual fastStatus_t TransformFailed(const char *errStr, fastStatus_t ret, fastGpuTimerHandle_t profileTimer);
+    ///The drop is counted against the failing stage
+    virtual fastStatus_t TransformFailed(const char *errStr, fastStatus_t ret, fastGpuTimerHandle_t profileTimer,
+                                         PipelineTelemetry::Stage stage);
 
     virtual fastStatus_t Close();
     virtual void         freeFilters();
@@ -113,6 +120,10 @@ public:
     QString getLastErrorDescription(){ return mErrString; }
     fastStatus_t getLastError(){ return mLastError; }
     bool isInitialized(){return mInitialised;}
+    ///True if the filters cannot process frames with these options. Frames up to
+    ///the initialized maximum size, white balance, LUTs, SAM/BPC switches and other
+    ///per-frame parameters are handled by Transform() without a new Init().
+    bool needsInit(const CUDAProcessorOptions& options) const;
     void setInfo(bool info)
     {
         QMutexLocker lock(&mut);
@@ -127,20 +138,30 @@ public:
 
     fastBayerPattern_t       BayerFormat;
     QMutex                   mut;
-    QMutex                   mut2;
-    QMap<QString, float>     stats;
-    QMap<QString, float>     stats2;
+    PipelineTelemetry        telemetry;
     fastExportToHostHandle_t hBitmapExport = nullptr;
     fastLut_16_t             outLut;
 
 protected:
     bool         info = true;
+    GpuTraceTimeline mGpuTrace;
+
+    /// Stops profileTimer (if any), adds its time to fullTime and records the stage.
+    void recordStage(PipelineTelemetry::Stage stage, fastGpuTimerHandle_t profileTimer, float* fullTime = nullptr);
+    /// Records a host export started at timer as stDeviceToHost, a failed one as dropped.
+    void recordDeviceToHost(const QElapsedTimer& timer, fastStatus_t ret);
 
     static const int JPEG_HEADER_SIZE = 1024;
+
+    ///JFIF header for jpegQuality. Headers are cached per quality and rebuilt
+    ///only if the tables or the frame layout changed since the last use.
+    const std::vector<unsigned char>& jpegHeader(unsigned jpegQuality);
     static const int FRAME_TIME = 2;
 
     fastSurfaceFormat_t surfaceFmt {};
     bool                mInitialised = false;
+    ///Options the filters were created with
+    CUDAProcessorOptions mInitOptions;
     QString             mErrString;
     fastStatus_t        mLastError {};
 
@@ -190,6 +211,13 @@ protected:
     fastJpegEncoderHandle_t hJpegEncoder = nullptr;
     fastJfifInfo_t          jfifInfo{};
     unsigned int            jpegStreamSize;
+    ///JFIF headers (SOI to SOS) by quality and the encoder state they were built from
+    struct JpegHeader
+    {
+        fastJfifInfo_t info{};
+        std::vector<unsigned char> data;
+    };
+    std::map<unsigned, JpegHeader> mJpegHeaders;
 
     //Denoise stuff
     fastDenoiseHandle_t             hDenoise = nullptr;
@@ -82,7 +82,9 @@ fastStatus_t CUDAProcessorGray::Init(CUDAProcessorOptions &options)
     mLastError = FAST_OK;
     mErrString = QString();
 
-    ret = fastInit(1U << 0, false);
+    //Device memory is allocated on the current device of the calling thread
+    cudaSetDevice(int(options.cudaDevice()));
+    ret = fastInit(1U << options.cudaDevice(), false);
     if(ret != FAST_OK)
         InitFailed("fastInit failed", ret);
 
@@ -102,8 +104,7 @@ fastStatus_t CUDAProcessorGray::Init(CUDAProcessorOptions &options)
         fastEnableInterfaceSynchronization(true);
     }
 
-    stats[QStringLiteral("inputWidth")] = -1;
-    stats[QStringLiteral("inputHeight")] = -1;
+    telemetry.reset();
 
     fastSurfaceFormat_t srcSurfaceFmt  = options.SurfaceFmt;
 
@@ -114,11 +115,14 @@ fastStatus_t CUDAProcessorGray::Init(CUDAProcessorOptions &options)
 
     if(options.Packed)
     {
+        fastRawFormat_t rawFormat = FAST_RAW_XIMEA12;
+        rawPackingGpuFormat(options.Packing, rawFormat);
+
         fastSDIRaw12Import_t p = {false};
         ret = fastRawImportFromDeviceCreate(
                     &hRawUnpacker,
 
-                    FAST_RAW_XIMEA12,
+                    rawFormat,
 
                     &p,
                     maxWidth,
@@ -540,7 +544,7 @@ fastStatus_t CUDAProcessorGray::Init(CUDAProcessorOptions &options)
         return InitFailed("cudaMalloc failed",ret);
     }
 
-    stats["totalViewportMemory"] = bufferSize;
+    telemetry.setGauge(PipelineTelemetry::gViewportMem, bufferSize);
     cudaMemoryInfo("Created hGLBuffer");
 
     //JPEG Stuff
@@ -635,11 +639,12 @@ fastStatus_t CUDAProcessorGray::Init(CUDAProcessorOptions &options)
     size_t totalMem = 0;
     cudaMemGetInfo(&freeMem, &totalMem);
 
-    stats[QStringLiteral("totalMem")] = totalMem;
-    stats[QStringLiteral("freeMem")] = freeMem;
-    stats[QStringLiteral("allocatedMem")] = requestedMemSpace;
+    telemetry.setGauge(PipelineTelemetry::gTotalMem, int64_t(totalMem));
+    telemetry.setGauge(PipelineTelemetry::gFreeMem, int64_t(freeMem));
+    telemetry.setGauge(PipelineTelemetry::gAllocatedMem, int64_t(requestedMemSpace));
 
     emit initialized(QString());
+    mInitOptions = options;
     mInitialised = true;
 
     mut.unlock();
@@ -659,7 +664,6 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
     }
 
     float fullTime = 0.;
-    float elapsedTimeGpu = 0.;
 
     QElapsedTimer cpuTimer;
     cpuTimer.start();
@@ -667,47 +671,34 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
     if(!mInitialised)
         return mLastError;
 
+    telemetry.beginFrame();
+    telemetry.setGauge(PipelineTelemetry::gFrameId, int64_t(image->meta.frameId));
+    mGpuTrace.begin(int64_t(image->meta.frameId));
+    TRACE_SCOPE_FRAME("cuda", "Transform", int64_t(image->meta.frameId));
+
     mErrString = QString();
     mLastError = FAST_OK;
     fastGpuTimerHandle_t profileTimer = nullptr;
     if(info)
         fastGpuTimerCreate(&profileTimer);
 
-    stats[QStringLiteral("hHostToDeviceAdapter")] = -1;
-    stats[QStringLiteral("hRawUnpacker")] = -1;
-    stats[QStringLiteral("hSam")] = -1;
-    stats[QStringLiteral("hBpc")] = -1;
-    stats[QStringLiteral("hWhiteBalance")] = -1;
-    stats[QStringLiteral("hDebayer")] = -1;
-    stats[QStringLiteral("hDenoise")] = -1;
-
-    stats[QStringLiteral("hOutLut")] = -1;
-    stats[QStringLiteral("h16to8Transform")] = -1;
-    stats[QStringLiteral("hCrop")] = -1;
-    stats[QStringLiteral("hDeviceToHostAdapter")] = -1;
-    stats[QStringLiteral("hExportToDevice")] = -1;
-    stats[QStringLiteral("hMjpegEncoder")] = -1;
-    stats[QStringLiteral("totalTime")] = -1;
-    stats[QStringLiteral("totalFps")] = -1;
-    stats[QStringLiteral("totalGPUTime")] = -1;
-    stats[QStringLiteral("totalGPUCPUTime")] = -1;
-
     fastStatus_t ret = FAST_OK;
     unsigned imgWidth  = image->w;
     unsigned imgHeight = image->h;
 
-    if(imgWidth > opts.MaxWidth || imgHeight > opts.MaxHeight )
-        return TransformFailed("Unsupported image size",FAST_INVALID_FORMAT,profileTimer);
+    //Filters take any frame size up to the one they were created for
+    if(imgWidth > mInitOptions.MaxWidth || imgHeight > mInitOptions.MaxHeight )
+        return TransformFailed("Unsupported image size",FAST_INVALID_FORMAT,profileTimer,PipelineTelemetry::stHostToDevice);
 
-    stats[QStringLiteral("inputWidth")] = imgWidth;
-    stats[QStringLiteral("inputHeight")] = imgHeight;
+    telemetry.setGauge(PipelineTelemetry::gInputWidth, imgWidth);
+    telemetry.setGauge(PipelineTelemetry::gInputHeight, imgHeight);
 
     if(info)
         fastGpuTimerStart(profileTimer);
-    QString key;
+    PipelineTelemetry::Stage stage = PipelineTelemetry::stHostToDevice;
     if(hDeviceToDeviceAdapter != nullptr)
     {
-        key = QStringLiteral("hHostToDeviceAdapter");
+        stage = PipelineTelemetry::stHostToDevice;
         ret = fastImportFromDeviceCopy(
                     hDeviceToDeviceAdapter,
 
@@ -718,11 +709,11 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("fastImportFromHostCopy failed", ret, profileTimer);
+            return TransformFailed("fastImportFromHostCopy failed", ret, profileTimer, PipelineTelemetry::stHostToDevice);
     }
     else if(hRawUnpacker != nullptr)
     {
-        key = QStringLiteral("hRawUnpacker");
+        stage = PipelineTelemetry::stRawUnpacker;
         ret = fastRawImportFromDeviceDecode(
                     hRawUnpacker,
 
@@ -733,17 +724,10 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("fastRawUnpackerDecode failed", ret, profileTimer);
+            return TransformFailed("fastRawUnpackerDecode failed", ret, profileTimer, PipelineTelemetry::stRawUnpacker);
     }
 
-    if(info)
-    {
-        fastGpuTimerStop(profileTimer);
-        fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-        fullTime += elapsedTimeGpu;
-        stats[key] = elapsedTimeGpu;
-    }
+    recordStage(stage, profileTimer, &fullTime);
 
     if(hSam && hSamMux)
     {
@@ -779,22 +763,14 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                            );
             }
             if(ret != FAST_OK && info)
-                return TransformFailed("fastImageFiltersTransform for SAM failed",ret,profileTimer);
+                return TransformFailed("fastImageFiltersTransform for SAM failed",ret,profileTimer,PipelineTelemetry::stSAM);
 
-            if(info)
-            {
-                fastGpuTimerStop(profileTimer);
-                fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-                fullTime += elapsedTimeGpu;
-                stats[QStringLiteral("hSAM")] = elapsedTimeGpu;
-            }
+            recordStage(PipelineTelemetry::stSAM, profileTimer, &fullTime);
 
             fastMuxSelect(hSamMux, 1);
         }
         else
         {
-            stats[QStringLiteral("hSAM")] = -1;
             fastMuxSelect(hSamMux, 0);
         }
     }
@@ -867,16 +843,9 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                         );
         }
         if(ret != FAST_OK && info)
-            return TransformFailed("fastImageFiltersTransform for Linearization Lut failed",ret,profileTimer);
+            return TransformFailed("fastImageFiltersTransform for Linearization Lut failed",ret,profileTimer,PipelineTelemetry::stLinearizationLut);
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            stats[QStringLiteral("hLinearizationLut")] = elapsedTimeGpu;
-            fullTime += elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stLinearizationLut, profileTimer, &fullTime);
     }
 
     if(hBpc && hBpcMux)
@@ -899,22 +868,14 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                        );
 
             if(ret != FAST_OK && info)
-                return TransformFailed("fastImageFiltersTransform for BPC failed", ret, profileTimer);
-
-            if(info)
-            {
-                fastGpuTimerStop(profileTimer);
-                fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
+                return TransformFailed("fastImageFiltersTransform for BPC failed", ret, profileTimer, PipelineTelemetry::stBPC);
 
-                fullTime += elapsedTimeGpu;
-                stats[QStringLiteral("hBpc")] = elapsedTimeGpu;
-            }
+            recordStage(PipelineTelemetry::stBPC, profileTimer, &fullTime);
 
             fastMuxSelect(hBpcMux, 1);
         }
         else
         {
-            stats[QStringLiteral("hBpc")] = -1;
             fastMuxSelect(hBpcMux, 0);
         }
     }
@@ -938,22 +899,14 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                         ) );
 
             if(ret != FAST_OK && info)
-                return TransformFailed("fastDenoiseTransform failed",ret,profileTimer);
+                return TransformFailed("fastDenoiseTransform failed",ret,profileTimer,PipelineTelemetry::stDenoise);
 
             fastMuxSelect(hDenoiseMux, 1);
 
-            if(info)
-            {
-                fastGpuTimerStop(profileTimer);
-                fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-                fullTime += elapsedTimeGpu;
-                stats[QStringLiteral("hDenoise")] = elapsedTimeGpu;
-            }
+            recordStage(PipelineTelemetry::stDenoise, profileTimer, &fullTime);
         }
         else
         {
-            stats[QStringLiteral("hDenoise")] = -1;
             fastMuxSelect(hDenoiseMux, 0);
         }
     }
@@ -974,16 +927,9 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("fastImageFiltersTransform for output Lut failed",ret,profileTimer);
-
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
+            return TransformFailed("fastImageFiltersTransform for output Lut failed",ret,profileTimer,PipelineTelemetry::stOutLut);
 
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("hOutLut")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stOutLut, profileTimer, &fullTime);
     }
 
     //16-bit to 8 bit transform
@@ -1004,16 +950,9 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                     );
 
         if(ret != FAST_OK)
-            return TransformFailed("h16to8Transform transform failed",ret,profileTimer);
+            return TransformFailed("h16to8Transform transform failed",ret,profileTimer,PipelineTelemetry::st16to8Transform);
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("h16to8Transform")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::st16to8Transform, profileTimer, &fullTime);
     }
 
 
@@ -1037,16 +976,9 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
                     ));
 
         if(ret != FAST_OK)
-            return TransformFailed("hGrayToRGBTransform transform failed",ret,profileTimer);
+            return TransformFailed("hGrayToRGBTransform transform failed",ret,profileTimer,PipelineTelemetry::stGrayToRGBTransform);
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("hGrayToRGBTransform")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stGrayToRGBTransform, profileTimer, &fullTime);
     }
 
     if(hExportToDevice)
@@ -1071,14 +1003,7 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
             qDebug("fastExportToDeviceCopy failed, ret = %d", ret);
 
 
-        if(info)
-        {
-            fastGpuTimerStop(profileTimer);
-            fastGpuTimerGetTime(profileTimer, &elapsedTimeGpu);
-
-            fullTime += elapsedTimeGpu;
-            stats[QStringLiteral("hExportToDevice")] = elapsedTimeGpu;
-        }
+        recordStage(PipelineTelemetry::stExportToDevice, profileTimer, &fullTime);
     }
 
     if(info)
@@ -1086,9 +1011,11 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
         cudaDeviceSynchronize();
 
         float mcs = float(cpuTimer.elapsed());
-        stats[QStringLiteral("totalGPUCPUTime")] = mcs;
-        stats[QStringLiteral("totalGPUTime")] = fullTime;
+        telemetry.record(PipelineTelemetry::stTotalGPUCPU, mcs);
+        telemetry.record(PipelineTelemetry::stTotalGPU, fullTime);
     }
+    else
+        telemetry.record(PipelineTelemetry::stTotalGPU);
 
     locker.unlock();
 
@@ -1098,10 +1025,6 @@ fastStatus_t CUDAProcessorGray::Transform(GPUImage_t *image, CUDAProcessorOption
         profileTimer = nullptr;
     }
 
-    mut2.lock();
-    stats2 = stats;
-    mut2.unlock();
-
     emit finished();
 
     return FAST_OK;
@@ -1120,6 +1043,8 @@ fastStatus_t CUDAProcessorGray::export8bitData(void* dstPtr, bool forceRGB)
     fastExportParameters_t p;
     p.convert = FAST_CONVERT_NONE;
     fastStatus_t ret = FAST_OK;
+    QElapsedTimer downloadTimer;
+    downloadTimer.start();
     if(forceRGB)
     {
         ret = (fastExportToHostCopy(
@@ -1142,6 +1067,7 @@ fastStatus_t CUDAProcessorGray::export8bitData(void* dstPtr, bool forceRGB)
                    &p
                    ));
     }
+    recordDeviceToHost(downloadTimer, ret);
 
     if(ret != FAST_OK)
     {
@@ -1164,8 +1090,7 @@ fastStatus_t CUDAProcessorGray::export8bitData(void* dstPtr, bool forceRGB)
 //    }
 
 //    fastStatus_t ret = FAST_OK;
-//    float elapsedTimeGpu = 0.;
-//    fastGpuTimerHandle_t profileTimer = nullptr;
+////    fastGpuTimerHandle_t profileTimer = nullptr;
 //    if(info)
 //        fastGpuTimerCreate(&profileTimer);
 
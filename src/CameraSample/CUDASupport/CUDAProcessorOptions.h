@@ -39,6 +39,7 @@
 #include <QRect>
 
 #include "Globals.h"
+#include "RawUnpack.h"
 
 class CUDAProcessorOptions
 {
@@ -50,7 +51,10 @@ public:
         vcMJPG,
         vcJPG,
         vcPGM,
-        vcHEVC
+        vcHEVC,
+        vcRAW,      ///Lossless compressed raw sequence
+        vcTIFF,
+        vcDNG       ///Raw frames as DNG files
     };
 
     CUDAProcessorOptions()
@@ -59,6 +63,7 @@ public:
         Height = 0;
 
         Packed = false;
+        Packing = rpNone;
 
         Info = false;
         DeviceId = (std::numeric_limits<unsigned>::max)();
@@ -117,6 +122,7 @@ public:
         Height = other.Height;
 
         Packed = other.Packed;
+        Packing = other.Packing;
 
         Info = other.Info;
         DeviceId = other.DeviceId;
@@ -181,10 +187,14 @@ public:
 
     bool Info;
     unsigned DeviceId;
+    ///CUDA device to process on, device 0 if DeviceId is not set
+    unsigned cudaDevice() const {return DeviceId < 32 ? DeviceId : 0;}
 
     bool ShowPicture;
 
     bool Packed;
+    ///Camera packing, selects the GPU raw importer when Packed is set
+    RawPacking Packing;
 
     unsigned int MaxWidth;
     unsigned int MaxHeight;
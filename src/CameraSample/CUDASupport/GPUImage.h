@@ -35,6 +35,7 @@
 #include <cstring>
 #include "alignment.hpp"
 #include "CudaAllocator.h"
+#include "FrameMetadata.h"
 
 template<class T>
 class GPUImage {
@@ -46,6 +47,7 @@ public:
     unsigned bitsPerChannel = 8;
 
     fastSurfaceFormat_t surfaceFmt = FAST_RGB8;
+    FrameMetadata meta;
 
     explicit GPUImage(void) {
         w = h = wPitch = 0;
@@ -58,6 +60,7 @@ public:
         wPitch = img.wPitch;
         bitsPerChannel = img.bitsPerChannel;
         surfaceFmt = img.surfaceFmt;
+        meta = img.meta;
 
         unsigned fullSize = wPitch * h;
 
@@ -0,0 +1,121 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "GpuTraceTimeline.h"
+#include "Tracer.h"
+
+GpuTraceTimeline::~GpuTraceTimeline()
+{
+    release();
+}
+
+void GpuTraceTimeline::begin(int64_t frame)
+{
+    end();
+    flush();
+    if(!Tracer::enabled())
+        return;
+
+    if(!mCreated)
+    {
+        for(auto& ev : mEvents)
+        {
+            if(cudaEventCreate(&ev) != cudaSuccess)
+            {
+                ev = nullptr;
+                release();
+                return;
+            }
+        }
+        mCreated = true;
+    }
+
+    cudaEventRecord(mEvents[0], mStream);
+    mStartUs = Tracer::nowUs();
+    mFrame = frame;
+    mCount = 0;
+    mActive = true;
+    mOwner.store(Tracer::currentThreadId(), std::memory_order_relaxed);
+}
+
+void GpuTraceTimeline::mark(const char* name)
+{
+    if(!Tracer::enabled() || mOwner.load(std::memory_order_relaxed) != Tracer::currentThreadId())
+        return;
+    if(!mActive || mCount >= MaxMarks)
+        return;
+
+    cudaEventRecord(mEvents[mCount + 1], mStream);
+    mNames[mCount] = name;
+    mCount++;
+}
+
+void GpuTraceTimeline::end()
+{
+    if(!mActive)
+        return;
+    mActive = false;
+    mPending = mCount > 0;
+}
+
+void GpuTraceTimeline::flush()
+{
+    if(!mPending)
+        return;
+    mPending = false;
+
+    if(cudaEventSynchronize(mEvents[mCount]) != cudaSuccess)
+        return;
+
+    Tracer& tracer = Tracer::instance();
+    int64_t prevUs = 0;
+    for(int i = 0; i < mCount; i++)
+    {
+        float ms = 0;
+        if(cudaEventElapsedTime(&ms, mEvents[0], mEvents[i + 1]) != cudaSuccess)
+            return;
+        int64_t us = int64_t(ms * 1000.f);
+        if(mNames[i] != nullptr)
+            tracer.complete("gpu", mNames[i], mStartUs + prevUs, us - prevUs, mFrame, Tracer::GpuTrackId);
+        prevUs = us;
+    }
+}
+
+void GpuTraceTimeline::release()
+{
+    mOwner.store(0, std::memory_order_relaxed);
+    mActive = false;
+    mPending = false;
+    for(auto& ev : mEvents)
+    {
+        if(ev)
+            cudaEventDestroy(ev);
+        ev = nullptr;
+    }
+    mCreated = false;
+}
@@ -0,0 +1,82 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef GPUTRACETIMELINE_H
+#define GPUTRACETIMELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+///Places GPU work of one frame on the tracer timeline using CUDA events.
+///A frame lasts until the next begin(), so exports issued after Transform
+///are included. Events are read back at the start of the next frame,
+///so tracing does not add host synchronization to the processing loop.
+///Only the thread that called begin() adds marks, exports called from
+///encoder threads are visible as CPU spans only.
+///Events go to the processing stream, the per-thread default stream unless
+///set, so tracing never serializes the SDK streams the way the legacy
+///default stream would.
+class GpuTraceTimeline
+{
+public:
+    static const int MaxMarks = 32;
+
+    GpuTraceTimeline() = default;
+    ~GpuTraceTimeline();
+
+    ///Start frame, does nothing if tracing is disabled
+    void begin(int64_t frame = -1);
+    ///GPU work queued since the previous mark becomes span with given name
+    void mark(const char* name);
+    ///Same as mark, but work since previous mark is not reported
+    void gap(){mark(nullptr);}
+    void end();
+    void release();
+
+    void setStream(cudaStream_t stream){mStream = stream;}
+
+private:
+    GpuTraceTimeline(const GpuTraceTimeline&) = delete;
+    GpuTraceTimeline& operator=(const GpuTraceTimeline&) = delete;
+
+    void flush();
+
+    cudaEvent_t mEvents[MaxMarks + 1] = {};
+    cudaStream_t mStream = cudaStreamPerThread;
+    const char* mNames[MaxMarks] = {};
+    int         mCount = 0;
+    bool        mCreated = false;
+    bool        mActive = false;
+    bool        mPending = false;
+    int64_t     mStartUs = 0;
+    int64_t     mFrame = -1;
+    std::atomic<uint32_t> mOwner{0};
+};
+
+#endif // GPUTRACETIMELINE_H
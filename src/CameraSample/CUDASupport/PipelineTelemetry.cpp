@@ -0,0 +1,322 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "PipelineTelemetry.h"
+
+#include <QJsonArray>
+
+namespace
+{
+const char* const cStageNames[PipelineTelemetry::stCount] = {
+    "host_to_device",
+    "raw_unpacker",
+    "sam",
+    "linearization_lut",
+    "bpc",
+    "white_balance",
+    "debayer",
+    "denoise",
+    "out_lut",
+    "16to8_transform",
+    "gray_to_rgb_transform",
+    "export_to_device",
+    "device_to_host",
+    "jpeg_encoder",
+    "export_nv12",
+    "export_p010",
+    "export_yuv8",
+    "total_gpu",
+    "total_gpu_cpu",
+    "encoder",
+    "writer",
+    "capture_latency"
+};
+
+const char* const cGaugeNames[PipelineTelemetry::gCount] = {
+    "input_width",
+    "input_height",
+    "total_mem_bytes",
+    "free_mem_bytes",
+    "allocated_mem_bytes",
+    "viewport_mem_bytes",
+    "acq_time_ns",
+    "writer_queue",
+    "frame_id",
+    "mjpeg_quality",
+    "mjpeg_kbps",
+    "mjpeg_target_kbps",
+    "rtsp_jpeg_quality",
+    "rtsp_jpeg_kbps",
+    "rtsp_jpeg_target_kbps"
+};
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    for(auto& b : mBuckets)
+        b.store(0, std::memory_order_relaxed);
+    mCount.store(0, std::memory_order_relaxed);
+    mSumUs.store(0, std::memory_order_relaxed);
+    mMaxUs.store(0, std::memory_order_relaxed);
+    mLastUs.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketIndex(uint32_t us)
+{
+    if(us < kSubBuckets)
+        return int(us);
+
+    int msb = 31;
+    while((us & (1u << msb)) == 0)
+        msb--;
+
+    int sub = int((us >> (msb - 3)) & (kSubBuckets - 1));
+    int idx = (msb - 2) * kSubBuckets + sub;
+    return idx < kBuckets ? idx : kBuckets - 1;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(int idx)
+{
+    if(idx < kSubBuckets)
+        return uint32_t(idx);
+
+    int msb = idx / kSubBuckets + 2;
+    uint32_t sub = uint32_t(idx % kSubBuckets);
+    return ((kSubBuckets + sub + 1) << (msb - 3)) - 1;
+}
+
+void LatencyHistogram::record(float ms)
+{
+    if(ms < 0)
+        return;
+
+    double us = double(ms) * 1000.;
+    uint32_t v = us >= 4294967295. ? 0xFFFFFFFFu : uint32_t(us + 0.5);
+
+    mBuckets[bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    mSumUs.fetch_add(v, std::memory_order_relaxed);
+    mLastUs.store(v, std::memory_order_relaxed);
+
+    uint32_t prev = mMaxUs.load(std::memory_order_relaxed);
+    while(v > prev && !mMaxUs.compare_exchange_weak(prev, v, std::memory_order_relaxed))
+        ;
+
+    mCount.fetch_add(1, std::memory_order_release);
+}
+
+float LatencyHistogram::lastMs() const
+{
+    return count() > 0 ? float(mLastUs.load(std::memory_order_relaxed)) / 1000.f : -1.f;
+}
+
+float LatencyHistogram::maxMs() const
+{
+    return count() > 0 ? float(mMaxUs.load(std::memory_order_relaxed)) / 1000.f : -1.f;
+}
+
+float LatencyHistogram::avgMs() const
+{
+    uint64_t cnt = count();
+    if(cnt == 0)
+        return -1.f;
+    return float(double(mSumUs.load(std::memory_order_relaxed)) / double(cnt) / 1000.);
+}
+
+double LatencyHistogram::sumMs() const
+{
+    return double(mSumUs.load(std::memory_order_relaxed)) / 1000.;
+}
+
+float LatencyHistogram::percentileMs(double p) const
+{
+    uint64_t counts[kBuckets];
+    uint64_t total = 0;
+    for(int i = 0; i < kBuckets; i++)
+    {
+        counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if(total == 0)
+        return -1.f;
+
+    uint64_t rank = uint64_t(p * double(total) + 0.5);
+    if(rank < 1)
+        rank = 1;
+    if(rank > total)
+        rank = total;
+
+    uint64_t acc = 0;
+    for(int i = 0; i < kBuckets; i++)
+    {
+        acc += counts[i];
+        if(acc >= rank)
+        {
+            //Bucket bound can exceed the real maximum
+            uint32_t v = bucketUpperBound(i);
+            uint32_t m = mMaxUs.load(std::memory_order_relaxed);
+            return float(v < m ? v : m) / 1000.f;
+        }
+    }
+    return maxMs();
+}
+
+PipelineTelemetry::Snapshot::Snapshot()
+{
+    for(auto& g : gauges)
+        g = -1;
+}
+
+QJsonObject PipelineTelemetry::Snapshot::toJson() const
+{
+    QJsonObject stagesObj;
+    for(int i = 0; i < stCount; i++)
+    {
+        const StageStats& st = stages[i];
+        if(st.framesIn == 0)
+            continue;
+
+        QJsonObject obj;
+        obj[QStringLiteral("active")] = st.active;
+        obj[QStringLiteral("last_ms")] = double(st.lastMs);
+        obj[QStringLiteral("avg_ms")] = double(st.avgMs);
+        obj[QStringLiteral("p50_ms")] = double(st.p50Ms);
+        obj[QStringLiteral("p99_ms")] = double(st.p99Ms);
+        obj[QStringLiteral("max_ms")] = double(st.maxMs);
+        obj[QStringLiteral("frames_in")] = double(st.framesIn);
+        obj[QStringLiteral("frames_out")] = double(st.framesOut);
+        obj[QStringLiteral("frames_dropped")] = double(st.framesDropped);
+        stagesObj[QLatin1String(stageName(Stage(i)))] = obj;
+    }
+
+    QJsonObject gaugesObj;
+    for(int i = 0; i < gCount; i++)
+    {
+        if(gauges[i] >= 0)
+            gaugesObj[QLatin1String(gaugeName(Gauge(i)))] = double(gauges[i]);
+    }
+
+    QJsonObject ret;
+    ret[QStringLiteral("frame")] = double(frame);
+    ret[QStringLiteral("stages")] = stagesObj;
+    ret[QStringLiteral("gauges")] = gaugesObj;
+    return ret;
+}
+
+PipelineTelemetry::PipelineTelemetry()
+{
+    reset();
+}
+
+void PipelineTelemetry::reset()
+{
+    for(auto& st : mStages)
+    {
+        st.latency.reset();
+        st.framesIn.store(0, std::memory_order_relaxed);
+        st.framesOut.store(0, std::memory_order_relaxed);
+        st.framesDropped.store(0, std::memory_order_relaxed);
+        st.lastFrame.store(0, std::memory_order_relaxed);
+    }
+    for(auto& g : mGauges)
+        g.store(-1, std::memory_order_relaxed);
+    mFrame.store(0, std::memory_order_relaxed);
+}
+
+void PipelineTelemetry::beginFrame()
+{
+    mFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineTelemetry::record(Stage s, float ms)
+{
+    StageData& st = mStages[s];
+    st.framesIn.fetch_add(1, std::memory_order_relaxed);
+    st.framesOut.fetch_add(1, std::memory_order_relaxed);
+    st.lastFrame.store(mFrame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    st.latency.record(ms);
+}
+
+void PipelineTelemetry::drop(Stage s)
+{
+    StageData& st = mStages[s];
+    st.framesIn.fetch_add(1, std::memory_order_relaxed);
+    st.framesDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineTelemetry::setGauge(Gauge g, int64_t val)
+{
+    mGauges[g].store(val, std::memory_order_relaxed);
+}
+
+PipelineTelemetry::Snapshot PipelineTelemetry::snapshot() const
+{
+    Snapshot ret;
+    ret.frame = mFrame.load(std::memory_order_relaxed);
+
+    for(int i = 0; i < stCount; i++)
+    {
+        const StageData& src = mStages[i];
+        StageStats& dst = ret.stages[i];
+
+        dst.framesIn = src.framesIn.load(std::memory_order_relaxed);
+        dst.framesOut = src.framesOut.load(std::memory_order_relaxed);
+        dst.framesDropped = src.framesDropped.load(std::memory_order_relaxed);
+        dst.active = dst.framesOut > 0 && src.lastFrame.load(std::memory_order_relaxed) == ret.frame;
+
+        if(src.latency.count() > 0)
+        {
+            dst.lastMs = src.latency.lastMs();
+            dst.avgMs = src.latency.avgMs();
+            dst.p50Ms = src.latency.percentileMs(0.5);
+            dst.p99Ms = src.latency.percentileMs(0.99);
+            dst.maxMs = src.latency.maxMs();
+            dst.timedFrames = src.latency.count();
+            dst.sumMs = src.latency.sumMs();
+        }
+    }
+
+    for(int i = 0; i < gCount; i++)
+        ret.gauges[i] = mGauges[i].load(std::memory_order_relaxed);
+
+    return ret;
+}
+
+const char* PipelineTelemetry::stageName(Stage s)
+{
+    return (s >= 0 && s < stCount) ? cStageNames[s] : "unknown";
+}
+
+const char* PipelineTelemetry::gaugeName(Gauge g)
+{
+    return (g >= 0 && g < gCount) ? cGaugeNames[g] : "unknown";
+}
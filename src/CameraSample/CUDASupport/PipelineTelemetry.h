@@ -0,0 +1,180 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef PIPELINETELEMETRY_H
+#define PIPELINETELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <QJsonObject>
+
+///Latency histogram with log-linear buckets (8 sub buckets per power of two)
+///over microseconds. Writers and readers never block each other.
+class LatencyHistogram
+{
+public:
+    static const int kSubBuckets = 8;
+    static const int kBuckets = 200;
+
+    LatencyHistogram();
+
+    void  record(float ms);
+    void  reset();
+
+    uint64_t count() const {return mCount.load(std::memory_order_relaxed);}
+    float lastMs() const;
+    float maxMs() const;
+    float avgMs() const;
+    double sumMs() const;
+
+    ///Value below which the given share (0..1) of samples falls
+    float percentileMs(double p) const;
+
+private:
+    static int      bucketIndex(uint32_t us);
+    static uint32_t bucketUpperBound(int idx);
+
+    std::atomic<uint64_t> mBuckets[kBuckets];
+    std::atomic<uint64_t> mCount;
+    std::atomic<uint64_t> mSumUs;
+    std::atomic<uint32_t> mMaxUs;
+    std::atomic<uint32_t> mLastUs;
+};
+
+///Fixed schema pipeline statistics: per stage latency histograms and
+///frames in/out/dropped counters plus a set of scalar gauges.
+///All updates are relaxed atomics, so it can stay enabled in production.
+class PipelineTelemetry
+{
+public:
+    typedef enum {
+        stHostToDevice = 0,
+        stRawUnpacker,
+        stSAM,
+        stLinearizationLut,
+        stBPC,
+        stWhiteBalance,
+        stDebayer,
+        stDenoise,
+        stOutLut,
+        st16to8Transform,
+        stGrayToRGBTransform,
+        stExportToDevice,
+        stDeviceToHost,
+        stJpegEncoder,
+        stExportNV12,
+        stExportP010,
+        stExportYuv8,
+        stTotalGPU,
+        stTotalGPUCPU,
+        stEncoder,
+        stWriter,
+        stCaptureLatency,   ///Camera receive time to end of processing and hand off to encoders
+        stCount
+    } Stage;
+
+    typedef enum {
+        gInputWidth = 0,
+        gInputHeight,
+        gTotalMem,
+        gFreeMem,
+        gAllocatedMem,
+        gViewportMem,
+        gAcqTimeNs,
+        gWriterQueue,
+        gFrameId,
+        gMjpegQuality,      ///Rate controlled Motion JPEG recording
+        gMjpegKbps,
+        gMjpegTargetKbps,
+        gRtspJpegQuality,   ///Rate controlled RTSP Motion JPEG
+        gRtspJpegKbps,
+        gRtspJpegTargetKbps,
+        gCount
+    } Gauge;
+
+    struct StageStats
+    {
+        bool     active = false; ///Stage ran for the latest frame
+        float    lastMs = -1;
+        float    avgMs = -1;
+        float    p50Ms = -1;
+        float    p99Ms = -1;
+        float    maxMs = -1;
+        uint64_t timedFrames = 0;   ///Frames with latency, count of sumMs
+        double   sumMs = 0;
+        uint64_t framesIn = 0;
+        uint64_t framesOut = 0;
+        uint64_t framesDropped = 0;
+    };
+
+    struct Snapshot
+    {
+        uint64_t   frame = 0;
+        StageStats stages[stCount];
+        int64_t    gauges[gCount];
+
+        Snapshot();
+        const StageStats& operator[](Stage s) const {return stages[s];}
+        int64_t gauge(Gauge g) const {return gauges[g];}
+        QJsonObject toJson() const;
+    };
+
+    PipelineTelemetry();
+
+    ///Starts a new frame, stages not recorded after that are reported inactive
+    void beginFrame();
+
+    ///Stage passed a frame, ms < 0 counts the frame without timing
+    void record(Stage s, float ms = -1);
+    ///Stage failed or discarded a frame
+    void drop(Stage s);
+    void setGauge(Gauge g, int64_t val);
+    void reset();
+
+    Snapshot snapshot() const;
+
+    static const char* stageName(Stage s);
+    static const char* gaugeName(Gauge g);
+
+private:
+    struct StageData
+    {
+        LatencyHistogram      latency;
+        std::atomic<uint64_t> framesIn;
+        std::atomic<uint64_t> framesOut;
+        std::atomic<uint64_t> framesDropped;
+        std::atomic<uint64_t> lastFrame;
+    };
+
+    StageData               mStages[stCount];
+    std::atomic<int64_t>    mGauges[gCount];
+    std::atomic<uint64_t>   mFrame;
+};
+
+#endif // PIPELINETELEMETRY_H
@@ -5,6 +5,7 @@
 #include <QElapsedTimer>
 
 #include "RawProcessor.h"
+#include "AppSettings.h"
 
 BaslerCamera::BaslerCamera()
 {
@@ -38,8 +39,15 @@ bool BaslerCamera::open(uint32_t devID)
     bool res = true;
     try
     {
-        // Create an instant camera object with the camera device found first.
-        mCamera.reset(new CInstantCamera(CTlFactory::GetInstance().CreateFirstDevice()));
+        // Create an instant camera object with the devID-th camera device found.
+        CTlFactory& factory = CTlFactory::GetInstance();
+        DeviceInfoList_t devices;
+        if(factory.EnumerateDevices(devices) <= int(devID))
+        {
+            qDebug() << "Camera" << devID << "not found";
+            return false;
+        }
+        mCamera.reset(new CInstantCamera(factory.CreateDevice(devices[devID])));
     }
     catch(const GenericException& e)
     {
@@ -246,6 +254,7 @@ bool BaslerCamera::open(uint32_t devID)
                 int64_t nPixelFormat = ptrPixFmt->GetValue();
                 // Set integer as new value for enumeration node
                 formats.SetIntValue(nPixelFormat);
+                mPacking = rawPackingFromPfnc(uint32_t(nPixelFormat));
             }
         }
     }
@@ -293,6 +302,24 @@ bool BaslerCamera::open(uint32_t devID)
          }
     }
 
+    //Cameras of a synchronized multi-camera setup share the PTP clock
+    if(AppSettings().pipelineSyncPtp)
+    {
+        CBooleanParameter ptp(nodemap, "PtpEnable");
+        if(!IsAvailable(ptp))
+            ptp.Attach(nodemap, "GevIEEE1588");
+        if(IsAvailable(ptp) && IsWritable(ptp))
+        {
+            ptp.SetValue(true);
+            mPtpEnabled = true;
+        }
+    }
+
+    //GigE cameras count timestamps in ticks, USB cameras report ns
+    CIntegerParameter tickFreq(nodemap, "GevTimestampTickFrequency");
+    if(IsAvailable(tickFreq) && IsReadable(tickFreq))
+        mTimestampTickHz = uint64_t(tickFreq.GetValue());
+
 
 
 
@@ -352,7 +379,10 @@ void BaslerCamera::startStreaming()
     {
 //        tmr.restart();
         // Wait for an image and then retrieve it. A timeout of 5000 ms is used.
+        TraceScope waitSpan("camera", "wait frame");
         mCamera->RetrieveResult(5000, ptrGrabResult, TimeoutHandling_Return);
+        waitSpan.finish();
+        const int64_t hostTimeUs = CircularBuffer::hostTimeUs();
 
 
         // Image grabbed successfully?
@@ -364,11 +394,7 @@ void BaslerCamera::startStreaming()
 
         UpdateStatistics(ptrGrabResult);
 
-        const uint8_t* in = (uint8_t*) ptrGrabResult->GetBuffer();
-        unsigned char* out = mInputBuffer.getBuffer();
-        size_t sz = ptrGrabResult->GetImageSize();
-        cudaMemcpy(out, in, sz, cudaMemcpyHostToDevice);
-        mInputBuffer.release();
+        uploadFrame(ptrGrabResult->GetBuffer(), ptrGrabResult->GetImageSize(), currentFrameMetadata(hostTimeUs));
 
         mRawProc->wake();
     }
@@ -638,8 +664,8 @@ void BaslerCamera::UpdateStatistics(const Pylon::CGrabResultPtr pBuff)
             // Update statistics
             // Total number of frames
             mStatistics[cmrCameraStatistic::statFramesTotal]++;
-            // Timestamp (we do not know the frequency!)
-            mStatistics[cmrCameraStatistic::statCurrTimestamp] = pBuff->GetTimeStamp();
+            // Timestamp in ns, frame synchronization compares it across cameras
+            mStatistics[cmrCameraStatistic::statCurrTimestamp] = timestampNs(pBuff->GetTimeStamp());
 
             // new frame ID
             uint64_t newFrameId = pBuff->GetID();
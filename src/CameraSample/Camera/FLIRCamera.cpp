@@ -31,6 +31,7 @@
 
 #include "MainWindow.h"
 #include "RawProcessor.h"
+#include "AppSettings.h"
 
 #include <QTimer>
 #include <QElapsedTimer>
@@ -82,6 +83,13 @@ bool FLIRCamera::open(uint32_t devID)
     if(mCam == nullptr)
         return false;
 
+    if(devID != 0)
+    {
+        if(devID >= mCamList.GetSize())
+            return false;
+        mCam = mCamList.GetByIndex(devID);
+    }
+
     // Initialize camera
     mCam->Init();
 
@@ -284,6 +292,7 @@ bool FLIRCamera::open(uint32_t devID)
                 int64_t nPixelFormat = ptrPixFmt->GetValue();
                 // Set integer as new value for enumeration node
                 ptrPixelFormats->SetIntValue(nPixelFormat);
+                mPacking = rawPackingFromPfnc(uint32_t(nPixelFormat));
             }
         }
     }
@@ -302,6 +311,19 @@ bool FLIRCamera::open(uint32_t devID)
         mFPS =  ptrFloat->GetValue();
     }
 
+    //Cameras of a synchronized multi-camera setup share the PTP clock
+    if(AppSettings().pipelineSyncPtp)
+    {
+        CBooleanPtr ptrPtp = nodeMap.GetNode("GevIEEE1588");
+        if(!IsAvailable(ptrPtp))
+            ptrPtp = nodeMap.GetNode("PtpEnable");
+        if(IsAvailable(ptrPtp) && IsWritable(ptrPtp))
+        {
+            ptrPtp->SetValue(true);
+            mPtpEnabled = true;
+        }
+    }
+
     if(!mInputBuffer.allocate(mWidth, mHeight, mSurfaceFormat))
         return false;
 
@@ -349,7 +371,10 @@ void FLIRCamera::startStreaming()
         try
         {
              // Retrieve next received image
+             TraceScope waitSpan("camera", "wait frame");
              ImagePtr pResultImage = mCam->GetNextImage(1000);
+             waitSpan.finish();
+             const int64_t hostTimeUs = CircularBuffer::hostTimeUs();
 
              // Ensure image is complete
              if (pResultImage->IsIncomplete())
@@ -360,11 +385,12 @@ void FLIRCamera::startStreaming()
              }
              else
              {
-                 unsigned char* dst = mInputBuffer.getBuffer();
-                 void* src = pResultImage->GetData();
-                 size_t sz = pResultImage->GetImageSize();
-                 cudaMemcpy(dst, src, sz, cudaMemcpyHostToDevice);
-                 mInputBuffer.release();
+                 FrameMetadata meta;
+                 meta.frameId = pResultImage->GetFrameID();
+                 //Spinnaker reports ns
+                 meta.deviceTimestamp = pResultImage->GetTimeStamp();
+                 meta.hostTimestampUs = hostTimeUs;
+                 uploadFrame(pResultImage->GetData(), pResultImage->GetImageSize(), meta);
              }
 
              // Release image
@@ -29,6 +29,7 @@
 #include "FrameBuffer.h"
 #include "SurfaceTraits.hpp"
 #include <QDateTime>
+#include <chrono>
 
 CircularBuffer::CircularBuffer(QObject *parent) : QObject(parent)
 {
@@ -47,11 +48,29 @@ bool CircularBuffer::allocate(int width, int height, fastSurfaceFormat_t format)
     //so we double buffer size just in case
     size_t bytesAlloc = height * pitch * 2;
 
+    mCurrent = 0;
+    mLast = -1;
+    mRead = mWritten = 0;
+    mDropped = 0;
+    mFrameCounter = 0;
+    mFrameSize = 0;
+
+    //Smaller frames (ROI) reuse the buffers, no device allocation on the way
+    if(!mImages.empty() && mImages.front().surfaceFmt == format && bytesAlloc <= mAllocated)
+    {
+        for(auto& img : mImages)
+        {
+            img.w = width;
+            img.h = height;
+            img.wPitch = (int)pitch;
+        }
+        mFrameSize = pitch * size_t(height);
+        return true;
+    }
+
     mImages.resize(numBuffers);
 
     mAllocated = 0;
-    mCurrent = 0;
-    mLast = -1;
 
     for(int i = 0; i < numBuffers; i++)
     {
@@ -72,7 +91,7 @@ bool CircularBuffer::allocate(int width, int height, fastSurfaceFormat_t format)
     }
 
     mAllocated = bytesAlloc;
-    mRead = mWritten = 0;
+    mFrameSize = pitch * size_t(height);
     return true;
 }
 
@@ -92,7 +111,7 @@ int CircularBuffer::pitch()
 
 size_t CircularBuffer::size()
 {
-    return mAllocated;
+    return mFrameSize;
 }
 fastSurfaceFormat_t CircularBuffer::surfaceFmt()
 {
@@ -113,17 +132,49 @@ unsigned char* CircularBuffer::getBuffer()
 
 GPUImage_t *CircularBuffer::getLastImage()
 {
-    if(mImages.empty() || mLast < 0)
+    if(mImages.empty())
+        return nullptr;
+
+    QMutexLocker lock(&mMutex);
+    if(mLast < 0)
         return nullptr;
     mRead++;
+    mConsumed.wakeAll();
 //    qDebug("Reading image = %d, ts = %u", mLast, QDateTime::currentDateTime().toMSecsSinceEpoch());
     return &(mImages[mLast]);
 }
 
-void CircularBuffer::release()
+void CircularBuffer::release(const FrameMetadata &meta)
 {
+    FrameMetadata& m = mImages[mCurrent].meta;
+    m = meta;
+    if(m.hostTimestampUs == 0)
+        m.hostTimestampUs = hostTimeUs();
+    if(m.frameId == 0)
+        m.frameId = mFrameCounter;
+    mFrameCounter++;
+
+    //Counters are shared with the processing thread
+    QMutexLocker lock(&mMutex);
     mLast = mCurrent;
     mWritten++;
     mDropped = mWritten - mRead;
 //    qDebug("Read = %d, written = %d, ts = %u", mRead, mWritten, QDateTime::currentDateTime().toMSecsSinceEpoch());
 }
+
+bool CircularBuffer::waitConsumed(unsigned long timeoutMs)
+{
+    QMutexLocker lock(&mMutex);
+    while(mRead < mWritten)
+    {
+        if(!mConsumed.wait(&mMutex, timeoutMs))
+            return false;
+    }
+    return true;
+}
+
+int64_t CircularBuffer::hostTimeUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
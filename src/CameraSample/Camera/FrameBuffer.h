@@ -33,6 +33,7 @@
 #include <QVector>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QWaitCondition>
 
 //#include "Image.h"
 //#include "FastAllocator.h"
@@ -51,11 +52,19 @@ public:
     bool allocate(int width, int height, fastSurfaceFormat_t format = FAST_I16);
     unsigned char* getBuffer();
     GPUImage_t* getLastImage();
-    void release();
+    /// Publish the buffer returned by getBuffer() together with its capture metadata.
+    /// Host timestamp is filled in here if the caller left it at zero.
+    void release(const FrameMetadata& meta = FrameMetadata());
+    /// Block until the last released frame was taken by getLastImage(), false on timeout.
+    /// File sources use it to run as fast as the processing without dropping frames.
+    bool waitConsumed(unsigned long timeoutMs);
+    /// Current wall clock time in microseconds since epoch (same clock as FrameMetadata::hostTimestampUs)
+    static int64_t hostTimeUs();
 
     int width();
     int height();
     int pitch();
+    ///Bytes of the current frame, pitch() * height()
     size_t size();
     fastSurfaceFormat_t surfaceFmt();
 
@@ -74,11 +83,15 @@ private:
 
     std::vector<GPUImage_t> mImages;
     QMutex mMutex;
+    QWaitCondition mConsumed;
+    //Bytes per buffer, reallocated only for larger frames
     size_t mAllocated = 0;
+    size_t mFrameSize = 0;
 
     int mRead = 0;
     int mWritten = 0;
     int mDropped = 0;
+    uint64_t mFrameCounter = 0;
 };
 
 #endif // FRAMEBUFFER_H
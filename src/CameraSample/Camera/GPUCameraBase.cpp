@@ -27,9 +27,101 @@
 */
 
 #include "GPUCameraBase.h"
+#include "ThreadPolicy.h"
 
 GPUCameraBase::GPUCameraBase() :
     QObject(nullptr)
 {
+    //Cameras start the thread in their constructors, started() comes from the thread itself
+    connect(&mCameraThread, &QThread::started, [](){ThreadPolicy::apply(AppSettings::trCamera);});
+}
+
+GPUCameraBase::~GPUCameraBase()
+{
+    if(mUploadStream)
+    {
+        cudaSetDevice(mCudaDevice);
+        cudaStreamDestroy(mUploadStream);
+    }
+}
+
+bool GPUCameraBase::uploadFrame(const void* src, size_t size, const FrameMetadata& meta, size_t srcPitch)
+{
+    unsigned char* dst = mInputBuffer.getBuffer();
+    if(mPacking != rpNone && !isPacked())
+    {
+        const size_t dstPitch = size_t(mWidth) * sizeof(uint16_t);
+        const size_t dstSize = dstPitch * size_t(mHeight);
+        if(size_t(mUnpackBuffer.size()) < dstSize)
+            mUnpackBuffer.resize(int(dstSize));
+
+        //Frames with a partial group per row come as one continuous bit stream
+        size_t rowBytes = rawPackedRowBytes(mPacking, unsigned(mWidth));
+        if(mWidth % int(rawPackingGroup(mPacking)) != 0)
+            rowBytes = size_t(mWidth) * size_t(rawPackingBits(mPacking)) / 8;
+
+        //Padded rows are skipped by the unpacker, no need to compact them first
+        const size_t pitch = srcPitch > rowBytes ? srcPitch : rowBytes;
+        if(size < pitch * size_t(mHeight - 1) + rowBytes)
+            return false;
+        {
+            TRACE_SCOPE_FRAME("camera", "unpack", int64_t(meta.frameId));
+            //Packed bytes in an unpacked buffer would only show up as noise downstream
+            if(!unpackRaw(mPacking, src, pitch, mUnpackBuffer.data(), dstPitch,
+                          unsigned(mWidth), unsigned(mHeight)))
+                return false;
+        }
+        src = mUnpackBuffer.constData();
+        size = dstSize;
+        srcPitch = 0;
+    }
+
+    {
+        TRACE_SCOPE_FRAME("camera", "upload", int64_t(meta.frameId));
+        cudaSetDevice(mCudaDevice);
+        if(mUploadStream == nullptr &&
+           cudaStreamCreateWithFlags(&mUploadStream, cudaStreamNonBlocking) != cudaSuccess)
+            mUploadStream = nullptr;
+
+        //Input buffer rows are back to back, let the copy engine drop the row padding.
+        //Pinned GenTL and V4L2 buffers are read by DMA while kernels of the
+        //previous frame run; the source goes back to the driver on return.
+        const size_t rowBytes = isPacked() ? rawPackedRowBytes(mPacking, unsigned(mWidth)) :
+                                             size_t(mWidth) * (mSurfaceFormat == FAST_I8 ? 1 : 2);
+        if(srcPitch > rowBytes)
+            cudaMemcpy2DAsync(dst, rowBytes, src, srcPitch, rowBytes, size_t(mHeight), cudaMemcpyHostToDevice, mUploadStream);
+        else
+            cudaMemcpyAsync(dst, src, size, cudaMemcpyHostToDevice, mUploadStream);
+        cudaStreamSynchronize(mUploadStream);
+    }
+    mInputBuffer.release(meta);
+    return true;
+}
+
+uint64_t GPUCameraBase::timestampNs(uint64_t ticks) const
+{
+    if(mTimestampTickHz == 0 || mTimestampTickHz == 1000000000ull)
+        return ticks;
+    //Whole seconds and the remainder separately, ticks * 1e9 overflows after a few hours
+    const uint64_t sec = ticks / mTimestampTickHz;
+    const uint64_t rem = ticks % mTimestampTickHz;
+    return sec * 1000000000ull + rem * 1000000000ull / mTimestampTickHz;
+}
+
+bool GPUCameraBase::resizeFrame(int width, int height)
+{
+    if(width <= 0 || height <= 0)
+        return false;
+    if(width == mWidth && height == mHeight && mInputBuffer.size() > 0)
+        return true;
 
+    //Called on the camera thread, the ring must stay on the pipeline device
+    cudaSetDevice(mCudaDevice);
+    if(!mInputBuffer.allocate(width, height, mSurfaceFormat))
+        return false;
+    mMaxWidth = qMax(mMaxWidth, mWidth);
+    mMaxHeight = qMax(mMaxHeight, mHeight);
+    mWidth = width;
+    mHeight = height;
+    return true;
 }
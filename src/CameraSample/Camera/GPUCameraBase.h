@@ -36,10 +36,14 @@
 #include <QTimer>
 #include <QThread>
 #include <QVariant>
+#include <QByteArray>
 #include <unordered_map>
+#include <cuda_runtime.h>
 
 #include "fastvideo_sdk.h"
 #include "FrameBuffer.h"
+#include "Tracer.h"
+#include "RawUnpack.h"
 
 #define  FrameEventID (QEvent::User + 1000)
 class FrameEvent : public QEvent
@@ -86,6 +90,17 @@ public:
         statCurrFps100 /// FPS multiplied by 100
     } ;
 
+    ///Sensor readout window. Offsets and size are in pixels after
+    ///binning and decimation, zero size means the whole sensor.
+    struct cmrRoi{
+        int offsetX = 0;
+        int offsetY = 0;
+        int width = 0;
+        int height = 0;
+        int binning = 1;
+        int decimation = 1;
+    };
+
     struct cmrParameterInfo{
         cmrCameraParameter param;
         float min;
@@ -97,6 +112,7 @@ public:
     } ;
 
     explicit GPUCameraBase();
+    ~GPUCameraBase();
 
     ///Connect to camera, initialize internal variables and
     ///allocate required resources
@@ -120,6 +136,14 @@ public:
     ///Get camera parameter information. Return true on success, false otherwise.
     virtual bool getParameterInfo(cmrParameterInfo& info) = 0;
 
+    ///Set sensor readout window, binning and decimation. Camera must be stopped.
+    ///The input buffer is reallocated for the new width() and height(),
+    ///processors have to be initialized again. Return false if not supported.
+    virtual bool setRoi(const cmrRoi& roi){Q_UNUSED(roi) return false;}
+
+    ///Readout window actually set on the camera
+    cmrRoi roi(){return mRoi;}
+
 
     ///Get current camera state
     cmrCameraState state() {return mState;}
@@ -137,11 +161,17 @@ public:
     fastSurfaceFormat_t surfaceFormat(){return mSurfaceFormat;}
 
 
+    ///Packed on the GPU by the raw importer
     bool isPacked(){return mImageFormat == cif12bpp_p;}
+    ///Packing of the frames delivered by the camera, rpNone if unpacked
+    RawPacking packing(){return mPacking;}
     bool isColor(){return mIsColor;}
 
     int width() {return mWidth;}
     int height(){return mHeight;}
+    ///Largest frame seen since open(), processors allocate for it once
+    int maxWidth() {return qMax(mMaxWidth, mWidth);}
+    int maxHeight(){return qMax(mMaxHeight, mHeight);}
 
     int whiteLevel(){return mWhite;}
     int blackLevel(){return mBblack;}
@@ -151,10 +181,17 @@ public:
     QString manufacturer(){return mManufacturer;}
     QString serial(){return mSerial;}
 
+    ///Device timestamps are taken from the PTP clock shared with other cameras
+    bool ptpEnabled(){return mPtpEnabled;}
+
     CircularBuffer* getFrameBuffer(){return &mInputBuffer;}
 
     void setProcessor(RawProcessor* proc){QMutexLocker l(&mLock); mRawProc = proc;}
 
+    ///CUDA device the input buffer lives on. Set before open().
+    void setCudaDevice(int device){mCudaDevice = device;}
+    int cudaDevice(){return mCudaDevice;}
+
     /// Get camera statistics
     bool  GetStatistics(cmrCameraStatistic stat, uint64_t &outStat) {
         if (mStatistics.find(stat)==mStatistics.end())
@@ -167,12 +204,35 @@ signals:
     void stateChanged(GPUCameraBase::cmrCameraState newState);
 
 protected:
+    /// Capture metadata for the frame counted by the last UpdateStatistics() call
+    FrameMetadata currentFrameMetadata(int64_t hostTimeUs) {
+        FrameMetadata meta;
+        meta.frameId = mCurrFrameID;
+        meta.deviceTimestamp = mStatistics[statCurrTimestamp];
+        meta.hostTimestampUs = hostTimeUs;
+        return meta;
+    }
+
+    ///Copies a camera frame to the next input buffer slot and releases it.
+    ///Packed frames without a GPU importer are unpacked on the CPU first.
+    ///srcPitch is the distance between rows in bytes, 0 if rows are back to back.
+    ///Return false if the frame is dropped because it cannot be unpacked.
+    bool uploadFrame(const void* src, size_t size, const FrameMetadata& meta, size_t srcPitch = 0);
+
+    ///Convert device timestamp ticks to ns with mTimestampTickHz
+    uint64_t timestampNs(uint64_t ticks) const;
+
+    ///Reallocate the input buffer for a new frame size
+    bool resizeFrame(int width, int height);
+
     QString mModel;
     QString mManufacturer;
     QString mSerial;
 
     int mWidth  = 0;
     int mHeight = 0;
+    int mMaxWidth  = 0;
+    int mMaxHeight = 0;
 
     float mFPS  = 0;
 
@@ -186,7 +246,12 @@ protected:
     fastBayerPattern_t  mPattern = FAST_BAYER_NONE;
     fastSurfaceFormat_t mSurfaceFormat = FAST_I8;
     cmrImageFormat      mImageFormat = cif8bpp;
+    RawPacking          mPacking = rpNone;
+    int                 mCudaDevice = 0;
     bool                mStreaming = false;
+    bool                mPtpEnabled = false;
+    uint64_t            mTimestampTickHz = 0; ///0 if the camera reports ns
+    cmrRoi              mRoi;
     CircularBuffer      mInputBuffer;
     RawProcessor*       mRawProc = nullptr;
 
@@ -201,6 +266,11 @@ protected:
     std::chrono::time_point<std::chrono::system_clock> mPrevFrameTime;
     const std::chrono::time_point<std::chrono::system_clock> kZeroTime;
     uint64_t mTotalBytesTransferred{0};
+
+private:
+    QByteArray mUnpackBuffer;
+    ///Uploads do not wait for processing kernels on the default stream
+    cudaStream_t mUploadStream = nullptr;
 };
 
 ///Base class for camera enumeration
@@ -3,11 +3,104 @@
 #ifdef SUPPORT_GENICAM
 #include <QVector>
 #include <QElapsedTimer>
+#include <QSemaphore>
 
 #include <RawProcessor.h>
+#include "AppSettings.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
 
 using CameraStatEnum = GPUCameraBase::cmrCameraStatistic  ;
 
+namespace
+{
+///Page-locked host memory mapped into the device address space.
+///The frame grabber DMAs into it and the upload runs without staging.
+class PinnedBufferAllocator : public rcg::BufferAllocator
+{
+public:
+    void* allocate(size_t size, size_t alignment) override
+    {
+        Q_UNUSED(alignment)
+        void* ptr = nullptr;
+        if(cudaHostAlloc(&ptr, size, cudaHostAllocMapped | cudaHostAllocPortable) != cudaSuccess)
+            return nullptr;
+        return ptr;
+    }
+    void free(void* p, size_t size) override
+    {
+        Q_UNUSED(size)
+        cudaFreeHost(p);
+    }
+};
+
+///Huge page backed memory registered with CUDA, fewer TLB misses for
+///multi megabyte frames. Falls back to transparent huge pages.
+class HugePageBufferAllocator : public rcg::BufferAllocator
+{
+public:
+    void* allocate(size_t size, size_t alignment) override
+    {
+        Q_UNUSED(alignment)
+#ifdef Q_OS_LINUX
+        const size_t hugePage = 2 * 1024 * 1024;
+        size = (size + hugePage - 1) / hugePage * hugePage;
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(ptr == MAP_FAILED)
+        {
+            ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(ptr == MAP_FAILED)
+                return nullptr;
+            madvise(ptr, size, MADV_HUGEPAGE);
+        }
+        if(cudaHostRegister(ptr, size, cudaHostRegisterPortable | cudaHostRegisterMapped) != cudaSuccess)
+        {
+            munmap(ptr, size);
+            return nullptr;
+        }
+        return ptr;
+#else
+        void* ptr = nullptr;
+        if(cudaHostAlloc(&ptr, size, cudaHostAllocMapped | cudaHostAllocPortable) != cudaSuccess)
+            return nullptr;
+        return ptr;
+#endif
+    }
+    void free(void* p, size_t size) override
+    {
+#ifdef Q_OS_LINUX
+        const size_t hugePage = 2 * 1024 * 1024;
+        cudaHostUnregister(p);
+        munmap(p, (size + hugePage - 1) / hugePage * hugePage);
+#else
+        Q_UNUSED(size)
+        cudaFreeHost(p);
+#endif
+    }
+};
+
+///Set an integer node to the nearest allowed value, return the value set or -1 if there is no such node
+int64_t setIntNode(GenApi::CNodeMapRef* nodeMap, const char* name, int64_t val)
+{
+    using namespace GenApi;
+
+    CIntegerPtr ptrInt = nodeMap->_GetNode(name);
+    if(!IsAvailable(ptrInt))
+        return -1;
+    if(IsWritable(ptrInt))
+    {
+        const int64_t minVal = int64_t(ptrInt->GetMin());
+        const int64_t inc = ptrInt->GetInc() > 0 ? int64_t(ptrInt->GetInc()) : 1;
+        val = qBound<int64_t>(minVal, val, int64_t(ptrInt->GetMax()));
+        val -= (val - minVal) % inc;
+        ptrInt->SetValue(val);
+    }
+    return int64_t(ptrInt->GetValue());
+}
+}
+
 GeniCamCamera::GeniCamCamera()
 {
     mCameraThread.setObjectName(QStringLiteral("GeniCamThread"));
@@ -29,6 +122,8 @@ bool GeniCamCamera::open(uint32_t devID)
 {
     using namespace GenApi;
 
+    //devID counts devices over all producers and interfaces
+    uint32_t index = 0;
     std::vector<std::shared_ptr<rcg::System> > system=rcg::System::getSystems();
     for (auto & i : system)
     {
@@ -40,14 +135,15 @@ bool GeniCamCamera::open(uint32_t devID)
 
         for (auto & k : interf)
         {
+            if(mDevice)
+                break;
+
             k->open();
             std::vector<std::shared_ptr<rcg::Device>> device = k->getDevices();
 
-            for (const auto & j : device)
-            {
-                mDevice = j;
-                break;
-            }
+            if(devID - index < device.size())
+                mDevice = device[devID - index];
+            index += uint32_t(device.size());
 
             if(!mDevice)
                 k->close();
@@ -146,6 +242,51 @@ bool GeniCamCamera::open(uint32_t devID)
             mWhite = 4095;
             mIsColor = false;
         }
+        else if(pixelFormats.contains(BayerRG12Packed))
+        {
+            mImageFormat = cif12bpp_p;
+            mSurfaceFormat = FAST_I12;
+            mPattern = FAST_BAYER_RGGB;
+            fmtString = "BayerRG12Packed";
+            mWhite = 4095;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(BayerGB12Packed))
+        {
+            mImageFormat = cif12bpp_p;
+            mSurfaceFormat = FAST_I12;
+            mPattern = FAST_BAYER_GBRG;
+            fmtString = "BayerGB12Packed";
+            mWhite = 4095;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(BayerGR12Packed))
+        {
+            mImageFormat = cif12bpp_p;
+            mSurfaceFormat = FAST_I12;
+            mPattern = FAST_BAYER_GRBG;
+            fmtString = "BayerGR12Packed";
+            mWhite = 4095;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(BayerBG12Packed))
+        {
+            mImageFormat = cif12bpp_p;
+            mSurfaceFormat = FAST_I12;
+            mPattern = FAST_BAYER_BGGR;
+            fmtString = "BayerBG12Packed";
+            mWhite = 4095;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(Mono12Packed))
+        {
+            mImageFormat = cif12bpp_p;
+            mSurfaceFormat = FAST_I12;
+            mPattern = FAST_BAYER_NONE;
+            fmtString = "Mono12Packed";
+            mWhite = 4095;
+            mIsColor = false;
+        }
 
         //12 bit unpacked
         else if(pixelFormats.contains(BayerRG12))
@@ -194,6 +335,53 @@ bool GeniCamCamera::open(uint32_t devID)
             mIsColor = false;
         }
 
+        //10 bit packed, unpacked on the CPU
+        else if(pixelFormats.contains(BayerRG10p))
+        {
+            mImageFormat = cif10bpp;
+            mSurfaceFormat = FAST_I10;
+            mPattern = FAST_BAYER_RGGB;
+            fmtString = "BayerRG10p";
+            mWhite = 1023;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(BayerGB10p))
+        {
+            mImageFormat = cif10bpp;
+            mSurfaceFormat = FAST_I10;
+            mPattern = FAST_BAYER_GBRG;
+            fmtString = "BayerGB10p";
+            mWhite = 1023;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(BayerGR10p))
+        {
+            mImageFormat = cif10bpp;
+            mSurfaceFormat = FAST_I10;
+            mPattern = FAST_BAYER_GRBG;
+            fmtString = "BayerGR10p";
+            mWhite = 1023;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(BayerBG10p))
+        {
+            mImageFormat = cif10bpp;
+            mSurfaceFormat = FAST_I10;
+            mPattern = FAST_BAYER_BGGR;
+            fmtString = "BayerBG10p";
+            mWhite = 1023;
+            mIsColor = true;
+        }
+        else if(pixelFormats.contains(Mono10p))
+        {
+            mImageFormat = cif10bpp;
+            mSurfaceFormat = FAST_I10;
+            mPattern = FAST_BAYER_NONE;
+            fmtString = "Mono10p";
+            mWhite = 1023;
+            mIsColor = false;
+        }
+
         //8 bit
         else if(pixelFormats.contains(BayerRG8))
         {
@@ -251,6 +439,7 @@ bool GeniCamCamera::open(uint32_t devID)
                 int64_t nPixelFormat = ptrPixFmt->GetValue();
                 // Set integer as new value for enumeration node
                 ptrPixelFormats->SetIntValue(nPixelFormat);
+                mPacking = rawPackingFromPfnc(uint32_t(nPixelFormat));
             }
         }
     }
@@ -282,6 +471,19 @@ bool GeniCamCamera::open(uint32_t devID)
          ptrLineMode->SetIntValue(ptrLineModeOut->GetValue());
     }
 
+    //Cameras of a synchronized multi-camera setup share the PTP clock
+    if(AppSettings().pipelineSyncPtp)
+    {
+        CBooleanPtr ptrPtp = nodeMap->_GetNode("PtpEnable");
+        if(!IsAvailable(ptrPtp))
+            ptrPtp = nodeMap->_GetNode("GevIEEE1588");
+        if(IsAvailable(ptrPtp) && IsWritable(ptrPtp))
+        {
+            ptrPtp->SetValue(true);
+            mPtpEnabled = true;
+        }
+    }
+
 //    camera.LineSelector.SetValue(LineSelector_Line2);
 //    camera.LineMode.SetValue(LineMode_Output);
 //    LineModeEnums e = camera.LineMode.GetValue();
@@ -291,6 +493,9 @@ bool GeniCamCamera::open(uint32_t devID)
     if(!mInputBuffer.allocate(mWidth, mHeight, mSurfaceFormat))
         return false;
 
+    mRoi = cmrRoi();
+    mRoi.width = mWidth;
+    mRoi.height = mHeight;
 
     mDevID = devID;
     mState = cstStopped;
@@ -331,7 +536,29 @@ void GeniCamCamera::startStreaming()
     if(streams.empty())
         return;
     streams[0]->open();
-    streams[0]->startStreaming();
+
+    AppSettings settings;
+    streams[0]->setBufferCount(size_t(settings.genTLBufferCount));
+    if(settings.genTLBufferMemory == AppSettings::bmPinned)
+        streams[0]->setBufferAllocator(std::make_shared<PinnedBufferAllocator>());
+    else if(settings.genTLBufferMemory == AppSettings::bmHugePages)
+        streams[0]->setBufferAllocator(std::make_shared<HugePageBufferAllocator>());
+    else
+        streams[0]->setBufferAllocator(nullptr);
+
+    try
+    {
+        streams[0]->startStreaming();
+    }
+    catch(const std::exception& e)
+    {
+        //Producer may not accept application buffers
+        if(settings.genTLBufferMemory == AppSettings::bmProducer)
+            throw;
+        qDebug("Announcing user buffers failed (%s), using producer buffers", e.what());
+        streams[0]->setBufferAllocator(nullptr);
+        streams[0]->startStreaming();
+    }
     QElapsedTimer tmr;
 
     // Reset the camera statistics
@@ -340,7 +567,10 @@ void GeniCamCamera::startStreaming()
     while(mState == cstStreaming)
     {
         tmr.restart();
+        TraceScope waitSpan("camera", "wait frame");
         const rcg::Buffer* buffer = streams[0]->grab(3000);
+        waitSpan.finish();
+        const int64_t hostTimeUs = CircularBuffer::hostTimeUs();
         if(buffer == nullptr)
             continue;
 
@@ -355,13 +585,7 @@ void GeniCamCamera::startStreaming()
             continue;
 
         //if(buffer->getImagePresent(1))
-        {
-            const unsigned char* in = static_cast<const unsigned char *>(buffer->getBase(1));
-            unsigned char* out = mInputBuffer.getBuffer();
-            size_t sz = buffer->getSize(1);
-            cudaMemcpy(out, in, sz, cudaMemcpyHostToDevice);
-            mInputBuffer.release();
-        }
+        uploadFrame(buffer->getBase(1), buffer->getSize(1), currentFrameMetadata(hostTimeUs));
 
         {
             QMutexLocker l(&mLock);
@@ -620,6 +844,76 @@ bool GeniCamCamera::getParameterInfo(cmrParameterInfo& info)
     return false;
 }
 
+bool GeniCamCamera::setRoi(const cmrRoi& roi)
+{
+    using namespace GenApi;
+
+    if(!mDevice || mState == cstStreaming)
+        return false;
+
+    //stop() does not wait for the streaming loop, queue behind it on the camera thread
+    if(QThread::currentThread() != thread())
+    {
+        bool ret = false;
+        QSemaphore done;
+        QTimer::singleShot(0, this, [this, roi, &ret, &done](){
+            ret = setRoi(roi);
+            done.release();
+        });
+        done.acquire();
+        return ret;
+    }
+
+    cmrRoi res;
+    try
+    {
+        std::shared_ptr<CNodeMapRef> nodeMap = mDevice->getRemoteNodeMap();
+
+        //Reset offsets first, otherwise the new width may not fit
+        setIntNode(nodeMap.get(), "OffsetX", 0);
+        setIntNode(nodeMap.get(), "OffsetY", 0);
+
+        //Binning and decimation change the maximum width and height
+        int64_t val = setIntNode(nodeMap.get(), "BinningHorizontal", roi.binning);
+        setIntNode(nodeMap.get(), "BinningVertical", roi.binning);
+        res.binning = val > 0 ? int(val) : 1;
+        val = setIntNode(nodeMap.get(), "DecimationHorizontal", roi.decimation);
+        setIntNode(nodeMap.get(), "DecimationVertical", roi.decimation);
+        res.decimation = val > 0 ? int(val) : 1;
+
+        CIntegerPtr ptrWidth = nodeMap->_GetNode("Width");
+        CIntegerPtr ptrHeight = nodeMap->_GetNode("Height");
+        if(!IsAvailable(ptrWidth) || !IsAvailable(ptrHeight))
+            return false;
+
+        //Packed rows must hold whole packing groups for the unpacker and the GPU importer
+        const int64_t group = mPacking != rpNone ? int64_t(rawPackingGroup(mPacking)) : 1;
+        int64_t width = roi.width > 0 ? roi.width : int64_t(ptrWidth->GetMax());
+        width = qMax(group, width / group * group);
+        res.width = int(setIntNode(nodeMap.get(), "Width", width));
+        if(res.width % group != 0)
+        {
+            std::cout << "Width " << res.width << " is not a multiple of the packing group" << std::endl;
+            setIntNode(nodeMap.get(), "Width", mWidth);
+            return false;
+        }
+        res.height = int(setIntNode(nodeMap.get(), "Height", roi.height > 0 ? roi.height : ptrHeight->GetMax()));
+        res.offsetX = int(qMax<int64_t>(0, setIntNode(nodeMap.get(), "OffsetX", roi.offsetX)));
+        res.offsetY = int(qMax<int64_t>(0, setIntNode(nodeMap.get(), "OffsetY", roi.offsetY)));
+    }
+    catch(GenICam::GenericException &ex)
+    {
+        std::cout << "GenericException: " << ex.GetDescription() << std::endl;
+        return false;
+    }
+
+    //Only the window is transferred and processed
+    if(!resizeFrame(res.width, res.height))
+        return false;
+    mRoi = res;
+    return true;
+}
+
 void GeniCamCamera::UpdateStatistics(const rcg::Buffer*  pBuff)
 {
     if(pBuff)
@@ -634,8 +928,8 @@ void GeniCamCamera::UpdateStatistics(const rcg::Buffer*  pBuff)
             // Update statistics
             // Total number of frames
             mStatistics[CameraStatEnum::statFramesTotal]++;
-            // Timestamp (we do not know the frequency!)
-            mStatistics[CameraStatEnum::statCurrTimestamp] = pBuff->getTimestamp();
+            // Timestamp in ns, frame synchronization compares it across cameras
+            mStatistics[CameraStatEnum::statCurrTimestamp] = pBuff->getTimestampNS();
 
             // new frame ID
             uint64_t newFrameId = pBuff->getFrameID();
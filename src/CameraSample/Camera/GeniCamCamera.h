@@ -26,6 +26,7 @@ public:
     virtual bool getParameter(cmrCameraParameter param, float& val);
     virtual bool setParameter(cmrCameraParameter param, float val);
     virtual bool getParameterInfo(cmrParameterInfo& info);
+    bool setRoi(const cmrRoi& roi) override;
 protected:
 
 private:
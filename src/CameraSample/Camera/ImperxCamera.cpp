@@ -31,6 +31,7 @@
 
 #include "MainWindow.h"
 #include "RawProcessor.h"
+#include "AppSettings.h"
 
 #include <QTimer>
 #include <QElapsedTimer>
@@ -194,6 +195,17 @@ bool ImperxCamera::open(uint32_t devID)
         m_pParameters->SetBooleanValue("AcquisitionFrameRateEnable", true);
         mFPS = m_pParameters->GetFloatValue("AcquisitionFrameRate");
 
+        // Cameras of a synchronized multi-camera setup share the PTP clock
+        if(AppSettings().pipelineSyncPtp)
+        {
+            mPtpEnabled = m_pParameters->SetBooleanValue("PtpEnable", true) == IPX_CAM_ERR_OK ||
+                          m_pParameters->SetBooleanValue("GevIEEE1588", true) == IPX_CAM_ERR_OK;
+        }
+
+        // GigE cameras count timestamps in ticks
+        auto tickFreq = m_pParameters->GetIntegerValue("GevTimestampTickFrequency", &err);
+        mTimestampTickHz = (err == IPX_CAM_ERR_OK && tickFreq > 0) ? uint64_t(tickFreq) : 0;
+
         // Allocate image data buffer
         if(!mInputBuffer.allocate(mWidth, mHeight, mSurfaceFormat))
             return false;
@@ -273,7 +285,10 @@ void ImperxCamera::startStreaming()
         // Retrieve next received image
         uint64_t timeout = 1000; // 1 second
         IpxCamErr err = IPX_CAM_ERR_OK;
+        TraceScope waitSpan("camera", "wait frame");
         auto pBuff = stream->GetBuffer(timeout, &err);
+        waitSpan.finish();
+        const int64_t hostTimeUs = CircularBuffer::hostTimeUs();
 
         // Ensure image is complete
         if (pBuff)
@@ -290,11 +305,7 @@ void ImperxCamera::startStreaming()
              else
              {
                  // Process new acquired buffer
-                 unsigned char* dst = mInputBuffer.getBuffer();
-                 void* src = pBuff->GetBufferPtr();
-                 size_t sz = pBuff->GetBufferSize();
-                 cudaMemcpy(dst, src, sz, cudaMemcpyHostToDevice);
-                 mInputBuffer.release();
+                 uploadFrame(pBuff->GetBufferPtr(), pBuff->GetBufferSize(), currentFrameMetadata(hostTimeUs));
                  stream->QueueBuffer(pBuff);
              }
 
@@ -441,8 +452,8 @@ void ImperxCamera::UpdateStatistics(IpxCam::Buffer *pBuff)
             // Update statistics
             // Total number of frames
             mStatistics[CameraStatEnum::statFramesTotal]++;
-            // Timestamp (we do not know the frequency!)
-            mStatistics[CameraStatEnum::statCurrTimestamp] = pBuff->GetTimestamp();
+            // Timestamp in ns, frame synchronization compares it across cameras
+            mStatistics[CameraStatEnum::statCurrTimestamp] = timestampNs(pBuff->GetTimestamp());
 
             // new frame ID
             uint64_t newFrameId = pBuff->GetFrameID();
@@ -5,6 +5,7 @@
 #include <QElapsedTimer>
 
 #include <RawProcessor.h>
+#include "AppSettings.h"
 
 using CameraStatEnum = GPUCameraBase::cmrCameraStatistic;
 
@@ -39,7 +40,13 @@ bool LucidCamera::open(uint32_t devID)
             return false;
         }
 
-        devInfo = deviceInfos[0];
+        if(devID >= deviceInfos.size())
+        {
+            qDebug() << "Camera" << devID << "not found";
+            return false;
+        }
+
+        devInfo = deviceInfos[devID];
         mDevice = mSystem->CreateDevice(devInfo);
 
 
@@ -229,6 +236,7 @@ bool LucidCamera::open(uint32_t devID)
             }
 
             Arena::SetNodeValue<GenICam::gcstring>(nodeMap, "PixelFormat", fmtString);
+            mPacking = isPacked() ? rpPFNC12p : rpNone;
 
     //        if(IsWritable(ptrPixelFormats))
     //        {
@@ -258,6 +266,17 @@ bool LucidCamera::open(uint32_t devID)
             mFPS =  ptrFloat->GetValue();
         }
 
+        //Cameras of a synchronized multi-camera setup share the PTP clock
+        if(AppSettings().pipelineSyncPtp)
+        {
+            CBooleanPtr ptrPtp = nodeMap->GetNode("PtpEnable");
+            if(IsAvailable(ptrPtp) && IsWritable(ptrPtp))
+            {
+                ptrPtp->SetValue(true);
+                mPtpEnabled = true;
+            }
+        }
+
         if(!mInputBuffer.allocate(mWidth, mHeight, mSurfaceFormat))
             return false;
 
@@ -396,7 +415,10 @@ void LucidCamera::startStreaming()
         {
             tmr.restart();
 
+            TraceScope waitSpan("camera", "wait frame");
             Arena::IImage* pImage = mDevice->GetImage(3000);
+            waitSpan.finish();
+            const int64_t hostTimeUs = CircularBuffer::hostTimeUs();
 
             UpdateStatistics(pImage);
 
@@ -404,13 +426,7 @@ void LucidCamera::startStreaming()
                 continue;
 
             //if(pImage->getImagePresent(1))
-            {
-                const unsigned char* in = static_cast<const unsigned char *>(pImage->GetData());
-                unsigned char* out = mInputBuffer.getBuffer();
-                size_t sz = pImage->GetSizeFilled();
-                cudaMemcpy(out, in, sz, cudaMemcpyHostToDevice);
-                mInputBuffer.release();
-            }
+            uploadFrame(pImage->GetData(), pImage->GetSizeFilled(), currentFrameMetadata(hostTimeUs));
 
             {
                 QMutexLocker l(&mLock);
@@ -707,8 +723,8 @@ void LucidCamera::UpdateStatistics(Arena::IImage* pImage)
             // Update statistics
             // Total number of frames
             mStatistics[CameraStatEnum::statFramesTotal]++;
-            // Timestamp (we do not know the frequency!)
-            mStatistics[CameraStatEnum::statCurrTimestamp] = pImage->GetTimestamp();
+            // Timestamp in ns, frame synchronization compares it across cameras
+            mStatistics[CameraStatEnum::statCurrTimestamp] = pImage->GetTimestampNs();
 
             // new frame ID
             uint64_t newFrameId = pImage->GetFrameId();
@@ -1,9 +1,12 @@
 #include "MIPICamera.h"
 
 #include <cuda.h>
+#include <cuda_runtime.h>
 
 #include "RawProcessor.h"
 
+#include <QSemaphore>
+
 #include <iostream>
 #include <libv4l2.h>
 #include <linux/videodev2.h>
@@ -11,6 +14,8 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include <thread>
 
@@ -41,43 +46,15 @@ union BS{
 
 */
 
-struct Mem{
-    int rows = 0;
-    int cols = 0;
-    int depth = 0;
-    std::vector<uint8_t> data;
-    int step[2] = {0, 0};
-
-    Mem(){}
-    Mem(int rows, int cols, int depth){
-        resize(rows, cols, depth);
-    }
-
-    size_t size() const{
-        return data.size();
-    }
-
-    uint8_t* ptr(int y){
-        return data.data() + y * cols * depth;
-    }
-    const uint8_t* ptr(int y) const{
-        return data.data() + y * cols * depth;
-    }
-
-    void resize(int rows, int cols, int depth){
-        this->rows = rows;
-        this->cols = cols;
-        this->depth = depth;
-        step[1] = depth;
-        step[0] = cols * depth;
-        this->data.resize(this->rows * this->cols * this->depth);
-
-    }
-    static Mem zeros(int rows, int cols, int depth){
-        Mem res;
-        res.resize(rows, cols, depth);
-        memset(res.data.data(), 0, res.data.size());
-    }
+///Frame held by the application between dequeue() and enqueue()
+struct V4l2Frame{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t pitch = 0;
+    int index = -1;
+    /// V4L2 buffer sequence number and driver timestamp
+    uint32_t sequence = 0;
+    uint64_t timestampNs = 0;
 };
 
 struct Res{
@@ -107,11 +84,34 @@ inline uint32_t make_fmt(char* fmt)
 
 #define CLEAR(fmt) memset(&(fmt), 0, sizeof(fmt))
 
+///MIPI CSI-2 packed bayer formats passed through by the driver
+inline RawPacking packingFromV4l2(uint32_t pixfmt)
+{
+    switch(pixfmt)
+    {
+    case V4L2_PIX_FMT_SBGGR10P:
+    case V4L2_PIX_FMT_SGBRG10P:
+    case V4L2_PIX_FMT_SGRBG10P:
+    case V4L2_PIX_FMT_SRGGB10P:
+        return rpMIPIRaw10;
+    case V4L2_PIX_FMT_SBGGR12P:
+    case V4L2_PIX_FMT_SGBRG12P:
+    case V4L2_PIX_FMT_SGRBG12P:
+    case V4L2_PIX_FMT_SRGGB12P:
+        return rpMIPIRaw12;
+    default:
+        return rpNone;
+    }
+}
+
 struct buffer{
     void *start = nullptr;
     size_t length = 0;
 };
 
+///Buffers the driver can have filled while the application holds one frame
+static const unsigned V4l2QueueDepth = 4;
+
 class CameraV4l2
 {
 public:
@@ -142,6 +142,13 @@ public:
     float fps() const{
         return mFps;
     }
+    RawPacking packing() const{
+        return mPacking;
+    }
+    ///Driver writes into page-locked memory the GPU reads directly
+    bool isUserPtr() const{
+        return mMemory == V4L2_MEMORY_USERPTR;
+    }
 
     bool is_open() const{
         return mIsOpen;
@@ -175,6 +182,7 @@ public:
         mWidth = fmt.fmt.pix.width;
         mHeight = fmt.fmt.pix.height;
         mBytesPerLines =fmt.fmt.pix.bytesperline;
+        mPacking = packingFromV4l2(fmt.fmt.pix.pixelformat);
 
         struct v4l2_frmivalenum temp;
         CLEAR(temp);
@@ -193,36 +201,15 @@ public:
         BS bs;
         bs.ui = fmt.fmt.pix.pixelformat;
 
-        struct v4l2_requestbuffers req;
-        CLEAR(req);
-        req.count = 2;
-        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        req.memory = V4L2_MEMORY_MMAP;
-        xioctl(mFd, VIDIOC_REQBUFS, &req);
+        //Driver DMA goes straight to pinned memory, MMAP buffers need a CPU copy
+        const size_t imageSize = fmt.fmt.pix.sizeimage > 0 ? fmt.fmt.pix.sizeimage :
+                                                            size_t(mBytesPerLines) * size_t(mHeight);
+        if(!requestUserPtr(imageSize) && !requestMmap())
+            return false;
 
-        mBuffrs.resize(req.count);
         for(size_t i = 0; i < mBuffrs.size(); ++i){
-            struct v4l2_buffer buf;
-            CLEAR(buf);
-            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_MMAP;
-            buf.index = i;
-            xioctl(mFd, VIDIOC_QUERYBUF, &buf);
-
-            mBuffrs[i].length = buf.length;
-            mBuffrs[i].start = v4l2_mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, buf.m.offset);
-            if (MAP_FAILED == mBuffrs[i].start){
+            if(!queue(int(i)))
                 return false;
-            }
-        }
-
-        for(size_t i = 0; i < mBuffrs.size(); ++i){
-            struct v4l2_buffer buf;
-            CLEAR(buf);
-            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_MMAP;
-            buf.index = i;
-            xioctl(mFd, VIDIOC_QBUF, &buf);
         }
 
         v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -239,45 +226,61 @@ public:
 
         if(mFd >= 0){
 
-            int res = 0;
-            for(size_t i = 0; i < mBuffrs.size(); ++i){
-                 res = v4l2_munmap(mBuffrs[i].start, mBuffrs[i].length);
-            }
-            mBuffrs.clear();
-
+            //Driver must stop writing before the memory goes away
             v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
             xioctl(mFd, VIDIOC_STREAMOFF, &type);
+            freeBuffers();
             ::close(mFd);
-            mFd = 0;
+            mFd = -1;
         }
     }
-    void get(Mem &res){
-        res.resize(mHeight, mWidth, 2);
-
-        if(!is_open())
-            return;
+    ///Wait up to timeoutMs for a filled buffer. The frame stays owned by
+    ///the application until enqueue(), keep it as short as possible.
+    bool dequeue(V4l2Frame& frame, int timeoutMs){
+        if(!is_open() || mBuffrs.empty())
+            return false;
 
-        if(mBuffrs.empty())
-            return;
+        //Poll without the lock so that controls can be set meanwhile
+        pollfd pfd;
+        pfd.fd = mFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int r = 0;
+        do{
+            r = poll(&pfd, 1, timeoutMs);
+        }while(r < 0 && errno == EINTR);
+        if(r <= 0 || !(pfd.revents & POLLIN))
+            return false;
 
         std::lock_guard<std::mutex> guard(mMutex);
+        if(!mIsOpen)
+            return false;
 
         v4l2_buffer buf;
         CLEAR(buf);
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        xioctl(mFd, VIDIOC_DQBUF, &buf);
+        buf.memory = mMemory;
+        if(ioctl(mFd, VIDIOC_DQBUF, &buf) < 0 || buf.index >= mBuffrs.size())
+            return false;
 
-        if(mBuffrs.empty() || buf.index > mBuffrs.size())
-            return;
+        frame.index = int(buf.index);
+        frame.data = static_cast<const uint8_t*>(mBuffrs[buf.index].start);
+        frame.pitch = size_t(mBytesPerLines);
+        frame.size = buf.bytesused > 0 ? buf.bytesused : mBuffrs[buf.index].length;
+        frame.sequence = buf.sequence;
+        frame.timestampNs = uint64_t(buf.timestamp.tv_sec) * 1000000000ull + uint64_t(buf.timestamp.tv_usec) * 1000ull;
+        return true;
+    }
 
-        for(int i = 0; i < mHeight; ++i){
-            char *ptr = (char*)mBuffrs[buf.index].start + i * mBytesPerLines;
-            memcpy(res.ptr(i), ptr, res.step[0]);
-        }
-        //memcpy(res.data, mBuffrs[buf.index].start, buf.bytesused);
+    ///Give the buffer back to the driver
+    void enqueue(V4l2Frame& frame){
+        if(frame.index < 0)
+            return;
 
-        xioctl(mFd, VIDIOC_QBUF, &buf);
+        std::lock_guard<std::mutex> guard(mMutex);
+        if(mIsOpen)
+            queue(frame.index);
+        frame.index = -1;
     }
 
     float exposure() const {
@@ -332,18 +335,107 @@ public:
 
 private:
     std::string mDev;
-    int mFd = 0;
+    int mFd = -1;
     bool mIsOpen = false;
     int mWidth = 0;
     int mHeight = 0;
     float mFps = 0;
     std::vector<buffer> mBuffrs;
+    v4l2_memory mMemory = V4L2_MEMORY_MMAP;
     int mBytesPerLines = 0;
+    RawPacking mPacking = rpNone;
     std::mutex mMutex;
     int mExposure = 0;
 
     int mResolutionId = 0;
 
+    bool requestUserPtr(size_t size){
+        struct v4l2_requestbuffers req;
+        CLEAR(req);
+        req.count = V4l2QueueDepth;
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_USERPTR;
+        if(!xioctl(mFd, VIDIOC_REQBUFS, &req) || req.count == 0)
+            return false;
+
+        //Page aligned as V4L2 requires, mapped into the GPU address space
+        const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size = (size + page - 1) / page * page;
+        mMemory = V4L2_MEMORY_USERPTR;
+        mBuffrs.resize(req.count);
+        for(auto& b : mBuffrs){
+            if(cudaHostAlloc(&b.start, size, cudaHostAllocMapped | cudaHostAllocPortable) != cudaSuccess){
+                b.start = nullptr;
+                freeBuffers();
+                return false;
+            }
+            b.length = size;
+        }
+        return true;
+    }
+
+    bool requestMmap(){
+        struct v4l2_requestbuffers req;
+        CLEAR(req);
+        req.count = V4l2QueueDepth;
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_MMAP;
+        if(!xioctl(mFd, VIDIOC_REQBUFS, &req) || req.count == 0)
+            return false;
+
+        mMemory = V4L2_MEMORY_MMAP;
+        mBuffrs.resize(req.count);
+        for(size_t i = 0; i < mBuffrs.size(); ++i){
+            struct v4l2_buffer buf;
+            CLEAR(buf);
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = i;
+            xioctl(mFd, VIDIOC_QUERYBUF, &buf);
+
+            mBuffrs[i].length = buf.length;
+            mBuffrs[i].start = v4l2_mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, buf.m.offset);
+            if (MAP_FAILED == mBuffrs[i].start){
+                mBuffrs[i].start = nullptr;
+                freeBuffers();
+                return false;
+            }
+        }
+        //Pageable, CUDA stages every frame through its own pinned buffer
+        return true;
+    }
+
+    void freeBuffers(){
+        for(auto& b : mBuffrs){
+            if(b.start == nullptr)
+                continue;
+            if(mMemory == V4L2_MEMORY_USERPTR)
+                cudaFreeHost(b.start);
+            else
+                v4l2_munmap(b.start, b.length);
+        }
+        mBuffrs.clear();
+
+        struct v4l2_requestbuffers req;
+        CLEAR(req);
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = mMemory;
+        xioctl(mFd, VIDIOC_REQBUFS, &req);
+    }
+
+    bool queue(int index){
+        struct v4l2_buffer buf;
+        CLEAR(buf);
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = mMemory;
+        buf.index = uint32_t(index);
+        if(mMemory == V4L2_MEMORY_USERPTR){
+            buf.m.userptr = reinterpret_cast<unsigned long>(mBuffrs[index].start);
+            buf.length = uint32_t(mBuffrs[index].length);
+        }
+        return xioctl(mFd, VIDIOC_QBUF, &buf);
+    }
+
     bool xioctl(int fd, int request, void *args) const{
         int r;
 
@@ -383,19 +475,25 @@ void MIPICamera::startStreaming()
     if(mState != cstStreaming)
         return;
 
-    QByteArray frameData;
-    frameData.resize((int)mInputBuffer.size());
-
-    Mem image;
+    V4l2Frame image;
 
     QElapsedTimer tmr;
     while(mState == cstStreaming)
     {
         tmr.restart();
-        mCamera->get(image);
-        unsigned char* dst = mInputBuffer.getBuffer();
-        cudaMemcpy(dst, image.ptr(0), image.size(), cudaMemcpyHostToDevice);
-        mInputBuffer.release();
+        {
+            TRACE_SCOPE("camera", "wait frame");
+            //Time out now and then to notice stop()
+            if(!mCamera->dequeue(image, 500))
+                continue;
+        }
+        FrameMetadata meta;
+        meta.frameId = image.sequence;
+        meta.deviceTimestamp = image.timestampNs;
+        meta.hostTimestampUs = CircularBuffer::hostTimeUs();
+        //Row padding is dropped by the unpacker or the 2D copy
+        uploadFrame(image.data, image.size, meta, image.pitch);
+        mCamera->enqueue(image);
 
         {
             QMutexLocker l(&mLock);
@@ -416,6 +514,13 @@ bool MIPICamera::open(uint32_t devID)
         mSurfaceFormat = FAST_I12;
         mImageFormat = cif12bpp;
         mWhite = 4095;
+        mPacking = mCamera->packing();
+        if(rawPackingBits(mPacking) == 10)
+        {
+            mSurfaceFormat = FAST_I10;
+            mImageFormat = cif10bpp;
+            mWhite = 1023;
+        }
         mBblack = 0;
         mIsColor = true;
         mFPS = mCamera->fps();
@@ -449,7 +554,20 @@ bool MIPICamera::stop()
 void MIPICamera::close()
 {
     stop();
-    mCamera->close();
+    //stop() does not wait for the streaming loop, it may still upload from a
+    //dequeued buffer. Stream off and free the buffers on the camera thread
+    //once the loop has returned.
+    if(QThread::currentThread() != thread() && mCameraThread.isRunning())
+    {
+        QSemaphore done;
+        QTimer::singleShot(0, this, [this, &done](){
+            mCamera->close();
+            done.release();
+        });
+        done.acquire();
+    }
+    else
+        mCamera->close();
     //xiCloseDevice(hDevice);
     mState = cstClosed;
     emit stateChanged(cstClosed);
@@ -29,8 +29,7 @@
 #include "PGMCamera.h"
 #include "MainWindow.h"
 #include "RawProcessor.h"
-
-extern int loadPPM(const char *file, void** data, BaseAllocator *alloc, unsigned int &width, unsigned &wPitch, unsigned int &height, unsigned &bitsPerPixel, unsigned &channels);
+#include "ppm.h"
 
 PGMCamera::PGMCamera(const QString &fileName,
                      fastBayerPattern_t  pattern,
@@ -74,6 +73,9 @@ bool PGMCamera::open(uint32_t devID)
                     sampleSize, samples))
         return false;
 
+    //Take ownership right away, loadPPM allocated it with our allocator
+    mInputImage.data.reset(bits);
+
     if(samples != 1)
         return false;
 
@@ -106,18 +108,6 @@ bool PGMCamera::open(uint32_t devID)
     mInputImage.wPitch = pitch;
     mInputImage.bitsPerChannel = sampleSize;
 
-    try
-    {
-        mInputImage.data.reset(static_cast<unsigned char*>(a.allocate(mInputImage.wPitch * mInputImage.h)));
-    }
-    catch(...)
-    {
-        return false;
-    }
-
-    memcpy(mInputImage.data.get(), bits, pitch * height);
-    a.deallocate(bits);
-
     if(!mInputBuffer.allocate(mWidth, mHeight, mSurfaceFormat))
         return false;
 
@@ -159,8 +149,7 @@ void PGMCamera::startStreaming()
 
     while(mState == cstStreaming)
     {
-        cudaMemcpy(mInputBuffer.getBuffer(), mInputImage.data.get(), mInputImage.wPitch * mInputImage.h, cudaMemcpyHostToDevice);
-        mInputBuffer.release();
+        uploadFrame(mInputImage.data.get(), mInputImage.wPitch * mInputImage.h, FrameMetadata());
         QThread::msleep(1000 / mFPS);
 
         {
@@ -0,0 +1,543 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "SequenceCamera.h"
+#include "RawProcessor.h"
+#include "RawSequence.h"
+#include "RawCodec.h"
+#include "ppm.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QCollator>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+//Frames read ahead of the played one
+const int kPrefetchFrames = 8;
+
+//Parse a binary PGM header, return the offset of the samples or 0
+size_t parsePgmHeader(const uchar* p, size_t size, unsigned& width, unsigned& height, unsigned& maxVal)
+{
+    if(size < 2 || p[0] != 'P' || p[1] != '5')
+        return 0;
+
+    size_t pos = 2;
+    unsigned values[3];
+    for(unsigned& v : values)
+    {
+        //Whitespace and comments
+        while(pos < size && (isspace(p[pos]) || p[pos] == '#'))
+        {
+            if(p[pos] == '#')
+                while(pos < size && p[pos] != '\n')
+                    pos++;
+            else
+                pos++;
+        }
+        if(pos >= size || !isdigit(p[pos]))
+            return 0;
+        v = 0;
+        while(pos < size && isdigit(p[pos]))
+            v = v * 10 + unsigned(p[pos++] - '0');
+    }
+    //Single whitespace before the samples
+    if(pos >= size || !isspace(p[pos]))
+        return 0;
+
+    width = values[0];
+    height = values[1];
+    maxVal = values[2];
+    if(width == 0 || height == 0 || maxVal == 0 || maxVal > 65535)
+        return 0;
+    return pos + 1;
+}
+
+void adviseWillNeed(const uchar* ptr, qint64 size)
+{
+#ifdef Q_OS_UNIX
+    if(ptr == nullptr || size <= 0)
+        return;
+    const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    uintptr_t start = uintptr_t(ptr) & ~(page - 1);
+    madvise(reinterpret_cast<void*>(start), size_t(uintptr_t(ptr) + uintptr_t(size) - start), MADV_WILLNEED);
+#else
+    Q_UNUSED(ptr)
+    Q_UNUSED(size)
+#endif
+}
+}
+
+SequenceCamera::SequenceCamera(const QString& path,
+                               fastBayerPattern_t pattern,
+                               bool isColor) :
+    mPath(path)
+{
+    mPattern = pattern;
+    mIsColor = isColor;
+    mCameraThread.setObjectName(QStringLiteral("SequenceCameraThread"));
+    moveToThread(&mCameraThread);
+    mCameraThread.start();
+}
+
+SequenceCamera::~SequenceCamera()
+{
+    //Leave the streaming loop, the mapping goes away with mFile
+    mState = cstClosed;
+    mCameraThread.quit();
+    mCameraThread.wait(3000);
+}
+
+void SequenceCamera::setPlayback(PlaybackMode mode, bool loop)
+{
+    mMode = mode;
+    mLoop = loop;
+}
+
+void SequenceCamera::setSubset(int part, int parts)
+{
+    mParts = qMax(1, parts);
+    mPart = qBound(0, part, mParts - 1);
+}
+
+void SequenceCamera::applySubset()
+{
+    if(mParts <= 1)
+        return;
+
+    //Frames [first, last) of the part, sizes differ by one at most
+    const qint64 count = mFrames.size();
+    const int first = int(count * mPart / mParts);
+    const int last = int(count * (mPart + 1) / mParts);
+    QVector<Frame> frames;
+    QStringList files;
+    for(int i = first; i < last; i++)
+    {
+        frames.append(mFrames[i]);
+        if(!mPgmFiles.isEmpty())
+            files.append(mPgmFiles[i]);
+    }
+    mFrames = frames;
+    mPgmFiles = files;
+}
+
+bool SequenceCamera::open(uint32_t devID)
+{
+    Q_UNUSED(devID)
+
+    mState = cstClosed;
+
+    mManufacturer = QStringLiteral("Fastvideo");
+    mModel = QStringLiteral("Raw sequence player");
+    mSerial = QStringLiteral("0000");
+
+    mFrames.clear();
+    mPgmFiles.clear();
+
+    QFileInfo info(mPath);
+    bool ret = false;
+    if(info.isDir())
+        ret = openDirectory();
+    else if(info.suffix().compare(QLatin1String("fvr"), Qt::CaseInsensitive) == 0)
+        ret = openSequence();
+    else
+    {
+        //A PGM file stands for its directory
+        mPath = info.path();
+        ret = openDirectory();
+    }
+    if(!ret)
+        return false;
+    applySubset();
+    if(mFrames.isEmpty())
+        return false;
+
+    mState = cstStopped;
+    emit stateChanged(cstStopped);
+    return true;
+}
+
+bool SequenceCamera::setFormat(unsigned width, unsigned height, unsigned bitDepth)
+{
+    if(bitDepth <= 8)
+    {
+        mImageFormat = cif8bpp;
+        mSurfaceFormat = FAST_I8;
+    }
+    else if(bitDepth <= 10)
+    {
+        mImageFormat = cif10bpp;
+        mSurfaceFormat = FAST_I10;
+    }
+    else if(bitDepth <= 12)
+    {
+        mImageFormat = cif12bpp;
+        mSurfaceFormat = FAST_I12;
+    }
+    else if(bitDepth <= 14)
+    {
+        mImageFormat = cif16bpp;
+        mSurfaceFormat = FAST_I14;
+    }
+    else
+    {
+        mImageFormat = cif16bpp;
+        mSurfaceFormat = FAST_I16;
+    }
+
+    mWidth = int(width);
+    mHeight = int(height);
+    mWhite = (1 << qMin(bitDepth, 16u)) - 1;
+    mBblack = 0;
+
+    mStagingPitch = size_t(width) * (mSurfaceFormat == FAST_I8 ? 1 : 2);
+    FastAllocator alloc;
+    mStaging.reset(static_cast<unsigned char*>(alloc.allocate(mStagingPitch * height)));
+
+    return mInputBuffer.allocate(mWidth, mHeight, mSurfaceFormat);
+}
+
+bool SequenceCamera::openSequence()
+{
+    mMap = nullptr;
+    mFile.close();
+    mFile.setFileName(mPath);
+    if(!mFile.open(QFile::ReadOnly))
+        return false;
+
+    const qint64 fileSize = mFile.size();
+    if(fileSize < qint64(sizeof(RawSequenceHeader)))
+        return false;
+
+    mMap = mFile.map(0, fileSize);
+    if(mMap == nullptr)
+        return false;
+#ifdef Q_OS_UNIX
+    madvise(mMap, size_t(fileSize), MADV_SEQUENTIAL);
+#endif
+
+    RawSequenceHeader hdr;
+    memcpy(&hdr, mMap, sizeof(hdr));
+    if(memcmp(hdr.magic, RawSequenceHeader().magic, sizeof(hdr.magic)) != 0 || hdr.version != 1)
+        return false;
+
+    auto addFrame = [this, fileSize](qint64 offset)
+    {
+        if(offset < qint64(sizeof(RawSequenceHeader)) || offset + qint64(sizeof(RawFrameHeader)) > fileSize)
+            return false;
+        RawFrameHeader rec;
+        memcpy(&rec, mMap + offset, sizeof(rec));
+        if(rec.magic != RawFrameHeader::Magic || offset + qint64(sizeof(rec)) + rec.size > fileSize)
+            return false;
+
+        Frame f;
+        f.offset = offset;
+        f.size = rec.size;
+        f.meta.frameId = rec.frameId;
+        f.meta.deviceTimestamp = rec.deviceTimestamp;
+        f.meta.hostTimestampUs = rec.hostTimestampUs;
+        mFrames.append(f);
+        return true;
+    };
+
+    if(hdr.frameCount > quint64(fileSize) / sizeof(quint64))
+        return false;
+    const qint64 indexSize = qint64(hdr.frameCount) * qint64(sizeof(quint64));
+    if(hdr.indexOffset != 0 && hdr.indexOffset <= quint64(fileSize - indexSize))
+    {
+        const uchar* index = mMap + hdr.indexOffset;
+        for(quint64 i = 0; i < hdr.frameCount; i++)
+        {
+            quint64 offset;
+            memcpy(&offset, index + i * sizeof(quint64), sizeof(offset));
+            addFrame(qint64(offset));
+        }
+    }
+    else
+    {
+        //Interrupted recording, walk the records up to the first broken one
+        qint64 offset = sizeof(RawSequenceHeader);
+        while(addFrame(offset))
+            offset += qint64(sizeof(RawFrameHeader)) + mFrames.last().size;
+        qDebug("%s has no index, %d frames found", qPrintable(mPath), mFrames.size());
+    }
+    if(mFrames.isEmpty())
+        return false;
+
+    mFPS = 60;
+    const qint64 durationUs = mFrames.last().meta.hostTimestampUs - mFrames.first().meta.hostTimestampUs;
+    if(mFrames.size() > 1 && durationUs > 0)
+        mFPS = float(double(mFrames.size() - 1) * 1000000. / double(durationUs));
+
+    if(hdr.bayerPattern == FAST_BAYER_NONE)
+        mIsColor = false;
+    else
+        mPattern = fastBayerPattern_t(hdr.bayerPattern);
+
+    return setFormat(hdr.width, hdr.height, hdr.bitDepth);
+}
+
+bool SequenceCamera::openDirectory()
+{
+    QDir dir(mPath);
+    mPgmFiles = dir.entryList(QStringList() << QStringLiteral("*.pgm"), QDir::Files);
+    if(mPgmFiles.isEmpty())
+        return false;
+
+    //Recorded names are prefix + frame number without leading zeros
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(mPgmFiles.begin(), mPgmFiles.end(), collator);
+    for(QString& name : mPgmFiles)
+        name = dir.absoluteFilePath(name);
+
+    QFile f(mPgmFiles.first());
+    if(!f.open(QFile::ReadOnly))
+        return false;
+    const uchar* p = f.map(0, f.size());
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned maxVal = 0;
+    if(p == nullptr || parsePgmHeader(p, size_t(f.size()), width, height, maxVal) == 0)
+        return false;
+
+    //Frame ids follow the file order, the same in every subset
+    mFrames.resize(mPgmFiles.size());
+    for(int i = 0; i < mFrames.size(); i++)
+        mFrames[i].meta.frameId = uint64_t(i) + 1;
+    mFPS = 60;
+
+    int bitDepth = 1;
+    while((1u << bitDepth) - 1 < maxVal)
+        bitDepth++;
+    return setFormat(width, height, unsigned(bitDepth));
+}
+
+void SequenceCamera::prefetch(int idx)
+{
+    if(idx < 0 || idx >= mFrames.size())
+        return;
+
+    if(mMap)
+    {
+        const Frame& f = mFrames[idx];
+        adviseWillNeed(mMap + f.offset, qint64(sizeof(RawFrameHeader)) + f.size);
+        return;
+    }
+#ifdef Q_OS_UNIX
+    //Start reading the file into the page cache, it is mapped later
+    QFile f(mPgmFiles[idx]);
+    if(f.open(QFile::ReadOnly))
+        posix_fadvise(f.handle(), 0, 0, POSIX_FADV_WILLNEED);
+#endif
+}
+
+bool SequenceCamera::loadFrame(int idx)
+{
+    if(mMap)
+    {
+        const Frame& f = mFrames[idx];
+        const uchar* data = mMap + f.offset + sizeof(RawFrameHeader);
+        RawCodec::Header hdr;
+        if(!RawCodec::header(data, f.size, hdr) ||
+           int(hdr.width) != mWidth || int(hdr.height) != mHeight ||
+           size_t(hdr.width) * hdr.bytesPerSample != mStagingPitch)
+            return false;
+
+        return RawCodec::decode(data, f.size, mStaging.get(), unsigned(mStagingPitch),
+                                mStagingPitch * size_t(mHeight));
+    }
+
+    QFile f(mPgmFiles[idx]);
+    if(!f.open(QFile::ReadOnly))
+        return false;
+    const uchar* p = f.map(0, f.size());
+    if(p == nullptr)
+        return false;
+
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned maxVal = 0;
+    size_t offset = parsePgmHeader(p, size_t(f.size()), width, height, maxVal);
+    const size_t rowBytes = size_t(width) * (maxVal > 255 ? 2 : 1);
+    if(offset == 0 || int(width) != mWidth || int(height) != mHeight || rowBytes != mStagingPitch ||
+       offset + rowBytes * height > size_t(f.size()))
+    {
+        qDebug("Skipping %s, frame size differs", qPrintable(mPgmFiles[idx]));
+        return false;
+    }
+
+    //PGM samples are big endian
+    if(maxVal > 255)
+        swapBytes16Rows(mStaging.get(), unsigned(mStagingPitch), p + offset, unsigned(rowBytes), unsigned(rowBytes), height);
+    else
+        memcpy(mStaging.get(), p + offset, rowBytes * height);
+    return true;
+}
+
+bool SequenceCamera::start()
+{
+    mState = cstStreaming;
+    emit stateChanged(cstStreaming);
+    QTimer::singleShot(0, this, [this](){startStreaming();});
+    return true;
+}
+
+bool SequenceCamera::stop()
+{
+    mState = cstStopped;
+    emit stateChanged(cstStopped);
+
+    return true;
+}
+
+void SequenceCamera::close()
+{
+    stop();
+    mState = cstClosed;
+    emit stateChanged(cstClosed);
+}
+
+void SequenceCamera::startStreaming()
+{
+    if(mState != cstStreaming || mFrames.isEmpty() || !mStaging)
+        return;
+
+    const qint64 startUs = mMap ? mFrames.first().meta.hostTimestampUs : 0;
+    QElapsedTimer timer;
+    int idx = 0;
+    //Frames loaded in the current pass
+    int loaded = 0;
+    for(int i = 0; i < kPrefetchFrames; i++)
+        prefetch(i);
+    timer.start();
+
+    while(mState == cstStreaming)
+    {
+        if(idx >= mFrames.size())
+        {
+            //Looping over frames that all fail to load would only spin
+            if(loaded == 0)
+                qDebug("No frame of %s could be loaded", qPrintable(mPath));
+            if(!mLoop || loaded == 0)
+            {
+                stop();
+                break;
+            }
+            idx = 0;
+            loaded = 0;
+            for(int i = 0; i < kPrefetchFrames; i++)
+                prefetch(i);
+            timer.restart();
+        }
+
+        prefetch(idx + kPrefetchFrames);
+        if(!loadFrame(idx))
+        {
+            idx++;
+            continue;
+        }
+        loaded++;
+
+        if(mMode == pmRecorded)
+        {
+            qint64 dueUs = mMap ? mFrames[idx].meta.hostTimestampUs - startUs :
+                                  qint64(double(idx) * 1000000. / double(mFPS));
+            qint64 waitUs = dueUs - timer.nsecsElapsed() / 1000;
+            if(waitUs > 0)
+                QThread::usleep(static_cast<unsigned long>(waitUs));
+        }
+
+        //Capture time is the playback time, ids and device timestamps are recorded ones
+        FrameMetadata meta = mFrames[idx].meta;
+        meta.hostTimestampUs = 0;
+        uploadFrame(mStaging.get(), mStagingPitch * size_t(mHeight), meta);
+
+        {
+            QMutexLocker l(&mLock);
+            if(mRawProc)
+                mRawProc->wake();
+        }
+        //The next frame must not overwrite one not processed yet, the timeout
+        //only lets a stop request through
+        if(mMode == pmMaxSpeed)
+        {
+            while(mState == cstStreaming && !mInputBuffer.waitConsumed(1000))
+                ;
+        }
+        idx++;
+    }
+}
+
+bool SequenceCamera::getParameter(cmrCameraParameter param, float& val)
+{
+    if(param < 0 || param > prmLast)
+        return false;
+
+    switch (param)
+    {
+    case prmFrameRate:
+        val = mFPS;
+        return true;
+
+    case prmExposureTime:
+        val = 1000 / mFPS;
+        return true;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+bool SequenceCamera::setParameter(cmrCameraParameter param, float val)
+{
+    Q_UNUSED(param)
+    Q_UNUSED(val)
+    return false;
+}
+
+bool SequenceCamera::getParameterInfo(cmrParameterInfo& info)
+{
+    Q_UNUSED(info)
+    return false;
+}
@@ -0,0 +1,107 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef SEQUENCECAMERA_H
+#define SEQUENCECAMERA_H
+
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+#include "GPUCameraBase.h"
+#include "FrameBuffer.h"
+#include "FastAllocator.h"
+
+///Plays a recorded raw sequence through the pipeline: a raw sequence file
+///(.fvr, see RawSequence.h) or a directory of PGM files in name order.
+///Files are memory mapped, the frames ahead are prefetched with
+///madvise/posix_fadvise. Frames go out at the recorded timing or as fast
+///as the processing takes them.
+class SequenceCamera : public GPUCameraBase
+{
+public:
+    enum PlaybackMode
+    {
+        pmRecorded = 0, ///Recorded timestamps, PGM frames at fps()
+        pmMaxSpeed      ///Next frame as soon as the previous one was processed
+    };
+
+    SequenceCamera(const QString& path, fastBayerPattern_t pattern, bool isColor = true);
+    ~SequenceCamera();
+
+    ///Set before start()
+    void setPlayback(PlaybackMode mode, bool loop);
+    ///Play the part-th of parts contiguous ranges of frames, to split a sequence
+    ///between pipelines. Container outputs (mjpg, fvr) of a pipeline then hold
+    ///consecutive frames. Set before open().
+    void setSubset(int part, int parts);
+    int frameCount() const {return mFrames.size();}
+
+    virtual bool open(uint32_t devID);
+    virtual bool start();
+    virtual bool stop();
+    virtual void close();
+
+    virtual bool getParameter(cmrCameraParameter param, float& val);
+    virtual bool setParameter(cmrCameraParameter param, float val);
+    virtual bool getParameterInfo(cmrParameterInfo& info);
+
+private:
+    struct Frame
+    {
+        qint64 offset = 0;  ///Record offset in the sequence file
+        unsigned size = 0;
+        FrameMetadata meta;
+    };
+
+    bool openSequence();
+    bool openDirectory();
+    bool setFormat(unsigned width, unsigned height, unsigned bitDepth);
+    void applySubset();
+    ///Decode or copy frame idx to mStaging
+    bool loadFrame(int idx);
+    void prefetch(int idx);
+    void startStreaming();
+
+    QString mPath;
+    PlaybackMode mMode = pmRecorded;
+    bool mLoop = true;
+    int mPart = 0;
+    int mParts = 1;
+
+    QFile mFile;
+    uchar* mMap = nullptr;
+    QStringList mPgmFiles;
+    QVector<Frame> mFrames;
+
+    std::unique_ptr<unsigned char, FastAllocator> mStaging;
+    size_t mStagingPitch = 0;
+};
+
+#endif // SEQUENCECAMERA_H
@@ -35,93 +35,6 @@
 
 ///////////////////////////////////////////
 
-/**
- * @brief getdata
- * @param data - input bit stream
- * @param offs - offset in bits stream
- * @param bits - bits in value
- * @return
- */
-uint16_t getdata(char* data, int& offs, int bits)
-{
-    int off1 = offs / 8;
-    int off2 = offs % 8;
-    uint16_t res = *(uint16_t*)&data[off1];
-    res >>= (off2);
-    return res & ((1 << bits) - 1);
-}
-
-/**
- * @brief read_inputstream
- * @param data - input bits stream
- * @param szbits - size of input bitstream
- * @param bits - bits in pixel
- * @param out - ouput stream
- */
-void read_inputstream(char* data, size_t szbits, int bits, uint16_t* out)
-{
-    int off = 0;
-    int id = 0;
-    uint16_t group[16];
-    int lowb = bits - 8;
-    int mask = (1 << lowb) - 1;
-    for(; off < szbits;){
-        for(int i = 0; i < 16; ++i){
-            group[i] = getdata(data, off, 8) << lowb;
-            off += 8;
-        }
-        for(int i = 0; i < 16; ++i){
-            group[i] = group[i] | ((getdata(data, off, lowb) & mask));
-            off += lowb;
-        }
-        memcpy(&out[id], group, sizeof(group));
-        id += 16;
-    }
-}
-
-/**
- * @brief read_inputstreamP
- * @param data - input bits stream
- * @param szbits - size of input bitstream
- * @param bits - bits in pixel
- * @param out - ouput stream
- */
-void read_inputstreamP(char* data, size_t szbits, int bits, uint16_t* out)
-{
-    //int off = 0;
-    //int id = 0;
-    int lowb = bits - 8;
-    int mask = (1 << lowb) - 1;
-    int cnto = bits * 16;
-    int cnt = static_cast<int>(szbits / cnto);
-#pragma omp parallel for
-    for(int i = 0; i < cnt; ++i){
-        uint16_t group[16];
-        int off = i * cnto;
-        int id = i * 16;
-        for(int i = 0; i < 16; ++i){
-            group[i] = getdata(data, off, 8) << lowb;
-            off += 8;
-        }
-        for(int i = 0; i < 16; ++i){
-            group[i] = group[i] | ((getdata(data, off, lowb) & mask));
-            off += lowb;
-        }
-        memcpy(&out[id], group, sizeof(group));
-        //id += 16;
-    }
-}
-
-std::map<fastSurfaceFormat_t, int> Bits = {
-    {FAST_I8, 8},
-    {FAST_I10, 10},
-    {FAST_I12, 12},
-    {FAST_I14, 14},
-    {FAST_I16, 16},
-};
-
-///////////////////////////////////////////
-
 XimeaCamera::XimeaCamera() :
     GPUCameraBase()
 {
@@ -154,6 +67,7 @@ bool XimeaCamera::open(uint32_t devID)
         char str[256] = {0};
         ret = xiGetParamString(hDevice, XI_PRM_DEVICE_NAME, str, sizeof(str));
         mModel = QString::fromLocal8Bit(str);
+        //This model sends XIMEA transport packing the GPU importer does not handle
         mPacked = mModel.toUpper() == QString("MU181CR-ON");
 
         ret = xiGetParamString(hDevice, XI_PRM_DEVICE_SN, str, sizeof(str));
@@ -199,8 +113,10 @@ bool XimeaCamera::open(uint32_t devID)
         {
             if(mPacked){
                 mImageFormat = cif12bpp;
+                mPacking = rpXimea12;
             }else{
                 mImageFormat = cif12bpp_p;
+                mPacking = rpPFNC12p;
             }
             mSurfaceFormat = FAST_I12;
         }
@@ -309,14 +225,8 @@ void XimeaCamera::startStreaming()
         return;
 
     QByteArray frameData;
-    frameData.resize((int)mInputBuffer.size());
-    QByteArray packedData;
-    size_t sizeBits = 0;
-    int bits = Bits[mSurfaceFormat];
-    if(mPacked){
-        sizeBits = mWidth * mHeight * bits;
-        packedData.resize((int)mInputBuffer.size());
-    }
+    //XI API may report not enough memory for a buffer of the exact frame size
+    frameData.resize((int)mInputBuffer.size() * 2);
 
     XI_IMG image = {0};
     image.size = sizeof(XI_IMG);
@@ -327,18 +237,17 @@ void XimeaCamera::startStreaming()
     while(mState == cstStreaming)
     {
         tmr.restart();
-        if(mPacked){
-            image.bp = packedData.data();
-            ret = xiGetImage(hDevice, 5000, &image);
-            read_inputstreamP(packedData.data(), sizeBits, bits, (uint16_t*)frameData.data());
-            image.bp_size = mWidth * mHeight * sizeof(uint16_t);
-        }else{
-            image.bp = frameData.data();
+        int64_t hostTimeUs = 0;
+        {
+            TRACE_SCOPE("camera", "wait frame");
             ret = xiGetImage(hDevice, 5000, &image);
+            hostTimeUs = CircularBuffer::hostTimeUs();
         }
-        unsigned char* dst = mInputBuffer.getBuffer();
-        cudaMemcpy(dst, frameData.data(), image.bp_size, cudaMemcpyHostToDevice);
-        mInputBuffer.release();
+        FrameMetadata meta;
+        meta.frameId = image.nframe;
+        meta.deviceTimestamp = uint64_t(image.tsSec) * 1000000000ull + uint64_t(image.tsUSec) * 1000ull;
+        meta.hostTimestampUs = hostTimeUs;
+        uploadFrame(frameData.data(), image.bp_size, meta);
 
         {
             QMutexLocker l(&mLock);
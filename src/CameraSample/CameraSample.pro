@@ -9,6 +9,10 @@ TARGET = $$PROJECT_NAME
 TEMPLATE = app
 
 unix:  FASTVIDEO_EXTRA_DLLS += $$PWD/GPUCameraSample.sh
+unix {
+    QMAKE_CXXFLAGS += -fopenmp
+    QMAKE_LFLAGS += -fopenmp
+}
 
 #CONFIG += console
 
@@ -33,16 +37,32 @@ SOURCES += main.cpp\
     helper_jpeg_load.cpp \
     helper_jpeg_store.cpp \
     RawProcessor.cpp \
+    RawUnpack.cpp \
+    Tracer.cpp \
     AsyncFileWriter.cpp \
     MJPEGEncoder.cpp \
+    MetricsServer.cpp \
+    PipelineManager.cpp \
+    FrameSynchronizer.cpp \
+    BurstRecorder.cpp \
+    ThreadPolicy.cpp \
+    RawCodec.cpp \
+    RawSequence.cpp \
+    TiffWriter.cpp \
+    DngWriter.cpp \
+    JpegRateControl.cpp \
+    BatchProcessor.cpp \
     avfilewriter/avfilewriter.cpp \
     $$OTHER_LIB_PATH/FastvideoSDK/common/SurfaceTraits.cpp \
     $$OTHER_LIB_PATH/FastvideoSDK/common/alignment.cpp \
     Camera/GPUCameraBase.cpp \
     Camera/FrameBuffer.cpp \
     Camera/PGMCamera.cpp \
+    Camera/SequenceCamera.cpp \
     CUDASupport/CUDAProcessorBase.cpp \
     CUDASupport/CUDAProcessorGray.cpp \
+    CUDASupport/PipelineTelemetry.cpp \
+    CUDASupport/GpuTraceTimeline.cpp \
     Widgets/DenoiseController.cpp \
     Widgets/GLImageViewer.cpp \
     Widgets/GtGWidget.cpp \
@@ -66,17 +86,34 @@ HEADERS  += MainWindow.h \
     ppm.h \
     helper_jpeg.hpp \
     RawProcessor.h \
+    RawUnpack.h \
+    Tracer.h \
     AsyncFileWriter.h \
     AsyncQueue.h \
     MJPEGEncoder.h \
+    MetricsServer.h \
+    PipelineManager.h \
+    FrameSynchronizer.h \
+    BurstRecorder.h \
+    ThreadPolicy.h \
+    RawCodec.h \
+    RawSequence.h \
+    TiffWriter.h \
+    DngWriter.h \
+    JpegRateControl.h \
+    BatchProcessor.h \
     avfilewriter/avfilewriter.h \
     Camera/GPUCameraBase.h \
     Camera/FrameBuffer.h \
     Camera/PGMCamera.h \
+    Camera/SequenceCamera.h \
     CUDASupport/CUDAProcessorGray.h \
     CUDASupport/CUDAProcessorBase.h \
+    CUDASupport/PipelineTelemetry.h \
+    CUDASupport/GpuTraceTimeline.h \
     CUDASupport/CUDAProcessorOptions.h \
     CUDASupport/CudaAllocator.h \
+    CUDASupport/FrameMetadata.h \
     CUDASupport/GPUImage.h \
     Widgets/DenoiseController.h \
     Widgets/GLImageViewer.h \
@@ -118,7 +155,8 @@ contains(DEFINES, SUPPORT_GENICAM ){
     rc_genicam_api/pointcloud.cc \
     rc_genicam_api/stream.cc \
     rc_genicam_api/system.cc \
-    Camera/GeniCamCamera.cpp
+    Camera/GeniCamCamera.cpp \
+    GenICamBench.cpp
 
     unix:  SOURCES += rc_genicam_api/gentl_wrapper_linux.cc
     win32: SOURCES += rc_genicam_api/gentl_wrapper_win32.cc
@@ -136,7 +174,8 @@ contains(DEFINES, SUPPORT_GENICAM ){
     rc_genicam_api/pointcloud.h \
     rc_genicam_api/stream.h \
     rc_genicam_api/system.h \
-    Camera/GeniCamCamera.h
+    Camera/GeniCamCamera.h \
+    GenICamBench.h
 }
 
 contains(DEFINES, SUPPORT_LUCID ){
@@ -0,0 +1,562 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "DngWriter.h"
+#include "TiffWriter.h"
+#include "CUDAProcessorOptions.h"
+#include "SurfaceTraits.hpp"
+#include "version.h"
+
+#include <QFile>
+#include <QDateTime>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+enum Tag : uint16_t
+{
+    tagNewSubfileType = 254,
+    tagImageWidth = 256,
+    tagImageLength = 257,
+    tagBitsPerSample = 258,
+    tagCompression = 259,
+    tagPhotometric = 262,
+    tagMake = 271,
+    tagModel = 272,
+    tagOrientation = 274,
+    tagSamplesPerPixel = 277,
+    tagPlanarConfiguration = 284,
+    tagSoftware = 305,
+    tagDateTime = 306,
+    tagTileWidth = 322,
+    tagTileLength = 323,
+    tagTileOffsets = 324,
+    tagTileByteCounts = 325,
+    tagCFARepeatPatternDim = 33421,
+    tagCFAPattern = 33422,
+    tagImageNumber = 37393,
+    tagDNGVersion = 50706,
+    tagDNGBackwardVersion = 50707,
+    tagUniqueCameraModel = 50708,
+    tagLinearizationTable = 50712,
+    tagBlackLevel = 50714,
+    tagWhiteLevel = 50717,
+    tagColorMatrix1 = 50721,
+    tagAsShotNeutral = 50728,
+    tagBaselineExposure = 50730,
+    tagCalibrationIlluminant1 = 50778
+};
+
+int threadCount()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+///Entropy coded segment writer with 0xFF byte stuffing
+class JpegBitWriter
+{
+public:
+    explicit JpegBitWriter(std::vector<unsigned char>& out) : mOut(out) {}
+
+    ///Up to 32 bits
+    void put(uint32_t bits, unsigned count)
+    {
+        mAcc = (mAcc << count) | (bits & uint32_t((uint64_t(1) << count) - 1));
+        mCount += count;
+        while(mCount >= 8)
+        {
+            mCount -= 8;
+            unsigned char b = (unsigned char)(mAcc >> mCount);
+            mOut.push_back(b);
+            if(b == 0xFF)
+                mOut.push_back(0);
+        }
+    }
+    ///Pad the last byte with ones
+    void flush()
+    {
+        if(mCount > 0)
+            put(0x7F, 8 - mCount);
+    }
+
+private:
+    std::vector<unsigned char>& mOut;
+    uint64_t mAcc = 0;
+    unsigned mCount = 0;
+};
+
+///Difference magnitude category (SSSS), bit length of |diff|
+inline unsigned category(int diff)
+{
+    uint32_t v = uint32_t(diff < 0 ? -diff : diff);
+    if(v == 0)
+        return 0;
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse(&idx, v);
+    return unsigned(idx) + 1;
+#else
+    return 32 - unsigned(__builtin_clz(v));
+#endif
+}
+
+///Code lengths of the optimal table limited to 16 bits, ITU T.81 Annex K.2.
+///bits[l] - number of codes of length l, vals - symbols by code length.
+void huffmanTable(const uint32_t* counts, unsigned char bits[17], std::vector<unsigned char>& vals)
+{
+    const int symbols = 17;
+    //Symbol 17 reserves the all ones code
+    long freq[symbols + 1];
+    int codeSize[symbols + 1];
+    int others[symbols + 1];
+    for(int i = 0; i < symbols; i++)
+        freq[i] = long(counts[i]);
+    freq[symbols] = 1;
+    std::fill(codeSize, codeSize + symbols + 1, 0);
+    std::fill(others, others + symbols + 1, -1);
+
+    while(true)
+    {
+        int v1 = -1;
+        int v2 = -1;
+        for(int i = 0; i <= symbols; i++)
+        {
+            if(freq[i] > 0 && (v1 < 0 || freq[i] <= freq[v1]))
+                v1 = i;
+        }
+        for(int i = 0; i <= symbols; i++)
+        {
+            if(i != v1 && freq[i] > 0 && (v2 < 0 || freq[i] <= freq[v2]))
+                v2 = i;
+        }
+        if(v2 < 0)
+            break;
+
+        freq[v1] += freq[v2];
+        freq[v2] = 0;
+        codeSize[v1]++;
+        while(others[v1] >= 0)
+        {
+            v1 = others[v1];
+            codeSize[v1]++;
+        }
+        others[v1] = v2;
+        codeSize[v2]++;
+        while(others[v2] >= 0)
+        {
+            v2 = others[v2];
+            codeSize[v2]++;
+        }
+    }
+
+    int count[33] = {};
+    for(int i = 0; i <= symbols; i++)
+    {
+        if(codeSize[i])
+            count[codeSize[i]]++;
+    }
+    for(int i = 32; i > 16; i--)
+    {
+        while(count[i] > 0)
+        {
+            int j = i - 2;
+            while(count[j] == 0)
+                j--;
+            count[i] -= 2;
+            count[i - 1]++;
+            count[j + 1] += 2;
+            count[j]--;
+        }
+    }
+    int last = 16;
+    while(count[last] == 0)
+        last--;
+    count[last]--;
+
+    bits[0] = 0;
+    for(int i = 1; i <= 16; i++)
+        bits[i] = (unsigned char)count[i];
+
+    vals.clear();
+    for(int len = 1; len <= 32; len++)
+    {
+        for(int i = 0; i < symbols; i++)
+        {
+            if(codeSize[i] == len)
+                vals.push_back((unsigned char)i);
+        }
+    }
+}
+
+void putMarker(std::vector<unsigned char>& out, unsigned char marker, unsigned length)
+{
+    out.push_back(0xFF);
+    out.push_back(marker);
+    out.push_back((unsigned char)(length >> 8));
+    out.push_back((unsigned char)length);
+}
+
+///Lossless JPEG of a tile, predictor 1. Pairs of CFA columns are two
+///interleaved components, left prediction stays within a colour.
+void encodeLosslessTile(const int* diffs, unsigned width, unsigned height, unsigned precision,
+                        std::vector<unsigned char>& out)
+{
+    const size_t count = size_t(width) * height;
+    uint32_t hist[17] = {};
+    for(size_t i = 0; i < count; i++)
+        hist[category(diffs[i])]++;
+
+    unsigned char bits[17];
+    std::vector<unsigned char> vals;
+    huffmanTable(hist, bits, vals);
+
+    uint32_t code[17] = {};
+    unsigned char size[17] = {};
+    uint32_t c = 0;
+    size_t k = 0;
+    for(int len = 1; len <= 16; len++)
+    {
+        for(int i = 0; i < bits[len]; i++)
+        {
+            code[vals[k]] = c++;
+            size[vals[k]] = (unsigned char)len;
+            k++;
+        }
+        c <<= 1;
+    }
+
+    out.clear();
+    out.push_back(0xFF);
+    out.push_back(0xD8);
+
+    putMarker(out, 0xC4, 2 + 1 + 16 + unsigned(vals.size()));
+    out.push_back(0x00);
+    out.insert(out.end(), bits + 1, bits + 17);
+    out.insert(out.end(), vals.begin(), vals.end());
+
+    putMarker(out, 0xC3, 8 + 3 * 2);
+    out.push_back((unsigned char)precision);
+    out.push_back((unsigned char)(height >> 8));
+    out.push_back((unsigned char)height);
+    out.push_back((unsigned char)((width / 2) >> 8));
+    out.push_back((unsigned char)(width / 2));
+    out.push_back(2);
+    for(unsigned char id = 1; id <= 2; id++)
+    {
+        out.push_back(id);
+        out.push_back(0x11);
+        out.push_back(0);
+    }
+
+    putMarker(out, 0xDA, 6 + 2 * 2);
+    out.push_back(2);
+    out.push_back(1);
+    out.push_back(0x00);
+    out.push_back(2);
+    out.push_back(0x00);
+    out.push_back(1);   //Predictor
+    out.push_back(0);
+    out.push_back(0);
+
+    JpegBitWriter bw(out);
+    for(size_t i = 0; i < count; i++)
+    {
+        const int diff = diffs[i];
+        const unsigned ssss = category(diff);
+        //Code and additional bits at once, 16 has no additional bits
+        const unsigned extra = ssss < 16 ? ssss : 0;
+        const uint32_t bits = (code[ssss] << extra) | (uint32_t(diff < 0 ? diff - 1 : diff) & ((1u << extra) - 1));
+        bw.put(bits, size[ssss] + extra);
+    }
+    bw.flush();
+
+    out.push_back(0xFF);
+    out.push_back(0xD9);
+}
+
+///Samples of the tile with edges extended by the last two columns and rows,
+///which keeps the CFA colours
+template<typename T>
+void tileDiffs(const unsigned char* src, unsigned pitch, unsigned width, unsigned height,
+               unsigned x0, unsigned y0, unsigned tile, unsigned precision, int* diffs)
+{
+    const int mask = 0xFFFF;
+    auto clampIdx = [](unsigned i, unsigned n) {return i < n ? i : (n >= 2 ? n - 2 + ((i - n) & 1) : 0);};
+    std::vector<int> prev(tile);
+    std::vector<int> cur(tile);
+    for(unsigned y = 0; y < tile; y++)
+    {
+        const T* row = reinterpret_cast<const T*>(src + size_t(clampIdx(y0 + y, height)) * pitch);
+        for(unsigned x = 0; x < tile; x++)
+            cur[x] = row[clampIdx(x0 + x, width)];
+
+        int* d = diffs + size_t(y) * tile;
+        for(unsigned x = 0; x < tile; x++)
+        {
+            int pred;
+            if(x >= 2)
+                pred = cur[x - 2];
+            else if(y > 0)
+                pred = prev[x];
+            else
+                pred = 1 << (precision - 1);
+            //Differences are modulo 2^16, -32768 codes as category 16
+            int diff = (cur[x] - pred) & mask;
+            d[x] = diff >= 32768 ? diff - 65536 : diff;
+        }
+        std::swap(prev, cur);
+    }
+}
+
+template<typename T>
+void copyTile(const unsigned char* src, unsigned pitch, unsigned width, unsigned height,
+              unsigned x0, unsigned y0, unsigned tile, std::vector<unsigned char>& out)
+{
+    out.resize(size_t(tile) * tile * sizeof(T));
+    T* dst = reinterpret_cast<T*>(out.data());
+    const unsigned w = std::min(tile, width - x0);
+    for(unsigned y = 0; y < tile; y++)
+    {
+        const unsigned sy = std::min(y0 + y, height - 1);
+        const T* row = reinterpret_cast<const T*>(src + size_t(sy) * pitch) + x0;
+        memcpy(dst, row, w * sizeof(T));
+        std::fill(dst + w, dst + tile, w > 0 ? row[w - 1] : T(0));
+        dst += tile;
+    }
+}
+
+QVector<uint32_t> rational(double v, uint32_t den = 1000000)
+{
+    return {uint32_t(std::lround(std::max(0., v) * den)), den};
+}
+}
+
+DngWriter::Params DngWriter::fromOptions(const CUDAProcessorOptions& opts, unsigned bayerPattern)
+{
+    Params p;
+    p.width = opts.Width;
+    p.height = opts.Height;
+    p.bytesPerSample = GetBytesPerChannelFromSurface(opts.SurfaceFmt);
+    p.bitDepth = GetBitsPerChannelFromSurface(opts.SurfaceFmt);
+    p.bayerPattern = bayerPattern;
+    p.blackLevel = opts.BlackLevel;
+    p.whiteLevel = opts.WhiteLevel;
+    p.red = opts.Red;
+    p.green = opts.Green;
+    p.blue = opts.Blue;
+    p.exposure = opts.eV;
+    p.linearization = opts.LinearizationLut;
+    return p;
+}
+
+void DngWriter::setParams(const Params& params)
+{
+    mParams = params;
+    mParams.tileSize = std::max(16u, (params.tileSize + 15) / 16 * 16);
+    mParams.bytesPerSample = params.bytesPerSample == 1 ? 1 : 2;
+    mParams.bitDepth = std::min(std::max(params.bitDepth, 2u), mParams.bytesPerSample * 8);
+}
+
+bool DngWriter::write(const QString& fileName, const void* data, unsigned pitch, const FrameMetadata& meta)
+{
+    const Params& p = mParams;
+    if(data == nullptr || p.width == 0 || p.height == 0)
+        return false;
+
+    QFile f(fileName);
+    if(!f.open(QFile::WriteOnly))
+        return false;
+
+    //IFD offset is patched when the tiles are written
+    const char header[8] = {'I', 'I', 42, 0, 0, 0, 0, 0};
+    if(f.write(header, sizeof(header)) != qint64(sizeof(header)))
+        return false;
+
+    const unsigned tile = p.tileSize;
+    const unsigned across = (p.width + tile - 1) / tile;
+    const unsigned down = (p.height + tile - 1) / tile;
+    const int tiles = int(across * down);
+    const unsigned char* src = static_cast<const unsigned char*>(data);
+
+    //A tile is in flight per thread, static schedule gives tile t to thread t % threads
+    const int slots = std::max(1, std::min(threadCount(), tiles));
+    mTiles.resize(size_t(slots));
+    if(p.compress)
+    {
+        mDiffs.resize(size_t(slots));
+        for(auto& d : mDiffs)
+            d.resize(size_t(tile) * tile);
+    }
+
+    QVector<uint32_t> offsets(tiles);
+    QVector<uint32_t> byteCounts(tiles);
+    qint64 pos = sizeof(header);
+    bool ok = true;
+
+#pragma omp parallel for ordered schedule(static, 1) num_threads(slots)
+    for(int t = 0; t < tiles; t++)
+    {
+        std::vector<unsigned char>& out = mTiles[size_t(t % slots)];
+        const unsigned x0 = unsigned(t) % across * tile;
+        const unsigned y0 = unsigned(t) / across * tile;
+        if(p.compress)
+        {
+            int* diffs = mDiffs[size_t(t % slots)].data();
+            if(p.bytesPerSample == 1)
+                tileDiffs<uint8_t>(src, pitch, p.width, p.height, x0, y0, tile, p.bitDepth, diffs);
+            else
+                tileDiffs<uint16_t>(src, pitch, p.width, p.height, x0, y0, tile, p.bitDepth, diffs);
+            encodeLosslessTile(diffs, tile, tile, p.bitDepth, out);
+        }
+        else if(p.bytesPerSample == 1)
+            copyTile<uint8_t>(src, pitch, p.width, p.height, x0, y0, tile, out);
+        else
+            copyTile<uint16_t>(src, pitch, p.width, p.height, x0, y0, tile, out);
+
+#pragma omp ordered
+        {
+            //Tiles start on a word boundary
+            if(pos & 1)
+            {
+                ok = ok && f.putChar(0);
+                pos++;
+            }
+            offsets[t] = uint32_t(pos);
+            byteCounts[t] = uint32_t(out.size());
+            ok = ok && f.write(reinterpret_cast<const char*>(out.data()), qint64(out.size())) == qint64(out.size());
+            pos += qint64(out.size());
+        }
+    }
+    if(!ok)
+        return false;
+
+    const bool cfa = p.bayerPattern != FAST_BAYER_NONE;
+    const QString make = p.make.isEmpty() ? QStringLiteral(APP_ORGANIZATION_NAME) : p.make;
+    const QString model = p.model.isEmpty() ? QStringLiteral("Camera") : p.model;
+    //Levels apply to linearized values, otherwise they cannot exceed the samples
+    uint32_t whiteLevel = p.whiteLevel > 0 ? p.whiteLevel : (1u << p.bitDepth) - 1;
+    if(p.linearization.isEmpty())
+        whiteLevel = std::min(whiteLevel, (1u << p.bitDepth) - 1);
+
+    TiffIfd ifd;
+    ifd.addLong(tagNewSubfileType, {0});
+    ifd.addLong(tagImageWidth, {p.width});
+    ifd.addLong(tagImageLength, {p.height});
+    ifd.addShort(tagBitsPerSample, {uint16_t(p.compress ? p.bitDepth : p.bytesPerSample * 8)});
+    ifd.addShort(tagCompression, {uint16_t(p.compress ? 7 : 1)});
+    ifd.addShort(tagPhotometric, {uint16_t(cfa ? 32803 : 34892)});    //CFA, LinearRaw
+    ifd.addAscii(tagMake, make.toUtf8());
+    ifd.addAscii(tagModel, model.toUtf8());
+    ifd.addShort(tagOrientation, {1});
+    ifd.addShort(tagSamplesPerPixel, {1});
+    ifd.addShort(tagPlanarConfiguration, {1});
+    ifd.addAscii(tagSoftware, QByteArray(MAIN_APPLICATION_NAME " " APP_VERSION_STRING));
+    if(meta.hostTimestampUs > 0)
+    {
+        QDateTime time = QDateTime::fromMSecsSinceEpoch(meta.hostTimestampUs / 1000);
+        ifd.addAscii(tagDateTime, time.toString(QStringLiteral("yyyy:MM:dd HH:mm:ss")).toLatin1());
+    }
+    ifd.addLong(tagTileWidth, {tile});
+    ifd.addLong(tagTileLength, {tile});
+    ifd.addLong(tagTileOffsets, offsets);
+    ifd.addLong(tagTileByteCounts, byteCounts);
+    if(cfa)
+    {
+        //0 - red, 1 - green, 2 - blue
+        QVector<uint8_t> pattern;
+        switch(p.bayerPattern)
+        {
+        case FAST_BAYER_BGGR:
+            pattern = {2, 1, 1, 0};
+            break;
+        case FAST_BAYER_GRBG:
+            pattern = {1, 0, 2, 1};
+            break;
+        case FAST_BAYER_GBRG:
+            pattern = {1, 2, 0, 1};
+            break;
+        default:
+            pattern = {0, 1, 1, 2};
+            break;
+        }
+        ifd.addShort(tagCFARepeatPatternDim, {2, 2});
+        ifd.addByte(tagCFAPattern, pattern);
+    }
+    ifd.addLong(tagImageNumber, {uint32_t(meta.frameId)});
+    ifd.addByte(tagDNGVersion, {1, 4, 0, 0});
+    ifd.addByte(tagDNGBackwardVersion, {1, 1, 0, 0});
+    ifd.addAscii(tagUniqueCameraModel, (make + QChar(' ') + model).toUtf8());
+    if(!p.linearization.isEmpty())
+        ifd.addShort(tagLinearizationTable, p.linearization);
+    ifd.addLong(tagBlackLevel, {p.blackLevel});
+    ifd.addLong(tagWhiteLevel, {whiteLevel});
+    if(cfa)
+    {
+        //No camera calibration, camera RGB is taken as linear sRGB, XYZ (D65) to sRGB
+        ifd.addSRational(tagColorMatrix1, { 32406, 10000, -15372, 10000,  -4986, 10000,
+                                            -9689, 10000,  18758, 10000,    415, 10000,
+                                              557, 10000,  -2040, 10000,  10570, 10000});
+        ifd.addShort(tagCalibrationIlluminant1, {21});
+        //Neutral is the inverse of the gains relative to green
+        QVector<uint32_t> neutral;
+        neutral << rational(p.green / std::max(p.red, 1e-3f))
+                << rational(1.)
+                << rational(p.green / std::max(p.blue, 1e-3f));
+        ifd.addRational(tagAsShotNeutral, neutral);
+    }
+    const int32_t ev = int32_t(std::lround(std::log2(std::max(p.exposure, 1e-3f)) * 100));
+    ifd.addSRational(tagBaselineExposure, {ev, 100});
+
+    if(pos & 1)
+    {
+        f.putChar(0);
+        pos++;
+    }
+    const uint32_t ifdOffset = uint32_t(pos);
+    const QByteArray dir = ifd.serialize(ifdOffset);
+    if(f.write(dir) != dir.size())
+        return false;
+
+    const unsigned char offset[4] = {(unsigned char)ifdOffset, (unsigned char)(ifdOffset >> 8),
+                                     (unsigned char)(ifdOffset >> 16), (unsigned char)(ifdOffset >> 24)};
+    return f.seek(4) && f.write(reinterpret_cast<const char*>(offset), 4) == 4;
+}
@@ -0,0 +1,82 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef DNGWRITER_H
+#define DNGWRITER_H
+
+#include <QString>
+#include <QVector>
+#include <vector>
+
+#include "FrameMetadata.h"
+
+class CUDAProcessorOptions;
+
+///Writes raw frames as tiled DNG files. Tiles are stored uncompressed or as
+///lossless JPEG (DNG compression 7), encoded in parallel and written to the
+///file in order as they are ready. The IFD follows the tile data.
+class DngWriter
+{
+public:
+    struct Params
+    {
+        unsigned width = 0;
+        unsigned height = 0;
+        unsigned bytesPerSample = 2;
+        unsigned bitDepth = 16;
+        unsigned bayerPattern = 0;       ///fastBayerPattern_t, FAST_BAYER_NONE - monochrome
+        unsigned blackLevel = 0;
+        unsigned whiteLevel = 0;         ///0 - maximum of bitDepth
+        float red = 1.f;                 ///White balance gains
+        float green = 1.f;
+        float blue = 1.f;
+        float exposure = 1.f;            ///Linear gain, stored as BaselineExposure
+        QVector<unsigned short> linearization;
+        QString make;
+        QString model;
+        bool compress = true;
+        unsigned tileSize = 256;         ///Multiple of 16
+    };
+
+    ///Black and white level, white balance, exposure and linearization of the
+    ///processing options, bayerPattern as for Params
+    static Params fromOptions(const CUDAProcessorOptions& opts, unsigned bayerPattern);
+
+    void setParams(const Params& params);
+    const Params& params() const {return mParams;}
+
+    ///Write width x height samples with rows pitch bytes apart to fileName
+    bool write(const QString& fileName, const void* data, unsigned pitch, const FrameMetadata& meta);
+
+private:
+    Params mParams;
+    std::vector<std::vector<unsigned char>> mTiles;
+    std::vector<std::vector<int>> mDiffs;
+};
+
+#endif // DNGWRITER_H
@@ -180,7 +180,10 @@ void FFCReader::readPGM(const QString& fileName, QVector<float>& cfa)
         return;
 
     if(samples != 1)
+    {
+        alloc.deallocate(bits);
         return;
+    }
 
     mPitch = width * sizeof(float);
     mHeight = height;
@@ -189,20 +192,21 @@ void FFCReader::readPGM(const QString& fileName, QVector<float>& cfa)
     unsigned nPixels = width * height;
     cfa.resize(nPixels);
 
-    if(bitsPerPixel == 8)
+    //Rows are padded to allocator alignment
+    float* dst = cfa.data();
+    for(uint y = 0; y < height; y++, dst += width)
     {
-        auto* src = static_cast<unsigned char*>(bits);
-        for(uint i = 0; i < nPixels; i++)
+        const unsigned char* row = bits + size_t(y) * pitch;
+        if(bitsPerPixel == 8)
         {
-            cfa[i] = float(src[i]);
+            for(uint x = 0; x < width; x++)
+                dst[x] = float(row[x]);
         }
-    }
-    else
-    {
-        auto* src = reinterpret_cast<unsigned short*>(bits);
-        for(uint i = 0; i < nPixels; i++)
+        else
         {
-            cfa[i] = float(src[i]);
+            auto* src = reinterpret_cast<const unsigned short*>(row);
+            for(uint x = 0; x < width; x++)
+                dst[x] = float(src[x]);
         }
     }
 
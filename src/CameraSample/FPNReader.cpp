@@ -56,7 +56,7 @@ FPNReader::FPNReader(const QString &fileName) :
 
 void FPNReader::readPGM(const QString& fileName)
 {
-    MallocAllocator alloc;
+    FastAllocator alloc;
     unsigned char* bits = nullptr;
 
     uint width = 0;
@@ -71,30 +71,19 @@ void FPNReader::readPGM(const QString& fileName)
                     bitsPerPixel, samples))
         return;
 
+    //Loaded straight into pinned memory, no extra copy needed
+    mFPNBuffer.reset(bits);
+
     if(samples != 1)
+    {
+        mFPNBuffer.reset();
         return;
+    }
 
     mPitch = pitch;
     mHeight = height;
     mWidth = width;
     mBpp = bitsPerPixel;
-
-    FastAllocator a;
-
-    try
-    {
-        mFPNBuffer.reset(static_cast<unsigned char*>(a.allocate(mPitch * mHeight)));
-    }
-    catch(...)
-    {
-        alloc.deallocate(bits);
-        return;
-    }
-
-    unsigned char* dst = mFPNBuffer.get();
-
-    memcpy(dst, bits, mPitch * mHeight);
-    alloc.deallocate(bits);
 }
 
 
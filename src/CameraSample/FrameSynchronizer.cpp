@@ -0,0 +1,178 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "FrameSynchronizer.h"
+#include "RawProcessor.h"
+
+#include <algorithm>
+
+FrameSynchronizer::FrameSynchronizer(int count, int64_t toleranceNs, bool ptp) :
+    mCameras(count),
+    mToleranceNs(toleranceNs),
+    mPtp(ptp)
+{
+    mStats.unmatched.fill(0, count);
+}
+
+void FrameSynchronizer::setProcessor(int idx, RawProcessor* proc)
+{
+    QMutexLocker l(&mLock);
+    if(idx >= 0 && idx < mCameras.size())
+        mCameras[idx].processor = proc;
+}
+
+void FrameSynchronizer::setOffsets(const QVector<int64_t>& offsetsNs)
+{
+    QMutexLocker l(&mLock);
+    for(int i = 0; i < mCameras.size() && i < offsetsNs.size(); i++)
+        mCameras[i].offsetNs = offsetsNs[i];
+}
+
+void FrameSynchronizer::push(int idx, GPUImage_t* img)
+{
+    if(img == nullptr || idx < 0 || idx >= mCameras.size())
+        return;
+
+    QVector<GPUImage_t*> images;
+    QVector<RawProcessor*> processors;
+    {
+        QMutexLocker l(&mLock);
+        Camera& cam = mCameras[idx];
+
+        Frame frame;
+        frame.image = img;
+        frame.timestamp = correctedTimestamp(cam, img->meta);
+        cam.pending.push_back(frame);
+        if(cam.pending.size() > maxPending)
+        {
+            cam.pending.pop_front();
+            cam.unmatched++;
+        }
+
+        if(!match(images))
+            return;
+
+        for(const Camera& c : mCameras)
+            processors.append(c.processor);
+    }
+
+    //Processors only take the pointer and wake up, no need to hold the lock
+    for(int i = 0; i < images.size(); i++)
+    {
+        if(processors[i])
+            processors[i]->processImage(images[i]);
+    }
+}
+
+void FrameSynchronizer::reset()
+{
+    QMutexLocker l(&mLock);
+    for(Camera& cam : mCameras)
+    {
+        cam.pending.clear();
+        cam.unmatched = 0;
+        cam.offsetWindow.clear();
+    }
+    mStats = Stats();
+    mStats.unmatched.fill(0, mCameras.size());
+}
+
+FrameSynchronizer::Stats FrameSynchronizer::stats()
+{
+    QMutexLocker l(&mLock);
+    for(int i = 0; i < mCameras.size(); i++)
+        mStats.unmatched[i] = mCameras[i].unmatched;
+    return mStats;
+}
+
+int64_t FrameSynchronizer::correctedTimestamp(Camera& cam, const FrameMetadata& meta)
+{
+    const int64_t hostNs = meta.hostTimestampUs * 1000;
+    if(meta.deviceTimestamp == 0)
+        return hostNs;
+
+    const int64_t deviceNs = int64_t(meta.deviceTimestamp);
+    if(mPtp)
+        return deviceNs + cam.offsetNs;
+
+    //Free running clocks. Transfer delay only adds to the arrival time, so the
+    //smallest recent difference is the best estimate of the clock offset.
+    //Older samples expire, a drifting clock moves the estimate with it.
+    OffsetSample sample;
+    sample.hostNs = hostNs;
+    sample.diffNs = deviceNs - hostNs;
+    while(!cam.offsetWindow.empty() && cam.offsetWindow.back().diffNs >= sample.diffNs)
+        cam.offsetWindow.pop_back();
+    cam.offsetWindow.push_back(sample);
+    while(cam.offsetWindow.front().hostNs < hostNs - offsetWindowNs)
+        cam.offsetWindow.pop_front();
+
+    cam.offsetNs = cam.offsetWindow.front().diffNs;
+    return deviceNs - cam.offsetNs;
+}
+
+bool FrameSynchronizer::match(QVector<GPUImage_t*>& images)
+{
+    for(;;)
+    {
+        int64_t newest = 0;
+        for(const Camera& cam : mCameras)
+        {
+            if(cam.pending.empty())
+                return false;
+            newest = std::max(newest, cam.pending.front().timestamp);
+        }
+
+        //Frames too old for the newest head will never get a partner
+        bool dropped = false;
+        for(Camera& cam : mCameras)
+        {
+            while(!cam.pending.empty() && cam.pending.front().timestamp < newest - mToleranceNs)
+            {
+                cam.pending.pop_front();
+                cam.unmatched++;
+                dropped = true;
+            }
+        }
+        if(dropped)
+            continue;
+
+        int64_t oldest = newest;
+        for(Camera& cam : mCameras)
+        {
+            oldest = std::min(oldest, cam.pending.front().timestamp);
+            images.append(cam.pending.front().image);
+            cam.pending.pop_front();
+        }
+
+        mStats.matchedSets++;
+        mStats.lastSkewNs = newest - oldest;
+        mStats.maxSkewNs = std::max(mStats.maxSkewNs, mStats.lastSkewNs);
+        return true;
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef FRAMESYNCHRONIZER_H
+#define FRAMESYNCHRONIZER_H
+
+#include <QMutex>
+#include <QVector>
+#include <deque>
+
+#include "FrameBuffer.h"
+
+class RawProcessor;
+
+///Groups frames of several cameras by device timestamp and hands matched
+///sets to the processors together. Frames without a partner within the
+///tolerance window are dropped and counted as unmatched.
+///
+///Device timestamps are expected in ns (see FrameMetadata). With PTP the
+///cameras share one clock and only the configured per-camera offsets are
+///applied. Otherwise the offset of every camera clock to the host clock is
+///estimated from the frame arrival times of the last offsetWindowNs, so the
+///estimate follows clocks that drift against the host.
+class FrameSynchronizer
+{
+public:
+    struct Stats
+    {
+        uint64_t matchedSets = 0;
+        QVector<uint64_t> unmatched; ///Per camera
+        int64_t lastSkewNs = 0;
+        int64_t maxSkewNs = 0;
+    };
+
+    FrameSynchronizer(int count, int64_t toleranceNs, bool ptp);
+
+    int count() const {return mCameras.size();}
+    void setProcessor(int idx, RawProcessor* proc);
+    ///Nanoseconds added to the device timestamps of camera idx (PTP mode)
+    void setOffsets(const QVector<int64_t>& offsetsNs);
+    ///Queue the frame of camera idx, called from the camera thread
+    void push(int idx, GPUImage_t* img);
+    void reset();
+    Stats stats();
+
+private:
+    struct Frame
+    {
+        GPUImage_t* image = nullptr;
+        int64_t timestamp = 0;
+    };
+
+    struct OffsetSample
+    {
+        int64_t hostNs = 0;
+        int64_t diffNs = 0;
+    };
+
+    struct Camera
+    {
+        RawProcessor* processor = nullptr;
+        std::deque<Frame> pending;
+        int64_t offsetNs = 0;
+        ///Increasing differences of the window, front is the minimum
+        std::deque<OffsetSample> offsetWindow;
+        uint64_t unmatched = 0;
+    };
+
+    //Input ring has only a few slots, older frames are overwritten anyway
+    static const size_t maxPending = 2;
+    //Long enough to catch a frame with little transfer delay, short enough
+    //to keep the error of a 100 ppm clock drift at 100 us
+    static const int64_t offsetWindowNs = 1000000000;
+
+    QMutex mLock;
+    QVector<Camera> mCameras;
+    int64_t mToleranceNs = 0;
+    bool mPtp = false;
+    Stats mStats;
+
+    int64_t correctedTimestamp(Camera& cam, const FrameMetadata& meta);
+    bool match(QVector<GPUImage_t*>& images);
+};
+
+#endif // FRAMESYNCHRONIZER_H
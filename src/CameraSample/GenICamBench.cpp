@@ -0,0 +1,159 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifdef SUPPORT_GENICAM
+
+#include "GenICamBench.h"
+#include "GeniCamCamera.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <cuda_runtime.h>
+#include <cstdio>
+
+namespace
+{
+struct Counters
+{
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+    uint64_t incomplete = 0;
+};
+
+Counters counters(GPUCameraBase& camera)
+{
+    typedef GPUCameraBase::cmrCameraStatistic Stat;
+    Counters ret;
+    camera.GetStatistics(Stat::statFramesTotal, ret.frames);
+    camera.GetStatistics(Stat::statFramesDropped, ret.dropped);
+    camera.GetStatistics(Stat::statFramesIncomplete, ret.incomplete);
+    return ret;
+}
+}
+
+int GenICamBench::exec(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measure GenICam acquisition without processing"));
+    parser.addHelpOption();
+
+    QCommandLineOption benchOpt(QStringLiteral("genicam-bench"), QStringLiteral("GenICam benchmark mode"));
+    QCommandLineOption deviceOpt(QStringLiteral("device"), QStringLiteral("Camera index over all producers, default 0"),
+                                 QStringLiteral("index"), QStringLiteral("0"));
+    QCommandLineOption secondsOpt(QStringLiteral("seconds"), QStringLiteral("Streaming time, default 5"),
+                                  QStringLiteral("value"), QStringLiteral("5"));
+    QCommandLineOption minFpsOpt(QStringLiteral("min-fps"), QStringLiteral("Fail below this frame rate"),
+                                 QStringLiteral("value"), QStringLiteral("0"));
+    QCommandLineOption minDropOpt(QStringLiteral("min-drop-rate"), QStringLiteral("Fail if fewer lost frames are reported (share 0..1)"),
+                                  QStringLiteral("value"), QStringLiteral("0"));
+    QCommandLineOption maxDropOpt(QStringLiteral("max-drop-rate"), QStringLiteral("Fail if more frames are lost (share 0..1)"),
+                                  QStringLiteral("value"), QStringLiteral("1"));
+    QCommandLineOption minIncompleteOpt(QStringLiteral("min-incomplete"), QStringLiteral("Fail if fewer incomplete frames are reported"),
+                                        QStringLiteral("count"), QStringLiteral("0"));
+    parser.addOptions({benchOpt, deviceOpt, secondsOpt, minFpsOpt, minDropOpt, maxDropOpt, minIncompleteOpt});
+    parser.process(arguments);
+
+    int devCount = 0;
+    if(cudaGetDeviceCount(&devCount) != cudaSuccess || devCount == 0)
+    {
+        fprintf(stderr, "No CUDA device found, benchmark skipped\n");
+        return SkipCode;
+    }
+
+    const double seconds = qMax(0.5, parser.value(secondsOpt).toDouble());
+
+    GeniCamCamera camera;
+    camera.setCudaDevice(0);
+    if(!camera.open(parser.value(deviceOpt).toUInt()))
+    {
+        fprintf(stderr, "Cannot open GenICam camera %s\n", qPrintable(parser.value(deviceOpt)));
+        return 1;
+    }
+    printf("%s %s (%s), %dx%d, %s\n", qPrintable(camera.manufacturer()), qPrintable(camera.model()),
+           qPrintable(camera.serial()), camera.width(), camera.height(), rawPackingName(camera.packing()));
+
+    if(!camera.start())
+    {
+        fprintf(stderr, "Cannot start streaming\n");
+        camera.close();
+        return 1;
+    }
+
+    //Counted from the first frame, opening and buffer setup are not measured
+    QElapsedTimer timer;
+    timer.start();
+    Counters start;
+    while(start.frames == 0 && timer.elapsed() < 5000)
+    {
+        QThread::msleep(1);
+        start = counters(camera);
+    }
+    timer.restart();
+    while(timer.elapsed() < qint64(seconds * 1000))
+        QThread::msleep(10);
+    const Counters end = counters(camera);
+    const double elapsed = double(timer.nsecsElapsed()) / 1e9;
+    uint64_t throughput = 0;
+    camera.GetStatistics(GPUCameraBase::cmrCameraStatistic::statCurrTroughputMbs100, throughput);
+
+    camera.stop();
+    camera.close();
+
+    const uint64_t frames = end.frames - start.frames;
+    const uint64_t dropped = end.dropped - start.dropped;
+    const uint64_t incomplete = end.incomplete - start.incomplete;
+    const double fps = frames / elapsed;
+    const double dropRate = frames + dropped > 0 ? double(dropped) / double(frames + dropped) : 0;
+
+    printf("Frames %llu in %.2f s, %.1f fps, %.1f Mbit/s\n", qulonglong(frames), elapsed, fps, double(throughput) / 100.);
+    printf("Lost %llu (%.2f%%), incomplete %llu\n", qulonglong(dropped), dropRate * 100, qulonglong(incomplete));
+
+    bool ok = frames > 0;
+    if(fps < parser.value(minFpsOpt).toDouble())
+    {
+        fprintf(stderr, "FAIL: %.1f fps is below %s\n", fps, qPrintable(parser.value(minFpsOpt)));
+        ok = false;
+    }
+    if(dropRate < parser.value(minDropOpt).toDouble() || dropRate > parser.value(maxDropOpt).toDouble())
+    {
+        fprintf(stderr, "FAIL: lost frame share %.4f is outside %s..%s\n", dropRate,
+                qPrintable(parser.value(minDropOpt)), qPrintable(parser.value(maxDropOpt)));
+        ok = false;
+    }
+    if(incomplete < parser.value(minIncompleteOpt).toULongLong())
+    {
+        fprintf(stderr, "FAIL: %llu incomplete frames, expected at least %s\n", qulonglong(incomplete),
+                qPrintable(parser.value(minIncompleteOpt)));
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+#endif // SUPPORT_GENICAM
@@ -0,0 +1,147 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "JpegRateControl.h"
+
+#include <QtGlobal>
+#include <cmath>
+
+JpegRateControl::JpegRateControl()
+{
+    mClock.start();
+}
+
+double JpegRateControl::scale(double quality)
+{
+    //Percent of the base tables, 100 at quality 50
+    quality = qBound(1., quality, 100.);
+    return qMax(1., quality < 50 ? 5000. / quality : 200. - 2. * quality);
+}
+
+double JpegRateControl::qualityFromScale(double scale)
+{
+    return scale >= 100 ? 5000. / scale : (200. - scale) / 2.;
+}
+
+void JpegRateControl::setParams(const Params& params, unsigned quality)
+{
+    QMutexLocker l(&mLock);
+    mParams = params;
+    mParams.minQuality = qBound(1u, params.minQuality, 100u);
+    mParams.maxQuality = qBound(mParams.minQuality, params.maxQuality, 100u);
+    mQuality = qBound(mParams.minQuality, quality, mParams.maxQuality);
+
+    mLastUs = -1;
+    mFrameUs = 0;
+    mDebtBytes = 0;
+    mStartUs = -1;
+    mTotalBytes = 0;
+    mFrames = 0;
+    mWindowStartUs = -1;
+    mWindowBytes = 0;
+    mWindowQuality = 0;
+    mWindowFrames = 0;
+    mReport = Report();
+    mReport.enabled = isEnabled();
+    mReport.targetKbps = double(mParams.targetBitrate) / 1000.;
+}
+
+unsigned JpegRateControl::quality(unsigned fixedQuality) const
+{
+    QMutexLocker l(&mLock);
+    return isEnabled() ? mQuality : fixedQuality;
+}
+
+void JpegRateControl::update(unsigned bytes, qint64 timestampUs)
+{
+    QMutexLocker l(&mLock);
+    const qint64 now = timestampUs >= 0 ? timestampUs : mClock.nsecsElapsed() / 1000;
+
+    //Timestamps went back (looped playback), measure from here
+    if(now < mLastUs)
+    {
+        mStartUs = -1;
+        mTotalBytes = 0;
+        mWindowStartUs = -1;
+        mWindowBytes = 0;
+        mWindowQuality = 0;
+        mWindowFrames = 0;
+    }
+    if(mLastUs >= 0 && now > mLastUs)
+    {
+        const double dt = double(now - mLastUs);
+        mFrameUs = mFrameUs > 0 ? mFrameUs + 0.1 * (dt - mFrameUs) : dt;
+    }
+    mLastUs = now;
+
+    //Report
+    if(mStartUs < 0)
+        mStartUs = now;
+    if(mWindowStartUs < 0)
+        mWindowStartUs = now;
+    mTotalBytes += bytes;
+    mFrames++;
+    mWindowBytes += bytes;
+    mWindowQuality += isEnabled() ? mQuality : 0;
+    mWindowFrames++;
+    if(now - mWindowStartUs >= 1000000)
+    {
+        mReport.kbps = double(mWindowBytes) * 8000. / double(now - mWindowStartUs);
+        mReport.quality = double(mWindowQuality) / mWindowFrames;
+        mWindowStartUs = now;
+        mWindowBytes = 0;
+        mWindowQuality = 0;
+        mWindowFrames = 0;
+    }
+    //Frame intervals, the last frame is not over yet
+    if(now > mStartUs)
+        mReport.totalKbps = double(mTotalBytes - bytes) * 8000. / (double(now - mStartUs));
+    mReport.frames = mFrames;
+
+    if(!isEnabled() || mFrameUs <= 0 || bytes == 0)
+        return;
+
+    const double fps = 1e6 / mFrameUs;
+    const double budget = double(mParams.targetBitrate) / 8. / fps;
+
+    //Pay the difference back within a second, at most a second of bytes is kept
+    const double second = double(mParams.targetBitrate) / 8.;
+    mDebtBytes = qBound(-second, mDebtBytes + double(bytes) - budget, second);
+    const double frameBudget = qMax(budget * 0.25, budget - mDebtBytes / fps);
+
+    //bytes * scale is the same for the next frame of similar content
+    const double next = scale(mQuality) * double(bytes) / frameBudget;
+    const double q = std::round(qualityFromScale(next));
+    mQuality = unsigned(qBound(double(mParams.minQuality), q, double(mParams.maxQuality)));
+}
+
+JpegRateControl::Report JpegRateControl::report() const
+{
+    QMutexLocker l(&mLock);
+    return mReport;
+}
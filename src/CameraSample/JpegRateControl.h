@@ -0,0 +1,98 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef JPEGRATECONTROL_H
+#define JPEGRATECONTROL_H
+
+#include <QMutex>
+#include <QElapsedTimer>
+
+///Chooses the JPEG quality of every frame to keep a Motion JPEG stream at
+///a target bitrate. Encoded size is taken as inversely proportional to the
+///quantization scale of the quality (IJG scaling), so the size of the last
+///frame predicts the scale which gives the frame budget. The budget is
+///corrected by the bits over or under the target during the last second.
+class JpegRateControl
+{
+public:
+    struct Params
+    {
+        qint64 targetBitrate = 0;   ///Bits per second, 0 - fixed quality
+        unsigned minQuality = 30;
+        unsigned maxQuality = 95;
+    };
+
+    ///Achieved against target over the last second and since setParams
+    struct Report
+    {
+        bool   enabled = false;
+        double targetKbps = 0;
+        double kbps = 0;
+        double totalKbps = 0;
+        double quality = 0;         ///Average quality of the last second
+        qint64 frames = 0;
+    };
+
+    JpegRateControl();
+
+    ///Start over with quality as the initial one
+    void setParams(const Params& params, unsigned quality);
+    bool isEnabled() const {return mParams.targetBitrate > 0;}
+
+    ///Quality of the next frame, fixedQuality if rate control is off
+    unsigned quality(unsigned fixedQuality) const;
+    ///Encoded size of the frame, timestampUs < 0 - time of the call
+    void update(unsigned bytes, qint64 timestampUs = -1);
+
+    Report report() const;
+
+private:
+    static double scale(double quality);
+    static double qualityFromScale(double scale);
+
+    mutable QMutex mLock;
+    QElapsedTimer mClock;
+    Params mParams;
+    unsigned mQuality = 90;
+
+    qint64 mLastUs = -1;
+    double mFrameUs = 0;            ///Smoothed frame interval
+    double mDebtBytes = 0;          ///Bytes over the target since start, decays in a second
+
+    qint64 mStartUs = -1;
+    qint64 mTotalBytes = 0;
+    qint64 mFrames = 0;
+
+    qint64 mWindowStartUs = -1;
+    qint64 mWindowBytes = 0;
+    qint64 mWindowQuality = 0;
+    int mWindowFrames = 0;
+    Report mReport;
+};
+
+#endif // JPEGRATECONTROL_H
@@ -43,18 +43,22 @@ extern "C"
 #include <libavformat/avformat.h>
 }
 
+#include "vutils.h"
+
 MJPEGEncoder::MJPEGEncoder(int width,
                            int height,
                            int fps,
                            fastJpegFormat_t fmt,
-                           const QString& outFileName)
+                           const QString& outFileName,
+                           int flushIntervalMs)
 {
-    AVStream*       out_stream;
-    AVCodecContext* enc_ctx;
-    AVCodec*        encoder;
-    unsigned int    i = 0;
+    AVStream*          out_stream;
+    AVCodecParameters* par;
+    AVDictionary*      opts = nullptr;
 
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
     av_register_all();
+#endif
 
     mFmtCtx = nullptr;
     mErr = avformat_alloc_output_context2(&mFmtCtx, nullptr, nullptr, outFileName.toStdString().c_str());
@@ -65,6 +69,21 @@ MJPEGEncoder::MJPEGEncoder(int width,
     }
 
     mFramesProcessed = 0;
+    mFps = fps;
+    mFlushIntervalMs = flushIntervalMs;
+
+    //Fragments and clusters are self-contained, a file cut short by power loss
+    //stays readable up to the last flush. AVI keeps its index until the trailer.
+    const QString formatName = QString::fromLatin1(mFmtCtx->oformat->name);
+    if(formatName.contains(QStringLiteral("mp4")) || formatName.contains(QStringLiteral("mov")))
+    {
+        av_dict_set(&opts, "movflags", "+frag_custom+empty_moov+default_base_moof", 0);
+        mFragmented = true;
+    }
+    else if(formatName.contains(QStringLiteral("matroska")))
+    {
+        mFragmented = true;
+    }
 
     out_stream = avformat_new_stream(mFmtCtx, nullptr);
     if(!out_stream)
@@ -74,57 +93,46 @@ MJPEGEncoder::MJPEGEncoder(int width,
         return;
     }
 
-    out_stream->time_base.den = fps;
+    //Fragmented containers keep capture time, AVI is constant frame rate
+    out_stream->time_base.den = mFragmented ? 1000000 : fps;
     out_stream->time_base.num = 1;
+    av_dict_set(&mFmtCtx->metadata, "creation_time", "now", 0);
 
-    enc_ctx = out_stream->codec;
-    encoder = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
-
-    enc_ctx->height = height;
-    enc_ctx->width = width;
-    enc_ctx->sample_aspect_ratio.den = 1;
-    enc_ctx->sample_aspect_ratio.num = 1;
-
-    enc_ctx->time_base.den = fps;
-    enc_ctx->time_base.num = 1;
-
-    enc_ctx->gop_size = 0; // all frames are intra frames
+    //Frames come already encoded, the muxer needs only the stream parameters
+    par = out_stream->codecpar;
+    par->codec_type = AVMEDIA_TYPE_VIDEO;
+    par->codec_id = AV_CODEC_ID_MJPEG;
+    par->width = width;
+    par->height = height;
+    par->sample_aspect_ratio.den = 1;
+    par->sample_aspect_ratio.num = 1;
 
     switch (fmt)
     {
     case FAST_JPEG_Y:
-        enc_ctx->pix_fmt = AV_PIX_FMT_GRAY8;
+        par->format = AV_PIX_FMT_GRAY8;
+        break;
     case FAST_JPEG_444:
-        enc_ctx->pix_fmt = AV_PIX_FMT_YUVJ444P;
+        par->format = AV_PIX_FMT_YUVJ444P;
         break;
     case FAST_JPEG_422:
-        enc_ctx->pix_fmt = AV_PIX_FMT_YUVJ422P;
+        par->format = AV_PIX_FMT_YUVJ422P;
         break;
     case FAST_JPEG_420:
-        enc_ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        par->format = AV_PIX_FMT_YUVJ420P;
         break;
     default:
-        enc_ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        par->format = AV_PIX_FMT_YUVJ420P;
         break;
     }
 
-    if(mFmtCtx->oformat->flags & AVFMT_GLOBALHEADER)
-    {
-        enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-    }
-
-    /* Third parameter can be used to pass settings to encoder */
-    mErr = avcodec_open2(enc_ctx, encoder, nullptr);
-    if(mErr < 0)
+    mPacket = av_packet_alloc();
+    if(!mPacket)
     {
-        qDebug("Cannot open video encoder for stream #%u", i);
+        mErr = AVERROR(ENOMEM);
         return;
     }
 
-    if(mFmtCtx->oformat->flags & AVFMT_GLOBALHEADER)
-        enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-
-
     if(!(mFmtCtx->oformat->flags & AVFMT_NOFILE))
     {
         mErr = avio_open(&mFmtCtx->pb, outFileName.toStdString().c_str(), AVIO_FLAG_WRITE);
@@ -136,21 +144,24 @@ MJPEGEncoder::MJPEGEncoder(int width,
     }
 
     /* init muxer, write output file header */
-    mErr = avformat_write_header(mFmtCtx, nullptr);
+    mErr = avformat_write_header(mFmtCtx, &opts);
+    av_dict_free(&opts);
     if(mErr < 0)
     {
         qDebug("Error occurred when opening output file");
         return;
     }
+    mFlushTimer.start();
 
 }
 
 MJPEGEncoder::~MJPEGEncoder()
 {
     close();
+    av_packet_free(&mPacket);
 }
 
-bool MJPEGEncoder::addJPEGFrame(unsigned char *jpgPtr, int jpgSize)
+bool MJPEGEncoder::addJPEGFrame(unsigned char *jpgPtr, int jpgSize, qint64 timestampUs)
 {
     if(mErr < 0)
         return false;
@@ -158,27 +169,46 @@ bool MJPEGEncoder::addJPEGFrame(unsigned char *jpgPtr, int jpgSize)
     QMutexLocker l(&mLock);
 
     bool ret = false;
-    AVCodecContext* pVideoCodec = mFmtCtx->streams[0]->codec;
-    if(pVideoCodec->codec_id != AV_CODEC_ID_MJPEG )
-        return ret;
-
     int err;
     char errbuf[1024];
 
-    //Write video frame
-    AVPacket videoPkt;
-    av_init_packet(&videoPkt);
+    //Write video frame straight from the writer buffer.
+    //There is one stream, av_write_frame() does not keep the packet.
+    err = wrap_packet(mPacket, jpgPtr, jpgSize);
+    if(err < 0)
+        return ret;
+
+    mPacket->flags |= AV_PKT_FLAG_KEY;
+    mPacket->stream_index = 0; //Output video stream
+    qint64 ptsUs = qint64(mFramesProcessed) * 1000000 / mFps;
+    if(mFragmented && timestampUs > 0)
+    {
+        if(mFirstTimestampUs < 0)
+            mFirstTimestampUs = timestampUs;
+        ptsUs = timestampUs - mFirstTimestampUs;
+        //Camera clock jitter must not make pts go backwards
+        if(ptsUs <= mLastPtsUs)
+            ptsUs = mLastPtsUs + 1;
+    }
+    mLastPtsUs = ptsUs;
 
-    videoPkt.flags |= AV_PKT_FLAG_KEY;
-    videoPkt.stream_index = 0; //Output video stream
-    videoPkt.data= jpgPtr;
-    videoPkt.size = jpgSize;
-    videoPkt.pts = mFramesProcessed;
-    videoPkt.dts = mFramesProcessed;
+    if(mFragmented)
+    {
+        mPacket->pts = ptsUs;
+        mPacket->duration = 1000000 / mFps;
+        av_packet_rescale_ts(mPacket, AVRational{1, 1000000}, mFmtCtx->streams[0]->time_base);
+    }
+    else
+    {
+        mPacket->pts = mFramesProcessed;
+        mPacket->duration = 1;
+        av_packet_rescale_ts(mPacket, AVRational{1, mFps}, mFmtCtx->streams[0]->time_base);
+    }
+    mPacket->dts = mPacket->pts;
 
     mFramesProcessed++;
 
-    err = av_interleaved_write_frame(mFmtCtx, &videoPkt);
+    err = av_write_frame(mFmtCtx, mPacket);
     if(err != 0)
     {
         av_strerror(err, errbuf, sizeof(errbuf));
@@ -186,36 +216,54 @@ bool MJPEGEncoder::addJPEGFrame(unsigned char *jpgPtr, int jpgSize)
     }
     else
     {
-        pVideoCodec->frame_number++;
         ret = true;
+        if(mFragmented)
+            mPendingBytes += jpgSize;
     }
-    av_free_packet(&videoPkt);
+    av_packet_unref(mPacket);
 
+    //Close the fragment (cluster) and hand it to the OS
+    if(ret && mFragmented && mFlushTimer.elapsed() >= mFlushIntervalMs)
+    {
+        av_write_frame(mFmtCtx, nullptr);
+        avio_flush(mFmtCtx->pb);
+        mPendingBytes = 0;
+        mFlushTimer.restart();
+    }
 
     return ret;
 }
 
-void MJPEGEncoder::close()
+qint64 MJPEGEncoder::bytesWritten()
 {
-    if(mErr < 0)
-        return;
+    QMutexLocker l(&mLock);
+    if(mErr < 0 || !mFmtCtx->pb)
+        return 0;
+    //Muxer keeps the open fragment (cluster) in memory until the next flush
+    return avio_tell(mFmtCtx->pb) + mPendingBytes;
+}
 
+qint64 MJPEGEncoder::durationUs()
+{
     QMutexLocker l(&mLock);
+    return mLastPtsUs < 0 ? 0 : mLastPtsUs + 1000000 / mFps;
+}
 
-    av_write_trailer(mFmtCtx);
-    if(mFmtCtx && mFmtCtx->nb_streams > 0)
-    {
-        for(unsigned i = 0; i < mFmtCtx->nb_streams; i++)
-        {
-            if(mFmtCtx->streams[i] && mFmtCtx->streams[i]->codec)
-                avcodec_close(mFmtCtx->streams[i]->codec);
-        }
-    }
+void MJPEGEncoder::close()
+{
+    QMutexLocker l(&mLock);
+    if(!mFmtCtx)
+        return;
 
+    //A file that failed to open has no header to finish, only the context is freed
+    if(mErr >= 0)
+        av_write_trailer(mFmtCtx);
 
-    if(mFmtCtx && !(mFmtCtx->oformat->flags & AVFMT_NOFILE))
-        avio_close(mFmtCtx->pb);
+    if(!(mFmtCtx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&mFmtCtx->pb);
     avformat_free_context(mFmtCtx);
+    mFmtCtx = nullptr;
+    av_packet_free(&mPacket);
 
     mErr = -1;
 }
@@ -31,26 +31,43 @@
 
 #include <QString>
 #include <QMutex>
+#include <QElapsedTimer>
 #include "fastvideo_sdk.h"
 
 struct AVFormatContext;
-struct AVFrame;
+struct AVPacket;
 
 class MJPEGEncoder
 {
 public:
+    ///Container comes from the file extension. MP4/MOV are written as fragmented MP4,
+    ///MKV clusters and MP4 fragments are flushed to the file every flushIntervalMs
     MJPEGEncoder(int width,
                  int height,
                  int fps,
                  fastJpegFormat_t fmt,
-                 const QString& outFileName);
+                 const QString& outFileName,
+                 int flushIntervalMs = 1000);
     ~MJPEGEncoder();
     bool isOpened(){return mErr >= 0;}
-    bool addJPEGFrame(unsigned char *jpgPtr, int jpgSize);
+    ///timestampUs is the capture time, stored as pts except in AVI (constant frame rate).
+    ///0 - frame number based
+    bool addJPEGFrame(unsigned char *jpgPtr, int jpgSize, qint64 timestampUs = 0);
     void close();
+    ///File size including the fragment not flushed yet
+    qint64 bytesWritten();
+    qint64 durationUs();
 private:
     AVFormatContext* mFmtCtx = nullptr;
+    AVPacket* mPacket = nullptr;
     int mFramesProcessed = 0;
+    int mFps = 25;
+    bool mFragmented = false;
+    int mFlushIntervalMs = 1000;
+    QElapsedTimer mFlushTimer;
+    qint64 mPendingBytes = 0;
+    qint64 mFirstTimestampUs = -1;
+    qint64 mLastPtsUs = -1;
     int mErr = 0;
 
     QMutex mLock;
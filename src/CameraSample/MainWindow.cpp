@@ -37,7 +37,9 @@
 
 #include "ppm.h"
 #include "PGMCamera.h"
+#include "SequenceCamera.h"
 #include "RawProcessor.h"
+#include "BurstRecorder.h"
 #include "FPNReader.h"
 #include "FFCReader.h"
 //#include "GtGWidget.h"
@@ -88,6 +90,17 @@ QAction* insertCamera(Ui::MainWindow *ui, MainWindow *mm, const QString &cameraN
     return act;
 }
 
+template<typename T>
+QAction* insertCameraPipelines(Ui::MainWindow *ui, MainWindow *mm, const QString &cameraName, QAction* prev)
+{
+    QAction *act = new QAction(QIcon(":/res/camera.svg"), cameraName);
+    ui->menuCamera->insertAction(prev, act);
+    QObject::connect(act, &QAction::triggered, [mm](){
+        mm->openCameraPipelines([](){return new T();});
+    });
+    return act;
+}
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
@@ -165,6 +178,12 @@ MainWindow::MainWindow(QWidget *parent) :
         ui->cboOutFormat->addItem(QStringLiteral("JPEG"), CUDAProcessorOptions::vcJPG);
         ui->cboOutFormat->addItem(QStringLiteral("Motion JPEG"), CUDAProcessorOptions::vcMJPG);
         ui->cboOutFormat->addItem(QStringLiteral("PGM"), CUDAProcessorOptions::vcPGM);
+        ui->cboOutFormat->addItem(QStringLiteral("TIFF"), CUDAProcessorOptions::vcTIFF);
+        ui->cboOutFormat->addItem(QStringLiteral("DNG"), CUDAProcessorOptions::vcDNG);
+        ui->cboOutFormat->addItem(QStringLiteral("Raw lossless (FVR)"), CUDAProcessorOptions::vcRAW);
+        ui->cboOutFormat->setItemData(ui->cboOutFormat->count() - 1,
+                                      tr("Compressed on the CPU, frames are dropped when the writer "
+                                         "cannot keep up with the camera"), Qt::ToolTipRole);
         ui->cboOutFormat->addItem(QStringLiteral("H264"), CUDAProcessorOptions::vcH264);
         ui->cboOutFormat->addItem(QStringLiteral("H265"), CUDAProcessorOptions::vcHEVC);
     }
@@ -187,6 +206,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->denoiseCtlr, SIGNAL(shrinkageChanged(int)), this, SLOT(onShrinkageChanged(int)));
     connect(ui->denoiseCtlr, SIGNAL(paramsChanged()), this, SLOT(onDenoiseParamsChanged()));
 
+    connect(ui->cameraController, SIGNAL(roiRequested()), this, SLOT(onCameraRoiRequested()));
+
     mStatusLabel = new QLabel(this);
     mFpsLabel = new QLabel(this);
 
@@ -231,26 +252,32 @@ MainWindow::MainWindow(QWidget *parent) :
 
 #ifdef SUPPORT_XIMEA
     insertCamera<XimeaCamera>(ui, this, "Open Ximea Camera", ui->actionOpenBayerPGM);
+    insertCameraPipelines<XimeaCamera>(ui, this, "Open All Ximea Cameras", ui->actionOpenBayerPGM);
 #endif
 
 #ifdef SUPPORT_GENICAM
     insertCamera<GeniCamCamera>(ui, this, "Open Geni Camera", ui->actionOpenBayerPGM);
+    insertCameraPipelines<GeniCamCamera>(ui, this, "Open All Geni Cameras", ui->actionOpenBayerPGM);
 #endif
 
 #ifdef SUPPORT_FLIR
     insertCamera<FLIRCamera>(ui, this, "Open FLIR Camera", ui->actionOpenBayerPGM);
+    insertCameraPipelines<FLIRCamera>(ui, this, "Open All FLIR Cameras", ui->actionOpenBayerPGM);
 #endif
 
 #ifdef SUPPORT_IMPERX
     insertCamera<ImperxCamera>(ui, this, "Open Imperx Camera", ui->actionOpenBayerPGM);
+    insertCameraPipelines<ImperxCamera>(ui, this, "Open All Imperx Cameras", ui->actionOpenBayerPGM);
 #endif
 
 #ifdef SUPPORT_LUCID
     insertCamera<LucidCamera>(ui, this, "Open Lucid Camera", ui->actionOpenBayerPGM);
+    insertCameraPipelines<LucidCamera>(ui, this, "Open All Lucid Cameras", ui->actionOpenBayerPGM);
 #endif
 
 #ifdef SUPPORT_BASLER
     insertCamera<BaslerCamera>(ui, this, "Open Basler Camera", ui->actionOpenBayerPGM);
+    insertCameraPipelines<BaslerCamera>(ui, this, "Open All Basler Cameras", ui->actionOpenBayerPGM);
 #endif
 
 #ifdef SUPPORT_MIPI
@@ -291,6 +318,8 @@ void MainWindow::closeEvent(QCloseEvent *event)
 {
     writeSettings();
 
+    mPipelines.close();
+
     if(mCameraPtr)
         mCameraPtr->stop();
 
@@ -303,11 +332,18 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
 void MainWindow::initNewCamera(GPUCameraBase* cmr, uint32_t devID)
 {
+    mPipelines.close();
+
     ui->cameraController->setCamera(nullptr);
+    mMetricsServer.setCamera(nullptr);
+    mMetricsServer.setProcessor(nullptr);
     mCameraPtr.reset(cmr);
     if(!mCameraPtr)
         return;
 
+    //Input buffer is allocated on the current device
+    mCameraPtr->setCudaDevice(ui->cboCUDADevice->currentData().toInt());
+    cudaSetDevice(mCameraPtr->cudaDevice());
     if(!mCameraPtr->open(devID))
     {
         QMessageBox::critical(this, QCoreApplication::applicationName(),
@@ -316,31 +352,65 @@ void MainWindow::initNewCamera(GPUCameraBase* cmr, uint32_t devID)
         return;
     }
 
+    attachCamera();
+}
+
+void MainWindow::openCameraPipelines(const PipelineManager::CameraFactory& factory)
+{
+    if(mCameraPtr)
+        mCameraPtr->stop();
+
+    //Synchronizer of the previous pipelines may still refer to the processor
+    mPipelines.close();
+    ui->cameraController->setCamera(nullptr);
+    mMetricsServer.setCamera(nullptr);
+    mMetricsServer.setProcessor(nullptr);
+    mProcessorPtr.reset();
+    mCameraPtr.reset();
+
+    int opened = mPipelines.open(factory, AppSettings().pipelineCameras);
+
+    //The first camera is displayed and controlled from the UI, the others follow its settings
+    mCameraPtr.reset(mPipelines.takeCamera(0));
+    if(!mCameraPtr)
+    {
+        mPipelines.close();
+        QMessageBox::critical(this, QCoreApplication::applicationName(),
+                              opened > 0 ? QObject::tr("Cannot open the first camera.") :
+                                           QObject::tr("Cannot open camera\nor no camera is connected."));
+        return;
+    }
+
+    attachCamera();
+    mProcessorPtr->setCpuAffinity(mPipelines.pipeline(0).cpuCore);
+    mStatusLabel->setText(mStatusLabel->text() + tr(", cameras opened: %1 of %2").arg(opened).arg(mPipelines.count()));
+}
+
+void MainWindow::attachCamera()
+{
     connect(mCameraPtr.data(),
             SIGNAL(stateChanged(GPUCameraBase::cmrCameraState)),
             this,
             SLOT(onCameraStateChanged(GPUCameraBase::cmrCameraState)));
 
     mProcessorPtr.reset(new RawProcessor(mCameraPtr.data(), mRendererPtr.data()));
+    {
+        AppSettings settings;
+        mProcessorPtr->setBurst(settings.burstPreFrames, settings.burstPostFrames);
+    }
 
     connect(mProcessorPtr.data(), SIGNAL(finished()), this, SLOT(onGPUFinished()));
     connect(mProcessorPtr.data(), SIGNAL(error()), this, SLOT(onGPUError()));
 
     mCameraPtr->setProcessor(mProcessorPtr.data());
+    mMetricsServer.setCamera(mCameraPtr.data());
+    mMetricsServer.setProcessor(mProcessorPtr.data());
     {
         QSignalBlocker b(ui->cboBayerPattern);
         ui->cboBayerPattern->setCurrentIndex(ui->cboBayerPattern->findData(mCameraPtr->bayerPattern()));
     }
 
-    mOptions.Width = mCameraPtr->width();
-    mOptions.Height = mCameraPtr->height();
-    mOptions.MaxWidth = mCameraPtr->width();
-    mOptions.MaxHeight = mCameraPtr->height();
-    mOptions.BayerFormat = mCameraPtr->bayerPattern();
-    mOptions.SurfaceFmt = mCameraPtr->surfaceFormat();
-    mOptions.WhiteLevel = mCameraPtr->whiteLevel();
-    mOptions.BlackLevel = 0;
-    mOptions.Packed = mCameraPtr->isPacked();
+    PipelineManager::setCameraOptions(mCameraPtr.data(), mOptions);
     updateOptions(mOptions);
 
     int bpp = GetBitsPerChannelFromSurface(mCameraPtr->surfaceFormat());
@@ -350,7 +420,7 @@ void MainWindow::initNewCamera(GPUCameraBase* cmr, uint32_t devID)
             arg(mOptions.Width).
             arg(mOptions.Height).
             arg(bpp).
-            arg(mCameraPtr->isPacked() ? QStringLiteral(" packed") : QString());
+            arg(mCameraPtr->packing() != rpNone ? QStringLiteral(" (%1)").arg(QString::fromLatin1(rawPackingName(mCameraPtr->packing()))) : QString());
 
     mStatusLabel->setText(msg);
 
@@ -456,6 +526,7 @@ void MainWindow::raw2Rgb(bool update, bool init)
         mProcessorPtr->init();
 
     mProcessorPtr->wake();
+    mPipelines.updateOptions(mOptions, init);
 
     if(update)
         updateAll();
@@ -699,6 +770,19 @@ void MainWindow::readSettings()
         QSignalBlocker b(ui->cboBayerType);
         ui->cboBayerType->setCurrentIndex(settings.value("Params/BayerType", 0).toInt());
     }
+
+    //Timeline tracing from startup, can also be toggled via metrics server
+    if(settings.value("Trace/Enabled", false).toBool())
+        Tracer::instance().setEnabled(true);
+
+    //Prometheus exporter, port 0 disables it. Unauthenticated, so localhost only
+    //unless Metrics/Address is set explicitly
+    quint16 metricsPort = quint16(settings.value("Metrics/Port", MetricsServer::DefaultPort).toUInt());
+    QHostAddress metricsAddress(settings.value("Metrics/Address", "127.0.0.1").toString());
+    if(metricsAddress.isNull())
+        metricsAddress = QHostAddress::LocalHost;
+    if(metricsPort > 0)
+        mMetricsServer.start(metricsPort, metricsAddress);
 }
 
 void MainWindow::writeSettings()
@@ -769,6 +853,9 @@ void MainWindow::updateOptions(CUDAProcessorOptions& opts)
 
     ui->denoiseCtlr->getDenoiseParams(opts.DenoiseParams, opts.EnableDenoise);
     ui->denoiseCtlr->getStaticDenoiseParams(opts.DenoiseStaticParams);
+
+    if(mCameraPtr)
+        opts.DeviceId = unsigned(mCameraPtr->cudaDevice());
 }
 
 void MainWindow::on_cboBayerPattern_currentIndexChanged(int index)
@@ -818,19 +905,41 @@ void MainWindow::on_actionRecord_toggled(bool arg1)
         mOptions.JpegSamplingFmt = (fastJpegFormat_t)(ui->cboSamplingFmt->currentData().toInt());
         mOptions.bitrate = getBitrate(ui->cbBitrate->currentText());
 
+        QString prefix = ui->txtFilePrefix->text();
+        if(mPipelines.count() > 0)
+            prefix = PipelineManager::filePrefix(prefix, mCameraPtr->devID());
+
         mProcessorPtr->setOutputPath(ui->txtOutPath->text());
-        mProcessorPtr->setFilePrefix(ui->txtFilePrefix->text());
+        mProcessorPtr->setFilePrefix(prefix);
         mProcessorPtr->updateOptions(mOptions);
         mProcessorPtr->startWriting();
+        mPipelines.startWriting(mOptions, ui->txtOutPath->text(), ui->txtFilePrefix->text());
     }
     else
     {
         mOptions.Codec = CUDAProcessorOptions::vcNone;
         mProcessorPtr->updateOptions(mOptions);
         mProcessorPtr->stopWriting();
+        mPipelines.stopWriting(mOptions);
     }
 }
 
+void MainWindow::on_actionBurstTrigger_triggered()
+{
+    if(!mProcessorPtr || !mCameraPtr)
+        return;
+
+    QString prefix = ui->txtFilePrefix->text();
+    if(mPipelines.count() > 0)
+        prefix = PipelineManager::filePrefix(prefix, mCameraPtr->devID());
+
+    mProcessorPtr->setOutputPath(ui->txtOutPath->text());
+    mProcessorPtr->setFilePrefix(prefix);
+    if(!mProcessorPtr->triggerBurst())
+        qDebug() << "Burst not started, previous one is in progress";
+    mPipelines.triggerBurst(ui->txtOutPath->text(), ui->txtFilePrefix->text());
+}
+
 void MainWindow::on_actionExit_triggered()
 {
     close();
@@ -940,117 +1049,129 @@ void MainWindow::onGPUFinished()
         return;
     }
 
-    QMap<QString, float> stats(mProcessorPtr->getStats());
+    const PipelineTelemetry::Snapshot stats(mProcessorPtr->getStats());
 
-
-    float val = stats[QStringLiteral("allocatedMem")];
-    float viewportMem = stats[QStringLiteral("totalViewportMemory")];
+    double val = double(stats.gauge(PipelineTelemetry::gAllocatedMem));
+    double viewportMem = double(stats.gauge(PipelineTelemetry::gViewportMem));
 
     if(val > 0 && viewportMem > 0)
         val += viewportMem;
 
     strInfo = tr("Total memory %1 MB, free %2 MB, allocated %3 MB\n").
-            arg(double(stats[QStringLiteral("totalMem")] / 1048576), 0, 'f', 0).
-            arg(double(stats[QStringLiteral("freeMem")] / 1048576), 0, 'f', 0).
-            arg(val > 0 ? double(val) / 1048576 : 0, 0, 'f', 0);
+            arg(double(stats.gauge(PipelineTelemetry::gTotalMem)) / 1048576, 0, 'f', 0).
+            arg(double(stats.gauge(PipelineTelemetry::gFreeMem)) / 1048576, 0, 'f', 0).
+            arg(val > 0 ? val / 1048576 : 0, 0, 'f', 0);
 
-    int w = int(stats[QStringLiteral("inputWidth")]);
-    int h = int(stats[QStringLiteral("inputHeight")]);
+    int w = int(stats.gauge(PipelineTelemetry::gInputWidth));
+    int h = int(stats.gauge(PipelineTelemetry::gInputHeight));
     if(w > 0 && h > 0)
         strInfo += tr("Input image: %1x%2 pixels\n").arg(w).arg(h);
 
-    val = stats[QStringLiteral("hRawUnpacker")];
-    if(val > 0)
-        strInfo += tr("Raw Unpacker = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hHostToDeviceAdapter")];
-    if(val > 0)
-        strInfo += tr("Host-to-device transfer = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hSAM")];
-    if(val > 0)
-        strInfo += tr("Dark frame and flat field correction = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hLinearizationLut")];
-    if(val > 0)
-        strInfo += tr("Linearization LUT = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hBpc")];
-    if(val > 0)
-        strInfo += tr("Bad pixels correction = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hWhiteBalance")];
-    if(val > 0)
-        strInfo += tr("White balance = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hDebayer")];
-    if(val > 0)
-        strInfo += tr("Debayer = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hDenoise")];
-    if(val > 0)
-        strInfo += tr("Denoise = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-
-    val = stats[QStringLiteral("hOutLut")];
-    if(val > 0)
-        strInfo += tr("Output gamma = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("h16to8Transform")];
-    if(val > 0)
-        strInfo += tr("16 to 8 bit transform = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-//    val = stats[QStringLiteral("hHistogram")];
-//    if(val > 0)
-//        strInfo += tr("Histogram = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hMjpegEncoder")];
-    if(val > 0)
-        strInfo += tr("JPEG encoder time: %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hDeviceToHostAdapter")];
-    if(val > 0)
-        strInfo += tr("Device-to-host transfer = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("hExportToDevice")];
-    if(val > 0)
-        strInfo += tr("Viewport texture copy = %1 ms\n").arg(double(val), 0, 'f', 2);
-
-    val = stats[QStringLiteral("procFrames")];
-    if(val >= 0)
-        strInfo += tr("Frames written = %1\n").arg(int(val));
-
-    val = stats[QStringLiteral("droppedFrames")];
-    if(val >= 0)
-        strInfo += tr("Frames dropped = %1\n").arg(int(val));
-
+    static const struct
+    {
+        PipelineTelemetry::Stage stage;
+        const char* title;
+    } stages[] = {
+        {PipelineTelemetry::stRawUnpacker,        QT_TR_NOOP("Raw Unpacker")},
+        {PipelineTelemetry::stHostToDevice,       QT_TR_NOOP("Host-to-device transfer")},
+        {PipelineTelemetry::stSAM,                QT_TR_NOOP("Dark frame and flat field correction")},
+        {PipelineTelemetry::stLinearizationLut,   QT_TR_NOOP("Linearization LUT")},
+        {PipelineTelemetry::stBPC,                QT_TR_NOOP("Bad pixels correction")},
+        {PipelineTelemetry::stWhiteBalance,       QT_TR_NOOP("White balance")},
+        {PipelineTelemetry::stDebayer,            QT_TR_NOOP("Debayer")},
+        {PipelineTelemetry::stDenoise,            QT_TR_NOOP("Denoise")},
+        {PipelineTelemetry::stOutLut,             QT_TR_NOOP("Output gamma")},
+        {PipelineTelemetry::st16to8Transform,     QT_TR_NOOP("16 to 8 bit transform")},
+        {PipelineTelemetry::stGrayToRGBTransform, QT_TR_NOOP("Gray to RGB transform")},
+        {PipelineTelemetry::stJpegEncoder,        QT_TR_NOOP("JPEG encoder time")},
+        {PipelineTelemetry::stDeviceToHost,       QT_TR_NOOP("Device-to-host transfer")},
+        {PipelineTelemetry::stExportToDevice,     QT_TR_NOOP("Viewport texture copy")}
+    };
+
+    for(const auto& item : stages)
+    {
+        const PipelineTelemetry::StageStats& st = stats[item.stage];
+        if(!st.active || st.lastMs <= 0)
+            continue;
+        strInfo += tr("%1 = %2 ms (p99 %3 ms)\n").
+                arg(tr(item.title)).
+                arg(double(st.lastMs), 0, 'f', 2).
+                arg(double(st.p99Ms), 0, 'f', 2);
+    }
 
-    float totalGPU = stats[QStringLiteral("totalGPUTime")];
-    if(totalGPU > 0)
+    const PipelineTelemetry::StageStats& writer = stats[PipelineTelemetry::stWriter];
+    if(writer.active)
     {
-        totalGPU += stats[QStringLiteral("totalViewportTime")] > 0 ? stats[QStringLiteral("totalViewportTime")] : 0;
-        strInfo += tr("Total GPU = %1 ms\n").arg(double(totalGPU), 0, 'f', 2);
+        strInfo += tr("Frames written = %1\n").arg(writer.framesOut);
+        strInfo += tr("Frames dropped = %1\n").arg(writer.framesDropped);
     }
 
-    float encoding = stats[QStringLiteral("encoding")];
-    if(encoding > 0){
-        //totalGPU += stats[QStringLiteral("encoding")] > 0 ? stats[QStringLiteral("encoding")] : 0;
-        strInfo += tr("Encoding duration = %1 ms\n").arg(double(encoding), 0, 'f', 2);
+    const PipelineTelemetry::StageStats& totalGPU = stats[PipelineTelemetry::stTotalGPU];
+    if(totalGPU.active && totalGPU.lastMs > 0)
+        strInfo += tr("Total GPU = %1 ms (p50 %2, p99 %3, max %4)\n").
+                arg(double(totalGPU.lastMs), 0, 'f', 2).
+                arg(double(totalGPU.p50Ms), 0, 'f', 2).
+                arg(double(totalGPU.p99Ms), 0, 'f', 2).
+                arg(double(totalGPU.maxMs), 0, 'f', 2);
+
+    const PipelineTelemetry::StageStats& encoding = stats[PipelineTelemetry::stEncoder];
+    if(encoding.active && encoding.lastMs > 0)
+        strInfo += tr("Encoding duration = %1 ms\n").arg(double(encoding.lastMs), 0, 'f', 2);
+
+    if(stats.gauge(PipelineTelemetry::gMjpegTargetKbps) > 0)
+        strInfo += tr("MJPEG = %1 of %2 kbit/s, quality %3\n").
+                arg(qlonglong(stats.gauge(PipelineTelemetry::gMjpegKbps))).
+                arg(qlonglong(stats.gauge(PipelineTelemetry::gMjpegTargetKbps))).
+                arg(qlonglong(stats.gauge(PipelineTelemetry::gMjpegQuality)));
+    if(stats.gauge(PipelineTelemetry::gRtspJpegTargetKbps) > 0)
+        strInfo += tr("RTSP JPEG = %1 of %2 kbit/s, quality %3\n").
+                arg(qlonglong(stats.gauge(PipelineTelemetry::gRtspJpegKbps))).
+                arg(qlonglong(stats.gauge(PipelineTelemetry::gRtspJpegTargetKbps))).
+                arg(qlonglong(stats.gauge(PipelineTelemetry::gRtspJpegQuality)));
+
+    const PipelineTelemetry::StageStats& totalGPUCPU = stats[PipelineTelemetry::stTotalGPUCPU];
+    if(totalGPUCPU.active && totalGPUCPU.lastMs > 0)
+        strInfo += tr("\nTotal GPU + CPU = %1 ms (p99 %2 ms)\n").
+                arg(double(totalGPUCPU.lastMs), 0, 'f', 2).
+                arg(double(totalGPUCPU.p99Ms), 0, 'f', 2);
+
+    //Recorded after the frame is handed to encoders, so it may lag one frame behind
+    const PipelineTelemetry::StageStats& latency = stats[PipelineTelemetry::stCaptureLatency];
+    if(latency.framesIn > 0)
+        strInfo += tr("Capture to output latency = %1 ms (p50 %2, p99 %3)\n").
+                arg(double(latency.lastMs), 0, 'f', 2).
+                arg(double(latency.p50Ms), 0, 'f', 2).
+                arg(double(latency.p99Ms), 0, 'f', 2);
+
+    if(FrameSynchronizer* sync = mPipelines.synchronizer())
+    {
+        const FrameSynchronizer::Stats syncStats = sync->stats();
+        strInfo += tr("Synchronized sets = %1, skew = %2 us (max %3 us)\n").
+                arg(qulonglong(syncStats.matchedSets)).
+                arg(double(syncStats.lastSkewNs) / 1000, 0, 'f', 1).
+                arg(double(syncStats.maxSkewNs) / 1000, 0, 'f', 1);
+        QStringList unmatched;
+        for(uint64_t v : syncStats.unmatched)
+            unmatched.append(QString::number(v));
+        strInfo += tr("Unmatched frames = %1\n").arg(unmatched.join(QStringLiteral(", ")));
     }
 
-    totalGPU = stats[QStringLiteral("totalGPUCPUTime")];
-    if(totalGPU > 0)
+    if(BurstRecorder* burst = mProcessorPtr->burstRecorder())
     {
-        totalGPU += stats[QStringLiteral("totalViewportTime")] > 0 ? stats[QStringLiteral("totalViewportTime")] : 0;
-        strInfo += tr("\nTotal GPU + CPU = %1 ms\n").arg(double(totalGPU), 0, 'f', 2);
+        const BurstRecorder::Stats burstStats = burst->stats();
+        strInfo += tr("Bursts = %1%2, frames written = %3, dropped = %4\n").
+                arg(qulonglong(burstStats.bursts)).
+                arg(burstStats.active ? tr(" (recording)") : QString()).
+                arg(qulonglong(burstStats.written)).
+                arg(qulonglong(burstStats.dropped));
     }
 
     ui->lblInfo->setPlainText(strInfo);
     ui->lblInfo->moveCursor(QTextCursor::End);
 
-    val = stats[QStringLiteral("acqTime")];
+    val = double(stats.gauge(PipelineTelemetry::gAcqTimeNs));
     if(val > 0)
-        mFpsLabel->setText( tr("%1 fps").arg(1000000000. / double(val), 0, 'f', 0));
+        mFpsLabel->setText( tr("%1 fps").arg(1000000000. / val, 0, 'f', 0));
 
 }
 
@@ -1134,6 +1255,30 @@ void MainWindow::on_actionOpenGrayPGM_triggered()
     openPGMFile(false);
 }
 
+void MainWindow::on_actionOpenSequence_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    QStringLiteral("Select raw sequence"),
+                                                    mCurrentDir,
+                                                    QStringLiteral("Raw sequences (*.fvr);;PGM sequences (*.pgm)"));
+
+    if(fileName.isEmpty())
+        return;
+
+    mCurrentDir = Globals::getPathOfFile(fileName);
+
+    if(mCameraPtr)
+        mCameraPtr->stop();
+
+    AppSettings settings;
+    SequenceCamera* camera = new SequenceCamera(
+                fileName,
+                (fastBayerPattern_t)ui->cboBayerPattern->currentData().toInt());
+    camera->setPlayback(settings.playbackMaxSpeed ? SequenceCamera::pmMaxSpeed : SequenceCamera::pmRecorded,
+                        settings.playbackLoop);
+    initNewCamera(camera, 0);
+}
+
 void MainWindow::onCameraStateChanged(GPUCameraBase::cmrCameraState newState)
 {
     if(newState == GPUCameraBase::cstClosed)
@@ -1144,6 +1289,7 @@ void MainWindow::onCameraStateChanged(GPUCameraBase::cmrCameraState newState)
         }
         ui->actionPlay->setEnabled(false);
         ui->actionRecord->setEnabled(false);
+        ui->actionBurstTrigger->setEnabled(false);
 
     }
     else if(newState == GPUCameraBase::cstStopped)
@@ -1154,6 +1300,7 @@ void MainWindow::onCameraStateChanged(GPUCameraBase::cmrCameraState newState)
             ui->actionPlay->setChecked(false);
         }
         ui->actionRecord->setEnabled(false);
+        ui->actionBurstTrigger->setEnabled(false);
     }
     else if(newState == GPUCameraBase::cstStreaming)
     {
@@ -1163,6 +1310,7 @@ void MainWindow::onCameraStateChanged(GPUCameraBase::cmrCameraState newState)
             ui->actionPlay->setChecked(true);
         }
         ui->actionRecord->setEnabled(true);
+        ui->actionBurstTrigger->setEnabled(mProcessorPtr && mProcessorPtr->burstRecorder());
     }
 }
 
@@ -1187,17 +1335,43 @@ void MainWindow::on_actionPlay_toggled(bool arg1)
         mRendererPtr->showImage();
         mCameraPtr->start();
         mProcessorPtr->start();
+        mPipelines.start(mOptions, mProcessorPtr.data());
         ui->gtgWidget->start();
 
     }
     else
     {
         mCameraPtr->stop();
+        mPipelines.stop();
         ui->gtgWidget->stop();
     }
 }
 
 
+void MainWindow::onCameraRoiRequested()
+{
+    if(!mCameraPtr || !mProcessorPtr)
+        return;
+
+    //Readout window can be changed on a stopped camera only
+    const bool playing = ui->actionPlay->isChecked();
+    ui->actionPlay->setChecked(false);
+
+    const GPUCameraBase::cmrRoi roi = ui->cameraController->roi();
+    if(!mCameraPtr->setRoi(roi))
+        QMessageBox::warning(this, QCoreApplication::applicationName(),
+                             QObject::tr("Camera does not support the requested region of interest."));
+    mPipelines.setRoi(roi);
+    ui->cameraController->updateRoi();
+
+    //Buffers and processors are sized for the window, not the full sensor
+    PipelineManager::setCameraOptions(mCameraPtr.data(), mOptions);
+    mRendererPtr->setImageSize(QSize(mOptions.Width, mOptions.Height));
+    raw2Rgb(false, true);
+
+    ui->actionPlay->setChecked(playing);
+}
+
 void MainWindow::onNewWBFromPoint(const QPoint& pt)
 {
     if(!mCameraPtr || !mProcessorPtr)
@@ -1341,6 +1515,8 @@ void MainWindow::on_actionClose_triggered()
     }
     ui->cameraStatistics->setCamera(nullptr);
     ui->cameraController->setCamera(nullptr);
+    mMetricsServer.setCamera(nullptr);
+    mMetricsServer.setProcessor(nullptr);
 
     mCameraPtr.reset(nullptr);
     mProcessorPtr.reset(nullptr);
@@ -36,6 +36,8 @@
 #include "FrameBuffer.h"
 #include "GPUCameraBase.h"
 #include "GLImageViewer.h"
+#include "MetricsServer.h"
+#include "PipelineManager.h"
 
 class GLImageViewer;
 class RawProcessor;
@@ -99,6 +101,7 @@ private slots:
     //Toolbar
     void on_actionOpenCamera_triggered();
     void on_actionRecord_toggled(bool arg1);
+    void on_actionBurstTrigger_triggered();
     void on_actionExit_triggered();
     void on_actionWB_picker_toggled(bool arg1);
     void on_actionPlay_toggled(bool arg1);
@@ -119,9 +122,12 @@ private slots:
     void openCameraObj(GPUCameraBase* camera);
     void openPGMFile(bool isBayer = true);
     void initNewCamera(GPUCameraBase* cmr, uint32_t devID);
+    void openCameraPipelines(const PipelineManager::CameraFactory& factory);
     void onCameraStateChanged(GPUCameraBase::cmrCameraState newState);
+    void onCameraRoiRequested();
     void on_actionOpenBayerPGM_triggered();
     void on_actionOpenGrayPGM_triggered();
+    void on_actionOpenSequence_triggered();
 
 
     void on_btnGetOutPath_clicked();
@@ -157,10 +163,14 @@ private:
     CUDAProcessorOptions mOptions;
     QVector<unsigned short> mGammaCurve;
     QTimer mTimerStatusRtsp;
+    MetricsServer mMetricsServer;
+    ///Cameras besides the displayed one
+    PipelineManager mPipelines;
 
     QString mCurrentDir;
 
     void delayInit();
+    void attachCamera();
     void raw2Rgb(bool update = true, bool init = false);
     void updateAll();
     void updateOptions(CUDAProcessorOptions& opts);
@@ -170,6 +180,8 @@ private:
 
     template<typename T>
     friend QAction* insertCamera(Ui::MainWindow *ui, MainWindow *mm, const QString &cameraName, QAction* prev);
+    template<typename T>
+    friend QAction* insertCameraPipelines(Ui::MainWindow *ui, MainWindow *mm, const QString &cameraName, QAction* prev);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,367 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "MetricsServer.h"
+
+#include "GPUCameraBase.h"
+#include "RawProcessor.h"
+#include "PipelineTelemetry.h"
+#include "Tracer.h"
+#include "ThreadPolicy.h"
+
+namespace
+{
+
+void addHelp(QByteArray& out, const char* name, const char* type, const char* help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void addValue(QByteArray& out, const char* name, const QByteArray& labels, double val)
+{
+    out += name;
+    if(!labels.isEmpty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += QByteArray::number(val, 'g', 15);
+    out += '\n';
+}
+
+QByteArray label(const char* name, const QString& value)
+{
+    QByteArray escaped;
+    const QByteArray utf8 = value.toUtf8();
+    escaped.reserve(utf8.size());
+    for(char c : utf8)
+    {
+        if(c == '\\' || c == '"')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if(c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+    return QByteArray(name) + "=\"" + escaped + '"';
+}
+
+}
+
+MetricsServer::MetricsServer(QObject *parent) :
+    QObject(parent)
+{
+    connect(&mServer, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(quint16 port, const QHostAddress& address)
+{
+    stop();
+    if(!mServer.listen(address, port))
+    {
+        qWarning("Metrics server: cannot listen on port %d: %s", port, qPrintable(mServer.errorString()));
+        return false;
+    }
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    mServer.close();
+    for(auto it = mRequests.begin(); it != mRequests.end(); ++it)
+    {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    mRequests.clear();
+}
+
+void MetricsServer::onNewConnection()
+{
+    while(QTcpSocket* sock = mServer.nextPendingConnection())
+    {
+        mRequests.insert(sock, QByteArray());
+        connect(sock, &QTcpSocket::readyRead, this, &MetricsServer::onReadyRead);
+        connect(sock, &QTcpSocket::disconnected, this, &MetricsServer::onDisconnected);
+    }
+}
+
+void MetricsServer::onDisconnected()
+{
+    QTcpSocket* sock = qobject_cast<QTcpSocket*>(sender());
+    if(sock == nullptr)
+        return;
+    mRequests.remove(sock);
+    sock->deleteLater();
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket* sock = qobject_cast<QTcpSocket*>(sender());
+    if(sock == nullptr || !mRequests.contains(sock))
+        return;
+
+    QByteArray& request = mRequests[sock];
+    request += sock->readAll();
+
+    int end = request.indexOf("\r\n\r\n");
+    if(end < 0)
+    {
+        if(request.size() > MaxRequestSize)
+            reply(sock, "413 Payload Too Large", "text/plain", "Request too large\n");
+        return;
+    }
+
+    const QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    if(requestLine.size() < 2)
+    {
+        reply(sock, "400 Bad Request", "text/plain", "Bad request\n");
+        return;
+    }
+
+    const QByteArray& method = requestLine[0];
+    QByteArray path = requestLine[1];
+    int query = path.indexOf('?');
+    if(query >= 0)
+        path.truncate(query);
+
+    //State changes are POST only, so links and prefetching cannot trigger them
+    const bool control = path == "/trace/start" || path == "/trace/stop";
+    if(control ? method != "POST" : (method != "GET" && method != "HEAD"))
+        reply(sock, "405 Method Not Allowed", "text/plain", "Method not allowed\n");
+    else if(path == "/metrics")
+        reply(sock, "200 OK", "text/plain; version=0.0.4; charset=utf-8", method == "HEAD" ? QByteArray() : metrics());
+    else if(path == "/trace")
+        reply(sock, "200 OK", "application/json", method == "HEAD" ? QByteArray() : Tracer::instance().toChromeJson());
+    else if(path == "/trace/start")
+    {
+        Tracer::instance().clear();
+        Tracer::instance().setEnabled(true);
+        reply(sock, "200 OK", "text/plain", "Tracing started\n");
+    }
+    else if(path == "/trace/stop")
+    {
+        Tracer::instance().setEnabled(false);
+        reply(sock, "200 OK", "text/plain", "Tracing stopped\n");
+    }
+    else if(path == "/")
+        reply(sock, "200 OK", "text/html",
+              "<html><body><a href=\"/metrics\">Metrics</a><br>"
+              "<a href=\"/trace\">Trace</a></body></html>\n");
+    else
+        reply(sock, "404 Not Found", "text/plain", "Not found\n");
+}
+
+void MetricsServer::reply(QTcpSocket* sock, const QByteArray& status, const QByteArray& contentType, const QByteArray& body)
+{
+    mRequests.remove(sock);
+
+    QByteArray response;
+    response.reserve(body.size() + 128);
+    response += "HTTP/1.1 " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    sock->write(response);
+    sock->disconnectFromHost();
+}
+
+QByteArray MetricsServer::metrics() const
+{
+    QByteArray out;
+    out.reserve(16 * 1024);
+    cameraMetrics(out);
+    processorMetrics(out);
+    streamerMetrics(out);
+    threadMetrics(out);
+    return out;
+}
+
+void MetricsServer::cameraMetrics(QByteArray& out) const
+{
+    addHelp(out, "gpucam_camera_streaming", "gauge", "1 if the camera is streaming");
+    addValue(out, "gpucam_camera_streaming", QByteArray(),
+             (mCamera && mCamera->state() == GPUCameraBase::cstStreaming) ? 1 : 0);
+    if(mCamera == nullptr)
+        return;
+
+    addHelp(out, "gpucam_camera_info", "gauge", "Connected camera");
+    addValue(out, "gpucam_camera_info",
+             label("manufacturer", mCamera->manufacturer()) + ',' +
+             label("model", mCamera->model()) + ',' +
+             label("serial", mCamera->serial()), 1);
+
+    typedef GPUCameraBase::cmrCameraStatistic Stat;
+    static const struct
+    {
+        Stat        stat;
+        const char* name;
+        const char* type;
+        const char* help;
+        double      scale;
+    } stats[] = {
+        {Stat::statFramesTotal,         "gpucam_camera_frames_total",            "counter", "Frames acquired", 1},
+        {Stat::statFramesDropped,       "gpucam_camera_frames_dropped_total",    "counter", "Frames dropped by camera or driver", 1},
+        {Stat::statFramesIncomplete,    "gpucam_camera_frames_incomplete_total", "counter", "Incomplete frames", 1},
+        {Stat::statCurrFps100,          "gpucam_camera_fps",                     "gauge",   "Current acquisition frame rate", 0.01},
+        {Stat::statCurrTroughputMbs100, "gpucam_camera_throughput_mbps",         "gauge",   "Current acquisition throughput, Mbit/s", 0.01}
+    };
+
+    for(const auto& item : stats)
+    {
+        uint64_t val = 0;
+        if(!mCamera->GetStatistics(item.stat, val))
+            continue;
+        addHelp(out, item.name, item.type, item.help);
+        addValue(out, item.name, QByteArray(), double(val) * item.scale);
+    }
+}
+
+void MetricsServer::processorMetrics(QByteArray& out) const
+{
+    if(mProcessor == nullptr)
+        return;
+
+    const PipelineTelemetry::Snapshot stats = mProcessor->getStats();
+
+    addHelp(out, "gpucam_stage_time_seconds", "summary", "Pipeline stage latency");
+    for(int i = 0; i < PipelineTelemetry::stCount; i++)
+    {
+        const PipelineTelemetry::StageStats& st = stats.stages[i];
+        if(st.p50Ms < 0)
+            continue;
+        const QByteArray stage = label("stage", PipelineTelemetry::stageName(PipelineTelemetry::Stage(i)));
+        addValue(out, "gpucam_stage_time_seconds", stage + ",quantile=\"0.5\"", double(st.p50Ms) / 1000.);
+        addValue(out, "gpucam_stage_time_seconds", stage + ",quantile=\"0.99\"", double(st.p99Ms) / 1000.);
+        addValue(out, "gpucam_stage_time_seconds", stage + ",quantile=\"1\"", double(st.maxMs) / 1000.);
+        addValue(out, "gpucam_stage_time_seconds_sum", stage, st.sumMs / 1000.);
+        addValue(out, "gpucam_stage_time_seconds_count", stage, double(st.timedFrames));
+    }
+
+    addHelp(out, "gpucam_stage_last_time_ms", "gauge", "Pipeline stage latency of the latest frame, ms");
+    for(int i = 0; i < PipelineTelemetry::stCount; i++)
+    {
+        const PipelineTelemetry::StageStats& st = stats.stages[i];
+        if(!st.active || st.lastMs < 0)
+            continue;
+        addValue(out, "gpucam_stage_last_time_ms",
+                 label("stage", PipelineTelemetry::stageName(PipelineTelemetry::Stage(i))), double(st.lastMs));
+    }
+
+    addHelp(out, "gpucam_stage_frames_total", "counter", "Frames passed by pipeline stage");
+    for(int i = 0; i < PipelineTelemetry::stCount; i++)
+    {
+        const PipelineTelemetry::StageStats& st = stats.stages[i];
+        if(st.framesIn == 0)
+            continue;
+        addValue(out, "gpucam_stage_frames_total",
+                 label("stage", PipelineTelemetry::stageName(PipelineTelemetry::Stage(i))), double(st.framesOut));
+    }
+
+    addHelp(out, "gpucam_stage_frames_dropped_total", "counter", "Frames failed or dropped by pipeline stage");
+    for(int i = 0; i < PipelineTelemetry::stCount; i++)
+    {
+        const PipelineTelemetry::StageStats& st = stats.stages[i];
+        if(st.framesIn == 0)
+            continue;
+        addValue(out, "gpucam_stage_frames_dropped_total",
+                 label("stage", PipelineTelemetry::stageName(PipelineTelemetry::Stage(i))), double(st.framesDropped));
+    }
+
+    for(int i = 0; i < PipelineTelemetry::gCount; i++)
+    {
+        const int64_t val = stats.gauges[i];
+        if(val < 0)
+            continue;
+        const QByteArray name = QByteArray("gpucam_") + PipelineTelemetry::gaugeName(PipelineTelemetry::Gauge(i));
+        addHelp(out, name.constData(), "gauge", "Pipeline gauge");
+        addValue(out, name.constData(), QByteArray(), double(val));
+    }
+}
+
+void MetricsServer::streamerMetrics(QByteArray& out) const
+{
+    if(mProcessor == nullptr)
+        return;
+
+    const std::vector<RTSPStreamerServer::ClientStats> clients = mProcessor->rtspClientStats();
+
+    addHelp(out, "gpucam_rtsp_clients", "gauge", "Connected RTSP clients");
+    addValue(out, "gpucam_rtsp_clients", QByteArray(), double(clients.size()));
+    if(clients.empty())
+        return;
+
+    addHelp(out, "gpucam_rtsp_client_bytes_sent_total", "counter", "Bytes sent to RTSP client");
+    for(const RTSPStreamerServer::ClientStats& c : clients)
+        addValue(out, "gpucam_rtsp_client_bytes_sent_total", label("client", c.peer), double(c.bytesSent));
+
+    addHelp(out, "gpucam_rtsp_client_frames_sent_total", "counter", "Encoded frames sent to RTSP client");
+    for(const RTSPStreamerServer::ClientStats& c : clients)
+        addValue(out, "gpucam_rtsp_client_frames_sent_total", label("client", c.peer), double(c.packetsSent));
+}
+
+void MetricsServer::threadMetrics(QByteArray& out) const
+{
+    const QVector<ThreadPolicy::ThreadInfo> threads = ThreadPolicy::threads();
+    if(threads.isEmpty())
+        return;
+
+    addHelp(out, "gpucam_thread_cpu_seconds_total", "counter", "CPU time of the application thread");
+    for(const ThreadPolicy::ThreadInfo& t : threads)
+    {
+        addValue(out, "gpucam_thread_cpu_seconds_total",
+                 label("thread", t.name) + ',' +
+                 label("role", QLatin1String(AppSettings::threadRoleName(t.role))),
+                 t.cpuSeconds);
+    }
+
+    addHelp(out, "gpucam_thread_realtime", "gauge", "1 if the thread runs with real-time scheduling");
+    for(const ThreadPolicy::ThreadInfo& t : threads)
+        addValue(out, "gpucam_thread_realtime", label("thread", t.name), t.realtime ? 1 : 0);
+}
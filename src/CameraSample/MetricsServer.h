@@ -0,0 +1,92 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QHash>
+#include <QByteArray>
+
+class GPUCameraBase;
+class RawProcessor;
+
+///Embedded HTTP endpoint exposing camera, processor, writer and streamer
+///metrics and CPU time of the application threads in Prometheus text
+///exposition format (GET /metrics).
+///GET /trace returns Chrome trace JSON, POST /trace/start and /trace/stop
+///control the tracer.
+///There is no authentication, so it listens on localhost unless told otherwise.
+///Lives in the GUI thread, scrapes read the same statistics the UI shows.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    static const quint16 DefaultPort = 9464;
+
+    explicit MetricsServer(QObject *parent = nullptr);
+    ~MetricsServer();
+
+    ///Start listening. Return true on success, false otherwise.
+    bool start(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+    void stop();
+    bool isListening() const {return mServer.isListening();}
+    quint16 port() const {return mServer.serverPort();}
+    QString errorString() const {return mServer.errorString();}
+
+    void setCamera(GPUCameraBase* camera){mCamera = camera;}
+    void setProcessor(RawProcessor* proc){mProcessor = proc;}
+
+    ///Current metrics in Prometheus text format
+    QByteArray metrics() const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    static const int MaxRequestSize = 8192;
+
+    QTcpServer     mServer;
+    GPUCameraBase* mCamera = nullptr;
+    RawProcessor*  mProcessor = nullptr;
+    QHash<QTcpSocket*, QByteArray> mRequests;
+
+    void reply(QTcpSocket* sock, const QByteArray& status, const QByteArray& contentType, const QByteArray& body);
+
+    void cameraMetrics(QByteArray& out) const;
+    void processorMetrics(QByteArray& out) const;
+    void streamerMetrics(QByteArray& out) const;
+    void threadMetrics(QByteArray& out) const;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,332 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "PipelineManager.h"
+#include "GPUCameraBase.h"
+#include "RawProcessor.h"
+#include "AppSettings.h"
+
+#include <QDebug>
+#include <cuda_runtime.h>
+#include <thread>
+#include <vector>
+
+PipelineManager::PipelineManager(QObject *parent) :
+    QObject(parent)
+{
+}
+
+PipelineManager::~PipelineManager()
+{
+    close();
+}
+
+int PipelineManager::open(const CameraFactory& factory, int count, const QVector<int>& cudaDevices)
+{
+    close();
+
+    AppSettings settings;
+    const QVector<int> devices = cudaDevices.isEmpty() ? settings.pipelineCudaDevices : cudaDevices;
+    for(int i = 0; i < count; i++)
+    {
+        QSharedPointer<Pipeline> p(new Pipeline());
+        p->devID = uint32_t(i);
+        p->cudaDevice = devices[i % devices.size()];
+        if(!settings.pipelineCpuCores.isEmpty())
+            p->cpuCore = settings.pipelineCpuCores[i % settings.pipelineCpuCores.size()];
+        p->camera.reset(factory());
+        if(p->camera)
+            p->camera->setCudaDevice(p->cudaDevice);
+        mPipelines.append(p);
+    }
+
+    //Opening is mostly waiting for the device, do it for all cameras at once.
+    //Input buffers are allocated on the current CUDA device of the opening thread.
+    std::vector<std::thread> threads;
+    //Each thread writes its own element through a raw pointer, no shared container state is touched
+    std::vector<char> opened(size_t(count), 0);
+    char* openedData = opened.data();
+    for(int i = 0; i < count; i++)
+    {
+        Pipeline* p = mPipelines[i].data();
+        if(!p->camera)
+            continue;
+        threads.emplace_back([p, i, openedData](){
+            cudaSetDevice(p->cudaDevice);
+            openedData[i] = p->camera->open(p->devID) ? 1 : 0;
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+
+    int ret = 0;
+    for(int i = 0; i < count; i++)
+    {
+        if(opened[size_t(i)])
+        {
+            ret++;
+            continue;
+        }
+        qDebug() << "Cannot open camera" << i;
+        mPipelines[i]->camera.reset();
+    }
+    return ret;
+}
+
+GPUCameraBase* PipelineManager::takeCamera(int idx)
+{
+    if(idx < 0 || idx >= mPipelines.size())
+        return nullptr;
+    return mPipelines[idx]->camera.take();
+}
+
+void PipelineManager::start(const CUDAProcessorOptions& opts, RawProcessor* primary, bool startCameras)
+{
+    //Processor init switches the current device of this thread
+    int prevDevice = 0;
+    cudaGetDevice(&prevDevice);
+
+    AppSettings settings;
+    for(auto& p : mPipelines)
+    {
+        if(!p->camera)
+            continue;
+
+        if(!p->processor)
+        {
+            p->processor.reset(new RawProcessor(p->camera.data(), nullptr));
+            p->processor->setCpuAffinity(p->cpuCore);
+            p->processor->setBurst(settings.burstPreFrames, settings.burstPostFrames);
+            p->camera->setProcessor(p->processor.data());
+
+            RawProcessor* proc = p->processor.data();
+            const uint32_t devID = p->devID;
+            connect(proc, &RawProcessor::error, this, [proc, devID](){
+                qDebug() << "Camera" << devID << "processing error:" << proc->getLastErrorDescription();
+            });
+        }
+
+        p->processor->updateOptions(pipelineOptions(*p, opts));
+        if(p->processor->init() != FAST_OK)
+        {
+            qDebug() << "Cannot init processor for camera" << p->devID;
+            p->camera->setProcessor(nullptr);
+            p->processor.reset();
+            continue;
+        }
+    }
+
+    //Processors must be attached before the first frame comes in
+    setupSync(primary);
+    for(auto& p : mPipelines)
+    {
+        if(!p->camera || !p->processor)
+            continue;
+        if(startCameras)
+            p->camera->start();
+        p->processor->start();
+    }
+
+    cudaSetDevice(prevDevice);
+}
+
+void PipelineManager::setupSync(RawProcessor* primary)
+{
+    AppSettings settings;
+    if(mSync)
+    {
+        mSync->reset();
+        return;
+    }
+
+    if(!settings.pipelineSync || primary == nullptr)
+        return;
+
+    //The primary processor stands in for the taken camera 0.
+    //Cameras which failed to open or init are left out, they would stall every set.
+    QVector<RawProcessor*> processors;
+    QVector<int64_t> offsets;
+    //Timestamps are only comparable directly if every camera follows the PTP clock
+    bool ptp = settings.pipelineSyncPtp && primary->camera() && primary->camera()->ptpEnabled();
+    processors.append(primary);
+    offsets.append(settings.pipelineTimestampOffsetsNs.value(0));
+    for(int i = 1; i < mPipelines.size(); i++)
+    {
+        if(!mPipelines[i]->processor)
+            continue;
+        processors.append(mPipelines[i]->processor.data());
+        ptp = ptp && mPipelines[i]->camera && mPipelines[i]->camera->ptpEnabled();
+        offsets.append(settings.pipelineTimestampOffsetsNs.value(int(mPipelines[i]->devID)));
+    }
+    if(processors.size() < 2)
+        return;
+
+    if(settings.pipelineSyncPtp && !ptp)
+        qDebug() << "PTP is not enabled on every camera, estimating clock offsets from arrival times";
+
+    mSync.reset(new FrameSynchronizer(processors.size(), int64_t(settings.pipelineSyncToleranceUs) * 1000, ptp));
+    mSync->setOffsets(offsets);
+    for(int i = 0; i < processors.size(); i++)
+    {
+        processors[i]->setSynchronizer(mSync.data(), i);
+        mSync->setProcessor(i, processors[i]);
+    }
+    mPrimary = primary;
+}
+
+void PipelineManager::stop()
+{
+    for(auto& p : mPipelines)
+    {
+        if(p->camera)
+            p->camera->stop();
+    }
+    for(auto& p : mPipelines)
+    {
+        if(p->processor)
+            p->processor->stop();
+    }
+}
+
+void PipelineManager::close()
+{
+    stop();
+    for(auto& p : mPipelines)
+    {
+        if(p->camera)
+        {
+            p->camera->setProcessor(nullptr);
+            p->camera->close();
+        }
+    }
+    if(mPrimary)
+        mPrimary->setSynchronizer(nullptr, 0);
+    mPrimary = nullptr;
+    mPipelines.clear();
+    mSync.reset();
+}
+
+void PipelineManager::updateOptions(const CUDAProcessorOptions& opts, bool init)
+{
+    int prevDevice = 0;
+    cudaGetDevice(&prevDevice);
+
+    for(auto& p : mPipelines)
+    {
+        if(!p->processor)
+            continue;
+
+        p->processor->updateOptions(pipelineOptions(*p, opts));
+        if(init)
+            p->processor->init();
+        p->processor->wake();
+    }
+
+    cudaSetDevice(prevDevice);
+}
+
+void PipelineManager::startWriting(const CUDAProcessorOptions& opts, const QString& path, const QString& prefix)
+{
+    for(auto& p : mPipelines)
+    {
+        if(!p->processor)
+            continue;
+
+        p->processor->setOutputPath(path);
+        p->processor->setFilePrefix(filePrefix(prefix, p->devID));
+        p->processor->updateOptions(pipelineOptions(*p, opts));
+        p->processor->startWriting();
+    }
+}
+
+void PipelineManager::stopWriting(const CUDAProcessorOptions& opts)
+{
+    for(auto& p : mPipelines)
+    {
+        if(!p->processor)
+            continue;
+
+        p->processor->updateOptions(pipelineOptions(*p, opts));
+        p->processor->stopWriting();
+    }
+}
+
+void PipelineManager::triggerBurst(const QString& path, const QString& prefix)
+{
+    for(auto& p : mPipelines)
+    {
+        if(!p->processor)
+            continue;
+
+        p->processor->setOutputPath(path);
+        p->processor->setFilePrefix(filePrefix(prefix, p->devID));
+        if(!p->processor->triggerBurst())
+            qDebug() << "Burst not started for camera" << p->devID;
+    }
+}
+
+void PipelineManager::setRoi(const GPUCameraBase::cmrRoi& roi)
+{
+    for(auto& p : mPipelines)
+    {
+        if(p->camera && !p->camera->setRoi(roi))
+            qDebug() << "Cannot set ROI for camera" << p->devID;
+    }
+}
+
+QString PipelineManager::filePrefix(const QString& prefix, uint32_t devID)
+{
+    return QStringLiteral("%1cam%2_").arg(prefix).arg(devID);
+}
+
+void PipelineManager::setCameraOptions(GPUCameraBase* camera, CUDAProcessorOptions& opts)
+{
+    opts.Width = camera->width();
+    opts.Height = camera->height();
+    opts.MaxWidth = unsigned(camera->maxWidth());
+    opts.MaxHeight = unsigned(camera->maxHeight());
+    opts.BayerFormat = camera->bayerPattern();
+    opts.SurfaceFmt = camera->surfaceFormat();
+    opts.WhiteLevel = camera->whiteLevel();
+    opts.BlackLevel = 0;
+    opts.Packed = camera->isPacked();
+    opts.Packing = camera->packing();
+    opts.DeviceId = unsigned(camera->cudaDevice());
+}
+
+CUDAProcessorOptions PipelineManager::pipelineOptions(const Pipeline& p, const CUDAProcessorOptions& opts) const
+{
+    CUDAProcessorOptions ret(opts);
+    setCameraOptions(p.camera.data(), ret);
+
+    //Dark frame and flat field are per sensor, they are loaded for the displayed camera only
+    ret.EnableSAM = false;
+    ret.MatrixA = nullptr;
+    ret.MatrixB = nullptr;
+    return ret;
+}
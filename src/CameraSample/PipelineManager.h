@@ -0,0 +1,103 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef PIPELINEMANAGER_H
+#define PIPELINEMANAGER_H
+
+#include <QObject>
+#include <QVector>
+#include <QSharedPointer>
+#include <QScopedPointer>
+#include <functional>
+
+#include "CUDAProcessorOptions.h"
+#include "FrameSynchronizer.h"
+#include "GPUCameraBase.h"
+
+class RawProcessor;
+
+///Runs several cameras of one kind at once. Every camera gets its own
+///RawProcessor, CUDA device and CPU core (see Pipelines/* in AppSettings),
+///output path and encoder settings are shared.
+class PipelineManager : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<GPUCameraBase*()> CameraFactory;
+
+    struct Pipeline
+    {
+        QScopedPointer<GPUCameraBase> camera;
+        QScopedPointer<RawProcessor> processor;
+        uint32_t devID = 0;
+        int cudaDevice = 0;
+        int cpuCore = -1;
+    };
+
+    explicit PipelineManager(QObject *parent = nullptr);
+    ~PipelineManager();
+
+    ///Open cameras 0..count-1 concurrently. Return number of opened cameras.
+    ///cudaDevices overrides Pipelines/CudaDevices of the settings if not empty.
+    int open(const CameraFactory& factory, int count, const QVector<int>& cudaDevices = QVector<int>());
+    ///Hand the camera of pipeline idx over to the caller, the pipeline stays empty
+    GPUCameraBase* takeCamera(int idx);
+    ///Create processors if needed and start streaming. primary processes the
+    ///camera taken with takeCamera(0), it joins frame synchronization if enabled.
+    ///startCameras false leaves the cameras stopped, e.g. to start writing first.
+    void start(const CUDAProcessorOptions& opts, RawProcessor* primary = nullptr, bool startCameras = true);
+    void stop();
+    void close();
+    void updateOptions(const CUDAProcessorOptions& opts, bool init = false);
+    void startWriting(const CUDAProcessorOptions& opts, const QString& path, const QString& prefix);
+    void stopWriting(const CUDAProcessorOptions& opts);
+    ///Start a burst on every camera with burst mode on, see Burst/* in AppSettings
+    void triggerBurst(const QString& path, const QString& prefix);
+    ///Set the readout window of all stopped cameras, processors follow on the next updateOptions(opts, true)
+    void setRoi(const GPUCameraBase::cmrRoi& roi);
+
+    int count() const {return mPipelines.size();}
+    const Pipeline& pipeline(int idx) const {return *mPipelines[idx];}
+    ///nullptr if frames are not synchronized
+    FrameSynchronizer* synchronizer() {return mSync.data();}
+
+    ///Output file prefix of the camera
+    static QString filePrefix(const QString& prefix, uint32_t devID);
+    ///Copy camera dependent fields into processing options
+    static void setCameraOptions(GPUCameraBase* camera, CUDAProcessorOptions& opts);
+
+private:
+    QVector<QSharedPointer<Pipeline>> mPipelines;
+    QScopedPointer<FrameSynchronizer> mSync;
+    RawProcessor* mPrimary = nullptr;
+
+    CUDAProcessorOptions pipelineOptions(const Pipeline& p, const CUDAProcessorOptions& opts) const;
+    void setupSync(RawProcessor* primary);
+};
+
+#endif // PIPELINEMANAGER_H
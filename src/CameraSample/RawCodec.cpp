@@ -0,0 +1,552 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "RawCodec.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+//Unary codes longer than this are escaped to the raw residual
+const int kLimit = 16;
+const int kBuckets = 16;
+const unsigned kDefaultStripRows = 64;
+
+inline int bitLength(uint32_t v)
+{
+    if(v == 0)
+        return 0;
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse(&idx, v);
+    return int(idx) + 1;
+#else
+    return 32 - __builtin_clz(v);
+#endif
+}
+
+inline int leadingZeros64(uint64_t v)
+{
+    if(v == 0)
+        return 64;
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return 63 - int(idx);
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+struct context
+{
+    uint32_t A;
+    uint32_t N;
+
+    int k() const
+    {
+        //Smallest k with N << k >= A
+        int k = std::max(0, bitLength(A) - bitLength(N));
+        return k + int((N << k) < A);
+    }
+    void update(uint32_t u)
+    {
+        A += u;
+        if(++N == 64)
+        {
+            A >>= 1;
+            N >>= 1;
+        }
+    }
+};
+
+struct contexts
+{
+    context c[4][kBuckets];
+
+    contexts()
+    {
+        for(auto& colour : c)
+            for(auto& ctx : colour)
+                ctx = {4, 1};
+    }
+};
+
+//MED predictor and activity bucket from the same colour neighbours
+inline unsigned predict(unsigned a, unsigned b, unsigned c)
+{
+    //Selects instead of branches, the comparisons are data dependent
+    unsigned mn = std::min(a, b);
+    unsigned mx = std::max(a, b);
+    unsigned p = a + b - c;
+    p = c >= mx ? mn : p;
+    p = c <= mn ? mx : p;
+    return p;
+}
+
+inline int bucket(unsigned a, unsigned b, unsigned c)
+{
+    unsigned d = unsigned(std::abs(int(a) - int(c)) + std::abs(int(b) - int(c)));
+    return std::min(bitLength(d), kBuckets - 1);
+}
+
+class bit_writer
+{
+public:
+    bit_writer(unsigned char* dst, size_t size) : mPtr(dst), mEnd(dst + size){}
+
+    //Up to 32 bits, less than 32 bits are pending between calls
+    void put(uint32_t v, int bits)
+    {
+        mAcc = (mAcc << bits) | v;
+        mBits += bits;
+        if(mBits >= 32)
+        {
+            mBits -= 32;
+            uint32_t w = uint32_t(mAcc >> mBits);
+            if(mPtr + 4 <= mEnd)
+            {
+                mPtr[0] = (unsigned char)(w >> 24);
+                mPtr[1] = (unsigned char)(w >> 16);
+                mPtr[2] = (unsigned char)(w >> 8);
+                mPtr[3] = (unsigned char)w;
+                mPtr += 4;
+            }
+        }
+    }
+    unsigned char* flush()
+    {
+        //Pad the pending bits to whole bytes
+        for(; mBits > 0 && mPtr < mEnd; mBits -= 8)
+        {
+            if(mBits < 8)
+            {
+                mAcc <<= 8 - mBits;
+                mBits = 8;
+            }
+            *mPtr++ = (unsigned char)(mAcc >> (mBits - 8));
+        }
+        mBits = 0;
+        return mPtr;
+    }
+
+private:
+    unsigned char* mPtr;
+    unsigned char* mEnd;
+    uint64_t mAcc = 0;
+    int mBits = 0;
+};
+
+class bit_reader
+{
+public:
+    bit_reader(const unsigned char* src, size_t size) : mPtr(src), mEnd(src + size){}
+
+    uint32_t get(int bits)
+    {
+        if(bits == 0)
+            return 0;
+        fill();
+        uint32_t v = uint32_t(mAcc >> (64 - bits));
+        mAcc <<= bits;
+        mBits -= bits;
+        return v;
+    }
+    //Zero bits before the next one, kLimit if there are at least kLimit.
+    //Consumes the zeros and the terminating one.
+    int unary()
+    {
+        fill();
+        int q = leadingZeros64(mAcc);
+        if(q >= kLimit)
+        {
+            mAcc <<= kLimit;
+            mBits -= kLimit;
+            return kLimit;
+        }
+        mAcc <<= q + 1;
+        mBits -= q + 1;
+        return q;
+    }
+    //Read past the end of data
+    bool overrun() const {return mPadding * 8 > mBits;}
+
+private:
+    void fill()
+    {
+        if(mBits > 32)
+            return;
+        if(mPtr + 4 <= mEnd)
+        {
+            uint64_t w = (uint64_t(mPtr[0]) << 24) | (uint64_t(mPtr[1]) << 16) |
+                         (uint64_t(mPtr[2]) << 8) | uint64_t(mPtr[3]);
+            mAcc |= w << (32 - mBits);
+            mBits += 32;
+            mPtr += 4;
+            return;
+        }
+        while(mBits <= 56)
+        {
+            uint64_t b = 0;
+            if(mPtr < mEnd)
+                b = *mPtr++;
+            else
+                mPadding++;
+            mAcc |= b << (56 - mBits);
+            mBits += 8;
+        }
+    }
+
+    const unsigned char* mPtr;
+    const unsigned char* mEnd;
+    uint64_t mAcc = 0;
+    int mBits = 0;
+    int mPadding = 0;
+};
+
+//u is the zigzag mapped residual
+inline void putResidual(bit_writer& bw, context& ctx, uint32_t u, int bits)
+{
+    int k = std::min(ctx.k(), bits);
+    uint32_t q = u >> k;
+    if(q < uint32_t(kLimit))
+    {
+        //q zeros, one and k low bits, at most 32 bits
+        bw.put((1u << k) | (u & ((1u << k) - 1)), int(q) + 1 + k);
+    }
+    else
+    {
+        bw.put(0, kLimit);
+        bw.put(u, bits + 1);
+    }
+    ctx.update(u);
+}
+
+inline int getResidual(bit_reader& br, context& ctx, int bits)
+{
+    int k = std::min(ctx.k(), bits);
+    int q = br.unary();
+    uint32_t u;
+    if(q < kLimit)
+        u = (uint32_t(q) << k) | br.get(k);
+    else
+        u = br.get(bits + 1);
+    ctx.update(u);
+    return (u & 1) ? -int(u >> 1) - 1 : int(u >> 1);
+}
+
+//Zigzag mapped residuals and neighbour activity of row y, no data dependencies
+//between samples so the loops are vectorized
+template<typename T>
+void predictRow(const T* cur, const T* up, unsigned w, unsigned shift, unsigned mid,
+                uint32_t* residual, uint32_t* activity)
+{
+    for(unsigned x = 0; x < w && x < 2; x++)
+    {
+        int e = int(unsigned(cur[x]) >> shift) - int(up ? unsigned(up[x]) >> shift : mid);
+        residual[x] = uint32_t(e * 2) ^ uint32_t(e >> 31);
+        activity[x] = 0;
+    }
+    if(up == nullptr)
+    {
+        for(unsigned x = 2; x < w; x++)
+        {
+            int e = int(unsigned(cur[x]) >> shift) - int(unsigned(cur[x - 2]) >> shift);
+            residual[x] = uint32_t(e * 2) ^ uint32_t(e >> 31);
+            activity[x] = 0;
+        }
+        return;
+    }
+    for(unsigned x = 2; x < w; x++)
+    {
+        int a = int(unsigned(cur[x - 2]) >> shift);
+        int b = int(unsigned(up[x]) >> shift);
+        int c = int(unsigned(up[x - 2]) >> shift);
+        int v = int(unsigned(cur[x]) >> shift);
+        //predict() on signed values
+        int mn = std::min(a, b);
+        int mx = std::max(a, b);
+        int p = a + b - c;
+        p = c >= mx ? mn : p;
+        p = c <= mn ? mx : p;
+        int e = v - p;
+        residual[x] = uint32_t(e * 2) ^ uint32_t(e >> 31);
+        activity[x] = uint32_t(std::abs(a - c) + std::abs(b - c));
+    }
+}
+
+template<typename T>
+void encodeRows(const unsigned char* src, unsigned pitch, unsigned w, unsigned y0, unsigned y1,
+                unsigned shift, int bits, bit_writer& bw)
+{
+    contexts ctx;
+    const unsigned mid = bits > 0 ? 1u << (bits - 1) : 0;
+    std::vector<uint32_t> residual(w);
+    std::vector<uint32_t> activity(w);
+    for(unsigned y = y0; y < y1; y++)
+    {
+        const T* cur = reinterpret_cast<const T*>(src + size_t(y) * pitch);
+        const T* up = y - y0 >= 2 ? reinterpret_cast<const T*>(src + size_t(y - 2) * pitch) : nullptr;
+        predictRow(cur, up, w, shift, mid, residual.data(), activity.data());
+
+        //Rice coding is serial, the contexts adapt sample by sample
+        context* row = ctx.c[(y & 1) << 1];
+        for(unsigned x = 0; x < w; x++)
+        {
+            int bkt = std::min(bitLength(activity[x]), kBuckets - 1);
+            putResidual(bw, row[(x & 1) * kBuckets + bkt], residual[x], bits);
+        }
+    }
+}
+
+template<typename T>
+bool decodeRows(const unsigned char* data, size_t size, unsigned char* dst, unsigned pitch, unsigned w,
+                unsigned y0, unsigned y1, unsigned shift, int bits)
+{
+    bit_reader br(data, size);
+    contexts ctx;
+    const unsigned mid = bits > 0 ? 1u << (bits - 1) : 0;
+    const int maxValue = (1 << bits) - 1;
+    for(unsigned y = y0; y < y1; y++)
+    {
+        T* cur = reinterpret_cast<T*>(dst + size_t(y) * pitch);
+        const T* up = y - y0 >= 2 ? reinterpret_cast<const T*>(dst + size_t(y - 2) * pitch) : nullptr;
+        context* row = ctx.c[(y & 1) << 1];
+        for(unsigned x = 0; x < w; x++)
+        {
+            //Same neighbours and contexts as in encodeRows()
+            unsigned p;
+            int bkt = 0;
+            if(up && x >= 2)
+            {
+                unsigned a = unsigned(cur[x - 2]) >> shift;
+                unsigned b = unsigned(up[x]) >> shift;
+                unsigned c = unsigned(up[x - 2]) >> shift;
+                p = predict(a, b, c);
+                bkt = bucket(a, b, c);
+            }
+            else if(up)
+                p = unsigned(up[x]) >> shift;
+            else if(x >= 2)
+                p = unsigned(cur[x - 2]) >> shift;
+            else
+                p = mid;
+
+            int v = int(p) + getResidual(br, row[(x & 1) * kBuckets + bkt], bits);
+            if(v < 0 || v > maxValue)
+                return false;
+            cur[x] = T(unsigned(v) << shift);
+        }
+        if(br.overrun())
+            return false;
+    }
+    return true;
+}
+
+unsigned stripRowsOf(unsigned rows)
+{
+    rows = rows == 0 ? kDefaultStripRows : rows;
+    return std::max(2u, (rows + 1) & ~1u);
+}
+
+//Worst case bytes of a strip: escaped residual of every sample
+size_t maxStripSize(unsigned width, unsigned rows, unsigned bytesPerSample)
+{
+    return (size_t(width) * rows * (kLimit + 8 * bytesPerSample + 1) + 7) / 8 + 8;
+}
+}
+
+struct RawCodec::strip
+{
+    std::vector<unsigned char> data;
+    size_t size = 0;
+    size_t offset = 0;
+};
+
+RawCodec::RawCodec() = default;
+RawCodec::~RawCodec() = default;
+
+void RawCodec::setStripRows(unsigned rows)
+{
+    mStripRows = rows;
+}
+
+size_t RawCodec::maxEncodedSize(unsigned width, unsigned height, unsigned bytesPerSample)
+{
+    //Strips have at least 2 rows
+    size_t strips = (height + 1) / 2;
+    return sizeof(Header) + strips * (sizeof(uint32_t) + 8) + maxStripSize(width, height, bytesPerSample);
+}
+
+size_t RawCodec::encode(const void* src, unsigned width, unsigned height, unsigned pitch,
+                        unsigned bytesPerSample, unsigned char* dst, size_t dstSize)
+{
+    if(src == nullptr || dst == nullptr || width == 0 || height == 0 ||
+       (bytesPerSample != 1 && bytesPerSample != 2))
+        return 0;
+
+    const unsigned char* ptr = static_cast<const unsigned char*>(src);
+
+    //Significant bits and zero low bits of all samples
+    unsigned bitsOr = 0;
+    const int h = int(height);
+#pragma omp parallel for reduction(|:bitsOr)
+    for(int y = 0; y < h; y++)
+    {
+        const unsigned char* row = ptr + size_t(y) * pitch;
+        unsigned acc = 0;
+        if(bytesPerSample == 2)
+        {
+            const uint16_t* s = reinterpret_cast<const uint16_t*>(row);
+            for(unsigned x = 0; x < width; x++)
+                acc |= s[x];
+        }
+        else
+        {
+            for(unsigned x = 0; x < width; x++)
+                acc |= row[x];
+        }
+        bitsOr |= acc;
+    }
+    unsigned shift = 0;
+    while(bitsOr != 0 && (bitsOr & (1u << shift)) == 0)
+        shift++;
+
+    Header hdr;
+    hdr.width = width;
+    hdr.height = height;
+    hdr.bytesPerSample = uint8_t(bytesPerSample);
+    hdr.shift = uint8_t(shift);
+    hdr.bits = uint8_t(bitLength(bitsOr >> shift));
+    hdr.stripRows = stripRowsOf(mStripRows);
+    hdr.stripCount = (height + hdr.stripRows - 1) / hdr.stripRows;
+
+    const int count = int(hdr.stripCount);
+    while(mStrips.size() < size_t(count))
+        mStrips.emplace_back(new strip());
+
+    const size_t stripCapacity = maxStripSize(width, hdr.stripRows, bytesPerSample);
+#pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < count; i++)
+    {
+        strip& s = *mStrips[size_t(i)];
+        if(s.data.size() < stripCapacity)
+            s.data.resize(stripCapacity);
+
+        unsigned y0 = unsigned(i) * hdr.stripRows;
+        unsigned y1 = std::min(height, y0 + hdr.stripRows);
+        bit_writer bw(s.data.data(), s.data.size());
+        if(bytesPerSample == 2)
+            encodeRows<uint16_t>(ptr, pitch, width, y0, y1, shift, hdr.bits, bw);
+        else
+            encodeRows<uint8_t>(ptr, pitch, width, y0, y1, shift, hdr.bits, bw);
+        s.size = size_t(bw.flush() - s.data.data());
+    }
+
+    size_t total = sizeof(Header) + size_t(count) * sizeof(uint32_t);
+    for(int i = 0; i < count; i++)
+    {
+        mStrips[size_t(i)]->offset = total;
+        total += mStrips[size_t(i)]->size;
+    }
+    if(total > dstSize)
+        return 0;
+
+    memcpy(dst, &hdr, sizeof(Header));
+    uint32_t* sizes = reinterpret_cast<uint32_t*>(dst + sizeof(Header));
+#pragma omp parallel for
+    for(int i = 0; i < count; i++)
+    {
+        const strip& s = *mStrips[size_t(i)];
+        sizes[i] = uint32_t(s.size);
+        memcpy(dst + s.offset, s.data.data(), s.size);
+    }
+    return total;
+}
+
+bool RawCodec::header(const unsigned char* data, size_t size, Header& hdr)
+{
+    if(data == nullptr || size < sizeof(Header))
+        return false;
+
+    memcpy(&hdr, data, sizeof(Header));
+    if(hdr.magic != Magic || hdr.width == 0 || hdr.height == 0 ||
+       (hdr.bytesPerSample != 1 && hdr.bytesPerSample != 2) ||
+       hdr.bits + hdr.shift > 8 * hdr.bytesPerSample ||
+       hdr.stripRows == 0 || hdr.stripCount != (hdr.height + hdr.stripRows - 1) / hdr.stripRows)
+        return false;
+
+    return size >= sizeof(Header) + size_t(hdr.stripCount) * sizeof(uint32_t);
+}
+
+bool RawCodec::decode(const unsigned char* data, size_t size, void* dst, unsigned pitch, size_t dstSize)
+{
+    Header hdr;
+    if(dst == nullptr || !header(data, size, hdr))
+        return false;
+
+    //The header is not trusted, the frame must fit into dst
+    const size_t rowBytes = size_t(hdr.width) * hdr.bytesPerSample;
+    if(pitch < rowBytes || size_t(hdr.height - 1) * pitch + rowBytes > dstSize)
+        return false;
+
+    const int count = int(hdr.stripCount);
+    const uint32_t* sizes = reinterpret_cast<const uint32_t*>(data + sizeof(Header));
+    std::vector<size_t> offsets(size_t(count) + 1);
+    offsets[0] = sizeof(Header) + size_t(count) * sizeof(uint32_t);
+    for(int i = 0; i < count; i++)
+        offsets[size_t(i) + 1] = offsets[size_t(i)] + sizes[i];
+    if(offsets.back() > size)
+        return false;
+
+    unsigned char* out = static_cast<unsigned char*>(dst);
+    bool ok = true;
+#pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < count; i++)
+    {
+        unsigned y0 = unsigned(i) * hdr.stripRows;
+        unsigned y1 = std::min(hdr.height, y0 + hdr.stripRows);
+        const unsigned char* s = data + offsets[size_t(i)];
+        size_t sz = sizes[i];
+        bool res = hdr.bytesPerSample == 2 ?
+                    decodeRows<uint16_t>(s, sz, out, pitch, hdr.width, y0, y1, hdr.shift, hdr.bits) :
+                    decodeRows<uint8_t>(s, sz, out, pitch, hdr.width, y0, y1, hdr.shift, hdr.bits);
+        if(!res)
+        {
+#pragma omp critical
+            ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,92 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef RAWCODEC_H
+#define RAWCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+///Lossless codec for raw Bayer frames of 8 or 16 bit samples.
+///A sample is predicted from its left, upper and upper left neighbours of
+///the same colour (MED predictor of LOCO-I on the 2x2 Bayer lattice), the
+///residual is Rice coded with a parameter adapted per colour and local
+///activity. Unused low bits (MSB aligned 10/12 bit data) are dropped.
+///The frame is split into strips of rows coded independently in parallel.
+///Prediction is vectorized per row, Rice coding is serial within a strip.
+///
+///Frame layout, little endian:
+///  Header, strip count x uint32 strip size, strip data
+class RawCodec
+{
+public:
+    struct Header
+    {
+        uint32_t magic = Magic;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint8_t  bytesPerSample = 2;
+        uint8_t  bits = 0;     ///Significant bits after the shift
+        uint8_t  shift = 0;    ///Common zero low bits
+        uint8_t  reserved = 0;
+        uint32_t stripRows = 0;
+        uint32_t stripCount = 0;
+    };
+    static const uint32_t Magic = 0x46525646; //FVRF
+
+    RawCodec();
+    ~RawCodec();
+
+    ///Rows per strip, even, 0 - default
+    void setStripRows(unsigned rows);
+
+    ///Worst case size of an encoded frame
+    static size_t maxEncodedSize(unsigned width, unsigned height, unsigned bytesPerSample);
+
+    ///Encode width x height samples of bytesPerSample (1 or 2) bytes with src rows
+    ///pitch bytes apart. Return encoded size or 0 if dst is too small.
+    size_t encode(const void* src, unsigned width, unsigned height, unsigned pitch,
+                  unsigned bytesPerSample, unsigned char* dst, size_t dstSize);
+
+    ///Read the frame header, false if data is not an encoded frame
+    static bool header(const unsigned char* data, size_t size, Header& hdr);
+
+    ///Decode to dst of dstSize bytes with rows pitch bytes apart, samples have
+    ///hdr.bytesPerSample bytes. Return false on corrupted data or if the frame
+    ///does not fit into dst.
+    static bool decode(const unsigned char* data, size_t size, void* dst, unsigned pitch, size_t dstSize);
+
+private:
+    struct strip;
+    std::vector<std::unique_ptr<strip>> mStrips;
+    unsigned mStripRows = 0;
+};
+
+#endif // RAWCODEC_H
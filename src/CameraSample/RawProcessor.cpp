@@ -30,10 +30,15 @@
 #include "CUDAProcessorBase.h"
 #include "CUDAProcessorGray.h"
 #include "FrameBuffer.h"
+#include "FrameSynchronizer.h"
+#include "BurstRecorder.h"
+#include "ThreadPolicy.h"
 #include "GPUCameraBase.h"
 #include "MainWindow.h"
 #include "FPNReader.h"
 #include "FFCReader.h"
+#include "ppm.h"
+#include "TiffWriter.h"
 
 #include "avfilewriter/avfilewriter.h"
 
@@ -53,6 +58,9 @@ RawProcessor::RawProcessor(GPUCameraBase *camera, GLRenderer *renderer):QObject(
 
     connect(mProcessorPtr.data(), SIGNAL(error()), this, SIGNAL(error()));
 
+    //Files of gray cameras stay one component, RTSP needs RGB
+    mFileJpeg.setKeepGray(true);
+
     mCUDAThread.setObjectName(QStringLiteral("CUDAThread"));
     moveToThread(&mCUDAThread);
     mCUDAThread.start();
@@ -70,6 +78,10 @@ fastStatus_t RawProcessor::init()
     if(!mProcessorPtr)
         return FAST_INVALID_VALUE;
 
+    //Recreating every filter stalls the stream, skip it when the current ones will do
+    if(!mProcessorPtr->needsInit(mOptions))
+        return FAST_OK;
+
     return mProcessorPtr->Init(mOptions);
 }
 
@@ -101,12 +113,88 @@ void RawProcessor::stop()
     }
 }
 
+void RawProcessor::setCpuAffinity(int core)
+{
+    //Applied by the processing thread on start
+    mCpuCore = core;
+}
+
 void RawProcessor::wake()
 {
+    //Called from the camera thread for new frames and from the UI thread to reprocess
+    FrameSynchronizer* sync = nullptr;
+    int syncIndex = 0;
+    GPUImage_t* img = nullptr;
+    {
+        QMutexLocker l(&mWaitMutex);
+        if(mSync && mCamera)
+        {
+            //A new frame waits for its partners, the same frame is just reprocessed
+            img = mCamera->getFrameBuffer()->getLastImage();
+            if(img && (!mPushed || img->meta.frameId != mPushedFrameId))
+            {
+                mPushed = true;
+                mPushedFrameId = img->meta.frameId;
+                sync = mSync;
+                syncIndex = mSyncIndex;
+            }
+        }
+    }
+    //Synchronizer calls processImage() of all processors, this one included
+    if(sync)
+    {
+        sync->push(syncIndex, img);
+        return;
+    }
+    mWake = true;
+    mWaitCond.wakeAll();
+}
+
+void RawProcessor::setSynchronizer(FrameSynchronizer* sync, int idx)
+{
+    QMutexLocker l(&mWaitMutex);
+    mSync = sync;
+    mSyncIndex = idx;
+    mSyncImage = nullptr;
+    mPushed = false;
+}
+
+void RawProcessor::processImage(GPUImage_t* img)
+{
+    {
+        QMutexLocker l(&mWaitMutex);
+        mSyncImage = img;
+        mSyncFrameId = img ? img->meta.frameId : 0;
+    }
     mWake = true;
     mWaitCond.wakeAll();
 }
 
+void RawProcessor::setBurst(int preFrames, int postFrames)
+{
+    QMutexLocker l(&mBurstLock);
+    if(preFrames <= 0 && postFrames <= 0)
+    {
+        mBurstPtr.reset();
+        return;
+    }
+    if(!mBurstPtr || mBurstPtr->preFrames() != preFrames || mBurstPtr->postFrames() != postFrames)
+        mBurstPtr.reset(new BurstRecorder(preFrames, postFrames));
+
+    //The input ring holds packed frames if the GPU importer unpacks them
+    mBurstPtr->setPacking(mCamera && mCamera->isPacked() ? mCamera->packing() : rpNone);
+}
+
+bool RawProcessor::triggerBurst()
+{
+    QMutexLocker l(&mBurstLock);
+    if(!mBurstPtr)
+        return false;
+
+    mBurstPtr->setOutput(mOutputPath, mFilePrefix);
+    return mBurstPtr->trigger();
+}
+
 void RawProcessor::updateOptions(const CUDAProcessorOptions& opts)
 {
     if(!mProcessorPtr)
@@ -123,15 +211,23 @@ void RawProcessor::startWorking()
     QElapsedTimer tm;
     tm.start();
 
+    //Frame size may change up to the maximum without restarting
     QByteArray buffer;
-    buffer.resize(mOptions.Width * mOptions.Height * 4);
+    buffer.resize(int(qMax(mOptions.MaxWidth, mOptions.Width) * qMax(mOptions.MaxHeight, mOptions.Height) * 4));
 
     int bpc = GetBitsPerChannelFromSurface(mCamera->surfaceFormat());
     int maxVal = (1 << bpc) - 1;
-    QString pgmHeader = QString("P5\n%1 %2\n%3\n").arg(mOptions.Width).arg(mOptions.Height).arg(maxVal);
+    QByteArray pgmHeader = QString("P5\n%1 %2\n%3\n").arg(mOptions.Width).arg(mOptions.Height).arg(maxVal).toLatin1();
+    QByteArray tiffHdr;
+    QSize tiffSize;
 
     mWake = false;
 
+    ThreadPolicy::apply(AppSettings::trProcessing, mCpuCore);
+
+    //CUDA device is per thread, use the one the processor was initialized on
+    cudaSetDevice(int(mOptions.cudaDevice()));
+
     while(mWorking)
     {
         if(!mWake)
@@ -147,7 +243,49 @@ void RawProcessor::startWorking()
         if(!mProcessorPtr || mCamera == nullptr)
             continue;
 
-        GPUImage_t* img = mCamera->getFrameBuffer()->getLastImage();
+        GPUImage_t* img = nullptr;
+        bool synced = false;
+        {
+            //Slot of a matched frame can be reused by the camera before we get here
+            QMutexLocker l(&mWaitMutex);
+            synced = mSync != nullptr;
+            if(synced)
+            {
+                if(mSyncImage == nullptr || mSyncImage->meta.frameId != mSyncFrameId)
+                    continue;
+                img = mSyncImage;
+            }
+        }
+        if(!synced)
+            img = mCamera->getFrameBuffer()->getLastImage();
+        //Camera thread may overwrite the buffer, keep metadata of this frame
+        const FrameMetadata meta = img ? img->meta : FrameMetadata();
+        const qulonglong fileNumber = mNameByFrameId ? qulonglong(meta.frameId) : qulonglong(mFrameCnt);
+        const int frameWidth = img ? img->w : mOptions.Width;
+        const int frameHeight = img ? img->h : mOptions.Height;
+
+        //Frame outgrew the filters, this is the only case to recreate them here
+        if(img && (unsigned(frameWidth) > mOptions.MaxWidth || unsigned(frameHeight) > mOptions.MaxHeight))
+        {
+            {
+                QMutexLocker lock(&(mProcessorPtr->mut));
+                mOptions.MaxWidth = qMax(mOptions.MaxWidth, unsigned(frameWidth));
+                mOptions.MaxHeight = qMax(mOptions.MaxHeight, unsigned(frameHeight));
+            }
+            if(mProcessorPtr->needsInit(mOptions))
+            {
+                mProcessorPtr->Init(mOptions);
+                buffer.resize(int(mOptions.MaxWidth * mOptions.MaxHeight * 4));
+            }
+        }
+
+        if(img)
+        {
+            QMutexLocker l(&mBurstLock);
+            if(mBurstPtr)
+                mBurstPtr->push(img);
+        }
+
         mProcessorPtr->Transform(img, mOptions);
         if(mRenderer)
         {
@@ -159,7 +297,7 @@ void RawProcessor::startWorking()
 #endif
             {
                 if(mOptions.ShowPicture){
-                    mRenderer->loadImage(mProcessorPtr->GetFrameBuffer(), mOptions.Width, mOptions.Height);
+                    mRenderer->loadImage(mProcessorPtr->GetFrameBuffer(), frameWidth, frameHeight);
                     mRenderer->update();
                 }
                 lastTime = curTime;
@@ -174,7 +312,7 @@ void RawProcessor::startWorking()
         {
             if(mRtspServer && mRtspServer->isConnected())
             {
-                mRtspServer->addFrame(nullptr);
+                mRtspServer->addFrame(nullptr, meta);
             }
         }
         if(mOptions.Codec == CUDAProcessorOptions::vcH264 || mOptions.Codec == CUDAProcessorOptions::vcHEVC)
@@ -184,12 +322,19 @@ void RawProcessor::startWorking()
                 unsigned char* data = (uchar*)buffer.data();
                 mProcessorPtr->export8bitData((void*)data, true);
 
-                mRtspServer->addFrame(data);
+                mRtspServer->addFrame(data, meta);
             }
         }
 
         if(mWriting && mFileWriterPtr)
         {
+            //Buffers of queued frames must not be handed out again
+            if(mWaitForWriter)
+            {
+                while(mWorking && mFileWriterPtr->queueSize() >= mFileWriterPtr->maxQueueSize() - 2)
+                    QThread::usleep(500);
+            }
+
             if(mOptions.Codec == CUDAProcessorOptions::vcJPG ||
                mOptions.Codec == CUDAProcessorOptions::vcMJPG)
             {
@@ -197,13 +342,20 @@ void RawProcessor::startWorking()
                 if(buf != nullptr)
                 {
                     FileWriterTask* task = new FileWriterTask();
-                    task->fileName =  QStringLiteral("%1/%2%3.jpg").arg(mOutputPath,mFilePrefix).arg(mFrameCnt);
+                    task->meta = meta;
+                    task->fileName =  QStringLiteral("%1/%2%3.jpg").arg(mOutputPath,mFilePrefix).arg(fileNumber);
                     task->size = mFileWriterPtr->bufferSize();
                     task->data = buf;
-                    mProcessorPtr->exportJPEGData(task->data, mOptions.JpegQuality, task->size);
-                    mFileWriterPtr->put(task);
-                    mFileWriterPtr->wake();
-                    mFrameCnt++;
+                    const unsigned quality = mFileRate.quality(mOptions.JpegQuality);
+                    if(exportJPEGData(mFileJpeg, mFileJpegRgb, task->data, frameWidth, frameHeight, quality, task->size) == FAST_OK)
+                    {
+                        mFileRate.update(task->size, meta.hostTimestampUs > 0 ? meta.hostTimestampUs : -1);
+                        mFileWriterPtr->put(task);
+                        mFileWriterPtr->wake();
+                        mFrameCnt++;
+                    }
+                    else
+                        delete task;
                 }
             }
             else if(mOptions.Codec == CUDAProcessorOptions::vcPGM)
@@ -216,34 +368,123 @@ void RawProcessor::startWorking()
                     unsigned pitch = 0;
                     mProcessorPtr->exportRawData(nullptr, w, h, pitch);
 
-                    int sz = pgmHeader.size() + pitch * h;
-
                     FileWriterTask* task = new FileWriterTask();
-                    task->fileName =  QStringLiteral("%1/%2%3.pgm").arg(mOutputPath,mFilePrefix).arg(mFrameCnt);
-                    task->size = sz;
+                    task->meta = meta;
+                    task->fileName =  QStringLiteral("%1/%2%3.pgm").arg(mOutputPath,mFilePrefix).arg(fileNumber);
 
                     task->data = buf;
-                    memcpy(task->data, pgmHeader.toStdString().c_str(), pgmHeader.size());
+                    memcpy(task->data, pgmHeader.constData(), pgmHeader.size());
                     unsigned char* data = task->data + pgmHeader.size();
                     mProcessorPtr->exportRawData((void*)data, w, h, pitch);
 
-                    //Not 8 bit pgm requires big endian byte order
+                    //Not 8 bit pgm requires big endian byte order.
+                    //Swap and drop row padding in one pass.
+                    unsigned rowBytes = w;
                     if(img->surfaceFmt != FAST_I8)
                     {
-                        unsigned short* data16 = (unsigned short*)data;
-                        for(unsigned i = 0; i < w * h; i++)
-                        {
-                            unsigned short val = *data16;
-                            *data16 = (val << 8) | (val >> 8);
-                            data16++;
-                        }
+                        rowBytes = w * sizeof(unsigned short);
+                        swapBytes16Rows(data, rowBytes, data, pitch, rowBytes, h);
                     }
+                    else if(pitch != rowBytes)
+                    {
+                        for(unsigned y = 1; y < h; y++)
+                            memmove(data + y * rowBytes, data + y * pitch, rowBytes);
+                    }
+                    task->size = pgmHeader.size() + rowBytes * h;
 
                     mFileWriterPtr->put(task);
                     mFileWriterPtr->wake();
                     mFrameCnt++;
                 }
 
+            }
+            else if(mOptions.Codec == CUDAProcessorOptions::vcTIFF)
+            {
+                unsigned char* buf = mFileWriterPtr->getBuffer();
+                if(buf != nullptr)
+                {
+                    const unsigned channels = mProcessorPtr->isGrayscale() ? 1 : 3;
+                    if(tiffHdr.isEmpty() || tiffSize != QSize(frameWidth, frameHeight))
+                    {
+                        tiffHdr = tiffHeader(unsigned(frameWidth), unsigned(frameHeight), channels);
+                        tiffSize = QSize(frameWidth, frameHeight);
+                    }
+
+                    unsigned char* data = buf + tiffHdr.size();
+                    if(mProcessorPtr->export8bitData((void*)data, channels == 3) == FAST_OK)
+                    {
+                        FileWriterTask* task = new FileWriterTask();
+                        task->meta = meta;
+                        task->fileName =  QStringLiteral("%1/%2%3.tif").arg(mOutputPath,mFilePrefix).arg(fileNumber);
+                        task->data = buf;
+                        memcpy(task->data, tiffHdr.constData(), size_t(tiffHdr.size()));
+
+                        //Drop row padding of the export
+                        const unsigned rowBytes = unsigned(frameWidth) * channels;
+                        const unsigned pitch = channels * (((unsigned(frameWidth) + FAST_ALIGNMENT - 1) / FAST_ALIGNMENT) * FAST_ALIGNMENT);
+                        if(pitch != rowBytes)
+                        {
+                            for(int y = 1; y < frameHeight; y++)
+                                memmove(data + size_t(y) * rowBytes, data + size_t(y) * pitch, rowBytes);
+                        }
+                        task->size = unsigned(tiffHdr.size()) + rowBytes * unsigned(frameHeight);
+
+                        mFileWriterPtr->put(task);
+                        mFileWriterPtr->wake();
+                        mFrameCnt++;
+                    }
+                }
+            }
+            else if(mOptions.Codec == CUDAProcessorOptions::vcDNG)
+            {
+                unsigned char* buf = mFileWriterPtr->getBuffer();
+                if(buf != nullptr)
+                {
+                    //Tiles are encoded on the writer thread, rows keep the export pitch
+                    unsigned w = 0;
+                    unsigned h = 0;
+                    unsigned pitch = 0;
+                    if(mProcessorPtr->exportRawData((void*)buf, w, h, pitch) == FAST_OK)
+                    {
+                        FileWriterTask* task = new FileWriterTask();
+                        task->meta = meta;
+                        task->fileName =  QStringLiteral("%1/%2%3.dng").arg(mOutputPath,mFilePrefix).arg(fileNumber);
+                        task->data = buf;
+                        task->size = pitch * h;
+                        task->width = w;
+                        task->height = h;
+                        task->pitch = pitch;
+
+                        mFileWriterPtr->put(task);
+                        mFileWriterPtr->wake();
+                        mFrameCnt++;
+                    }
+                }
+            }
+            else if(mOptions.Codec == CUDAProcessorOptions::vcRAW)
+            {
+                unsigned char* buf = mFileWriterPtr->getBuffer();
+                if(buf != nullptr)
+                {
+                    //Samples are compressed on the writer thread, rows keep the export pitch
+                    unsigned w = 0;
+                    unsigned h = 0;
+                    unsigned pitch = 0;
+                    if(mProcessorPtr->exportRawData((void*)buf, w, h, pitch) == FAST_OK)
+                    {
+                        FileWriterTask* task = new FileWriterTask();
+                        task->meta = meta;
+                        task->data = buf;
+                        task->size = pitch * h;
+                        task->width = w;
+                        task->height = h;
+                        task->pitch = pitch;
+
+                        mFileWriterPtr->put(task);
+                        mFileWriterPtr->wake();
+                        mFrameCnt++;
+                    }
+                }
             }else if(mOptions.Codec == CUDAProcessorOptions::vcH264 || mOptions.Codec == CUDAProcessorOptions::vcHEVC)
             {
                 //unsigned char* buf = mFileWriterPtr->getBuffer();
@@ -257,6 +498,7 @@ void RawProcessor::startWorking()
 //                    int sz = pitch * h;
 
                     FileWriterTask* task = new FileWriterTask();
+                    task->meta = meta;
                     task->fileName =  QStringLiteral("%1/%2%3.mkv").arg(mOutputPath,mFilePrefix).arg(mFrameCnt);
                     task->size = 0;
 
@@ -270,10 +512,52 @@ void RawProcessor::startWorking()
                 }
             }
         }
+
+        if(meta.hostTimestampUs > 0)
+        {
+            mProcessorPtr->telemetry.record(PipelineTelemetry::stCaptureLatency,
+                                            float(CircularBuffer::hostTimeUs() - meta.hostTimestampUs) / 1000.f);
+        }
     }
     mWorking = false;
 }
 
+fastStatus_t RawProcessor::exportJPEGData(jpeg_encoder& cpuEncoder, QByteArray& rgb, void* dstPtr,
+                                          int width, int height, unsigned quality, unsigned& size)
+{
+    unsigned capacity = size;
+    fastStatus_t ret = mProcessorPtr->exportJPEGData(dstPtr, quality, size);
+    if(ret != FAST_INVALID_HANDLE)
+        return ret;
+
+    //GPU encoder was not created (not enough GPU memory), encode strips on the CPU
+    const int channels = cpuEncoder.keepGray() && mProcessorPtr->isGrayscale() ? 1 : 3;
+    int pitch = channels * (((width + FAST_ALIGNMENT - 1) / FAST_ALIGNMENT) * FAST_ALIGNMENT);
+    if(rgb.size() < pitch * height)
+        rgb.resize(pitch * height);
+
+    ret = mProcessorPtr->export8bitData(rgb.data(), channels == 3);
+    if(ret != FAST_OK)
+        return ret;
+
+    size = capacity;
+    if(!cpuEncoder.encode(reinterpret_cast<uchar*>(rgb.data()), width, height, channels, pitch,
+                          static_cast<uchar*>(dstPtr), size, int(quality)))
+        return FAST_INTERNAL_ERROR;
+
+    return FAST_OK;
+}
+
+void RawProcessor::logRate(const char* name, const JpegRateControl& rate)
+{
+    const JpegRateControl::Report r = rate.report();
+    if(!r.enabled || r.frames == 0)
+        return;
+    qDebug("%s rate control: %.0f of %.0f kbit/s (%.1f%%), %lld frames, quality %.0f",
+           name, r.totalKbps, r.targetKbps, r.targetKbps > 0 ? 100. * r.totalKbps / r.targetKbps : 0.,
+           qlonglong(r.frames), r.quality);
+}
+
 fastStatus_t RawProcessor::getLastError()
 {
     if(mProcessorPtr)
@@ -287,35 +571,49 @@ QString RawProcessor::getLastErrorDescription()
     return  (mProcessorPtr) ? mProcessorPtr->getLastErrorDescription() : QString();
 }
 
-QMap<QString, float> RawProcessor::getStats()
+PipelineTelemetry::Snapshot RawProcessor::getStats()
 {
-    QMap<QString, float> ret;
+    PipelineTelemetry::Snapshot ret;
     if(mProcessorPtr)
     {
-        {
-            // to minimize delay in main thread
-            mProcessorPtr->mut2.lock();
-            ret = mProcessorPtr->stats2;
-            mProcessorPtr->mut2.unlock();
-        }
+        ret = mProcessorPtr->telemetry.snapshot();
 
+        PipelineTelemetry::StageStats& writer = ret.stages[PipelineTelemetry::stWriter];
+        PipelineTelemetry::StageStats& encoder = ret.stages[PipelineTelemetry::stEncoder];
         if(mWriting)
         {
-            ret[QStringLiteral("procFrames")] = mFileWriterPtr->getProcessedFrames();
-            ret[QStringLiteral("droppedFrames")] = mFileWriterPtr->getDroppedFrames();
+            writer.active = true;
+            writer.framesOut = mFileWriterPtr->getProcessedFrames() - mFileWriterPtr->getFailedFrames();
+            writer.framesDropped = mFileWriterPtr->getDroppedFrames() + mFileWriterPtr->getFailedFrames();
+            writer.framesIn = writer.framesOut + writer.framesDropped;
+            ret.gauges[PipelineTelemetry::gWriterQueue] = mFileWriterPtr->queueSize();
             AVFileWriter *obj = dynamic_cast<AVFileWriter*>(mFileWriterPtr.data());
             if(obj)
-                ret[QStringLiteral("encoding")] = obj->duration();
+            {
+                encoder.active = true;
+                encoder.lastMs = float(obj->duration());
+            }
         }
-        else
+        ret.gauges[PipelineTelemetry::gAcqTimeNs] = acqTimeNsec;
+
+        const JpegRateControl::Report fileRate = mFileRate.report();
+        if(mWriting && fileRate.enabled)
+        {
+            ret.gauges[PipelineTelemetry::gMjpegQuality] = qRound64(fileRate.quality);
+            ret.gauges[PipelineTelemetry::gMjpegKbps] = qRound64(fileRate.kbps);
+            ret.gauges[PipelineTelemetry::gMjpegTargetKbps] = qRound64(fileRate.targetKbps);
+        }
+        const JpegRateControl::Report rtspRate = mRtspRate.report();
+        if(mRtspServer && rtspRate.enabled)
         {
-            ret[QStringLiteral("procFrames")] = -1;
-            ret[QStringLiteral("droppedFrames")] = -1;
+            ret.gauges[PipelineTelemetry::gRtspJpegQuality] = qRound64(rtspRate.quality);
+            ret.gauges[PipelineTelemetry::gRtspJpegKbps] = qRound64(rtspRate.kbps);
+            ret.gauges[PipelineTelemetry::gRtspJpegTargetKbps] = qRound64(rtspRate.targetKbps);
         }
-        ret[QStringLiteral("acqTime")] = acqTimeNsec;
 
         if(mRtspServer){
-            ret[QStringLiteral("encoding")] = mRtspServer->duration();
+            encoder.active = true;
+            encoder.lastMs = float(mRtspServer->duration());
         }
     }
 
@@ -340,24 +638,69 @@ void RawProcessor::startWriting()
 
     mCodec = mOptions.Codec;
 
+    {
+        AppSettings settings;
+        JpegRateControl::Params rate;
+        if(settings.jpegRateControl && mCodec == CUDAProcessorOptions::vcMJPG)
+            rate.targetBitrate = mOptions.bitrate;
+        rate.minQuality = unsigned(settings.jpegRateMinQuality);
+        rate.maxQuality = unsigned(settings.jpegRateMaxQuality);
+        mFileRate.setParams(rate, mOptions.JpegQuality);
+    }
+
     if(mCodec == CUDAProcessorOptions::vcMJPG)
     {
+        AppSettings settings;
         QString fileName = QDir::toNativeSeparators(
-                    QStringLiteral("%1/%2.avi").
-                    arg(mOutputPath).
-                    arg(QDateTime::currentDateTime().toString(QStringLiteral("dd_MM_yyyy_hh_mm_ss"))));
+                    QStringLiteral("%1/%2%3.%4").
+                    arg(mOutputPath, mFilePrefix).
+                    arg(QDateTime::currentDateTime().toString(QStringLiteral("dd_MM_yyyy_hh_mm_ss"))).
+                    arg(settings.recordingContainer));
         AsyncMJPEGWriter* writer = new AsyncMJPEGWriter();
+        writer->setRollover(qint64(settings.recordingMaxFileSizeMB) << 20, settings.recordingMaxDurationSec);
         writer->open(mCamera->width(),
                      mCamera->height(),
                      25,
                      mCamera->isColor() ? mOptions.JpegSamplingFmt : FAST_JPEG_Y,
+                     fileName,
+                     settings.recordingFlushIntervalMs);
+        mFileWriterPtr.reset(writer);
+    }
+    else if(mCodec == CUDAProcessorOptions::vcRAW)
+    {
+        AppSettings settings;
+        QString fileName = QDir::toNativeSeparators(
+                    QStringLiteral("%1/%2%3.fvr").
+                    arg(mOutputPath, mFilePrefix).
+                    arg(QDateTime::currentDateTime().toString(QStringLiteral("dd_MM_yyyy_hh_mm_ss"))));
+        AsyncRawWriter* writer = new AsyncRawWriter();
+        writer->setRollover(qint64(settings.recordingMaxFileSizeMB) << 20, settings.recordingMaxDurationSec);
+        writer->open(mCamera->width(),
+                     mCamera->height(),
+                     GetBytesPerChannelFromSurface(mOptions.SurfaceFmt),
+                     GetBitsPerChannelFromSurface(mOptions.SurfaceFmt),
+                     mCamera->isColor() ? mCamera->bayerPattern() : FAST_BAYER_NONE,
                      fileName);
         mFileWriterPtr.reset(writer);
     }
+    else if(mCodec == CUDAProcessorOptions::vcDNG)
+    {
+        AppSettings settings;
+        DngWriter::Params params = DngWriter::fromOptions(mOptions, mCamera->isColor() ? mCamera->bayerPattern() : FAST_BAYER_NONE);
+        params.width = mCamera->width();
+        params.height = mCamera->height();
+        params.make = mCamera->manufacturer();
+        params.model = mCamera->model();
+        params.compress = settings.dngCompression;
+        params.tileSize = unsigned(settings.dngTileSize);
+        AsyncDngWriter* writer = new AsyncDngWriter();
+        writer->setParams(params);
+        mFileWriterPtr.reset(writer);
+    }
     else if(mCodec == CUDAProcessorOptions::vcH264 || mCodec == CUDAProcessorOptions::vcHEVC){
         QString fileName = QDir::toNativeSeparators(
-                    QStringLiteral("%1/%2.avi").
-                    arg(mOutputPath).
+                    QStringLiteral("%1/%2%3.avi").
+                    arg(mOutputPath, mFilePrefix).
                     arg(QDateTime::currentDateTime().toString(QStringLiteral("dd_MM_yyyy_hh_mm_ss"))));
 
         AVFileWriter *writer = new AVFileWriter();
@@ -399,8 +742,12 @@ void RawProcessor::startWriting()
     else
         mFileWriterPtr.reset(new AsyncFileWriter());
 
-    unsigned pitch = 3 *(((mOptions.Width + FAST_ALIGNMENT - 1) / FAST_ALIGNMENT ) * FAST_ALIGNMENT);
-    unsigned sz = pitch * mOptions.Height;
+    //Frames of the full sensor fit, ROI and binning may change while recording
+    const unsigned maxWidth = qMax<unsigned>(unsigned(mOptions.Width), unsigned(mCamera->maxWidth()));
+    const unsigned maxHeight = qMax<unsigned>(unsigned(mOptions.Height), unsigned(mCamera->maxHeight()));
+    unsigned pitch = 3 *(((maxWidth + FAST_ALIGNMENT - 1) / FAST_ALIGNMENT ) * FAST_ALIGNMENT);
+    //Room for PGM and TIFF file headers before the exported rows
+    unsigned sz = pitch * maxHeight + 4096;
     mFileWriterPtr->initBuffers(sz);
 
     mFrameCnt = 0;
@@ -420,6 +767,15 @@ void RawProcessor::stopWriting()
     {
         AsyncMJPEGWriter* writer = static_cast<AsyncMJPEGWriter*>(mFileWriterPtr.data());
         writer->close();
+        logRate("MJPEG recording", mFileRate);
+    }
+    if(mCodec == CUDAProcessorOptions::vcRAW)
+    {
+        //The index is written after the queued frames
+        AsyncRawWriter* writer = static_cast<AsyncRawWriter*>(mFileWriterPtr.data());
+        writer->waitFinish();
+        writer->close();
+        qDebug("Raw recording compression ratio %.2f", writer->compressionRatio());
     }
     if(mCodec == CUDAProcessorOptions::vcH264 || mCodec == CUDAProcessorOptions::vcHEVC){
         AVFileWriter *writer = static_cast<AVFileWriter*>(mFileWriterPtr.data());
@@ -624,6 +980,14 @@ void RawProcessor::setRtspServer(const QString &url)
 
     mRtspServer.reset(new RTSPStreamerServer(mOptions.Width, mOptions.Height, 3, url, encType, mOptions.bitrate));
 
+    AppSettings settings;
+    JpegRateControl::Params rate;
+    if(settings.jpegRateControl && encType == RTSPStreamerServer::etJPEG)
+        rate.targetBitrate = mOptions.bitrate;
+    rate.minQuality = unsigned(settings.jpegRateMinQuality);
+    rate.maxQuality = unsigned(settings.jpegRateMaxQuality);
+    mRtspRate.setParams(rate, mOptions.JpegQuality);
+
     mRtspServer->setMultithreading(false);
 
 	auto funEncode = [this](int, unsigned char* , int width, int height, int, Buffer& output){
@@ -631,10 +995,14 @@ void RawProcessor::setRtspServer(const QString &url)
 		int channels = dynamic_cast<CUDAProcessorGray*>(mProcessorPtr.data()) == nullptr? 3 : 1;
 
 		unsigned pitch = channels *(((width + FAST_ALIGNMENT - 1) / FAST_ALIGNMENT ) * FAST_ALIGNMENT);
-        unsigned sz = pitch * height;
+        unsigned sz = unsigned(qMax<size_t>(pitch * height, jpeg_encoder::maxEncodedSize(width, height)));
 
 		output.buffer.resize(sz);
-		mProcessorPtr->exportJPEGData(output.buffer.data(), mOptions.JpegQuality, sz);
+		const unsigned quality = mRtspRate.quality(mOptions.JpegQuality);
+		if(exportJPEGData(mRtspJpeg, mRtspJpegRgb, output.buffer.data(), width, height, quality, sz) != FAST_OK)
+			sz = 0;
+		else
+			mRtspRate.update(sz);
 		output.size = sz;
     };
     mRtspServer->setUseCustomEncodeJpeg(true);
@@ -687,6 +1055,8 @@ void RawProcessor::startRtspServer()
 
 void RawProcessor::stopRtspServer()
 {
+    if(mRtspServer)
+        logRate("RTSP JPEG", mRtspRate);
     mRtspServer.reset();
 }
 
@@ -699,3 +1069,10 @@ bool RawProcessor::isConnectedRtspClient() const
 {
     return mRtspServer && mRtspServer->isConnected();
 }
+
+std::vector<RTSPStreamerServer::ClientStats> RawProcessor::rtspClientStats() const
+{
+    if(!mRtspServer)
+        return std::vector<RTSPStreamerServer::ClientStats>();
+    return mRtspServer->clientStats();
+}
@@ -38,14 +38,20 @@
 #include <QColor>
 
 #include "CUDAProcessorOptions.h"
+#include "PipelineTelemetry.h"
 #include "AsyncFileWriter.h"
 #include "RTSPStreamerServer.h"
+#include "JpegEncoder.h"
+#include "JpegRateControl.h"
+#include "FrameBuffer.h"
 
 class CUDAProcessorBase;
 class CircularBuffer;
 class MainWindow;
 class GLRenderer;
 class GPUCameraBase;
+class FrameSynchronizer;
+class BurstRecorder;
 
 class RawProcessor : public QObject
 {
@@ -60,14 +66,36 @@ public:
     void wake();
     void updateOptions(const CUDAProcessorOptions& opts);
     CUDAProcessorBase*   getCUDAProcessor() {return mProcessorPtr.data();}
+    GPUCameraBase*       camera() {return mCamera;}
     fastStatus_t         getLastError();
     QString              getLastErrorDescription();
-    QMap<QString, float> getStats();
+    PipelineTelemetry::Snapshot getStats();
     void startWriting();
     void stopWriting();
     void setOutputPath(const QString& path){mOutputPath = path;}
     void setFilePrefix(const QString& prefix){mFilePrefix = prefix;}
+    ///Number output files by the camera frame id instead of a counter from startWriting()
+    void setNameByFrameId(bool on){mNameByFrameId = on;}
+    ///Frames handed to the file writer since startWriting()
+    unsigned framesWritten() const {return mFrameCnt;}
+    ///Wait while the file writer queue is full instead of dropping frames,
+    ///for offline processing where the source waits for the processing
+    void setWaitForWriter(bool on){mWaitForWriter = on;}
+    AsyncWriter* fileWriter() {return mFileWriterPtr.data();}
     void setSAM(const QString& fpnFileName, const QString& ffcFileName);
+    ///Pin the processing thread to a CPU core, negative to use Threads/Processing settings
+    void setCpuAffinity(int core);
+    ///New camera frames go to the synchronizer as camera idx instead of being
+    ///processed directly, nullptr to process every frame as it arrives
+    void setSynchronizer(FrameSynchronizer* sync, int idx);
+    ///Process the given frame, called by the synchronizer with a matched frame
+    void processImage(GPUImage_t* img);
+    ///Keep the last preFrames raw frames for triggerBurst(), 0 frames to disable
+    void setBurst(int preFrames, int postFrames);
+    ///Write the retained frames and the next post-trigger ones to the output path.
+    ///Return false if burst mode is off or the previous burst is not finished.
+    bool triggerBurst();
+    BurstRecorder* burstRecorder() {return mBurstPtr.data();}
 
     QColor getAvgRawColor(QPoint rawPoint);
 
@@ -77,6 +105,7 @@ public:
     void stopRtspServer();
     bool isStartedRtsp() const;
     bool isConnectedRtspClient() const;
+    std::vector<RTSPStreamerServer::ClientStats> rtspClientStats() const;
 
     float acqTimeNsec = -1.;
 
@@ -107,11 +136,33 @@ private:
     QString              mOutputPath;
     QString              mFilePrefix;
     unsigned             mFrameCnt = 0;
+    bool                 mNameByFrameId = false;
+    bool                 mWaitForWriter = false;
     QString              mUrl;
     QScopedPointer<RTSPStreamerServer> mRtspServer;
+    FrameSynchronizer*   mSync = nullptr;
+    int                  mSyncIndex = 0;
+    GPUImage_t*          mSyncImage = nullptr;
+    uint64_t             mSyncFrameId = 0;
+    uint64_t             mPushedFrameId = 0;
+    bool                 mPushed = false;
+    QScopedPointer<BurstRecorder> mBurstPtr;
+    QMutex               mBurstLock;
+    int                  mCpuCore = -1;
+    jpeg_encoder         mFileJpeg;
+    QByteArray           mFileJpegRgb;
+    jpeg_encoder         mRtspJpeg;
+    QByteArray           mRtspJpegRgb;
+    JpegRateControl      mFileRate;
+    JpegRateControl      mRtspRate;
 
 
     void startWorking();
+    ///GPU JPEG encoding, on the CPU with the given encoder if there is no GPU encoder.
+    ///size is the capacity of dstPtr on input and the JPEG size on return
+    fastStatus_t exportJPEGData(jpeg_encoder& cpuEncoder, QByteArray& rgb, void* dstPtr,
+                                int width, int height, unsigned quality, unsigned& size);
+    static void logRate(const char* name, const JpegRateControl& rate);
 };
 
 //class AsyncCUDATransformer : public QObject
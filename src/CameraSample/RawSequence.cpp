@@ -0,0 +1,108 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "RawSequence.h"
+
+#include <QDebug>
+
+RawSequenceWriter::~RawSequenceWriter()
+{
+    close();
+}
+
+bool RawSequenceWriter::open(const QString& fileName, unsigned width, unsigned height,
+                             unsigned bitDepth, unsigned bayerPattern)
+{
+    close();
+
+    mHeader = RawSequenceHeader();
+    mHeader.width = width;
+    mHeader.height = height;
+    mHeader.bitDepth = bitDepth;
+    mHeader.bayerPattern = bayerPattern;
+    mIndex.clear();
+    mFirstUs = mLastUs = 0;
+
+    mFile.setFileName(fileName);
+    if(!mFile.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        qDebug("Cannot open %s", qPrintable(fileName));
+        return false;
+    }
+    if(mFile.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader)) != qint64(sizeof(mHeader)))
+    {
+        mFile.close();
+        return false;
+    }
+    return true;
+}
+
+bool RawSequenceWriter::addFrame(const unsigned char* data, unsigned size, const FrameMetadata& meta)
+{
+    if(!mFile.isOpen() || data == nullptr || size == 0)
+        return false;
+
+    RawFrameHeader frame;
+    frame.size = size;
+    frame.frameId = meta.frameId;
+    frame.deviceTimestamp = meta.deviceTimestamp;
+    frame.hostTimestampUs = meta.hostTimestampUs;
+
+    quint64 offset = quint64(mFile.pos());
+    if(mFile.write(reinterpret_cast<const char*>(&frame), sizeof(frame)) != qint64(sizeof(frame)) ||
+       mFile.write(reinterpret_cast<const char*>(data), size) != qint64(size))
+    {
+        //Drop the partial record, readers stop at it otherwise
+        mFile.resize(qint64(offset));
+        mFile.seek(qint64(offset));
+        return false;
+    }
+
+    if(mIndex.isEmpty())
+        mFirstUs = meta.hostTimestampUs;
+    mLastUs = meta.hostTimestampUs;
+    mIndex.append(offset);
+    return true;
+}
+
+void RawSequenceWriter::close()
+{
+    if(!mFile.isOpen())
+        return;
+
+    mHeader.frameCount = quint64(mIndex.size());
+    mHeader.indexOffset = quint64(mFile.pos());
+    qint64 indexSize = qint64(mIndex.size()) * qint64(sizeof(quint64));
+    if(mFile.write(reinterpret_cast<const char*>(mIndex.constData()), indexSize) == indexSize)
+    {
+        mFile.seek(0);
+        mFile.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+    }
+    mFile.close();
+    mIndex.clear();
+}
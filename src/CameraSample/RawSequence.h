@@ -0,0 +1,92 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef RAWSEQUENCE_H
+#define RAWSEQUENCE_H
+
+#include <QFile>
+#include <QVector>
+
+#include "FrameMetadata.h"
+
+///Raw sequence (.fvr) file layout, little endian:
+///  RawSequenceHeader
+///  frame records: RawFrameHeader followed by a RawCodec frame of size bytes
+///  index: frameCount x uint64_t file offset of the frame records
+///The header gets frameCount and indexOffset on close. A file of an interrupted
+///recording has indexOffset 0, its frames are found by walking the records.
+struct RawSequenceHeader
+{
+    char     magic[8] = {'F', 'V', 'R', 'A', 'W', 'S', 'Q', '\0'};
+    uint32_t version = 1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t bitDepth = 0;      ///Camera bits per sample
+    uint32_t bayerPattern = 0;  ///fastBayerPattern_t, FAST_BAYER_NONE for mono
+    uint32_t reserved = 0;
+    uint64_t frameCount = 0;
+    uint64_t indexOffset = 0;
+};
+
+struct RawFrameHeader
+{
+    static const uint32_t Magic = 0x52525646; //FVRR
+    uint32_t magic = Magic;
+    uint32_t size = 0;
+    uint64_t frameId = 0;
+    uint64_t deviceTimestamp = 0;
+    int64_t  hostTimestampUs = 0;
+};
+
+class RawSequenceWriter
+{
+public:
+    RawSequenceWriter() = default;
+    ~RawSequenceWriter();
+
+    bool open(const QString& fileName, unsigned width, unsigned height,
+              unsigned bitDepth, unsigned bayerPattern);
+    bool isOpened() const {return mFile.isOpen();}
+    ///Append an encoded frame
+    bool addFrame(const unsigned char* data, unsigned size, const FrameMetadata& meta);
+    ///Write the index and the final header
+    void close();
+
+    qint64 bytesWritten() const {return mFile.isOpen() ? mFile.pos() : 0;}
+    ///Capture time between the first and the last frame
+    qint64 durationUs() const {return mLastUs - mFirstUs;}
+
+private:
+    QFile mFile;
+    RawSequenceHeader mHeader;
+    QVector<quint64> mIndex;
+    qint64 mFirstUs = 0;
+    qint64 mLastUs = 0;
+};
+
+#endif // RAWSEQUENCE_H
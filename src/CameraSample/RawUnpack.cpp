@@ -0,0 +1,627 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "RawUnpack.h"
+
+#include <chrono>
+#include <cstring>
+
+//AVX2 kernels are built for every x86 target and picked at run time, so
+//the default x86-64 build does not need -mavx2 or /arch:AVX2
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define RAW_USE_AVX2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RAW_AVX2_TARGET
+#else
+#define RAW_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RAW_USE_NEON
+#endif
+
+namespace
+{
+struct PackingInfo
+{
+    const char* name;
+    int bits;
+    unsigned group;         //pixels
+    unsigned groupBytes;
+};
+
+const PackingInfo cPackings[rpCount] = {
+    {"none",           16, 1,  2},
+    {"PFNC 10p",       10, 4,  5},
+    {"PFNC 12p",       12, 2,  3},
+    {"PFNC 14p",       14, 4,  7},
+    {"GVSP 12Packed",  12, 2,  3},
+    {"MIPI RAW10",     10, 4,  5},
+    {"MIPI RAW12",     12, 2,  3},
+    {"XIMEA 10",       10, 16, 20},
+    {"XIMEA 12",       12, 16, 24},
+    {"XIMEA 14",       14, 16, 28}
+};
+
+/////////////////////////////////////////////
+/// Scalar kernels, one packing group per call
+
+inline void groupPFNC10p(const unsigned char* s, uint16_t* d)
+{
+    d[0] = uint16_t( s[0]       | ((s[1] & 0x03) << 8));
+    d[1] = uint16_t((s[1] >> 2) | ((s[2] & 0x0F) << 6));
+    d[2] = uint16_t((s[2] >> 4) | ((s[3] & 0x3F) << 4));
+    d[3] = uint16_t((s[3] >> 6) |  (s[4] << 2));
+}
+
+inline void groupPFNC12p(const unsigned char* s, uint16_t* d)
+{
+    d[0] = uint16_t( s[0]       | ((s[1] & 0x0F) << 8));
+    d[1] = uint16_t((s[1] >> 4) |  (s[2] << 4));
+}
+
+inline void groupPFNC14p(const unsigned char* s, uint16_t* d)
+{
+    uint64_t v = 0;
+    for(int i = 6; i >= 0; i--)
+        v = (v << 8) | s[i];
+    d[0] = uint16_t( v        & 0x3FFF);
+    d[1] = uint16_t((v >> 14) & 0x3FFF);
+    d[2] = uint16_t((v >> 28) & 0x3FFF);
+    d[3] = uint16_t((v >> 42) & 0x3FFF);
+}
+
+inline void groupGVSP12Packed(const unsigned char* s, uint16_t* d)
+{
+    d[0] = uint16_t((s[0] << 4) | (s[1] & 0x0F));
+    d[1] = uint16_t((s[2] << 4) | (s[1] >> 4));
+}
+
+inline void groupMIPIRaw10(const unsigned char* s, uint16_t* d)
+{
+    d[0] = uint16_t((s[0] << 2) | ( s[4]       & 0x03));
+    d[1] = uint16_t((s[1] << 2) | ((s[4] >> 2) & 0x03));
+    d[2] = uint16_t((s[2] << 2) | ((s[4] >> 4) & 0x03));
+    d[3] = uint16_t((s[3] << 2) |  (s[4] >> 6));
+}
+
+inline void groupMIPIRaw12(const unsigned char* s, uint16_t* d)
+{
+    d[0] = uint16_t((s[0] << 4) | (s[2] & 0x0F));
+    d[1] = uint16_t((s[1] << 4) | (s[2] >> 4));
+}
+
+//16 MSB bytes followed by a LSB first bit stream of (bits - 8) bit fields
+template<int bits>
+inline void groupXimea(const unsigned char* s, uint16_t* d)
+{
+    const int lowb = bits - 8;
+    const unsigned mask = (1u << lowb) - 1;
+    const unsigned char* low = s + 16;
+    unsigned acc = 0;
+    int accBits = 0;
+    for(int i = 0; i < 16; i++)
+    {
+        if(accBits < lowb)
+        {
+            acc |= unsigned(*low++) << accBits;
+            accBits += 8;
+        }
+        d[i] = uint16_t((s[i] << lowb) | (acc & mask));
+        acc >>= lowb;
+        accBits -= lowb;
+    }
+}
+
+typedef void (*GroupFun)(const unsigned char*, uint16_t*);
+
+GroupFun groupFun(RawPacking packing)
+{
+    switch(packing)
+    {
+    case rpPFNC10p:      return groupPFNC10p;
+    case rpPFNC12p:      return groupPFNC12p;
+    case rpPFNC14p:      return groupPFNC14p;
+    case rpGVSP12Packed: return groupGVSP12Packed;
+    case rpMIPIRaw10:    return groupMIPIRaw10;
+    case rpMIPIRaw12:    return groupMIPIRaw12;
+    case rpXimea10:      return groupXimea<10>;
+    case rpXimea12:      return groupXimea<12>;
+    case rpXimea14:      return groupXimea<14>;
+    default:             return nullptr;
+    }
+}
+
+/////////////////////////////////////////////
+/// SIMD kernels. Each returns the number of pixels done, the rest goes
+/// through the scalar kernels. Loads never pass the end of the packed row.
+
+#if defined(RAW_USE_AVX2)
+
+bool detectAvx2()
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if(r[0] < 7)
+        return false;
+    //OS must save YMM registers
+    __cpuid(r, 1);
+    if((r[2] & (1 << 27)) == 0 || (r[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+const bool cAvx2 = detectAvx2();
+
+//PFNC 12p, GVSP 12Packed and MIPI RAW12: 16 pixels from 24 bytes
+RAW_AVX2_TARGET unsigned simd12(RawPacking packing, const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+    __m256i shuffle;
+    if(packing == rpPFNC12p)
+        shuffle = _mm256_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11,
+                                   0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+    else if(packing == rpGVSP12Packed)
+        shuffle = _mm256_setr_epi8(1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11,
+                                   1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11);
+    else
+        shuffle = _mm256_setr_epi8(2, 0, 2, 1, 5, 3, 5, 4, 8, 6, 8, 7, 11, 9, 11, 10,
+                                   2, 0, 2, 1, 5, 3, 5, 4, 8, 6, 8, 7, 11, 9, 11, 10);
+
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    const __m256i mask12 = _mm256_set1_epi16(0x0FFF);
+    const __m256i maskHi = _mm256_set1_epi16(0x0FF0);
+    const __m256i maskLo = _mm256_set1_epi16(0x000F);
+
+    unsigned x = 0;
+    for(; x + 16 <= width && size_t(x) / 2 * 3 + 32 <= rowBytes; x += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + x / 2 * 3));
+        v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, lanes), shuffle);
+
+        __m256i even;
+        if(packing == rpPFNC12p)
+            even = _mm256_and_si256(v, mask12);
+        else
+            even = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(v, 4), maskHi),
+                                   _mm256_and_si256(v, maskLo));
+        __m256i odd = _mm256_srli_epi16(v, 4);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), _mm256_blend_epi16(even, odd, 0xAA));
+    }
+    return x;
+}
+
+//PFNC 10p and MIPI RAW10: 16 pixels from 20 bytes
+RAW_AVX2_TARGET unsigned simd10(RawPacking packing, const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+    //Lane 1 starts 8 bytes in, its groups start at byte 10
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 2, 3, 4, 5);
+    const __m256i mask10 = _mm256_set1_epi16(0x03FF);
+
+    unsigned x = 0;
+    if(packing == rpPFNC10p)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9,
+                                                 2, 3, 3, 4, 4, 5, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11);
+        const __m256i mul = _mm256_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1);
+        for(; x + 16 <= width && size_t(x) / 4 * 5 + 32 <= rowBytes; x += 16)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + x / 4 * 5));
+            v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, lanes), shuffle);
+            v = _mm256_srli_epi16(_mm256_mullo_epi16(v, mul), 6);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), _mm256_and_si256(v, mask10));
+        }
+    }
+    else
+    {
+        const char z = char(0x80);
+        const __m256i shuffleHi = _mm256_setr_epi8(0, z, 1, z, 2, z, 3, z, 5, z, 6, z, 7, z, 8, z,
+                                                   2, z, 3, z, 4, z, 5, z, 7, z, 8, z, 9, z, 10, z);
+        const __m256i shuffleLo = _mm256_setr_epi8(4, z, 4, z, 4, z, 4, z, 9, z, 9, z, 9, z, 9, z,
+                                                   6, z, 6, z, 6, z, 6, z, 11, z, 11, z, 11, z, 11, z);
+        const __m256i mul = _mm256_setr_epi16(16384, 4096, 1024, 256, 16384, 4096, 1024, 256,
+                                              16384, 4096, 1024, 256, 16384, 4096, 1024, 256);
+        for(; x + 16 <= width && size_t(x) / 4 * 5 + 32 <= rowBytes; x += 16)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + x / 4 * 5));
+            v = _mm256_permutevar8x32_epi32(v, lanes);
+            __m256i hi = _mm256_slli_epi16(_mm256_shuffle_epi8(v, shuffleHi), 2);
+            __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_shuffle_epi8(v, shuffleLo), mul), 14);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), _mm256_or_si256(hi, lo));
+        }
+    }
+    return x;
+}
+
+//PFNC 14p: 16 pixels from 28 bytes through 32 bit lanes
+RAW_AVX2_TARGET unsigned simd14(const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+    //4 pixels of a group per lane, lane 1 holds the next group (7 bytes in)
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 3, 1, 2, 3, 4, 3, 4, 5, 6, 5, 6, 7, 8,
+                                             7, 8, 9, 10, 8, 9, 10, 11, 10, 11, 12, 13, 12, 13, 14, 15);
+    const __m256i shifts = _mm256_setr_epi32(0, 6, 4, 2, 0, 6, 4, 2);
+    const __m256i mask14 = _mm256_set1_epi32(0x3FFF);
+
+    unsigned x = 0;
+    for(; x + 16 <= width && size_t(x) / 4 * 7 + 32 <= rowBytes; x += 16)
+    {
+        const unsigned char* p = s + x / 4 * 7;
+        __m256i a = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        __m256i b = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 14)));
+        a = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(a, shuffle), shifts), mask14);
+        b = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(b, shuffle), shifts), mask14);
+        //packus interleaves lanes: a0 b0 a1 b1 -> a0 a1 b0 b1
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), v);
+    }
+    return x;
+}
+
+//XIMEA transport packing: one 16 pixel group per iteration
+RAW_AVX2_TARGET unsigned simdXimea(RawPacking packing, const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+    const int bits = cPackings[packing].bits;
+    const unsigned groupBytes = cPackings[packing].groupBytes;
+    const char z = char(0x80);
+
+    unsigned x = 0;
+    for(; x + 16 <= width && size_t(x) / 16 * groupBytes + 32 <= rowBytes; x += 16)
+    {
+        const unsigned char* p = s + x / 16 * groupBytes;
+        __m128i hi8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i low8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        __m256i lo;
+        if(bits == 12)
+        {
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+            __m128i l = _mm_unpacklo_epi8(_mm_and_si128(low8, nibble),
+                                          _mm_and_si128(_mm_srli_epi16(low8, 4), nibble));
+            lo = _mm256_cvtepu8_epi16(l);
+        }
+        else if(bits == 10)
+        {
+            const __m128i idx = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+            const __m256i mul = _mm256_setr_epi16(16384, 4096, 1024, 256, 16384, 4096, 1024, 256,
+                                                  16384, 4096, 1024, 256, 16384, 4096, 1024, 256);
+            lo = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(low8, idx));
+            lo = _mm256_srli_epi16(_mm256_mullo_epi16(lo, mul), 14);
+        }
+        else
+        {
+            //6 bit fields, 4 pixels per 3 bytes at bit offsets 0, 6, 4, 2
+            const __m128i idx0 = _mm_setr_epi8(0, 1, 0, 1, 1, 2, 2, z, 3, 4, 3, 4, 4, 5, 5, z);
+            const __m128i idx1 = _mm_setr_epi8(6, 7, 6, 7, 7, 8, 8, z, 9, 10, 9, 10, 10, 11, 11, z);
+            const __m256i mul = _mm256_setr_epi16(1024, 16, 64, 256, 1024, 16, 64, 256,
+                                                  1024, 16, 64, 256, 1024, 16, 64, 256);
+            lo = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_shuffle_epi8(low8, idx0)),
+                                         _mm_shuffle_epi8(low8, idx1), 1);
+            lo = _mm256_srli_epi16(_mm256_mullo_epi16(lo, mul), 10);
+        }
+        __m256i hi = _mm256_slli_epi16(_mm256_cvtepu8_epi16(hi8), bits - 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), _mm256_or_si256(hi, lo));
+    }
+    return x;
+}
+
+#elif defined(RAW_USE_NEON)
+
+//PFNC 12p, GVSP 12Packed and MIPI RAW12: 16 pixels from 24 bytes
+unsigned simd12(RawPacking packing, const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+    const uint8x8_t nibble = vdup_n_u8(0x0F);
+    unsigned x = 0;
+    for(; x + 16 <= width && size_t(x) / 2 * 3 + 24 <= rowBytes; x += 16)
+    {
+        uint8x8x3_t b = vld3_u8(s + x / 2 * 3);
+        uint16x8x2_t r;
+        if(packing == rpPFNC12p)
+        {
+            r.val[0] = vorrq_u16(vmovl_u8(b.val[0]), vshll_n_u8(vand_u8(b.val[1], nibble), 8));
+            r.val[1] = vorrq_u16(vmovl_u8(vshr_n_u8(b.val[1], 4)), vshll_n_u8(b.val[2], 4));
+        }
+        else if(packing == rpGVSP12Packed)
+        {
+            r.val[0] = vorrq_u16(vshll_n_u8(b.val[0], 4), vmovl_u8(vand_u8(b.val[1], nibble)));
+            r.val[1] = vorrq_u16(vshll_n_u8(b.val[2], 4), vmovl_u8(vshr_n_u8(b.val[1], 4)));
+        }
+        else
+        {
+            r.val[0] = vorrq_u16(vshll_n_u8(b.val[0], 4), vmovl_u8(vand_u8(b.val[2], nibble)));
+            r.val[1] = vorrq_u16(vshll_n_u8(b.val[1], 4), vmovl_u8(vshr_n_u8(b.val[2], 4)));
+        }
+        vst2q_u16(d + x, r);
+    }
+    return x;
+}
+
+unsigned simd10(RawPacking, const unsigned char*, uint16_t*, unsigned, size_t)
+{
+    return 0;
+}
+
+unsigned simd14(const unsigned char*, uint16_t*, unsigned, size_t)
+{
+    return 0;
+}
+
+//XIMEA 12 bit transport packing, other depths go through the scalar kernel
+unsigned simdXimea(RawPacking packing, const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+    if(packing != rpXimea12)
+        return 0;
+
+    const uint8x8_t nibble = vdup_n_u8(0x0F);
+    unsigned x = 0;
+    for(; x + 16 <= width && size_t(x) / 16 * 24 + 24 <= rowBytes; x += 16)
+    {
+        const unsigned char* p = s + x / 16 * 24;
+        uint8x16_t hi = vld1q_u8(p);
+        uint8x8_t low = vld1_u8(p + 16);
+        uint8x8x2_t l = vzip_u8(vand_u8(low, nibble), vshr_n_u8(low, 4));
+        vst1q_u16(d + x,     vorrq_u16(vshll_n_u8(vget_low_u8(hi), 4),  vmovl_u8(l.val[0])));
+        vst1q_u16(d + x + 8, vorrq_u16(vshll_n_u8(vget_high_u8(hi), 4), vmovl_u8(l.val[1])));
+    }
+    return x;
+}
+
+#else
+
+unsigned simd12(RawPacking, const unsigned char*, uint16_t*, unsigned, size_t) {return 0;}
+unsigned simd10(RawPacking, const unsigned char*, uint16_t*, unsigned, size_t) {return 0;}
+unsigned simd14(const unsigned char*, uint16_t*, unsigned, size_t) {return 0;}
+unsigned simdXimea(RawPacking, const unsigned char*, uint16_t*, unsigned, size_t) {return 0;}
+
+#endif
+
+unsigned unpackSimd(RawPacking packing, const unsigned char* s, uint16_t* d, unsigned width, size_t rowBytes)
+{
+#if defined(RAW_USE_AVX2)
+    if(!cAvx2)
+        return 0;
+#endif
+    switch(packing)
+    {
+    case rpPFNC12p:
+    case rpGVSP12Packed:
+    case rpMIPIRaw12:
+        return simd12(packing, s, d, width, rowBytes);
+    case rpPFNC10p:
+    case rpMIPIRaw10:
+        return simd10(packing, s, d, width, rowBytes);
+    case rpPFNC14p:
+        return simd14(s, d, width, rowBytes);
+    case rpXimea10:
+    case rpXimea12:
+    case rpXimea14:
+        return simdXimea(packing, s, d, width, rowBytes);
+    default:
+        return 0;
+    }
+}
+}
+
+bool cpuHasAvx2()
+{
+#if defined(RAW_USE_AVX2)
+    //Function local, callers may run before the statics of this file are initialized
+    static const bool avx2 = detectAvx2();
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+int rawPackingBits(RawPacking packing)
+{
+    return packing < rpCount ? cPackings[packing].bits : 0;
+}
+
+const char* rawPackingName(RawPacking packing)
+{
+    return packing < rpCount ? cPackings[packing].name : "";
+}
+
+unsigned rawPackingGroup(RawPacking packing)
+{
+    return packing < rpCount ? cPackings[packing].group : 1;
+}
+
+size_t rawPackedRowBytes(RawPacking packing, unsigned width)
+{
+    if(packing >= rpCount)
+        return 0;
+    const PackingInfo& info = cPackings[packing];
+    return (size_t(width) + info.group - 1) / info.group * info.groupBytes;
+}
+
+RawPacking rawPackingFromPfnc(uint32_t pfnc)
+{
+    switch(pfnc)
+    {
+    case 0x010A0046: //Mono10p
+    case 0x010A0052: //BayerBG10p
+    case 0x010A0054: //BayerGB10p
+    case 0x010A0056: //BayerGR10p
+    case 0x010A0058: //BayerRG10p
+        return rpPFNC10p;
+    case 0x010C0047: //Mono12p
+    case 0x010C0053: //BayerBG12p
+    case 0x010C0055: //BayerGB12p
+    case 0x010C0057: //BayerGR12p
+    case 0x010C0059: //BayerRG12p
+        return rpPFNC12p;
+    case 0x010E0104: //Mono14p
+    case 0x010E0108: //BayerBG14p
+    case 0x010E0107: //BayerGB14p
+    case 0x010E0105: //BayerGR14p
+    case 0x010E0106: //BayerRG14p
+        return rpPFNC14p;
+    case 0x010C0006: //Mono12Packed
+    case 0x010C002D: //BayerBG12Packed
+    case 0x010C002C: //BayerGB12Packed
+    case 0x010C002A: //BayerGR12Packed
+    case 0x010C002B: //BayerRG12Packed
+        return rpGVSP12Packed;
+    default:
+        return rpNone;
+    }
+}
+
+bool rawPackingGpuFormat(RawPacking packing, fastRawFormat_t& format)
+{
+    switch(packing)
+    {
+    case rpPFNC12p:
+        format = FAST_RAW_XIMEA12;
+        return true;
+    case rpGVSP12Packed:
+        format = FAST_RAW_PTG12;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void unpackRawRow(RawPacking packing, const unsigned char* src, uint16_t* dst, unsigned width)
+{
+    GroupFun fun = groupFun(packing);
+    if(fun == nullptr)
+        return;
+
+    const PackingInfo& info = cPackings[packing];
+    const size_t rowBytes = size_t(width) / info.group * info.groupBytes;
+
+    unsigned x = unpackSimd(packing, src, dst, width, rowBytes);
+    for(; x + info.group <= width; x += info.group)
+        fun(src + x / info.group * info.groupBytes, dst + x);
+
+    //Partial group at the end of the stream
+    if(x < width)
+    {
+        unsigned char s[32] = {0};
+        uint16_t d[16];
+        size_t off = x / info.group * info.groupBytes;
+        size_t tail = (size_t(width - x) * unsigned(info.bits) + 7) / 8;
+        if(info.group == 16)
+            tail = size_t(width - x) + (size_t(width - x) * unsigned(info.bits - 8) + 7) / 8;
+        memcpy(s, src + off, tail < info.groupBytes ? tail : info.groupBytes);
+        fun(s, d);
+        memcpy(dst + x, d, (width - x) * sizeof(uint16_t));
+    }
+}
+
+bool unpackRaw(RawPacking packing, const void* src, size_t srcPitch,
+               void* dst, size_t dstPitch, unsigned width, unsigned height)
+{
+    if(packing == rpNone || packing >= rpCount || src == nullptr || dst == nullptr)
+        return false;
+
+    const auto* s = static_cast<const unsigned char*>(src);
+    auto* d = static_cast<unsigned char*>(dst);
+    const unsigned group = cPackings[packing].group;
+    const size_t rowBytes = rawPackedRowBytes(packing, width);
+
+    if(width % group == 0)
+    {
+        //Both sides contiguous: one long row gives the SIMD loop fewer tails
+        if(srcPitch == rowBytes && dstPitch == size_t(width) * sizeof(uint16_t))
+        {
+            unpackRawRow(packing, s, reinterpret_cast<uint16_t*>(d), width * height);
+            return true;
+        }
+        for(unsigned y = 0; y < height; y++)
+            unpackRawRow(packing, s + y * srcPitch, reinterpret_cast<uint16_t*>(d + y * dstPitch), width);
+        return true;
+    }
+
+    //Rows split packing groups, only valid for a continuous bit stream
+    const size_t total = size_t(width) * height;
+    const int bits = cPackings[packing].bits;
+    if(srcPitch != size_t(width) * unsigned(bits) / 8 || total % group != 0)
+        return false;
+
+    if(dstPitch == size_t(width) * sizeof(uint16_t))
+    {
+        unpackRawRow(packing, s, reinterpret_cast<uint16_t*>(d), unsigned(total));
+        return true;
+    }
+
+    std::vector<uint16_t> tmp(total);
+    unpackRawRow(packing, s, tmp.data(), unsigned(total));
+    for(unsigned y = 0; y < height; y++)
+        memcpy(d + y * dstPitch, tmp.data() + size_t(y) * width, width * sizeof(uint16_t));
+    return true;
+}
+
+std::vector<RawUnpackBenchmark> benchmarkRawUnpack(unsigned width, unsigned height, int iterations)
+{
+    std::vector<RawUnpackBenchmark> ret;
+    if(iterations <= 0)
+        return ret;
+
+    width = width / 16 * 16;
+    std::vector<uint16_t> out(size_t(width) * height);
+
+    for(int p = rpPFNC10p; p < rpCount; p++)
+    {
+        const RawPacking packing = RawPacking(p);
+        const size_t rowBytes = rawPackedRowBytes(packing, width);
+        std::vector<unsigned char> in(rowBytes * height);
+
+        uint32_t seed = 12345;
+        for(auto& b : in)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            b = static_cast<unsigned char>(seed >> 24);
+        }
+
+        unpackRaw(packing, in.data(), rowBytes, out.data(), width * sizeof(uint16_t), width, height);
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++)
+            unpackRaw(packing, in.data(), rowBytes, out.data(), width * sizeof(uint16_t), width, height);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        RawUnpackBenchmark res;
+        res.packing = packing;
+        if(sec > 0)
+        {
+            res.mpixPerSec = double(width) * height * iterations / sec / 1e6;
+            res.mbytesPerSec = double(in.size()) * iterations / sec / 1e6;
+        }
+        ret.push_back(res);
+    }
+    return ret;
+}
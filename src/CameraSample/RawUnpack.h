@@ -0,0 +1,91 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef RAWUNPACK_H
+#define RAWUNPACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fastvideo_sdk.h"
+
+///Packed raw layouts delivered by cameras. Unpacked samples are 16 bit
+///little endian with the value in the low bits (as FAST_I10/I12/I14 expect).
+typedef enum {
+    rpNone = 0,       ///Not packed, 8 or 16 bit per sample
+    rpPFNC10p,        ///GenICam PFNC Mono10p/Bayer10p, 4 pixels in 5 bytes, LSB first
+    rpPFNC12p,        ///GenICam PFNC Mono12p/Bayer12p, 2 pixels in 3 bytes, LSB first
+    rpPFNC14p,        ///GenICam PFNC Mono14p/Bayer14p, 4 pixels in 7 bytes, LSB first
+    rpGVSP12Packed,   ///GigE Vision Mono12Packed/Bayer12Packed, MSB bytes around a shared nibble byte
+    rpMIPIRaw10,      ///MIPI CSI-2 RAW10, 4 MSB bytes then one byte of 2 bit LSBs
+    rpMIPIRaw12,      ///MIPI CSI-2 RAW12, 2 MSB bytes then one byte of 4 bit LSBs
+    rpXimea10,        ///XIMEA transport packing, 16 MSB bytes then 16 LSB fields
+    rpXimea12,
+    rpXimea14,
+    rpCount
+} RawPacking;
+
+int rawPackingBits(RawPacking packing);
+const char* rawPackingName(RawPacking packing);
+
+///Pixels in one packing group, rows must hold a whole number of groups
+unsigned rawPackingGroup(RawPacking packing);
+
+///Bytes in a packed row of width pixels
+size_t rawPackedRowBytes(RawPacking packing, unsigned width);
+
+///Packing of a GenICam PFNC pixel format, rpNone for unpacked or unknown formats
+RawPacking rawPackingFromPfnc(uint32_t pfnc);
+
+///Fastvideo raw importer that unpacks the layout on the GPU, false if there is none
+bool rawPackingGpuFormat(RawPacking packing, fastRawFormat_t& format);
+
+///x86 CPU with AVX2 usable by the OS, checked once at start up. Kernels built
+///with the avx2 target attribute are picked with it at run time.
+bool cpuHasAvx2();
+
+///Unpacks width pixels of one row (AVX2/NEON where available)
+void unpackRawRow(RawPacking packing, const unsigned char* src, uint16_t* dst, unsigned width);
+
+///Unpacks a frame, pitches are in bytes. A frame stored as one continuous
+///bit stream (srcPitch equal to the packed row size) may have any width.
+bool unpackRaw(RawPacking packing, const void* src, size_t srcPitch,
+               void* dst, size_t dstPitch, unsigned width, unsigned height);
+
+struct RawUnpackBenchmark
+{
+    RawPacking packing = rpNone;
+    double mpixPerSec = 0;
+    double mbytesPerSec = 0;    ///Packed input bytes
+};
+
+///Measures CPU unpack throughput of every layout on a synthetic frame
+std::vector<RawUnpackBenchmark> benchmarkRawUnpack(unsigned width, unsigned height, int iterations);
+
+#endif // RAWUNPACK_H
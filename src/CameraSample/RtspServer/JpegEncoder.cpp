@@ -28,240 +28,388 @@
 
 #include "JpegEncoder.h"
 
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <csetjmp>
+#include <cstring>
 
-#if 0
-#include "turbojpeg.h"
-#else
-#include "jpeglib.h"
+#ifdef _OPENMP
+#include <omp.h>
 #endif
 
-jpeg_encoder::jpeg_encoder()
-{
+#include "jpeglib.h"
 
+namespace {
+
+/// MCU height of 4:2:0, the libjpeg default for RGB input
+const int MCU_SIZE = 16;
+/// MCU height of one component images
+const int MCU_SIZE_GRAY = 8;
+
+/// Rows per strip for setStripRows(rows), a multiple of MCU_SIZE
+int stripRowsOf(int rows, int height)
+{
+    if(rows <= 0){
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        rows = (height + threads - 1) / threads;
+    }
+    return std::max(1, (rows + MCU_SIZE - 1) / MCU_SIZE) * MCU_SIZE;
 }
 
-jpeg_encoder::~jpeg_encoder()
+struct error_mgr {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+METHODDEF(void)
+error_exit(j_common_ptr cinfo)
 {
+    char msg[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, msg);
+    qDebug("Jpeg encoder error: %s", msg);
 
+    longjmp(reinterpret_cast<error_mgr*>(cinfo->err)->jump, 1);
 }
 
-#if 0
-bool jpeg_encoder::encode(unsigned char *input, int width, int height, std::vector<uchar> &output, int quality)
-{
-    tjhandle handle = tjInitCompress();
+struct destination_mgr {
+    struct jpeg_destination_mgr pub;
+    std::vector<uchar> *buffer;
+};
 
-    int pixFormat = TJPF_GRAY;
-    int outSubSamp = TJSAMP_GRAY;
+METHODDEF(void)
+init_destination(j_compress_ptr cinfo)
+{
+    destination_mgr *dest = reinterpret_cast<destination_mgr*>(cinfo->dest);
 
-    int flags = TJFLAG_FASTUPSAMPLE | TJFLAG_FASTDCT | TJFLAG_FORCESSE;
+    dest->pub.next_output_byte = dest->buffer->data();
+    dest->pub.free_in_buffer = dest->buffer->size();
+}
 
-    pixFormat = TJPF_RGB;
-    outSubSamp = TJSAMP_420;
+/// The buffer is sized for the worst case, grow it only if a strip still does not fit
+METHODDEF(boolean)
+empty_output_buffer(j_compress_ptr cinfo)
+{
+    destination_mgr *dest = reinterpret_cast<destination_mgr*>(cinfo->dest);
 
-    uchar *jpegBuf = nullptr;
-    ulong jpegSize = 0;
+    size_t used = dest->buffer->size();
+    dest->buffer->resize(used * 2);
 
-    int pitch = static_cast<int>(width * 3);
-    if(tjCompress2(handle, input, width, pitch, height,
-            pixFormat, &jpegBuf, &jpegSize, outSubSamp, quality, flags) < 0){
-        return false;
-    }
+    dest->pub.next_output_byte = dest->buffer->data() + used;
+    dest->pub.free_in_buffer = dest->buffer->size() - used;
 
-    output.resize(jpegSize);
-    std::copy(jpegBuf, jpegBuf + jpegSize, output.data());
+    return TRUE;
+}
 
-    tjFree(jpegBuf);
+METHODDEF(void)
+term_destination(j_compress_ptr)
+{
+}
 
-    return true;
+inline int readWord(const uchar* data)
+{
+    return (data[0] << 8) | data[1];
 }
 
-bool jpeg_encoder::encode(unsigned char *input, int width, int height, uchar *output, uint &size, int quality)
+/// Size of the headers up to the end of SOS, 0 if the stream is not a baseline JPEG
+size_t headerSize(const uchar* data, size_t size, size_t& sofOffset)
 {
-    tjhandle handle = tjInitCompress();
+    sofOffset = 0;
+    if(size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return 0;
+
+    size_t pos = 2;
+    while(pos + 4 <= size && data[pos] == 0xFF){
+        uchar marker = data[pos + 1];
+        size_t len = size_t(readWord(data + pos + 2));
+        if(marker == 0xC0)
+            sofOffset = pos;
+        pos += 2 + len;
+        if(marker == 0xDA)
+            return sofOffset > 0 && pos <= size ? pos : 0;
+    }
+    return 0;
+}
 
-    int pixFormat = TJPF_GRAY;
-    int outSubSamp = TJSAMP_GRAY;
+} // namespace
 
-    int flags = TJFLAG_ACCURATEDCT | TJFLAG_PROGRESSIVE;
+struct jpeg_encoder::strip
+{
+    jpeg_compress_struct cinfo;
+    error_mgr jerr;
+    destination_mgr dest;
+    std::vector<uchar> buffer;
+    std::vector<uchar> rgb;
+    size_t size = 0;
+    size_t header = 0;
+    size_t offset = 0;
+    int mcuRow = 0;
+    bool ok = false;
+
+    strip()
+    {
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = error_exit;
+        jpeg_create_compress(&cinfo);
+
+        dest.pub.init_destination = init_destination;
+        dest.pub.empty_output_buffer = empty_output_buffer;
+        dest.pub.term_destination = term_destination;
+        dest.buffer = &buffer;
+        cinfo.dest = &dest.pub;
+    }
+    ~strip()
+    {
+        jpeg_destroy_compress(&cinfo);
+    }
 
-    pixFormat = TJPF_RGB;
-    outSubSamp = TJSAMP_420;
+    bool encode(const uchar* input, int width, int height, int channels, int pitch, int quality, bool gray);
+};
 
-    uchar *jpegBuf = nullptr;
-    ulong jpegSize = 0;
+bool jpeg_encoder::strip::encode(const uchar *input, int width, int height, int channels, int pitch, int quality, bool gray)
+{
+    size = 0;
+    size_t capacity = jpeg_encoder::maxEncodedSize(width, height);
+    if(buffer.size() < capacity)
+        buffer.resize(capacity);
 
-    int pitch = width * 3;
-    if(tjCompress2(handle, input, width, pitch, height,
-            pixFormat, &jpegBuf, &jpegSize, outSubSamp, quality, flags) < 0){
+    if(setjmp(jerr.jump)){
+        jpeg_abort_compress(&cinfo);
         return false;
     }
 
-    std::copy(jpegBuf, jpegBuf + jpegSize, output);
-    size = jpegSize;
+    //Gray is expanded to RGB unless one component output was asked for
+    cinfo.in_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+    cinfo.image_width = JDIMENSION(width);
+    cinfo.image_height = JDIMENSION(height);
+    cinfo.input_components = gray ? 1 : 3;
 
-    tjFree(jpegBuf);
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+    cinfo.restart_in_rows = 1;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    JSAMPROW rows[MCU_SIZE];
+    const bool expand = channels == 1 && !gray;
+    if(expand){
+        rgb.resize(size_t(width) * 3 * MCU_SIZE);
+        for(int i = 0; i < MCU_SIZE; ++i)
+            rows[i] = rgb.data() + size_t(i) * width * 3;
+    }
 
-    tjDestroy(handle);
+    while(cinfo.next_scanline < cinfo.image_height){
+        int count = std::min<int>(MCU_SIZE, int(cinfo.image_height - cinfo.next_scanline));
+        for(int i = 0; i < count; ++i){
+            const uchar *in = input + size_t(cinfo.next_scanline + i) * pitch;
+            if(expand){
+                uchar *out = rows[i];
+                for(int x = 0; x < width; ++x){
+                    out[x * 3 + 0] = in[x];
+                    out[x * 3 + 1] = in[x];
+                    out[x * 3 + 2] = in[x];
+                }
+            }else{
+                rows[i] = const_cast<uchar*>(in);
+            }
+        }
+        jpeg_write_scanlines(&cinfo, rows, JDIMENSION(count));
+    }
+
+    jpeg_finish_compress(&cinfo);
 
+    size = buffer.size() - dest.pub.free_in_buffer;
     return true;
 }
-#else
-
-#define OUTPUT_BUF_SIZE  4096
-
-typedef struct {
-    struct jpeg_destination_mgr pub; /* public fields */
 
-    std::vector<uchar> *output;
-    std::vector<uchar> *buffer;		/* start of buffer */
-} my_destination_mgr;
-
-typedef my_destination_mgr * my_dest_ptr;
-
-METHODDEF(void)
-init_destination (j_compress_ptr cinfo)
+jpeg_encoder::jpeg_encoder()
 {
-    my_dest_ptr dest = (my_dest_ptr) cinfo->dest;
-
-    dest->buffer->clear();
-    dest->output->clear();
-
-    /* Allocate the output buffer --- it will be released when done with image */
-    dest->buffer->resize(OUTPUT_BUF_SIZE);
 
-    dest->pub.next_output_byte = (JOCTET*)dest->buffer->data();
-    dest->pub.free_in_buffer = OUTPUT_BUF_SIZE;
 }
 
-
-METHODDEF(boolean)
-empty_dst (j_compress_ptr cinfo)
+jpeg_encoder::~jpeg_encoder()
 {
-    my_dest_ptr dest = (my_dest_ptr) cinfo->dest;
-
-    size_t size = dest->output->size();
-    size_t size_add = dest->buffer->size();
-    dest->output->resize(size + size_add);
-    std::copy(dest->buffer->data(), dest->buffer->data() + size_add, dest->output->data() + size);//append(*dest->buffer);
 
-    dest->pub.next_output_byte = (JOCTET*)dest->buffer->data();
-    dest->pub.free_in_buffer = OUTPUT_BUF_SIZE;
-
-    return TRUE;
 }
 
-
-/*
- * Terminate destination --- called by jpeg_finish_compress
- * after all data has been written.  Usually needs to flush buffer.
- *
- * NB: *not* called by jpeg_abort or jpeg_destroy; surrounding
- * application must deal with any cleanup that should happen even
- * for error exit.
- */
-
-METHODDEF(void)
-term_destination (j_compress_ptr cinfo)
+void jpeg_encoder::setStripRows(int rows)
 {
-    my_dest_ptr dest = (my_dest_ptr) cinfo->dest;
-    size_t datacount = OUTPUT_BUF_SIZE - dest->pub.free_in_buffer;
-
-    /* Write any data remaining in the buffer */
-    if (datacount > 0) {
-        size_t size = dest->output->size();
-        size_t size_add = datacount;
-        dest->output->resize(size + size_add);
-        std::copy(dest->buffer->data(), dest->buffer->data() + size_add, dest->output->data() + size);//append(*dest->buffer);
-        //dest->output->insert(dest->buffer->data(), datacount);
-    }
+    mStripRows = rows;
 }
 
-////////////
+void jpeg_encoder::setKeepGray(bool keep)
+{
+    mKeepGray = keep;
+}
 
-void error_exit(j_common_ptr cinfo)
+size_t jpeg_encoder::maxEncodedSize(int width, int height)
 {
-    std::cout << "Error " << cinfo->err->msg_code << " " << cinfo->err->msg_parm.i[0] << std::endl;
+    //Same bound as tjBufSize() of libjpeg-turbo for 4:2:0
+    size_t w = (size_t(width) + MCU_SIZE - 1) / MCU_SIZE * MCU_SIZE;
+    size_t h = (size_t(height) + MCU_SIZE - 1) / MCU_SIZE * MCU_SIZE;
+    return w * h * 3 + 2048;
 }
 
 bool jpeg_encoder::encode(unsigned char *input, int width, int height,
                           int channels, std::vector<uchar> &output, int quality)
 {
-    jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
-
-    cinfo.err = jpeg_std_error(&jerr);
-    cinfo.err->error_exit = error_exit;
-
-    cinfo.in_color_space = JCS_RGB;
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-    cinfo.input_components = 3;
-    cinfo.jpeg_color_space = JCS_YCbCr;
+    size_t capacity = maxEncodedSize(width, height);
+    if(output.size() < capacity)
+        output.resize(capacity);
 
-    my_destination_mgr dest;
-
-//    if (cinfo.dest == nullptr) {	/* first time for this JPEG object? */
-//        cinfo.dest = (struct jpeg_destination_mgr *)
-//                (*cinfo.mem->alloc_small) ((j_common_ptr) &cinfo, JPOOL_PERMANENT,
-//                                           sizeof(my_destination_mgr));
-//    }
-
-    cinfo.dest = (struct jpeg_destination_mgr *)&dest;
+    uint size = uint(output.size());
+    if(!encode(input, width, height, channels, width * channels, output.data(), size, quality)){
+        output.clear();
+        return false;
+    }
+    output.resize(size);
+    return true;
+}
 
-    dest.pub.init_destination = init_destination;
-    dest.pub.empty_output_buffer = empty_dst;
-    dest.pub.term_destination = term_destination;
+bool jpeg_encoder::encode(unsigned char *input, int width, int height,
+                          int channels, uchar *output, uint &size, int quality)
+{
+    return encode(input, width, height, channels, width * channels, output, size, quality);
+}
 
-    std::vector<uchar> buffer;
-    dest.buffer = &buffer;
-    dest.output = &output;
+bool jpeg_encoder::encode(unsigned char *input, int width, int height,
+                          int channels, int pitch, uchar *output, uint &size, int quality)
+{
+    size_t capacity = size;
+    size = 0;
+    if(input == nullptr || output == nullptr || width <= 0 || height <= 0 ||
+       (channels != 1 && channels != 3))
+        return false;
 
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
-    jpeg_start_compress(&cinfo, true);
+    const int rows = stripRowsOf(mStripRows, height);
+    int count = (height + rows - 1) / rows;
+    while(int(mStrips.size()) < count)
+        mStrips.emplace_back(new strip());
+
+    //Strip rows are a multiple of both MCU heights, restart markers count MCU rows
+    const bool gray = channels == 1 && mKeepGray;
+    const int mcuHeight = gray ? MCU_SIZE_GRAY : MCU_SIZE;
+
+#pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < count; ++i){
+        strip *s = mStrips[size_t(i)].get();
+        int y = i * rows;
+        s->ok = s->encode(input + size_t(y) * pitch, width, std::min(rows, height - y), channels, pitch, quality, gray);
+        s->mcuRow = y / mcuHeight;
+    }
 
-    JSAMPROW arr[1];
-    int pitch = width * 3;
+    //Entropy data of the strips goes after the headers of the first one,
+    //separated by restart markers. Offsets are known before copying.
+    size_t sofOffset = 0;
+    size_t total = 0;
+    for(int i = 0; i < count; ++i){
+        strip *s = mStrips[size_t(i)].get();
+        if(!s->ok)
+            return false;
+
+        s->header = headerSize(s->buffer.data(), s->size, sofOffset);
+        if(s->header == 0 || s->size < s->header + 2)
+            return false;
+
+        if(i == 0)
+            total = s->header;
+        else
+            total += 2;
+        s->offset = total;
+        total += s->size - s->header - 2;
+    }
+    total += 2;
 
-    if(channels == 1){
-        int pitchIn = width;
+    if(total > capacity)
+        return false;
 
-        std::vector<unsigned char> row;
-        row.resize(pitch);
-        arr[0] = row.data();
+    const strip *first = mStrips[0].get();
+    std::memcpy(output, first->buffer.data(), first->header);
+    headerSize(output, first->header, sofOffset);
+    output[sofOffset + 5] = uchar(height >> 8);
+    output[sofOffset + 6] = uchar(height & 0xFF);
+
+#pragma omp parallel for
+    for(int i = 0; i < count; ++i){
+        const strip *s = mStrips[size_t(i)].get();
+        const uchar *in = s->buffer.data() + s->header;
+        const uchar *end = s->buffer.data() + s->size - 2;
+        uchar *out = output + s->offset;
+        int marker = s->mcuRow;
+
+        if(i > 0){
+            out[-2] = 0xFF;
+            out[-1] = uchar(0xD0 + ((marker - 1) & 7));
+        }
 
-        while(cinfo.next_scanline < cinfo.image_height){
-            unsigned char *in = input + cinfo.next_scanline * pitchIn;
-            for(int i = 0; i < width; ++i){
-                row.data()[i * 3 + 0] = in[i];
-                row.data()[i * 3 + 1] = in[i];
-                row.data()[i * 3 + 2] = in[i];
+        //Restart markers of the strip start from RST0, continue the image numbering
+        while(in < end){
+            const uchar *ff = static_cast<const uchar*>(std::memchr(in, 0xFF, size_t(end - in)));
+            if(ff == nullptr || ff + 1 >= end){
+                std::memcpy(out, in, size_t(end - in));
+                break;
             }
-
-            jpeg_write_scanlines(&cinfo, arr, 1);
-        }
-    }else{
-        while(cinfo.next_scanline < cinfo.image_height){
-            arr[0] = input + cinfo.next_scanline * pitch;
-            jpeg_write_scanlines(&cinfo, arr, 1);
+            size_t len = size_t(ff - in) + 2;
+            std::memcpy(out, in, len);
+            if(ff[1] >= 0xD0 && ff[1] <= 0xD7)
+                out[len - 1] = uchar(0xD0 + (marker++ & 7));
+            out += len;
+            in += len;
         }
     }
 
-    jpeg_finish_compress(&cinfo);
-    jpeg_destroy_compress(&cinfo);
+    output[total - 2] = 0xFF;
+    output[total - 1] = 0xD9;
+    size = uint(total);
 
     return true;
 }
 
-bool jpeg_encoder::encode(unsigned char *input, int width, int height,
-                          int channels, uchar *output, uint &size, int quality)
+std::vector<JpegEncoderBenchmark> benchmarkJpegEncoder(int width, int height, int quality, int iterations)
 {
-    input, width, height, channels, output, size, quality;
-    return false;
-}
+    std::vector<JpegEncoderBenchmark> ret;
+    if(width <= 0 || height <= 0 || iterations <= 0)
+        return ret;
+
+    //Smooth gradients with a little noise, random bytes would only measure the entropy coder
+    std::vector<uchar> rgb(size_t(width) * height * 3);
+    uint32_t seed = 12345;
+    for(int y = 0; y < height; y++){
+        uchar* row = rgb.data() + size_t(y) * width * 3;
+        for(int x = 0; x < width; x++){
+            seed = seed * 1664525u + 1013904223u;
+            const int noise = int(seed >> 29);
+            row[x * 3] = uchar((x * 255 / width + noise) & 0xFF);
+            row[x * 3 + 1] = uchar((y * 255 / height + noise) & 0xFF);
+            row[x * 3 + 2] = uchar(((x + y) * 127 / (width + height) + noise) & 0xFF);
+        }
+    }
 
-#endif
+    std::vector<uchar> out(jpeg_encoder::maxEncodedSize(width, height));
+    for(int rows : {height, 256, 64, 0}){
+        jpeg_encoder enc;
+        enc.setStripRows(rows);
+
+        uint size = uint(out.size());
+        if(!enc.encode(rgb.data(), width, height, 3, out.data(), size, quality))
+            continue;
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++){
+            size = uint(out.size());
+            enc.encode(rgb.data(), width, height, 3, out.data(), size, quality);
+        }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        JpegEncoderBenchmark res;
+        const int stripRows = stripRowsOf(rows, height);
+        res.stripRows = std::min(height, stripRows);
+        res.strips = (height + stripRows - 1) / stripRows;
+        res.bytesPerFrame = size;
+        if(sec > 0)
+            res.mpixPerSec = double(width) * height * iterations / sec / 1e6;
+        ret.push_back(res);
+    }
+    return ret;
+}
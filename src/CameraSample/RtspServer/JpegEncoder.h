@@ -33,19 +33,57 @@
 #include <QByteArray>
 #include <QSharedPointer>
 
+#include <memory>
+#include <vector>
+
 #include "common_utils.h"
 
+/**
+ * @brief The jpeg_encoder class
+ * Baseline libjpeg encoder. The image is cut into horizontal strips that are
+ * encoded in parallel with a restart marker after every MCU row, and the strips
+ * are stitched into one JPEG. Encoder objects and strip buffers are kept
+ * between frames, so keep one encoder per stream.
+ */
 class jpeg_encoder
 {
 public:
 	jpeg_encoder();
 	~jpeg_encoder();
 
+    /// Rows per strip, rounded up to the MCU height. 0 splits by the number of threads
+    void setStripRows(int rows);
+    /// Encode gray input as one component JPEG. Off by default, gray is
+    /// expanded to RGB because RTP/JPEG cannot carry one component images
+    void setKeepGray(bool keep);
+    bool keepGray() const { return mKeepGray; }
+    /// Upper bound of the JPEG size, use it to preallocate the output buffer
+    static size_t maxEncodedSize(int width, int height);
+
     bool encode(unsigned char* input, int width, int height, int channels, std::vector<uchar>& output, int quality = 60);
+    /// size is the capacity of output on input and the JPEG size on return
     bool encode(unsigned char* input, int width, int height, int channels, uchar* output, uint &size, int quality = 60);
+    /// Same as above for rows pitch bytes apart
+    bool encode(unsigned char* input, int width, int height, int channels, int pitch, uchar* output, uint &size, int quality = 60);
 
 private:
+    struct strip;
+
+    std::vector<std::unique_ptr<strip>> mStrips;
+    int mStripRows = 0;
+    bool mKeepGray = false;
+};
 
+struct JpegEncoderBenchmark
+{
+    int stripRows = 0;          ///Rows per strip, the frame height for one strip
+    int strips = 0;
+    double mpixPerSec = 0;
+    double bytesPerFrame = 0;
 };
 
+///Measures RGB encode throughput on a synthetic frame with one strip,
+///a few fixed strip heights and one strip per thread
+std::vector<JpegEncoderBenchmark> benchmarkJpegEncoder(int width, int height, int quality, int iterations);
+
 #endif // JPEG_ENCODER_H
@@ -36,6 +36,8 @@
 
 #include "common_utils.h"
 #include "vutils.h"
+#include "Tracer.h"
+#include "ThreadPolicy.h"
 
 #include <QPainter>
 #include <QImage>
@@ -64,11 +66,15 @@ RTSPStreamerServer::RTSPStreamerServer(int width, int height,
 {
     int ret = 0;
 
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
 	avcodec_register_all();
 	av_register_all();
+#endif
     avformat_network_init();
 
     mJpegEncode = encodeJpeg;
+    mFrame = av_frame_alloc();
+    mPacket = av_packet_alloc();
 
     if(mEncoderType == etNVENC)
     {
@@ -151,7 +157,7 @@ RTSPStreamerServer::RTSPStreamerServer(int width, int height,
     }
 
 	//frames per second
-    mCtx->time_base = {1, mFps};         // for test. maybe do not affect
+    mCtx->time_base = {1, 90000};        // rtp clock, pts comes from capture time
     mCtx->framerate = {mFps, 1};         // for test. maybe do not affect
 	mCtx->gop_size = 0;
     mCtx->pix_fmt = mPixFmt;
@@ -236,9 +242,10 @@ RTSPStreamerServer::~RTSPStreamerServer()
     try{
         if(mCtx)
         {
-            avcodec_close(mCtx);
             avcodec_free_context(&mCtx);
         }
+        av_frame_free(&mFrame);
+        av_packet_free(&mPacket);
         if(mHwDeviceCtx){
             av_buffer_unref(&mHwDeviceCtx);
             mHwDeviceCtx = nullptr;
@@ -305,6 +312,7 @@ bool RTSPStreamerServer::isConnected() const
 
 bool RTSPStreamerServer::isAnyClientInit() const
 {
+    std::lock_guard<std::mutex> lg(mClientsMutex);
 	for(TcpClient *c: mClients){
 		if(c->isInit()){
 			return true;
@@ -389,8 +397,24 @@ double RTSPStreamerServer::duration() const
     return mDuration;
 }
 
+std::vector<RTSPStreamerServer::ClientStats> RTSPStreamerServer::clientStats() const
+{
+    std::lock_guard<std::mutex> lg(mClientsMutex);
+    std::vector<ClientStats> ret;
+    ret.reserve(mClients.size());
+    for(TcpClient *c: mClients){
+        ClientStats st;
+        st.peer = c->peer();
+        st.bytesSent = c->bytesSent();
+        st.packetsSent = c->packetsSent();
+        ret.push_back(st);
+    }
+    return ret;
+}
+
 void RTSPStreamerServer::removeClient(TcpClient *client)
 {
+    std::lock_guard<std::mutex> lg(mClientsMutex);
     for(auto it = mClients.begin(); it != mClients.end(); ++it)
     {
         if(*it == client)
@@ -408,7 +432,10 @@ void RTSPStreamerServer::newConnection()
     if(sock)
     {
         TcpClient *client = new TcpClient(sock, mUrl, mCtx, (TcpClient::EncoderType)mEncoderType);
-        mClients.push_back(client);
+        {
+            std::lock_guard<std::mutex> lg(mClientsMutex);
+            mClients.push_back(client);
+        }
 		connect(client, SIGNAL(removeClient(TcpClient*)), this, SLOT(removeClient(TcpClient*)));
 //		connect(sock, SIGNAL(disconnected()),
 //				client, SLOT(deleteLater()), Qt::QueuedConnection);
@@ -419,6 +446,7 @@ void RTSPStreamerServer::newConnection()
 
 void RTSPStreamerServer::doServer()
 {
+    ThreadPolicy::apply(AppSettings::trNetwork);
     mServer.reset(new QTcpServer);
 
     qDebug("---- server start -----");
@@ -487,7 +515,7 @@ void RTSPStreamerServer::Gray2Yuv420p(unsigned char *yuv, unsigned char *gray, i
 	  }
 }
 
-bool RTSPStreamerServer::addFrame(unsigned char *rgbPtr)
+bool RTSPStreamerServer::addFrame(unsigned char *rgbPtr, const FrameMetadata &meta)
 {
 //	if(mTimerCtrlFps.elapsed() - mDelayFps < mCurrentTimeElapsed){
 //		return false;
@@ -497,10 +525,11 @@ bool RTSPStreamerServer::addFrame(unsigned char *rgbPtr)
 	std::lock_guard<std::mutex> lg(mFrameMutex);
 
 	if(mFrameBuffers.size() < mMaxFrameBuffers)
-		mFrameBuffers.push_back(FrameBuffer(rgbPtr));
+		mFrameBuffers.push_back(FrameBuffer(rgbPtr, meta));
 
 	if(!mFrameThread.get()){
 		mFrameThread.reset(new std::thread([this](){
+			ThreadPolicy::apply(AppSettings::trNetwork);
 			doFrameBuffer();
 		}));
 	}
@@ -518,7 +547,7 @@ void RTSPStreamerServer::doFrameBuffer()
 			mFrameBuffers.pop_front();
 			mFrameMutex.unlock();
 
-			addInternalFrame(fb.buffer);
+			addInternalFrame(fb.buffer, fb.meta);
 		}
 	}
 }
@@ -555,22 +584,42 @@ void drawTimeToImageGray(uchar *gray, int width, int height, const QDateTime& ti
     qDebug("time %s", time.toString("hh:mm:ss.zzz").toLatin1().data());
 }
 
-bool RTSPStreamerServer::addInternalFrame(uchar *rgbPtr)
+int64_t RTSPStreamerServer::nextPts(const FrameMetadata &meta)
 {
+    int64_t pts = 0;
+    if(meta.hostTimestampUs == 0){
+        pts = mLastPts + 90000 / mFps;
+    }else{
+        if(mFirstCaptureUs == 0)
+            mFirstCaptureUs = meta.hostTimestampUs;
+        pts = av_rescale(meta.hostTimestampUs - mFirstCaptureUs, 90000, 1000000);
+    }
+    // camera clock jitter must not make pts go backwards
+    if(pts <= mLastPts)
+        pts = mLastPts + 1;
+    mLastPts = pts;
+    return pts;
+}
+
+bool RTSPStreamerServer::addInternalFrame(uchar *rgbPtr, const FrameMetadata &meta)
+{
+    TRACE_SCOPE_FRAME("rtsp", "encode frame", int64_t(meta.frameId));
 	auto starttime = getNow();
 
     if(!mIsInitialized || mClients.empty())
         return false;
 	int ret = 0;
+    mCurrentMeta = meta;
+    const int64_t pts = nextPts(meta);
 
     if(((mCodecId == AV_CODEC_ID_H264 || mCodecId == AV_CODEC_ID_INDEO3 || mCodecId == AV_CODEC_ID_HEVC) && !mUseCustomEncodeH264)
             || (mEncoderType == etJPEG && !mUseCustomEncodeJpeg))
 	{
-		AVFrame* frm = av_frame_alloc();
+		AVFrame* frm = mFrame;
 		frm->width = mWidth;
 		frm->height = mHeight;
 		frm->format = mPixFmt;
-		frm->pts = mFramesProcessed++;
+		frm->pts = pts;
 		//Set frame->data pointers manually
 		if(mChannels == 1)
 		{
@@ -667,13 +716,10 @@ bool RTSPStreamerServer::addInternalFrame(uchar *rgbPtr)
         }
 #endif
 
-		av_frame_free(&frm);
+		av_frame_unref(frm);
 	}
 	else
 	{
-		AVPacket pkt;
-		av_init_packet(&pkt);
-
 		int t = 0;
 
         if(mEncoderType == etJPEG)
@@ -687,18 +733,19 @@ bool RTSPStreamerServer::addInternalFrame(uchar *rgbPtr)
 			throw new std::exception();
 		}
 
-		av_new_packet(&pkt, static_cast<int>(mJpegData[t].size));
-		pkt.pts = mFramesProcessed++;
-
-		std::copy(mJpegData[t].buffer.data(), mJpegData[t].buffer.data() + mJpegData[t].size, pkt.data);
+		//Clients write the packet out before sendPkt() returns, no copy is needed
+		if(mJpegData[t].size > 0 &&
+		   wrap_packet(mPacket, mJpegData[t].buffer.data(), static_cast<int>(mJpegData[t].size)) == 0)
+		{
+			mPacket->pts = mPacket->dts = pts;
+			mPacket->flags |= AV_PKT_FLAG_KEY;
 
-		sendPkt(&pkt);
-		av_packet_unref(&pkt);
+			sendPkt(mPacket);
+			av_packet_unref(mPacket);
+		}
 	}
 
-	double duration = getDuration(starttime);
-	qDebug("encode duration %f", duration);
-    mDuration = duration;
+    mDuration = getDuration(starttime);
 
 	if(ret == 0)
 	{
@@ -714,19 +761,13 @@ void RTSPStreamerServer::encodeWriteFrame(uint8_t *buf, int width, int height)
 {
     if(mV4L2Encoder.data()){
         if(mV4L2Encoder->getEncodedData(mUserBuffer)){
-            if(!mUserBuffer.empty()){
-                AVPacket enc_pkt;
-                enc_pkt.data = nullptr;
-                enc_pkt.size = 0;
-                av_init_packet(&enc_pkt);
-
-                av_new_packet(&enc_pkt, static_cast<int>(mUserBuffer.size()));
-                enc_pkt.pts = enc_pkt.dts = mFramesProcessed;
-                enc_pkt.flags = AV_PKT_FLAG_KEY;
-                std::copy(mUserBuffer.data(),mUserBuffer.data() + mUserBuffer.size(), enc_pkt.data);
-
-                sendPkt(&enc_pkt);
-                av_packet_unref(&enc_pkt);
+            if(!mUserBuffer.empty() &&
+               wrap_packet(mPacket, mUserBuffer.data(), static_cast<int>(mUserBuffer.size())) == 0){
+                mPacket->pts = mPacket->dts = mLastPts;
+                mPacket->flags = AV_PKT_FLAG_KEY;
+
+                sendPkt(mPacket);
+                av_packet_unref(mPacket);
             }
         }
     }
@@ -735,24 +776,21 @@ void RTSPStreamerServer::encodeWriteFrame(uint8_t *buf, int width, int height)
 
 void RTSPStreamerServer::encodeWriteFrame(AVFrame *frame)
 {
-    int ret = 0, got;
-	AVPacket enc_pkt;
-    enc_pkt.data = nullptr;
-	enc_pkt.size = 0;
-
-    av_init_packet(&enc_pkt);
-
-    ret = avcodec_encode_video2(mCtx, &enc_pkt, frame, &got);
-    if(got > 0){
-        enc_pkt.pts = frame->pts;
-        sendPkt(&enc_pkt);
-        av_packet_unref(&enc_pkt);
+    int ret = avcodec_send_frame(mCtx, frame);
+    while(ret >= 0){
+        ret = avcodec_receive_packet(mCtx, mPacket);
+        if(ret < 0)
+            break;
+        sendPkt(mPacket);
+        av_packet_unref(mPacket);
     }
 }
 
 void RTSPStreamerServer::sendPkt(AVPacket *pkt)
 {
+    TRACE_SCOPE("rtsp", "send packet");
+    std::lock_guard<std::mutex> lg(mClientsMutex);
     for(TcpClient *c: mClients){
-		c->sendpkt(pkt);
+		c->sendpkt(pkt, mCurrentMeta);
 	}
 }
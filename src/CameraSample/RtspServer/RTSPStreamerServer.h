@@ -73,6 +73,13 @@ public:
 		etJ2K
 	} EncoderType;
 
+    struct ClientStats
+    {
+        QString peer;
+        qint64  bytesSent = 0;
+        qint64  packetsSent = 0;
+    };
+
     explicit RTSPStreamerServer(int width, int height, int channels, const QString& url,
                                 EncoderType encType, unsigned bitrate, QObject *parent = nullptr);
 	~RTSPStreamerServer();
@@ -128,13 +135,20 @@ public:
 	 * @brief addRGBFrame
 	 * default function to add rgb frame
 	 * @param rgbPtr
+	 * @param meta	capture metadata, pts is derived from the host capture time
 	 * @return
 	 */
-	bool addFrame (unsigned char* rgbPtr);
+	bool addFrame (unsigned char* rgbPtr, const FrameMetadata& meta = FrameMetadata());
 
 	bool startServer();
 
     double duration() const;
+    /**
+     * @brief clientStats
+     * per client throughput counters
+     * @return
+     */
+    std::vector<ClientStats> clientStats() const;
 
 signals:
 
@@ -166,6 +180,11 @@ private:
 	qint64 mCurrentTimeElapsed = 0;
 
     qint64      mFramesProcessed = 0;
+    /// capture time of the first frame and last pts, in mCtx->time_base units
+    int64_t     mFirstCaptureUs = 0;
+    int64_t     mLastPts = -1;
+    FrameMetadata mCurrentMeta;
+    int64_t nextPts(const FrameMetadata& meta);
     qint64      mBitrate = 20000000;
 
     std::unique_ptr<QTcpServer> mServer;
@@ -182,8 +201,9 @@ private:
 	struct FrameBuffer{
 		uchar *buffer = nullptr;
 		size_t size = 0;
+		FrameMetadata meta;
 		FrameBuffer(){}
-		FrameBuffer(uchar *buf){ buffer = buf; }
+		FrameBuffer(uchar *buf, const FrameMetadata& m){ buffer = buf; meta = m; }
 	};
 	// very unsafe
 	size_t mMaxFrameBuffers = 2;
@@ -191,7 +211,7 @@ private:
 	std::mutex mFrameMutex;
 	bool mDone = false;
 	void doFrameBuffer();
-	bool addInternalFrame(uchar *rgbPtr);
+	bool addInternalFrame(uchar *rgbPtr, const FrameMetadata& meta);
 
     QHostAddress    mHost;
     ushort          mPort;
@@ -202,9 +222,13 @@ private:
     AVCodecContext* mCtx = nullptr;
     AVCodec*        mCodec = nullptr;
     AVBufferRef*    mHwDeviceCtx = NULL;
+    /// reused for every frame, hold no references between frames
+    AVFrame*        mFrame = nullptr;
+    AVPacket*       mPacket = nullptr;
 
     QVector<unsigned char> mEncoderBuffer;
     std::list<TcpClient*>  mClients;
+    mutable std::mutex     mClientsMutex;
 
     std::vector<bytearray> mData;
 	std::vector<Buffer> mJpegData;
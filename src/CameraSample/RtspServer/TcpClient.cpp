@@ -27,6 +27,7 @@
 */
 
 #include "TcpClient.h"
+#include "Tracer.h"
 
 #include <QDateTime>
 #include <QCryptographicHash>
@@ -70,6 +71,8 @@ TcpClient::TcpClient(QTcpSocket *sock, const QString &url, AVCodecContext *codec
 
 //	sock->moveToThread(m_thread.get());
 
+    m_peer = QString("%1:%2").arg(sock->peerAddress().toString()).arg(sock->peerPort());
+
     m_serverPort1 = (rand() % 55000) + 5000;
     m_serverPort2 = m_serverPort1 + 1;
 
@@ -97,33 +100,43 @@ TcpClient::~TcpClient()
 	}
 }
 
-void TcpClient::sendpkt(AVPacket *pkt)
+void TcpClient::sendpkt(AVPacket *pkt, const FrameMetadata &meta)
 {
+    TRACE_SCOPE("rtsp", "send to client");
 	std::lock_guard<std::mutex> lg(m_mutex);
 
-	auto starttime = getNow();
-
     if(m_isCustomTransport && m_udpSocket.get()){
-        m_ctpTransport.createPacket(pkt->data, pkt->size, m_packets);
+        m_ctpTransport.createPacket(pkt->data, pkt->size, m_packets, meta.frameId, meta.hostTimestampUs);
+        qint64 sent = 0;
         for(QByteArray& d: m_packets){
-            m_udpSocket->writeDatagram(d, m_socket->peerAddress(), m_clientPort1);
+            qint64 res = m_udpSocket->writeDatagram(d, m_socket->peerAddress(), m_clientPort1);
+            if(res > 0)
+                sent += res;
         }
+        m_bytesSent += sent;
+        m_packetsSent++;
     }else if(m_fmt && m_isInit){
         pkt->stream_index = 0;
 
-        //AVStream *st = m_fmt->streams[pkt->stream_index];
-
-        //AVRational *time_base = &m_fmt->streams[pkt->stream_index]->time_base;
-
-        pkt->pts = pkt->pts * 90000/60;     /// 60 fps
+        // rtp muxer uses its own 90 kHz time base, rescale pts taken from capture time.
+        // The packet is shared by all clients, so timestamps are restored afterwards
+        const int64_t pts = pkt->pts;
+        const int64_t dts = pkt->dts;
+        const int64_t duration = pkt->duration;
+        av_packet_rescale_ts(pkt, m_ctx_main->time_base, m_fmt->streams[0]->time_base);
 
+        int size = pkt->size;
         int ret;
         //ret = avformat_write_header(m_fmt, nullptr);
         ret = av_write_frame(m_fmt, pkt);
+        pkt->pts = pts;
+        pkt->dts = dts;
+        pkt->duration = duration;
+        if(ret >= 0){
+            m_bytesSent += size;
+            m_packetsSent++;
+        }
 	}
-
-	double duration = getDuration(starttime);
-	qDebug("send duration %f", duration);
 }
 
 bool TcpClient::isInit() const
@@ -131,6 +144,21 @@ bool TcpClient::isInit() const
 	return m_isInit;
 }
 
+QString TcpClient::peer() const
+{
+    return m_peer;
+}
+
+qint64 TcpClient::bytesSent() const
+{
+    return m_bytesSent;
+}
+
+qint64 TcpClient::packetsSent() const
+{
+    return m_packetsSent;
+}
+
 void TcpClient::connected()
 {
 
@@ -145,7 +173,6 @@ void TcpClient::disconnected()
     if(m_fmt){
         //ret = avio_open(&m_fmt->pb, m_fmt->filename, AVIO_FLAG_WRITE);
         avio_close(m_fmt->pb);
-        avcodec_close(m_fmt->streams[0]->codec);
         avformat_free_context(m_fmt);
         m_fmt = nullptr;
     }
@@ -493,8 +520,6 @@ void TcpClient::setPlay()
         stream->codecpar->codec_id = m_codec->id;
         stream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
         stream->codecpar->format = m_ctx_main->pix_fmt;
-        stream->codec->flags = m_ctx_main->flags;
-        stream->codec->flags2 = m_ctx_main->flags2;
         stream->time_base = m_ctx_main->time_base;
 
     //    ret = avcodec_open2(c, m_codec, nullptr);
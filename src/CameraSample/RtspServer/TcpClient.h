@@ -35,6 +35,7 @@
 #include <QUdpSocket>
 #include <QTimer>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 
@@ -55,6 +56,7 @@ extern "C" {
 
 #include "common_utils.h"
 #include "CTPTransport.h"
+#include "FrameMetadata.h"
 
 class TcpClient : public QObject
 {
@@ -90,15 +92,34 @@ public:
 	/**
 	 * @brief sendpkt
 	 * send packet to client
-	 * @param pkt
+	 * @param pkt	packet with pts in the time base of the encoder context
+	 * @param meta	capture metadata of the frame, forwarded by the custom transport
 	 */
-	void sendpkt(AVPacket* pkt);
+	void sendpkt(AVPacket* pkt, const FrameMetadata& meta = FrameMetadata());
 	/**
 	 * @brief isInit
 	 * return true if transport ready
 	 * @return
 	 */
 	bool isInit() const;
+    /**
+     * @brief peer
+     * remote address of the client as "ip:port"
+     * @return
+     */
+    QString peer() const;
+    /**
+     * @brief bytesSent
+     * payload bytes sent to client since connection
+     * @return
+     */
+    qint64 bytesSent() const;
+    /**
+     * @brief packetsSent
+     * encoded frames sent to client since connection
+     * @return
+     */
+    qint64 packetsSent() const;
 
 signals:
 	void removeClient(TcpClient *);
@@ -131,6 +152,10 @@ private:
 
     qint64 m_frameCnt = 0;
 
+    QString m_peer;
+    std::atomic<qint64> m_bytesSent{0};
+    std::atomic<qint64> m_packetsSent{0};
+
 	ushort m_clientPort1 = 0;
 	ushort m_clientPort2 = 0;
 	ushort m_serverPort1 = 6000;
@@ -50,9 +50,17 @@ void encodeJpeg(int idthread, unsigned char* data, int width, int height, int ch
 	std::copy(d.data(), d.data() + d.size(), output.buffer.data());
 #else
     idthread;
-	jpeg_encoder enc;
-	enc.encode(data, width, height, channels, output.buffer, 30);
-	output.size = output.buffer.size();
+    //Strip encoders and the output buffer are reused from frame to frame
+    static thread_local jpeg_encoder enc;
+
+    size_t capacity = jpeg_encoder::maxEncodedSize(width, height);
+    if(output.buffer.size() < capacity)
+        output.buffer.resize(capacity);
+
+    uint size = uint(output.buffer.size());
+    if(!enc.encode(data, width, height, channels, output.buffer.data(), size, 30))
+        size = 0;
+    output.size = size;
 #endif
 }
 
@@ -68,6 +76,23 @@ void copyPartImage(unsigned char *input, size_t xoff, size_t yoff, size_t sizeEl
 
 /////////////////////////
 
+static void keep_buffer(void *, uint8_t *)
+{
+}
+
+int wrap_packet(AVPacket *pkt, uint8_t *data, int size)
+{
+    av_packet_unref(pkt);
+
+    pkt->buf = av_buffer_create(data, size, keep_buffer, nullptr, AV_BUFFER_FLAG_READONLY);
+    if(!pkt->buf)
+        return AVERROR(ENOMEM);
+
+    pkt->data = data;
+    pkt->size = size;
+    return 0;
+}
+
 int set_hwframe_ctx(AVCodecContext *ctx, AVBufferRef *hw_device_ctx, int width, int height, AVPixelFormat pixfmt)
 {
     AVBufferRef *hw_frames_ref;
@@ -55,4 +55,15 @@ void copyPartImage(unsigned char *input, size_t xoff, size_t yoff, size_t sizeEl
  */
 int set_hwframe_ctx(AVCodecContext *ctx, AVBufferRef *hw_device_ctx, int width, int height, AVPixelFormat pixfmt);
 
+/**
+ * @brief wrap_packet
+ * point pkt to our own buffer as a read only refcounted packet, without copying.
+ * ffmpeg never frees the buffer, it must stay unchanged until the packet is written
+ * @param pkt
+ * @param data
+ * @param size
+ * @return 0 or AVERROR
+ */
+int wrap_packet(AVPacket *pkt, uint8_t *data, int size);
+
 #endif // VUTILS_H
@@ -0,0 +1,318 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "ThreadPolicy.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QFile>
+#include <QDebug>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+namespace
+{
+
+struct RegisteredThread
+{
+    ThreadPolicy::ThreadInfo info;
+#ifdef _WIN32
+    DWORD id = 0;
+    HANDLE handle = nullptr;
+#else
+    pthread_t id;
+    clockid_t clock;
+#endif
+};
+
+QMutex gThreadsLock;
+QVector<RegisteredThread> gThreads;
+
+#ifdef _WIN32
+bool isCurrent(const RegisteredThread& t){return t.id == GetCurrentThreadId();}
+
+void releaseThread(RegisteredThread& t)
+{
+    if(t.handle)
+        CloseHandle(t.handle);
+    t.handle = nullptr;
+}
+
+bool cpuTime(const RegisteredThread& t, double& seconds)
+{
+    DWORD code = 0;
+    if(!GetExitCodeThread(t.handle, &code) || code != STILL_ACTIVE)
+        return false;
+
+    FILETIME creation, exit, kernel, user;
+    if(!GetThreadTimes(t.handle, &creation, &exit, &kernel, &user))
+        return false;
+
+    auto ticks = [](const FILETIME& ft){return (quint64(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;};
+    seconds = double(ticks(kernel) + ticks(user)) / 1e7;
+    return true;
+}
+#else
+bool isCurrent(const RegisteredThread& t){return pthread_equal(t.id, pthread_self()) != 0;}
+
+void releaseThread(RegisteredThread&){}
+
+bool cpuTime(const RegisteredThread& t, double& seconds)
+{
+    //Fails once the thread is gone
+    timespec ts;
+    if(clock_gettime(t.clock, &ts) != 0)
+        return false;
+
+    seconds = double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+    return true;
+}
+#endif
+
+void unregisterCurrentThread()
+{
+    QMutexLocker l(&gThreadsLock);
+    for(int i = 0; i < gThreads.size(); i++)
+    {
+        if(isCurrent(gThreads[i]))
+        {
+            releaseThread(gThreads[i]);
+            gThreads.remove(i);
+            return;
+        }
+    }
+}
+
+//Unregisters at thread exit, QThreads and adopted native threads alike
+struct ThreadGuard
+{
+    bool registered = false;
+    ~ThreadGuard()
+    {
+        if(registered)
+            unregisterCurrentThread();
+    }
+};
+
+void registerCurrentThread(AppSettings::ThreadRole role, bool realtime)
+{
+    RegisteredThread t;
+    t.info.role = role;
+    t.info.realtime = realtime;
+    t.info.name = QThread::currentThread()->objectName();
+    if(t.info.name.isEmpty())
+        t.info.name = QLatin1String(AppSettings::threadRoleName(role));
+
+#ifdef _WIN32
+    t.id = GetCurrentThreadId();
+    if(!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(),
+                        &t.handle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+        return;
+#else
+    t.id = pthread_self();
+    if(pthread_getcpuclockid(t.id, &t.clock) != 0)
+        return;
+#endif
+
+    QMutexLocker l(&gThreadsLock);
+    for(RegisteredThread& r : gThreads)
+    {
+        //Policy applied again, e.g. processing restarted
+        if(isCurrent(r))
+        {
+            releaseThread(r);
+            r = t;
+            return;
+        }
+    }
+    gThreads.append(t);
+
+    //One guard per thread however often the policy is applied
+    thread_local ThreadGuard guard;
+    guard.registered = true;
+}
+
+}
+
+void ThreadPolicy::apply(AppSettings::ThreadRole role, int core)
+{
+    if(role < 0 || role >= AppSettings::trCount)
+        return;
+
+    const AppSettings settings;
+    const AppSettings::ThreadSettings& policy = settings.threads[role];
+    const char* roleName = AppSettings::threadRoleName(role);
+
+    QVector<int> cores;
+    if(core >= 0)
+        cores.append(core);
+    else
+    {
+        cores = policy.cores;
+        if(policy.numaNode >= 0)
+        {
+            const QVector<int> node = numaCores(policy.numaNode);
+            if(node.isEmpty())
+                qDebug("NUMA node %d of %s threads not found", policy.numaNode, roleName);
+            else if(cores.isEmpty())
+                cores = node;
+            else
+            {
+                QVector<int> common;
+                for(int c : cores)
+                {
+                    if(node.contains(c))
+                        common.append(c);
+                }
+                cores = common.isEmpty() ? node : common;
+            }
+        }
+    }
+
+    if(!cores.isEmpty() && !setCurrentThreadAffinity(cores))
+        qDebug("Cannot set CPU affinity of %s thread", roleName);
+
+    bool realtime = false;
+    if(policy.realtime)
+    {
+        realtime = setCurrentThreadRealtime(policy.priority);
+        if(!realtime)
+            qDebug("Cannot enable real-time scheduling of %s thread (needs CAP_SYS_NICE or rtprio limit)", roleName);
+    }
+
+    registerCurrentThread(role, realtime);
+}
+
+QVector<ThreadPolicy::ThreadInfo> ThreadPolicy::threads()
+{
+    QVector<ThreadInfo> ret;
+
+    QMutexLocker l(&gThreadsLock);
+    for(int i = 0; i < gThreads.size();)
+    {
+        double seconds = 0;
+        if(!cpuTime(gThreads[i], seconds))
+        {
+            releaseThread(gThreads[i]);
+            gThreads.remove(i);
+            continue;
+        }
+
+        ThreadInfo info = gThreads[i].info;
+        info.cpuSeconds = seconds;
+        ret.append(info);
+        i++;
+    }
+    return ret;
+}
+
+QVector<int> ThreadPolicy::numaCores(int node)
+{
+    QVector<int> ret;
+    if(node < 0)
+        return ret;
+
+#ifdef _WIN32
+    ULONGLONG mask = 0;
+    if(!GetNumaNodeProcessorMask(UCHAR(node), &mask))
+        return ret;
+    for(int i = 0; i < 64; i++)
+    {
+        if(mask & (ULONGLONG(1) << i))
+            ret.append(i);
+    }
+#else
+    //Comma separated list of ranges, e.g. 0-7,16-23
+    QFile f(QStringLiteral("/sys/devices/system/node/node%1/cpulist").arg(node));
+    if(!f.open(QFile::ReadOnly))
+        return ret;
+
+    for(const QString& range : QString::fromLatin1(f.readAll()).trimmed().split(QChar(','), QString::SkipEmptyParts))
+    {
+        const QStringList bounds = range.split(QChar('-'));
+        const int first = bounds.first().toInt();
+        const int last = bounds.last().toInt();
+        for(int i = first; i <= last; i++)
+            ret.append(i);
+    }
+#endif
+    return ret;
+}
+
+bool ThreadPolicy::setCurrentThreadAffinity(const QVector<int>& cores)
+{
+    const int count = QThread::idealThreadCount();
+
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for(int core : cores)
+    {
+        if(core >= 0 && core < count && core < int(sizeof(mask) * 8))
+            mask |= DWORD_PTR(1) << core;
+        else
+            qDebug("CPU core %d is not available", core);
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool any = false;
+    for(int core : cores)
+    {
+        if(core >= 0 && core < count && core < CPU_SETSIZE)
+        {
+            CPU_SET(core, &set);
+            any = true;
+        }
+        else
+            qDebug("CPU core %d is not available", core);
+    }
+    return any && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+bool ThreadPolicy::setCurrentThreadRealtime(int priority)
+{
+#ifdef _WIN32
+    Q_UNUSED(priority)
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+    const int minPriority = sched_get_priority_min(SCHED_FIFO);
+    const int maxPriority = sched_get_priority_max(SCHED_FIFO);
+
+    sched_param param;
+    param.sched_priority = priority > 0 ? qBound(minPriority, priority, maxPriority) : (minPriority + maxPriority) / 2;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
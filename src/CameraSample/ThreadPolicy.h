@@ -0,0 +1,68 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <QString>
+#include <QVector>
+
+#include "AppSettings.h"
+
+///Applies the Threads/* settings to the calling thread: allowed CPU cores
+///or NUMA node and optional real-time scheduling. Threads that applied a
+///policy are registered, threads() reports their CPU time.
+///
+///Real-time threads must block while waiting for work, a busy loop under
+///SCHED_FIFO starves everything else on its cores.
+class ThreadPolicy
+{
+public:
+    struct ThreadInfo
+    {
+        QString name;
+        AppSettings::ThreadRole role = AppSettings::trCamera;
+        bool realtime = false;
+        double cpuSeconds = 0;
+    };
+
+    ///Apply the policy of role to the calling thread. Core >= 0 pins the
+    ///thread to this core instead of the configured ones.
+    static void apply(AppSettings::ThreadRole role, int core = -1);
+
+    ///Registered threads that are still running
+    static QVector<ThreadInfo> threads();
+
+    ///CPU cores of a NUMA node, empty if unknown
+    static QVector<int> numaCores(int node);
+
+    static bool setCurrentThreadAffinity(const QVector<int>& cores);
+    static bool setCurrentThreadRealtime(int priority);
+};
+
+#endif // THREADPOLICY_H
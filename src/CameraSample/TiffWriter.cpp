@@ -0,0 +1,176 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "TiffWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+unsigned typeSize(uint16_t type)
+{
+    switch(type)
+    {
+    case TiffIfd::tShort:
+        return 2;
+    case TiffIfd::tLong:
+        return 4;
+    case TiffIfd::tRational:
+    case TiffIfd::tSRational:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+void appendLE(QByteArray& ba, uint32_t v, int bytes)
+{
+    for(int i = 0; i < bytes; i++)
+        ba.append(char((v >> (8 * i)) & 0xFF));
+}
+}
+
+void TiffIfd::add(uint16_t tag, Type type, uint32_t count, const void* values)
+{
+    entry e;
+    e.tag = tag;
+    e.type = uint16_t(type);
+    e.count = count;
+    e.data = QByteArray(static_cast<const char*>(values), int(count * typeSize(type)));
+
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), tag,
+                               [](const entry& a, uint16_t t){return a.tag < t;});
+    if(it != mEntries.end() && it->tag == tag)
+        *it = e;
+    else
+        mEntries.insert(it, e);
+}
+
+void TiffIfd::addByte(uint16_t tag, const QVector<uint8_t>& values)
+{
+    add(tag, tByte, uint32_t(values.size()), values.constData());
+}
+
+void TiffIfd::addShort(uint16_t tag, const QVector<uint16_t>& values)
+{
+    add(tag, tShort, uint32_t(values.size()), values.constData());
+}
+
+void TiffIfd::addLong(uint16_t tag, const QVector<uint32_t>& values)
+{
+    add(tag, tLong, uint32_t(values.size()), values.constData());
+}
+
+void TiffIfd::addRational(uint16_t tag, const QVector<uint32_t>& values)
+{
+    add(tag, tRational, uint32_t(values.size() / 2), values.constData());
+}
+
+void TiffIfd::addSRational(uint16_t tag, const QVector<int32_t>& values)
+{
+    add(tag, tSRational, uint32_t(values.size() / 2), values.constData());
+}
+
+void TiffIfd::addAscii(uint16_t tag, const QByteArray& text)
+{
+    QByteArray s(text);
+    s.append('\0');
+    add(tag, tAscii, uint32_t(s.size()), s.constData());
+}
+
+uint32_t TiffIfd::size() const
+{
+    uint32_t ret = 2 + 12 * uint32_t(mEntries.size()) + 4;
+    for(const entry& e : mEntries)
+    {
+        if(e.data.size() > 4)
+            ret += uint32_t(e.data.size() + (e.data.size() & 1));
+    }
+    return ret;
+}
+
+QByteArray TiffIfd::serialize(uint32_t offset, uint32_t next) const
+{
+    QByteArray dir;
+    QByteArray values;
+    uint32_t valuesOffset = offset + 2 + 12 * uint32_t(mEntries.size()) + 4;
+
+    appendLE(dir, uint32_t(mEntries.size()), 2);
+    for(const entry& e : mEntries)
+    {
+        appendLE(dir, e.tag, 2);
+        appendLE(dir, e.type, 2);
+        appendLE(dir, e.count, 4);
+        if(e.data.size() <= 4)
+        {
+            //Inline values are left justified
+            QByteArray v(e.data);
+            v.append(QByteArray(4 - v.size(), '\0'));
+            dir.append(v);
+        }
+        else
+        {
+            //Out of line values start on a word boundary
+            appendLE(dir, valuesOffset + uint32_t(values.size()), 4);
+            values.append(e.data);
+            if(e.data.size() & 1)
+                values.append('\0');
+        }
+    }
+    appendLE(dir, next, 4);
+    return dir + values;
+}
+
+QByteArray tiffHeader(unsigned width, unsigned height, unsigned channels)
+{
+    const uint32_t ifdOffset = 8;
+    const uint32_t dataSize = uint32_t(width) * height * channels;
+
+    TiffIfd ifd;
+    ifd.addLong(256, {uint32_t(width)});                      //ImageWidth
+    ifd.addLong(257, {uint32_t(height)});                     //ImageLength
+    ifd.addShort(258, QVector<uint16_t>(int(channels), 8));   //BitsPerSample
+    ifd.addShort(259, {1});                                   //Compression: none
+    ifd.addShort(262, {uint16_t(channels == 1 ? 1 : 2)});     //Photometric: BlackIsZero, RGB
+    ifd.addLong(273, {0});                                    //StripOffsets, set below
+    ifd.addShort(277, {uint16_t(channels)});                  //SamplesPerPixel
+    ifd.addLong(278, {uint32_t(height)});                     //RowsPerStrip
+    ifd.addLong(279, {dataSize});                             //StripByteCounts
+    ifd.addRational(282, {72, 1});                            //XResolution
+    ifd.addRational(283, {72, 1});                            //YResolution
+    ifd.addShort(284, {1});                                   //PlanarConfiguration: chunky
+    ifd.addShort(296, {2});                                   //ResolutionUnit: inch
+    //Single strip right after the header, the value is inline so the size stays
+    ifd.addLong(273, {ifdOffset + ifd.size()});
+
+    QByteArray ret("II*\0", 4);
+    appendLE(ret, ifdOffset, 4);
+    ret.append(ifd.serialize(ifdOffset));
+    return ret;
+}
@@ -0,0 +1,82 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef TIFFWRITER_H
+#define TIFFWRITER_H
+
+#include <QByteArray>
+#include <QVector>
+#include <cstdint>
+
+///TIFF image file directory builder, little endian ("II") files only.
+///Entries are kept sorted by tag, adding a tag again replaces its value.
+class TiffIfd
+{
+public:
+    enum Type
+    {
+        tByte = 1,
+        tAscii = 2,
+        tShort = 3,
+        tLong = 4,
+        tRational = 5,
+        tUndefined = 7,
+        tSRational = 10
+    };
+
+    ///count values of type in host (little endian) byte order
+    void add(uint16_t tag, Type type, uint32_t count, const void* values);
+    void addByte(uint16_t tag, const QVector<uint8_t>& values);
+    void addShort(uint16_t tag, const QVector<uint16_t>& values);
+    void addLong(uint16_t tag, const QVector<uint32_t>& values);
+    ///Numerator, denominator pairs
+    void addRational(uint16_t tag, const QVector<uint32_t>& values);
+    void addSRational(uint16_t tag, const QVector<int32_t>& values);
+    void addAscii(uint16_t tag, const QByteArray& text);
+
+    ///Bytes of the directory and its out of line values
+    uint32_t size() const;
+    ///Directory placed at file offset, next is the offset of the following IFD or 0
+    QByteArray serialize(uint32_t offset, uint32_t next = 0) const;
+
+private:
+    struct entry
+    {
+        uint16_t tag;
+        uint16_t type;
+        uint32_t count;
+        QByteArray data;
+    };
+    QVector<entry> mEntries;
+};
+
+///File header, IFD and tag values of an uncompressed 8 bit gray or RGB
+///TIFF. Image rows of width * channels bytes follow it in the file.
+QByteArray tiffHeader(unsigned width, unsigned height, unsigned channels);
+
+#endif // TIFFWRITER_H
@@ -0,0 +1,205 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#include "Tracer.h"
+
+#include <chrono>
+
+#include <QFile>
+#include <QThread>
+
+namespace
+{
+const std::chrono::steady_clock::time_point cStartTime = std::chrono::steady_clock::now();
+std::atomic<uint32_t> gNextThreadId(1);
+
+void appendString(QByteArray& out, const char* str)
+{
+    out += '"';
+    for(const char* p = str; *p; p++)
+    {
+        if(*p == '"' || *p == '\\')
+            out += '\\';
+        if(uchar(*p) >= 0x20)
+            out += *p;
+    }
+    out += '"';
+}
+}
+
+std::atomic<bool> Tracer::sEnabled(false);
+
+Tracer::Tracer() :
+    mEvents(new Event[Capacity]),
+    mHead(0)
+{
+    for(int i = 0; i < Capacity; i++)
+        mEvents[i].seq.store(0, std::memory_order_relaxed);
+    setThreadName(GpuTrackId, QStringLiteral("GPU"));
+}
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::setEnabled(bool on)
+{
+    instance();
+    sEnabled.store(on, std::memory_order_relaxed);
+}
+
+void Tracer::clear()
+{
+    for(int i = 0; i < Capacity; i++)
+        mEvents[i].seq.store(0, std::memory_order_relaxed);
+}
+
+int64_t Tracer::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - cStartTime).count();
+}
+
+uint32_t Tracer::currentThreadId()
+{
+    static thread_local uint32_t id = 0;
+    if(id == 0)
+    {
+        id = gNextThreadId.fetch_add(1, std::memory_order_relaxed);
+        QString name = QThread::currentThread() ? QThread::currentThread()->objectName() : QString();
+        if(name.isEmpty())
+            name = QStringLiteral("Thread %1").arg(id);
+        instance().setThreadName(id, name);
+    }
+    return id;
+}
+
+void Tracer::complete(const char* cat, const char* name, int64_t startUs, int64_t durUs, int64_t frame, uint32_t tid)
+{
+    const uint64_t idx = mHead.fetch_add(1, std::memory_order_relaxed);
+    Event& e = mEvents[idx % Capacity];
+
+    //Seqlock: odd while writing, reader skips torn slots
+    e.seq.store(2 * idx + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.cat.store(cat, std::memory_order_relaxed);
+    e.name.store(name, std::memory_order_relaxed);
+    e.ts.store(startUs, std::memory_order_relaxed);
+    e.dur.store(durUs, std::memory_order_relaxed);
+    e.frame.store(frame, std::memory_order_relaxed);
+    e.tid.store(tid, std::memory_order_relaxed);
+    e.seq.store(2 * idx + 2, std::memory_order_release);
+}
+
+void Tracer::setThreadName(uint32_t tid, const QString& name)
+{
+    std::lock_guard<std::mutex> l(mNamesLock);
+    for(auto& item : mThreadNames)
+    {
+        if(item.first == tid)
+        {
+            item.second = name;
+            return;
+        }
+    }
+    mThreadNames.emplace_back(tid, name);
+}
+
+QByteArray Tracer::toChromeJson() const
+{
+    QByteArray out;
+    out.reserve(Capacity * 100);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> l(mNamesLock);
+        for(const auto& item : mThreadNames)
+        {
+            if(!first)
+                out += ',';
+            first = false;
+            out += "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+            out += QByteArray::number(item.first);
+            out += ",\"args\":{\"name\":";
+            appendString(out, item.second.toUtf8().constData());
+            out += "}}";
+        }
+    }
+
+    for(int i = 0; i < Capacity; i++)
+    {
+        const Event& e = mEvents[i];
+        const uint64_t seq = e.seq.load(std::memory_order_acquire);
+        if(seq == 0 || (seq & 1))
+            continue;
+
+        const char* cat = e.cat.load(std::memory_order_relaxed);
+        const char* name = e.name.load(std::memory_order_relaxed);
+        const int64_t ts = e.ts.load(std::memory_order_relaxed);
+        const int64_t dur = e.dur.load(std::memory_order_relaxed);
+        const int64_t frame = e.frame.load(std::memory_order_relaxed);
+        const uint32_t tid = e.tid.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(e.seq.load(std::memory_order_relaxed) != seq)
+            continue;
+
+        if(!first)
+            out += ',';
+        first = false;
+        out += "\n{\"ph\":\"X\",\"pid\":1,\"tid\":";
+        out += QByteArray::number(tid);
+        out += ",\"cat\":";
+        appendString(out, cat);
+        out += ",\"name\":";
+        appendString(out, name);
+        out += ",\"ts\":";
+        out += QByteArray::number(qlonglong(ts));
+        out += ",\"dur\":";
+        out += QByteArray::number(qlonglong(dur));
+        if(frame >= 0)
+        {
+            out += ",\"args\":{\"frame\":";
+            out += QByteArray::number(qlonglong(frame));
+            out += '}';
+        }
+        out += '}';
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool Tracer::save(const QString& fileName) const
+{
+    QFile f(fileName);
+    if(!f.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+    return f.write(toChromeJson()) >= 0;
+}
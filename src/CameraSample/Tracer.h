@@ -0,0 +1,134 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QString>
+#include <QByteArray>
+
+///Low overhead timeline tracer. Spans are stored in a fixed size ring buffer
+///and can be dumped as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+///Names and categories must be string literals (pointers are stored as is).
+class Tracer
+{
+public:
+    static const int Capacity = 1 << 16;
+
+    ///Pseudo thread id for GPU stream spans
+    static const uint32_t GpuTrackId = 0xFFFF;
+
+    static Tracer& instance();
+
+    static bool enabled() {return sEnabled.load(std::memory_order_relaxed);}
+    void setEnabled(bool on);
+    void clear();
+
+    ///Microseconds since tracer creation
+    static int64_t nowUs();
+    ///Small sequential id of the calling thread
+    static uint32_t currentThreadId();
+
+    ///Add complete span. Thread safe, never blocks.
+    void complete(const char* cat, const char* name, int64_t startUs, int64_t durUs,
+                  int64_t frame = -1, uint32_t tid = currentThreadId());
+
+    void setThreadName(uint32_t tid, const QString& name);
+
+    QByteArray toChromeJson() const;
+    bool save(const QString& fileName) const;
+
+private:
+    struct Event
+    {
+        std::atomic<uint64_t>    seq;
+        std::atomic<const char*> cat;
+        std::atomic<const char*> name;
+        std::atomic<int64_t>     ts;
+        std::atomic<int64_t>     dur;
+        std::atomic<int64_t>     frame;
+        std::atomic<uint32_t>    tid;
+    };
+
+    Tracer();
+
+    static std::atomic<bool> sEnabled;
+
+    std::unique_ptr<Event[]> mEvents;
+    std::atomic<uint64_t>    mHead;
+
+    mutable std::mutex       mNamesLock;
+    std::vector<std::pair<uint32_t, QString>> mThreadNames;
+};
+
+///Records span from construction to destruction when tracing is enabled
+class TraceScope
+{
+public:
+    TraceScope(const char* cat, const char* name, int64_t frame = -1) :
+        mCat(cat),
+        mName(name),
+        mFrame(frame),
+        mStart(Tracer::enabled() ? Tracer::nowUs() : -1)
+    {
+    }
+    ~TraceScope()
+    {
+        finish();
+    }
+    ///Close span before the end of the scope
+    void finish()
+    {
+        if(mStart >= 0)
+            Tracer::instance().complete(mCat, mName, mStart, Tracer::nowUs() - mStart, mFrame);
+        mStart = -1;
+    }
+    void setFrame(int64_t frame){mFrame = frame;}
+
+private:
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    const char* mCat;
+    const char* mName;
+    int64_t     mFrame;
+    int64_t     mStart;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(cat, name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(cat, name)
+#define TRACE_SCOPE_FRAME(cat, name, frame) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(cat, name, frame)
+
+#endif // TRACER_H
@@ -34,6 +34,12 @@ CameraSetupWidget::CameraSetupWidget(QWidget *parent) :
     ui(new Ui::CameraSetupWidget)
 {
     ui->setupUi(this);
+
+    for(int factor : {1, 2, 4})
+    {
+        ui->cboBinning->addItem(QStringLiteral("%1x%1").arg(factor), factor);
+        ui->cboDecimation->addItem(QStringLiteral("%1x%1").arg(factor), factor);
+    }
 }
 
 CameraSetupWidget::~CameraSetupWidget()
@@ -49,16 +55,20 @@ void CameraSetupWidget::setCamera(GPUCameraBase* cameraPtr)
     {
         ui->spnFrameRate->setEnabled(false);
         ui->spnExposureTime->setEnabled(false);
+        enableRoi(false);
     }
     else if(mCameraPtr->state() == GPUCameraBase::cstClosed)
     {
         ui->spnFrameRate->setEnabled(false);
         ui->spnExposureTime->setEnabled(false);
+        enableRoi(false);
     }
     else
     {
         ui->spnFrameRate->setEnabled(true);
         ui->spnExposureTime->setEnabled(true);
+        enableRoi(true);
+        updateRoi();
 
         connect(mCameraPtr, SIGNAL(stateChanged(GPUCameraBase::cmrCameraState)),
                 this, SLOT(onCameraStateChanged(GPUCameraBase::cmrCameraState)));
@@ -93,6 +103,51 @@ void CameraSetupWidget::setExposureCamera(float value)
 {
     ui->spnExposureTime->setValue(value);
 }
+
+GPUCameraBase::cmrRoi CameraSetupWidget::roi() const
+{
+    GPUCameraBase::cmrRoi roi;
+    roi.offsetX = ui->spnOffsetX->value();
+    roi.offsetY = ui->spnOffsetY->value();
+    roi.width = ui->spnRoiWidth->value();
+    roi.height = ui->spnRoiHeight->value();
+    roi.binning = ui->cboBinning->currentData().toInt();
+    roi.decimation = ui->cboDecimation->currentData().toInt();
+    return roi;
+}
+
+void CameraSetupWidget::updateRoi()
+{
+    if(mCameraPtr == nullptr)
+        return;
+
+    const GPUCameraBase::cmrRoi roi = mCameraPtr->roi();
+    ui->spnOffsetX->setValue(roi.offsetX);
+    ui->spnOffsetY->setValue(roi.offsetY);
+    ui->spnRoiWidth->setValue(roi.width);
+    ui->spnRoiHeight->setValue(roi.height);
+    ui->cboBinning->setCurrentIndex(qMax(0, ui->cboBinning->findData(roi.binning)));
+    ui->cboDecimation->setCurrentIndex(qMax(0, ui->cboDecimation->findData(roi.decimation)));
+}
+
+void CameraSetupWidget::enableRoi(bool enable)
+{
+    ui->spnOffsetX->setEnabled(enable);
+    ui->spnOffsetY->setEnabled(enable);
+    ui->spnRoiWidth->setEnabled(enable);
+    ui->spnRoiHeight->setEnabled(enable);
+    ui->cboBinning->setEnabled(enable);
+    ui->cboDecimation->setEnabled(enable);
+    ui->btnApplyRoi->setEnabled(enable);
+}
+
+void CameraSetupWidget::on_btnApplyRoi_clicked()
+{
+    if(mCameraPtr == nullptr)
+        return;
+
+    emit roiRequested();
+}
 void CameraSetupWidget::on_spnFrameRate_valueChanged(double arg1)
 {
     if(mCameraPtr == nullptr)
@@ -135,11 +190,13 @@ void CameraSetupWidget::onCameraStateChanged(GPUCameraBase::cmrCameraState newSt
     {
         ui->spnFrameRate->setEnabled(false);
         ui->spnExposureTime->setEnabled(false);
+        enableRoi(false);
     }
     else
     {
         ui->spnFrameRate->setEnabled(true);
         ui->spnExposureTime->setEnabled(true);
+        enableRoi(true);
     }
 //    else if(newState == CameraBase::cstStopped)
 //    {
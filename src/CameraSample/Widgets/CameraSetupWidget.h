@@ -48,11 +48,23 @@ public:
 
     void setExposureCamera(float value);
 
+    ///Readout window entered by the user
+    GPUCameraBase::cmrRoi roi() const;
+    ///Show the readout window set on the camera
+    void updateRoi();
+
+signals:
+    ///User asked to apply roi() to the camera
+    void roiRequested();
+
 private slots:
     void on_spnFrameRate_valueChanged(double arg1);
     void on_spnExposureTime_valueChanged(int arg1);
     void onCameraStateChanged(GPUCameraBase::cmrCameraState newState);
+    void on_btnApplyRoi_clicked();
 private:
+    void enableRoi(bool enable);
+
     Ui::CameraSetupWidget *ui;
     GPUCameraBase* mCameraPtr = nullptr;
 
@@ -2,6 +2,8 @@
 
 #include "common_utils.h"
 #include "vutils.h"
+#include "Tracer.h"
+#include "ThreadPolicy.h"
 
 #include <QFileInfo>
 
@@ -20,16 +22,23 @@ extern "C"{
 
 AVFileWriter::AVFileWriter(QObject *parent) : AsyncWriter(-1, parent)
 {
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
     avcodec_register_all();
     av_register_all();
+#endif
     avformat_network_init();
     //av_log_set_level(AV_LOG_TRACE);
+
+    mFrame = av_frame_alloc();
+    mPacket = av_packet_alloc();
 }
 
 
 AVFileWriter::~AVFileWriter()
 {
     close();
+    av_frame_free(&mFrame);
+    av_packet_free(&mPacket);
 }
 
 void AVFileWriter::setEncodeNv12Fun(TEncodeFun fun)
@@ -136,11 +145,9 @@ bool AVFileWriter::open(int w, int h, int bitrate, int fps, bool isHEVC, const Q
     mStream = avformat_new_stream(mFmt, mCodec);
     mStream->id = mFmt->nb_streams - 1;
 
-    mStream->time_base = {1, mFps};
+    mStream->time_base = {1, 1000};
 
-    mCtx = mStream->codec;
-
-    //mCtx = avcodec_alloc_context3(mCodec);
+    mCtx = avcodec_alloc_context3(mCodec);
 
     mCtx->bit_rate = mBitrate;
 
@@ -150,7 +157,7 @@ bool AVFileWriter::open(int w, int h, int bitrate, int fps, bool isHEVC, const Q
     }
 
     //frames per second
-    mCtx->time_base = {1, mFps};         // for test. maybe do not affect
+    mCtx->time_base = {1, 1000};         // pts in ms from capture time
     mCtx->framerate = {mFps, 1};         // for test. maybe do not affect
     mCtx->gop_size = GOP_SIZE;
     mCtx->max_b_frames = GOP_SIZE;
@@ -159,8 +166,6 @@ bool AVFileWriter::open(int w, int h, int bitrate, int fps, bool isHEVC, const Q
 #else
     mCtx->pix_fmt = AV_PIX_FMT_CUDA;
 
-    avcodec_parameters_from_context(mStream->codecpar, mCtx);
-
     ret = av_hwdevice_ctx_create(&mHwDeviceCtx, AV_HWDEVICE_TYPE_CUDA, nullptr, nullptr, 0);
 
     ret = set_hwframe_ctx(mCtx, mHwDeviceCtx, mWidth, mHeight, mPixFmt);
@@ -200,6 +205,9 @@ bool AVFileWriter::open(int w, int h, int bitrate, int fps, bool isHEVC, const Q
         return false;
     }
 
+    //Stream parameters come from the opened encoder, extradata included
+    avcodec_parameters_from_context(mStream->codecpar, mCtx);
+
     res = avformat_write_header(mFmt, nullptr);
 
     mDelayFps = 1000 / mFps;
@@ -211,6 +219,9 @@ bool AVFileWriter::open(int w, int h, int bitrate, int fps, bool isHEVC, const Q
     mIsInitialized = true;
     mProcessed = 0;
     mDropped = 0;
+    mFramesProcessed = 0;
+    mFirstCaptureUs = 0;
+    mLastPts = -1;
 
     return true;
 }
@@ -245,16 +256,9 @@ void AVFileWriter::close()
         }
         if(mCtx)
         {
-            avcodec_close(mCtx);
+            avcodec_free_context(&mCtx);
             avio_close(mFmt->pb);
             mFmt->pb = nullptr;
-            /* free the streams */
-            for(uint i = 0; i < mFmt->nb_streams; i++) {
-                avcodec_free_context(&mFmt->streams[i]->codec);
-                mFmt->streams[i]->codec = nullptr;
-                av_freep(&mFmt->streams[i]);
-            }
-            mCtx = nullptr;
         }
         if(mFmt)
         {
@@ -281,11 +285,12 @@ void AVFileWriter::processTask(FileWriterTask *task)
         mFileName = task->fileName;
 
     if(mFrameBuffers.size() < mMaxFrameBuffers)
-        mFrameBuffers.push_back(FrameBuffer(task->data, task->size));
+        mFrameBuffers.push_back(FrameBuffer(task->data, task->size, task->meta));
 
     if(!mFrameThread.get()){
         mFrameThread.reset(new std::thread([this](){
             QThread::currentThread()->setObjectName("FrameThread");
+            ThreadPolicy::apply(AppSettings::trWriter);
             doEncodeFrame();
         }));
     }
@@ -298,30 +303,48 @@ void AVFileWriter::doEncodeFrame()
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }else{
             mFrameMutex.lock();
-            //FrameBuffer fb = mFrameBuffers.front();
+            FrameBuffer fb = mFrameBuffers.front();
             mFrameBuffers.pop_front();
             mFrameMutex.unlock();
 
-            while(!mDone && addInternalFrame()){};
+            addInternalFrame(fb.meta);
         }
     }
 }
 
-bool AVFileWriter::addInternalFrame()
+int64_t AVFileWriter::nextPts(const FrameMetadata &meta)
 {
+    int64_t pts = 0;
+    if(meta.hostTimestampUs == 0){
+        pts = mLastPts + 1000 / mFps;
+    }else{
+        if(mFirstCaptureUs == 0)
+            mFirstCaptureUs = meta.hostTimestampUs;
+        pts = (meta.hostTimestampUs - mFirstCaptureUs) / 1000;
+    }
+    if(pts <= mLastPts)
+        pts = mLastPts + 1;
+    mLastPts = pts;
+    return pts;
+}
+
+bool AVFileWriter::addInternalFrame(const FrameMetadata &meta)
+{
+    TRACE_SCOPE_FRAME("writer", "encode frame", int64_t(meta.frameId));
     auto starttime = getNow();
 
     if(!mIsInitialized)
         return false;
     int ret = 0;
+    const int64_t pts = nextPts(meta);
 
     if(((mCodecId == AV_CODEC_ID_H264 || mCodecId == AV_CODEC_ID_INDEO3 || mCodecId == AV_CODEC_ID_HEVC)))
     {
-        AVFrame* frm = av_frame_alloc();
+        AVFrame* frm = mFrame;
         frm->width = mWidth;
         frm->height = mHeight;
         frm->format = mPixFmt;
-        frm->pts = mFramesProcessed;
+        frm->pts = pts;
         //Set frame->data pointers manually
         if(mChannels == 1/* && rgbPtr != nullptr*/)
         {
@@ -418,7 +441,7 @@ bool AVFileWriter::addInternalFrame()
 #endif
         }
 
-        av_frame_free(&frm);
+        av_frame_unref(frm);
     }
 
     double duration = getDuration(starttime);
@@ -427,7 +450,7 @@ bool AVFileWriter::addInternalFrame()
 
     if(ret == 0)
     {
-        mFramesProcessed += 1000/mFps;
+        mFramesProcessed++;
         return true;
     }
 
@@ -439,19 +462,14 @@ void AVFileWriter::encodeWriteFrame(uint8_t *buf, int width, int height)
 {
     if(mV4L2Encoder.data()){
         if(mV4L2Encoder->getEncodedData(mUserBuffer)){
-            if(!mUserBuffer.empty()){
-                AVPacket enc_pkt;
-                enc_pkt.data = nullptr;
-                enc_pkt.size = 0;
-                av_init_packet(&enc_pkt);
-
-                av_new_packet(&enc_pkt, static_cast<int>(mUserBuffer.size()));
-                enc_pkt.pts = enc_pkt.dts = mFramesProcessed;
-                enc_pkt.flags = AV_PKT_FLAG_KEY;
-                std::copy(mUserBuffer.data(),mUserBuffer.data() + mUserBuffer.size(), enc_pkt.data);
-
-                sendPkt(&enc_pkt);
-                av_packet_unref(&enc_pkt);
+            //Single stream muxing writes the packet out before returning, no copy is needed
+            if(!mUserBuffer.empty() &&
+               wrap_packet(mPacket, mUserBuffer.data(), static_cast<int>(mUserBuffer.size())) == 0){
+                mPacket->pts = mPacket->dts = mLastPts;
+                mPacket->flags = AV_PKT_FLAG_KEY;
+
+                sendPkt(mPacket);
+                av_packet_unref(mPacket);
             }
         }
     }
@@ -460,24 +478,16 @@ void AVFileWriter::encodeWriteFrame(uint8_t *buf, int width, int height)
 
 void AVFileWriter::encodeWriteFrame(AVFrame *frame, int* pgot)
 {
-    int ret = 0;
-    AVPacket enc_pkt;
-    enc_pkt.data = nullptr;
-    enc_pkt.size = 0;
-
-    av_init_packet(&enc_pkt);
-
-    ret = avcodec_send_frame(mCtx, frame);
+    int ret = avcodec_send_frame(mCtx, frame);
     while(ret >= 0){
-        ret = avcodec_receive_packet(mCtx, &enc_pkt);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+        ret = avcodec_receive_packet(mCtx, mPacket);
+        if(ret < 0)
             return;
-        enc_pkt.pts = frame->pts;
         if(pgot){
             *pgot = 1;
         }
-        sendPkt(&enc_pkt);
-        av_packet_unref(&enc_pkt);
+        sendPkt(mPacket);
+        av_packet_unref(mPacket);
     }
 }
 
@@ -570,5 +580,8 @@ void AVFileWriter::restartAsync()
 
 void AVFileWriter::write_pkt(AVPacket *enc_pkt, int )
 {
+    TRACE_SCOPE("writer", "write packet");
+    // muxer may change the stream time base in avformat_write_header
+    av_packet_rescale_ts(enc_pkt, mCtx->time_base, mStream->time_base);
     av_interleaved_write_frame(mFmt, enc_pkt);
 }
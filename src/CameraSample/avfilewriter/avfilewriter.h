@@ -87,6 +87,10 @@ private:
     QByteArray mEncoderBuffer;
     QElapsedTimer mTimerCtrlFps;
     int64_t mFramesProcessed = 0;
+    /// capture time of the first frame and last pts, pts are in milliseconds
+    int64_t mFirstCaptureUs = 0;
+    int64_t mLastPts = -1;
+    int64_t nextPts(const FrameMetadata& meta);
     int mChannels = 3;
     bool mIsInitialized = 0;
     TEncodeFun mNv12Encode;
@@ -102,6 +106,9 @@ private:
     AVCodecContext* mCtx = nullptr;
     AVCodec*        mCodec = nullptr;
     AVBufferRef*    mHwDeviceCtx = NULL;
+    /// reused for every frame, hold no references between frames
+    AVFrame*        mFrame = nullptr;
+    AVPacket*       mPacket = nullptr;
 
     std::shared_ptr< std::thread > mFrameThread;
 //    std::shared_ptr< std::thread > mPacketThread;
@@ -114,8 +121,9 @@ private:
 
     struct FrameBuffer{
         QByteArray buffer;
+        FrameMetadata meta;
         FrameBuffer(){}
-        FrameBuffer(uchar *buf, int size){
+        FrameBuffer(uchar *buf, int size, const FrameMetadata& m): meta(m){
             Q_UNUSED(buf)
             Q_UNUSED(size)
 //            if(size > 0){
@@ -137,7 +145,7 @@ private:
     //QScopedPointer<TSEncoder> mFileWriter;
 
     void doEncodeFrame();
-    bool addInternalFrame();
+    bool addInternalFrame(const FrameMetadata& meta);
 
     //void RGB2Yuv420p(unsigned char *destination, unsigned char *rgba, int width, int height);
     //void Gray2Yuv420p(unsigned char *destination, unsigned char *rgba, int width, int height);
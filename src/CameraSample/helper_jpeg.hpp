@@ -63,6 +63,14 @@ fastStatus_t DLL fastJfifStoreToFile(
 	fastJfifInfo_t *jfifInfo
 );
 
+//Markers from SOI to SOS without the entropy coded data
+fastStatus_t DLL fastJfifHeaderStoreToMemory(
+	unsigned char *outputStream,
+	unsigned *outputStreamSize,
+
+	fastJfifInfo_t *jfifInfo
+);
+
 fastStatus_t DLL fastJfifStoreToMemory(
 	unsigned char *outputStream,
 	unsigned *outputStreamSize,
@@ -282,6 +282,43 @@ fastStatus_t fastJfifStoreToFile(
     return FAST_OK;
 }
 
+fastStatus_t fastJfifHeaderStoreToMemory(
+    unsigned char *outputStream,
+	unsigned *outputStreamSize,
+
+    fastJfifInfo_t *jfifInfo
+){
+    try {
+        Bytestream header;
+        AppendHeader(
+            header,
+
+            uint16_t(jfifInfo->height),
+            uint16_t(jfifInfo->width),
+			jfifInfo->bitsPerChannel,
+
+            &jfifInfo->quantState,
+            &jfifInfo->huffmanState,
+            &jfifInfo->scanMap,
+
+            jfifInfo->jpegFmt,
+            uint16_t(jfifInfo->restartInterval),
+			jfifInfo->exifSections,
+			jfifInfo->exifSectionsCount
+        );
+
+		if(header.GetSize() > *outputStreamSize)
+			return FAST_INSUFFICIENT_HOST_MEMORY;
+
+		memcpy(outputStream, header.GetBase(), header.GetSize());
+        *outputStreamSize = static_cast<unsigned>(header.GetSize());
+    }catch(...){
+        return FAST_INTERNAL_ERROR;
+    }
+
+    return FAST_OK;
+}
+
 fastStatus_t fastJfifStoreToMemory(
     unsigned char *outputStream,
 	unsigned *outputStreamSize,
@@ -31,19 +31,75 @@
 #include <QStyleFactory>
 #include <QMessageBox>
 #include "version.h"
+#include "RawUnpack.h"
+#include "JpegEncoder.h"
+#include "BatchProcessor.h"
+#include "GenICamBench.h"
+
+#include <cstdio>
+#include <cstring>
+
+///Prints CPU unpack throughput for every packed raw layout
+static int benchUnpack()
+{
+    const unsigned width = 4096;
+    const unsigned height = 3072;
+    printf("Raw unpack, %ux%u frame\n", width, height);
+    for(const auto& res : benchmarkRawUnpack(width, height, 20))
+        printf("%-16s %8.1f Mpix/s %8.1f MB/s\n", rawPackingName(res.packing), res.mpixPerSec, res.mbytesPerSec);
+    return 0;
+}
+
+///Prints strip parallel JPEG encoder throughput against one strip
+static int benchJpeg()
+{
+    const int width = 1920;
+    const int height = 1080;
+    printf("JPEG encoder, %dx%d RGB frame, quality 90\n", width, height);
+    for(const auto& res : benchmarkJpegEncoder(width, height, 90, 20))
+        printf("%5d rows x %3d strips %8.1f Mpix/s %8.0f bytes\n", res.stripRows, res.strips, res.mpixPerSec, res.bytesPerFrame);
+    return 0;
+}
+
+static void setApplicationInfo()
+{
+    QCoreApplication::setOrganizationName(QStringLiteral(APP_ORGANIZATION_NAME));
+    QCoreApplication::setOrganizationDomain(QStringLiteral(APP_ORGANIZATION_DOMAIN));
+    QCoreApplication::setApplicationName(QStringLiteral(MAIN_APPLICATION_NAME));
+    QCoreApplication::setApplicationVersion(QStringLiteral(APP_VERSION_STRING));
+}
 
 int main(int argc, char *argv[])
 {
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--bench-unpack") == 0)
+            return benchUnpack();
+        if(strcmp(argv[i], "--bench-jpeg") == 0)
+            return benchJpeg();
+        if(strcmp(argv[i], "--batch") == 0)
+        {
+            QCoreApplication a(argc, argv);
+            setApplicationInfo();
+            return BatchProcessor::exec(QCoreApplication::arguments());
+        }
+#ifdef SUPPORT_GENICAM
+        if(strcmp(argv[i], "--genicam-bench") == 0)
+        {
+            QCoreApplication a(argc, argv);
+            setApplicationInfo();
+            return GenICamBench::exec(QCoreApplication::arguments());
+        }
+#endif
+    }
+
 #if QT_VERSION >= 0x050600
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
 
     QApplication a(argc, argv);
 
-    QCoreApplication::setOrganizationName(QStringLiteral(APP_ORGANIZATION_NAME));
-    QCoreApplication::setOrganizationDomain(QStringLiteral(APP_ORGANIZATION_DOMAIN));
-    QCoreApplication::setApplicationName(QStringLiteral(MAIN_APPLICATION_NAME));
-    QCoreApplication::setApplicationVersion(QStringLiteral(APP_VERSION_STRING));
+    setApplicationInfo();
     QCoreApplication::addLibraryPath(QStringLiteral("."));
     QCoreApplication::addLibraryPath(QCoreApplication::applicationDirPath());
 
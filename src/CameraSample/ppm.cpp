@@ -12,109 +12,260 @@ FASTVIDEO SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
 */
 #include "ppm.h"
 #include "helper_image/helper_common.h"
+#include "RawUnpack.h"
 #include <cctype>
 #include <fstream>
 #include <cstring>
-#include <cmath>
+#include <vector>
+
+#include <QFile>
+#include <QByteArray>
+
+//The AVX2 swap is built for every x86 target and picked at run time
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define PPM_USE_AVX2
+#if defined(_MSC_VER)
+#define PPM_AVX2_TARGET
+#else
+#define PPM_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define PPM_USE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PPM_USE_NEON
+#endif
+
+namespace
+{
+struct PNMHeader
+{
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned maxval = 0;
+    unsigned channels = 0;
+    //Fastvideo P15/P16 files store 16 bit samples in little endian order
+    bool fvHeader = false;
+    size_t dataOffset = 0;
+};
+
+//Skip whitespaces and comments
+size_t skipSpaces(const unsigned char* p, size_t pos, size_t size)
+{
+    while(pos < size)
+    {
+        if(p[pos] == '#')
+        {
+            while(pos < size && p[pos] != '\n' && p[pos] != '\r')
+                pos++;
+        }
+        else if(isspace(p[pos]))
+            pos++;
+        else
+            break;
+    }
+    return pos;
+}
 
-int loadPPM(const char *file, void** data, BaseAllocator *alloc, unsigned int &width, unsigned &wPitch, unsigned int &height, unsigned &bitsPerPixel, unsigned &channels) {
-    FILE *fp = nullptr;
+bool readNumber(const unsigned char* p, size_t& pos, size_t size, unsigned& val)
+{
+    pos = skipSpaces(p, pos, size);
+    if(pos >= size || !isdigit(p[pos]))
+        return false;
+
+    unsigned long long v = 0;
+    while(pos < size && isdigit(p[pos]))
+    {
+        v = v * 10 + (p[pos] - '0');
+        if(v > 0xFFFFFFFFull)
+            return false;
+        pos++;
+    }
+    val = unsigned(v);
+    return true;
+}
 
-	if(FOPEN_FAIL(FOPEN(fp, file, "rb")))
-		return 0;
+bool parseHeader(const unsigned char* p, size_t size, PNMHeader& hdr)
+{
+    size_t pos = skipSpaces(p, 0, size);
+    if(pos + 2 > size || p[pos] != 'P')
+        return false;
+    pos++;
+
+    if(pos + 1 < size && p[pos] == '1' && (p[pos + 1] == '5' || p[pos + 1] == '6'))
+    {
+        hdr.channels = (p[pos + 1] == '5') ? 1 : 3;
+        hdr.fvHeader = true;
+        pos += 2;
+    }
+    else if(p[pos] == '5' || p[pos] == '6')
+    {
+        hdr.channels = (p[pos] == '5') ? 1 : 3;
+        pos++;
+    }
+    else
+        return false;   //channels stays 0 for unknown magic numbers
+
+    if(!readNumber(p, pos, size, hdr.width) ||
+       !readNumber(p, pos, size, hdr.height) ||
+       !readNumber(p, pos, size, hdr.maxval))
+        return false;
+
+    if(hdr.width == 0 || hdr.height == 0 || hdr.maxval == 0 || hdr.maxval > 65535)
+        return false;
+
+    //Exactly one whitespace separates header from samples
+    if(pos >= size || !isspace(p[pos]))
+        return false;
+
+    hdr.dataOffset = pos + 1;
+    return true;
+}
 
-	unsigned int startPosition = 0;
+unsigned bitsFromMaxval(unsigned maxval)
+{
+    unsigned bits = 1;
+    while(bits < 16 && (1u << bits) <= maxval)
+        bits++;
+    return bits;
+}
 
-	// check header
-	char header[PGMHeaderSize] = { 0 };
+//Read only mapping of the whole file with fallback to plain read
+//for files which cannot be mapped (pipes, some network shares)
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* fileName) : mFile(QString::fromLocal8Bit(fileName))
+    {
+        if(!mFile.open(QFile::ReadOnly))
+            return;
+
+        mSize = size_t(mFile.size());
+        if(mSize == 0)
+            return;
+
+        mData = mFile.map(0, mFile.size());
+        if(mData == nullptr)
+        {
+            mBuffer = mFile.readAll();
+            mData = reinterpret_cast<const unsigned char*>(mBuffer.constData());
+            mSize = size_t(mBuffer.size());
+        }
+    }
+
+    const unsigned char* data() const {return mData;}
+    size_t size() const {return mSize;}
+
+private:
+    QFile mFile;
+    QByteArray mBuffer;
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+};
+
+#if defined(PPM_USE_AVX2)
+//Returns the number of samples done
+PPM_AVX2_TARGET size_t swapBytes16Avx2(unsigned char* d, const unsigned char* s, size_t count)
+{
+    const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i * 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i * 2), _mm256_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+#endif
+}
 
-	while (header[startPosition] == 0) {
-		startPosition = 0;
-        if(fgets(header, PGMHeaderSize, fp) == nullptr)
-			return 0;
+void swapBytes16(void* dst, const void* src, size_t count)
+{
+    auto* d = static_cast<unsigned char*>(dst);
+    const auto* s = static_cast<const unsigned char*>(src);
+    size_t i = 0;
+
+#if defined(PPM_USE_AVX2)
+    if(cpuHasAvx2())
+        i = swapBytes16Avx2(d, s, count);
+#endif
+
+#if defined(PPM_USE_SSE2)
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 2));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * 2), v);
+    }
+#elif defined(PPM_USE_NEON)
+    for(; i + 8 <= count; i += 8)
+        vst1q_u8(d + i * 2, vrev16q_u8(vld1q_u8(s + i * 2)));
+#endif
+
+    for(; i < count; i++)
+    {
+        unsigned char lo = s[i * 2];
+        unsigned char hi = s[i * 2 + 1];
+        d[i * 2] = hi;
+        d[i * 2 + 1] = lo;
+    }
+}
 
-		while (isspace(header[startPosition])) startPosition++;
-	}
+void swapBytes16Rows(void* dst, unsigned dstPitch, const void* src, unsigned srcPitch, unsigned rowBytes, unsigned h)
+{
+    auto* d = static_cast<unsigned char*>(dst);
+    const auto* s = static_cast<const unsigned char*>(src);
+    for(unsigned y = 0; y < h; y++)
+        swapBytes16(d + size_t(y) * dstPitch, s + size_t(y) * srcPitch, rowBytes / 2);
+}
 
-	bool fvHeader = false;
-	int strOffset = 2;
-	if(strncmp(&header[startPosition], "P5", 2) == 0) {
-		channels = 1;
-	}
-	else if(strncmp(&header[startPosition], "P6", 2) == 0) {
-		channels = 3;
-	}
-	else if(strncmp(&header[startPosition], "P15", 3) == 0) {     //fv
-		channels = 1;
-		strOffset = 3;
-		fvHeader = true;
-	}
-	else if(strncmp(&header[startPosition], "P16", 3) == 0) {    //fv
-		channels = 3;
-		strOffset = 3;
-		fvHeader = true;
-	}
-	else {
+int loadPPM(const char *file, void** data, BaseAllocator *alloc, unsigned int &width, unsigned &wPitch, unsigned int &height, unsigned &bitsPerPixel, unsigned &channels) {
+	MappedFile mapped(file);
+	if(mapped.data() == nullptr)
+		return 0;
+
+	PNMHeader hdr;
+	if(!parseHeader(mapped.data(), mapped.size(), hdr))
+	{
+		//Unknown magic number is reported as channels = 0, malformed header as failure
+		const bool unknown = hdr.channels == 0;
 		channels = 0;
-		return 1;
+		*data = nullptr;
+		return unknown ? 1 : 0;
 	}
 
-	// parse header, read maxval, width and height
-	unsigned int maxval = 0;
-    unsigned int i = 0;
-	int readsCount = 0;
-
-    if((i = SSCANF(&header[startPosition + strOffset], "%u %u %u", &width, &height, &maxval)) == (unsigned int)(EOF))
-        i = 0;
-
-	while (i < 3) {
-        if(fgets(header, PGMHeaderSize, fp) == nullptr)
-			return 0;
-
-		if(header[0] == '#')
-			continue;
-
-		if(i == 0) {
-            if((readsCount = SSCANF(header, "%u %u %u", &width, &height, &maxval)) != EOF)
-				i += readsCount;
-		}
-		else if(i == 1) {
-            if((readsCount = SSCANF(header, "%u %u", &height, &maxval)) != EOF)
-				i += readsCount;
-		}
-		else if(i == 2) {
-            if((readsCount = SSCANF(header, "%u", &maxval)) != EOF)
-				i += readsCount;
-		}
-	}
-	bitsPerPixel = int(log(maxval + 1) / log(2));
+	width = hdr.width;
+	height = hdr.height;
+	channels = hdr.channels;
+	bitsPerPixel = bitsFromMaxval(hdr.maxval);
 
-	const int bytePerPixel = _uSnapUp<unsigned>(bitsPerPixel, 8) / 8;
+	const unsigned bytePerPixel = _uSnapUp<unsigned>(bitsPerPixel, 8) / 8;
+	const size_t rowBytes = size_t(width) * bytePerPixel * channels;
+
+	if(mapped.size() - hdr.dataOffset < rowBytes * height)
+		return 0;
 
 	wPitch = channels * _uSnapUp<unsigned>(width * bytePerPixel, alloc->getAlignment());
 
 	*data = alloc->allocate(wPitch * height);
-    auto *d = static_cast<unsigned char *>(*data);
-
-	for(unsigned i = 0; i < height; i++) {
-
-		if(fread(&d[i * wPitch], sizeof(unsigned char), width * bytePerPixel * channels, fp) == 0)
-			return 0;
-
-		if(bytePerPixel == 2 && !fvHeader)
-		{
-            auto *p = reinterpret_cast<unsigned short*>(&d[i * wPitch]);
-			for(unsigned int x = 0; x < wPitch / bytePerPixel; x++)
-			{
-				unsigned short t = p[x];
-				unsigned short t1 = t >> 8;
-				t = (t << 8) | t1;
-				p[x] = t;
-			}
-		}
+	auto *d = static_cast<unsigned char *>(*data);
+	const unsigned char* s = mapped.data() + hdr.dataOffset;
+
+	//PGM/PPM store 16 bit samples in big endian order
+	if(bytePerPixel == 2 && !hdr.fvHeader)
+	{
+		swapBytes16Rows(d, wPitch, s, unsigned(rowBytes), unsigned(rowBytes), height);
+	}
+	else
+	{
+		for(unsigned i = 0; i < height; i++)
+			memcpy(&d[size_t(i) * wPitch], &s[i * rowBytes], rowBytes);
 	}
 
-	fclose(fp);
 	return 1;
 }
 
@@ -124,61 +275,17 @@ int getFileParameters(const char *file, unsigned &width, unsigned &height) {
 	if(FOPEN_FAIL(FOPEN(fp, file, "rb")))
 		return 0;
 
-	unsigned int startPosition = 0;
-    unsigned channels = 0;
-	// check header
-	char header[PGMHeaderSize] = { 0 };
-
-	while (header[startPosition] == 0) {
-		startPosition = 0;
-        if(fgets(header, PGMHeaderSize, fp) == nullptr)
-			return 0;
-
-		while (isspace(header[startPosition])) startPosition++;
-	}
+	//Header never exceeds a few hundred bytes unless it holds long comments
+	unsigned char header[PGMHeaderSize * 4] = { 0 };
+	size_t sz = fread(header, 1, sizeof(header), fp);
+	fclose(fp);
 
-	if(strncmp(&header[startPosition], "P5", 2) == 0) {
-//		channels = 1;
-	}
-	else if(strncmp(&header[startPosition], "P6", 2) == 0) {
-//		channels = 3;
-	}
-	else {
-//		channels = 0;
+	PNMHeader hdr;
+	if(!parseHeader(header, sz, hdr) || hdr.fvHeader)
 		return 0;
-	}
-
-	// parse header, read maxval, width and height
-	unsigned int maxval = 0;
-    unsigned int i = 0;
-    unsigned int readsCount = 0;
-
-    if((i = SSCANF(&header[startPosition + 2], "%u %u %u", &width, &height, &maxval)) == (unsigned int)(EOF))
-        i = 0;
-
-	while (i < 3) {
-        if(fgets(header, PGMHeaderSize, fp) == nullptr)
-			return 0;
-
-		if(header[0] == '#')
-			continue;
-
-		if(i == 0) {
-            if((readsCount = SSCANF(header, "%u %u %u", &width, &height, &maxval)) != (unsigned int)(EOF))
-				i += readsCount;
-		}
-		else if(i == 1) {
-            if((readsCount = SSCANF(header, "%u %u", &height, &maxval)) != (unsigned int)(EOF))
-				i += readsCount;
-		}
-		else if(i == 2) {
-            if((readsCount = SSCANF(header, "%u", &maxval)) != (unsigned int)(EOF))
-				i += readsCount;
-		}
-	}
 
-	fclose(fp);
-    (void) channels;
+	width = hdr.width;
+	height = hdr.height;
 	return 1;
 }
 
@@ -202,23 +309,22 @@ int savePPM(const char *file, unsigned char *data, unsigned w, unsigned wPitch,
 		return 0;
 
 	fh << w << "\n" << h << "\n" << ((1 << bitsPerPixel) - 1) << std::endl;
-	const int bytePerPixel = _uSnapUp<unsigned>(bitsPerPixel, 8) / 8;
+	const unsigned bytePerPixel = _uSnapUp<unsigned>(bitsPerPixel, 8) / 8;
+	const unsigned rowBytes = w * channels * bytePerPixel;
+
+	//Swap into scratch row so caller data stays intact
+	std::vector<unsigned char> row(bytePerPixel == 2 ? rowBytes : 0);
 
 	for(unsigned int y = 0; y < h && fh.good(); y++)
 	{
+		const unsigned char* src = &data[size_t(y) * wPitch];
         if(bytePerPixel == 2)
         {
-            auto *p = reinterpret_cast<unsigned short*>(data);
-            for(unsigned int x = 0; x < wPitch / bytePerPixel; x++)
-            {
-                unsigned short t = p[y * wPitch / bytePerPixel + x];
-                unsigned short t1 = t >> 8;
-                t = (t << 8) | t1;
-                p[y * wPitch / bytePerPixel + x] = t;
-            }
+			swapBytes16(row.data(), src, rowBytes / 2);
+			src = row.data();
         }
 
-		fh.write(reinterpret_cast<const char *>(&data[y * wPitch]), w * channels * bytePerPixel);
+		fh.write(reinterpret_cast<const char *>(src), rowBytes);
 	}
 
 	fh.flush();
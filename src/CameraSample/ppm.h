@@ -14,10 +14,19 @@ FASTVIDEO SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
 #define __PPM__
 
 #include "BaseAllocator.h"
+#include <cstddef>
 
 int getFileParameters(const char *file, unsigned &width, unsigned &height);
 int loadPPM(const char *file, void** data, BaseAllocator *alloc, unsigned int &width, unsigned &wPitch, unsigned int &height, unsigned &bitsPerPixel, unsigned &channels);
 int savePPM(const char *file, unsigned char *data, unsigned w, unsigned wPitch, unsigned h, int bitsPerPixel, unsigned int channels);
 
+//Swap bytes of count 16 bit samples (SSE2/NEON where available).
+//dst may be equal to src or lie before it in the same buffer.
+void swapBytes16(void* dst, const void* src, size_t count);
+
+//Copy h rows of rowBytes 16 bit samples from src with srcPitch to dst with dstPitch swapping bytes.
+//Works in place when dst <= src and dstPitch <= srcPitch (e.g. to drop row padding before writing PGM).
+void swapBytes16Rows(void* dst, unsigned dstPitch, const void* src, unsigned srcPitch, unsigned rowBytes, unsigned h);
+
 
 #endif //__PPM__
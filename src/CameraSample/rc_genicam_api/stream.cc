@@ -62,6 +62,7 @@ Stream::Stream(const std::shared_ptr<Device> &_parent,
   stream=0;
   event=0;
   bn=0;
+  nbuffers=0;
 }
 
 Stream::~Stream()
@@ -132,6 +133,32 @@ void Stream::close()
   }
 }
 
+void Stream::setBufferCount(size_t n)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  nbuffers=n;
+}
+
+void Stream::setBufferAllocator(const std::shared_ptr<BufferAllocator> &alloc)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  allocator=alloc;
+}
+
+void Stream::freeUserBuffers()
+{
+  if (user_allocator)
+  {
+    for (size_t i=0; i<user_buffers.size(); i++)
+    {
+      user_allocator->free(user_buffers[i].first, user_buffers[i].second);
+    }
+  }
+
+  user_buffers.clear();
+  user_allocator.reset();
+}
+
 void Stream::startStreaming(int na)
 {
   std::lock_guard<std::recursive_mutex> lock(mtx);
@@ -182,12 +209,36 @@ void Stream::startStreaming(int na)
 
   bool err=false;
 
-  bn=std::max(static_cast<size_t>(8), getBufAnnounceMin());
+  size_t alignment=std::max(static_cast<size_t>(1), getBufAlignment());
+
+  bn=std::max(nbuffers > 0 ? nbuffers : static_cast<size_t>(8), getBufAnnounceMin());
   for (size_t i=0; i<bn; i++)
   {
     GenTL::BUFFER_HANDLE p=0;
 
-    if (gentl->DSAllocAndAnnounceBuffer(stream, size, 0, &p) != GenTL::GC_ERR_SUCCESS)
+    if (allocator)
+    {
+      // announce application owned memory
+
+      void *mem=allocator->allocate(size, alignment);
+
+      if (mem == 0)
+      {
+        err=true;
+        break;
+      }
+
+      if (gentl->DSAnnounceBuffer(stream, mem, size, 0, &p) != GenTL::GC_ERR_SUCCESS)
+      {
+        allocator->free(mem, size);
+        err=true;
+        break;
+      }
+
+      user_allocator=allocator;
+      user_buffers.push_back(std::make_pair(mem, size));
+    }
+    else if (gentl->DSAllocAndAnnounceBuffer(stream, size, 0, &p) != GenTL::GC_ERR_SUCCESS)
     {
       err=true;
       break;
@@ -243,6 +294,9 @@ void Stream::startStreaming(int na)
       gentl->DSRevokeBuffer(stream, p, 0, 0);
     }
 
+    freeUserBuffers();
+    bn=0;
+
     // unlock parameters
 
     std::shared_ptr<GenApi::CNodeMapRef> nmap=parent->getRemoteNodeMap();
@@ -285,6 +339,10 @@ void Stream::stopStreaming()
       }
     }
 
+    // memory of revoked buffers is owned by the application
+
+    freeUserBuffers();
+
     event=0;
     bn=0;
 
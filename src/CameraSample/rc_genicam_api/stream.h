@@ -40,12 +40,42 @@
 #include "buffer.h"
 
 #include <mutex>
+#include <vector>
 
 namespace rcg
 {
 
 class Buffer;
 
+/**
+  Allocator for buffers that are owned by the application and announced to
+  the producer with DSAnnounceBuffer(), e.g. page-locked memory that the GPU
+  can read directly.
+*/
+
+class BufferAllocator
+{
+  public:
+
+    virtual ~BufferAllocator() {}
+
+    /**
+      Allocates memory for one buffer.
+
+      @param size      Size of the buffer in bytes.
+      @param alignment Alignment required by the producer, 1 if there is none.
+      @return          Pointer to the memory or 0 on failure.
+    */
+
+    virtual void *allocate(size_t size, size_t alignment)=0;
+
+    /**
+      Frees memory returned by allocate().
+    */
+
+    virtual void free(void *p, size_t size)=0;
+};
+
 /**
   The stream class encapsulates a Genicam stream.
 
@@ -96,6 +126,26 @@ class Stream : public std::enable_shared_from_this<Stream>
 
     void close();
 
+    /**
+      Sets the number of buffers that are announced by startStreaming(). The
+      number is raised to the minimum that the producer requires. A deep queue
+      absorbs bursts on fast links.
+
+      @param n Number of buffers. 0 selects the default of 8.
+    */
+
+    void setBufferCount(size_t n);
+
+    /**
+      Sets the allocator for application owned buffers. Without an allocator,
+      the producer allocates the buffers. The setting is used by the next call
+      of startStreaming().
+
+      @param alloc Allocator or 0 for producer allocated buffers.
+    */
+
+    void setBufferAllocator(const std::shared_ptr<BufferAllocator> &alloc);
+
     /**
       Allocates buffers and registers internal events if necessary and starts
       streaming.
@@ -290,6 +340,14 @@ class Stream : public std::enable_shared_from_this<Stream>
     void *event;
     size_t bn;
 
+    size_t nbuffers;
+    std::shared_ptr<BufferAllocator> allocator;
+    // allocator of user_buffers, the current one may have been replaced since
+    std::shared_ptr<BufferAllocator> user_allocator;
+    std::vector<std::pair<void *, size_t> > user_buffers;
+
+    void freeUserBuffers();
+
     std::shared_ptr<CPort> cport;
     std::shared_ptr<GenApi::CNodeMapRef> nodemap;
 };
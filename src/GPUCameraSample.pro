@@ -2,3 +2,9 @@ TEMPLATE = subdirs
 SUBDIRS = \
         CameraSample \
         RtspPlayer
+
+#Uncomment to build mock GenTL producer for testing without cameras.
+#CI builds (CI environment variable set) always build it, see common_defs.pri
+#SUBDIRS += MockGenTL
+CI_BUILD = $$(CI)
+!isEmpty(CI_BUILD): SUBDIRS += MockGenTL
@@ -0,0 +1,1650 @@
+/*
+ Copyright 2011-2019 Fastvideo, LLC.
+ All rights reserved.
+
+ This file is a part of the GPUCameraSample project
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 3. Any third-party SDKs from that project (XIMEA SDK, Fastvideo SDK, etc.) are licensed on different terms. Please see their corresponding license terms.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those
+ of the authors and should not be interpreted as representing official policies,
+ either expressed or implied, of the FreeBSD Project.
+*/
+
+///Stand-in GenTL producer for exercising the GenICam grab path without a camera.
+///Serves synthetic Mono/Bayer frames, settings come from the environment:
+///  MOCK_GENTL_WIDTH, MOCK_GENTL_HEIGHT       frame size (1920x1200)
+///  MOCK_GENTL_PIXEL_FORMATS                  comma separated PFNC names (BayerRG12p,BayerRG8)
+///  MOCK_GENTL_FPS                            frame rate (60)
+///  MOCK_GENTL_DEVICES                        number of cameras (1)
+///  MOCK_GENTL_INCOMPLETE_EVERY               every Nth frame is delivered incomplete
+///  MOCK_GENTL_LOST_EVERY                     every Nth frame is lost (frame ID gap)
+///  MOCK_GENTL_STALL_EVERY, MOCK_GENTL_STALL_MS
+///                                            every Nth frame is held back, grab() times out
+
+#define GCTLIDLL
+#include <GenTL/GenTL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace GenTL;
+
+namespace
+{
+
+const uint32_t cGenTLMajor = 1;
+const uint32_t cGenTLMinor = 5;
+
+const char* const cVendor = "Fastvideo";
+const char* const cModel = "MockCamera";
+const char* const cTLType = "Custom";
+
+///////////////////////////////////////////
+/// Settings
+
+int envInt(const char* name, int def)
+{
+    const char* v = getenv(name);
+    return v != nullptr && *v != 0 ? atoi(v) : def;
+}
+
+struct PixelFormatInfo
+{
+    const char* name;
+    uint32_t pfnc;
+};
+
+const PixelFormatInfo cPixelFormats[] = {
+    {"Mono8",           0x01080001},
+    {"Mono10",          0x01100003},
+    {"Mono12",          0x01100005},
+    {"Mono16",          0x01100007},
+    {"BayerGR8",        0x01080008},
+    {"BayerRG8",        0x01080009},
+    {"BayerGB8",        0x0108000A},
+    {"BayerBG8",        0x0108000B},
+    {"BayerGR12",       0x01100010},
+    {"BayerRG12",       0x01100011},
+    {"BayerGB12",       0x01100012},
+    {"BayerBG12",       0x01100013},
+    {"Mono10p",         0x010A0046},
+    {"Mono12p",         0x010C0047},
+    {"BayerBG10p",      0x010A0052},
+    {"BayerBG12p",      0x010C0053},
+    {"BayerGB10p",      0x010A0054},
+    {"BayerGB12p",      0x010C0055},
+    {"BayerGR10p",      0x010A0056},
+    {"BayerGR12p",      0x010C0057},
+    {"BayerRG10p",      0x010A0058},
+    {"BayerRG12p",      0x010C0059},
+    {"Mono12Packed",    0x010C0006},
+    {"BayerGR12Packed", 0x010C002A},
+    {"BayerRG12Packed", 0x010C002B},
+    {"BayerGB12Packed", 0x010C002C},
+    {"BayerBG12Packed", 0x010C002D}
+};
+
+///Bits per pixel on the wire, PFNC keeps it in bits 16..23
+inline unsigned pixelBits(uint32_t pfnc)
+{
+    return (pfnc >> 16) & 0xFF;
+}
+
+///Significant bits of a sample
+unsigned sampleBits(uint32_t pfnc)
+{
+    switch(pfnc)
+    {
+    case 0x01100003: return 10;
+    case 0x01100005: case 0x01100010: case 0x01100011: case 0x01100012: case 0x01100013: return 12;
+    case 0x01100007: return 16;
+    default: return pixelBits(pfnc);
+    }
+}
+
+inline bool isGvspPacked(uint32_t pfnc)
+{
+    return pfnc == 0x010C0006 || (pfnc >= 0x010C002A && pfnc <= 0x010C002D);
+}
+
+struct Settings
+{
+    unsigned width = 1920;
+    unsigned height = 1200;
+    double fps = 60;
+    int devices = 1;
+    int incompleteEvery = 0;
+    int lostEvery = 0;
+    int stallEvery = 0;
+    int stallMs = 0;
+    std::vector<PixelFormatInfo> formats;
+
+    Settings()
+    {
+        width = unsigned(std::max(16, envInt("MOCK_GENTL_WIDTH", int(width)))) & ~15u;
+        height = unsigned(std::max(2, envInt("MOCK_GENTL_HEIGHT", int(height)))) & ~1u;
+        fps = std::max(1, envInt("MOCK_GENTL_FPS", 60));
+        devices = std::max(1, envInt("MOCK_GENTL_DEVICES", 1));
+        incompleteEvery = envInt("MOCK_GENTL_INCOMPLETE_EVERY", 0);
+        lostEvery = envInt("MOCK_GENTL_LOST_EVERY", 0);
+        stallEvery = envInt("MOCK_GENTL_STALL_EVERY", 0);
+        stallMs = envInt("MOCK_GENTL_STALL_MS", 5000);
+
+        const char* names = getenv("MOCK_GENTL_PIXEL_FORMATS");
+        std::stringstream in(names != nullptr && *names != 0 ? names : "BayerRG12p,BayerRG8");
+        std::string name;
+        while(std::getline(in, name, ','))
+        {
+            for(const auto& f : cPixelFormats)
+            {
+                if(name == f.name)
+                    formats.push_back(f);
+            }
+        }
+        if(formats.empty())
+            formats.push_back(cPixelFormats[5]);
+    }
+};
+
+const Settings& settings()
+{
+    static Settings s;
+    return s;
+}
+
+///////////////////////////////////////////
+/// Errors
+
+thread_local GC_ERROR gLastError = GC_ERR_SUCCESS;
+thread_local std::string gLastErrorText;
+
+GC_ERROR fail(GC_ERROR err, const char* text)
+{
+    gLastError = err;
+    gLastErrorText = text;
+    return err;
+}
+
+///////////////////////////////////////////
+/// Info helpers. A null buffer queries the required size.
+
+GC_ERROR putInfo(INFO_DATATYPE* type, void* buffer, size_t* size, INFO_DATATYPE t, const void* value, size_t valueSize)
+{
+    if(size == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "size is null");
+    if(type != nullptr)
+        *type = t;
+    if(buffer == nullptr)
+    {
+        *size = valueSize;
+        return GC_ERR_SUCCESS;
+    }
+    if(*size < valueSize)
+        return fail(GC_ERR_BUFFER_TOO_SMALL, "buffer too small");
+    memcpy(buffer, value, valueSize);
+    *size = valueSize;
+    return GC_ERR_SUCCESS;
+}
+
+GC_ERROR putString(INFO_DATATYPE* type, void* buffer, size_t* size, const std::string& value)
+{
+    return putInfo(type, buffer, size, INFO_DATATYPE_STRING, value.c_str(), value.size() + 1);
+}
+
+template<class T>
+GC_ERROR putValue(INFO_DATATYPE* type, void* buffer, size_t* size, INFO_DATATYPE t, T value)
+{
+    return putInfo(type, buffer, size, t, &value, sizeof(T));
+}
+
+GC_ERROR putBool(INFO_DATATYPE* type, void* buffer, size_t* size, bool value)
+{
+    return putValue<bool8_t>(type, buffer, size, INFO_DATATYPE_BOOL8, value ? 1 : 0);
+}
+
+///////////////////////////////////////////
+/// Handles
+
+enum HandleKind : uint32_t
+{
+    hkSystem = 0x4D4B0001,
+    hkInterface,
+    hkDevice,
+    hkRemotePort,
+    hkStream,
+    hkEvent,
+    hkBuffer
+};
+
+struct HandleBase
+{
+    explicit HandleBase(HandleKind k) : kind(k) {}
+    HandleKind kind;
+};
+
+template<class T>
+T* cast(void* h, HandleKind kind)
+{
+    auto* b = static_cast<HandleBase*>(h);
+    return b != nullptr && b->kind == kind ? static_cast<T*>(b) : nullptr;
+}
+
+struct Device;
+struct Stream;
+
+struct BufferEntry : HandleBase
+{
+    BufferEntry() : HandleBase(hkBuffer) {}
+    unsigned char* base = nullptr;
+    size_t size = 0;
+    void* priv = nullptr;
+    bool owned = false;
+    bool queued = false;
+    size_t filled = 0;
+    bool incomplete = false;
+    uint64_t frameId = 0;
+    uint64_t timestampNs = 0;
+    uint32_t pixelFormat = 0;
+    unsigned width = 0;
+    unsigned height = 0;
+};
+
+struct Event : HandleBase
+{
+    explicit Event(Stream* s) : HandleBase(hkEvent), stream(s) {}
+    Stream* stream;
+};
+
+///Register map of the remote device
+enum : uint64_t
+{
+    regWidth = 0x00,
+    regHeight = 0x04,
+    regWidthMax = 0x08,
+    regHeightMax = 0x0C,
+    regPixelFormat = 0x10,
+    regPayloadSize = 0x14,
+    regTLParamsLocked = 0x18,
+    regAcquisitionStart = 0x1C,
+    regAcquisitionStop = 0x20,
+    regFrameRateEnable = 0x24,
+    regFrameRate = 0x28,
+    regExposureTime = 0x30,
+    regExposureMode = 0x38,
+    regSize = 0x40,
+    regXml = 0x10000
+};
+
+struct RemotePort : HandleBase
+{
+    explicit RemotePort(Device* d) : HandleBase(hkRemotePort), device(d) {}
+    Device* device;
+};
+
+struct Device : HandleBase
+{
+    explicit Device(int idx);
+
+    int index;
+    std::string id;
+    std::string xml;
+    RemotePort port;
+    std::unique_ptr<Stream> stream;
+    bool open = false;
+
+    std::mutex regLock;
+    unsigned char regs[regSize] = {0};
+
+    uint32_t reg32(uint64_t addr)
+    {
+        uint32_t v = 0;
+        memcpy(&v, regs + addr, sizeof(v));
+        return v;
+    }
+    void setReg32(uint64_t addr, uint32_t v)
+    {
+        memcpy(regs + addr, &v, sizeof(v));
+    }
+    double regDouble(uint64_t addr)
+    {
+        double v = 0;
+        memcpy(&v, regs + addr, sizeof(v));
+        return v;
+    }
+    void setRegDouble(uint64_t addr, double v)
+    {
+        memcpy(regs + addr, &v, sizeof(v));
+    }
+    size_t payloadSize()
+    {
+        return size_t(reg32(regWidth)) * reg32(regHeight) * pixelBits(reg32(regPixelFormat)) / 8;
+    }
+
+    GC_ERROR read(uint64_t addr, void* buffer, size_t* size);
+    GC_ERROR write(uint64_t addr, const void* buffer, size_t* size);
+};
+
+struct Stream : HandleBase
+{
+    explicit Stream(Device* d) : HandleBase(hkStream), device(d), event(this) {}
+    ~Stream() { stop(); }
+
+    Device* device;
+    Event event;
+    bool eventRegistered = false;
+    std::string id = "Stream0";
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector<std::unique_ptr<BufferEntry>> announced;
+    std::deque<BufferEntry*> input;
+    std::deque<BufferEntry*> output;
+    bool killed = false;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+    uint64_t toAcquire = 0;
+    uint64_t delivered = 0;
+    uint64_t underrun = 0;
+    uint64_t started = 0;
+    uint64_t frameId = 0;
+
+    std::vector<std::vector<unsigned char>> frames;
+
+    void start(uint64_t count);
+    void stop();
+    void run();
+    void render();
+};
+
+struct Interface : HandleBase
+{
+    Interface() : HandleBase(hkInterface) {}
+    std::string id = "MockInterface";
+    std::vector<std::unique_ptr<Device>> devices;
+    bool open = false;
+};
+
+struct System : HandleBase
+{
+    System() : HandleBase(hkSystem) {}
+    Interface iface;
+    bool open = false;
+};
+
+bool gInitialized = false;
+std::unique_ptr<System> gSystem;
+
+///////////////////////////////////////////
+/// Remote device description
+
+std::string intReg(const char* name, uint64_t addr, const char* access)
+{
+    std::stringstream s;
+    s << "  <IntReg Name=\"" << name << "\">\n"
+      << "    <Address>0x" << std::hex << addr << std::dec << "</Address>\n"
+      << "    <Length>4</Length>\n"
+      << "    <AccessMode>" << access << "</AccessMode>\n"
+      << "    <pPort>Device</pPort>\n"
+      << "    <Cachable>NoCache</Cachable>\n"
+      << "    <Sign>Unsigned</Sign>\n"
+      << "    <Endianess>LittleEndian</Endianess>\n"
+      << "  </IntReg>\n";
+    return s.str();
+}
+
+std::string floatReg(const char* name, uint64_t addr)
+{
+    std::stringstream s;
+    s << "  <FloatReg Name=\"" << name << "\">\n"
+      << "    <Address>0x" << std::hex << addr << std::dec << "</Address>\n"
+      << "    <Length>8</Length>\n"
+      << "    <AccessMode>RW</AccessMode>\n"
+      << "    <pPort>Device</pPort>\n"
+      << "    <Cachable>NoCache</Cachable>\n"
+      << "    <Endianess>LittleEndian</Endianess>\n"
+      << "  </FloatReg>\n";
+    return s.str();
+}
+
+std::string buildXml()
+{
+    const Settings& cfg = settings();
+    std::stringstream s;
+    s << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+      << "<RegisterDescription ModelName=\"" << cModel << "\" VendorName=\"" << cVendor << "\""
+      << " StandardNameSpace=\"None\" SchemaMajorVersion=\"1\" SchemaMinorVersion=\"1\" SchemaSubMinorVersion=\"0\""
+      << " MajorVersion=\"1\" MinorVersion=\"0\" SubMinorVersion=\"0\""
+      << " ProductGuid=\"5E0B0D29-2A43-4B1C-9C36-4E5A6D1F0A01\" VersionGuid=\"5E0B0D29-2A43-4B1C-9C36-4E5A6D1F0A02\""
+      << " xmlns=\"http://www.genicam.org/GenApi/Version_1_1\""
+      << " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+      << " xsi:schemaLocation=\"http://www.genicam.org/GenApi/Version_1_1 http://www.genicam.org/GenApi/GenApiSchema_Version_1_1.xsd\">\n";
+
+    s << "  <Category Name=\"Root\" NameSpace=\"Standard\">\n";
+    for(const char* f : {"Width", "Height", "PixelFormat", "PayloadSize", "TLParamsLocked",
+                         "AcquisitionStart", "AcquisitionStop", "AcquisitionFrameRateEnable",
+                         "AcquisitionFrameRate", "ExposureMode", "ExposureTime"})
+        s << "    <pFeature>" << f << "</pFeature>\n";
+    s << "  </Category>\n";
+
+    s << "  <Integer Name=\"Width\" NameSpace=\"Standard\">\n"
+      << "    <pValue>WidthReg</pValue>\n    <Min>16</Min>\n    <pMax>WidthMaxReg</pMax>\n    <Inc>16</Inc>\n"
+      << "  </Integer>\n";
+    s << "  <Integer Name=\"Height\" NameSpace=\"Standard\">\n"
+      << "    <pValue>HeightReg</pValue>\n    <Min>2</Min>\n    <pMax>HeightMaxReg</pMax>\n    <Inc>2</Inc>\n"
+      << "  </Integer>\n";
+
+    s << "  <Enumeration Name=\"PixelFormat\" NameSpace=\"Standard\">\n";
+    for(const auto& f : cfg.formats)
+        s << "    <EnumEntry Name=\"" << f.name << "\" NameSpace=\"Standard\">\n"
+          << "      <Value>" << f.pfnc << "</Value>\n"
+          << "    </EnumEntry>\n";
+    s << "    <pValue>PixelFormatReg</pValue>\n"
+      << "  </Enumeration>\n";
+
+    s << "  <Integer Name=\"PayloadSize\" NameSpace=\"Standard\">\n"
+      << "    <pValue>PayloadSizeReg</pValue>\n"
+      << "  </Integer>\n";
+    s << "  <Integer Name=\"TLParamsLocked\" NameSpace=\"Standard\">\n"
+      << "    <Visibility>Invisible</Visibility>\n"
+      << "    <pValue>TLParamsLockedReg</pValue>\n    <Min>0</Min>\n    <Max>1</Max>\n"
+      << "  </Integer>\n";
+
+    s << "  <Command Name=\"AcquisitionStart\" NameSpace=\"Standard\">\n"
+      << "    <pValue>AcquisitionStartReg</pValue>\n    <CommandValue>1</CommandValue>\n"
+      << "  </Command>\n";
+    s << "  <Command Name=\"AcquisitionStop\" NameSpace=\"Standard\">\n"
+      << "    <pValue>AcquisitionStopReg</pValue>\n    <CommandValue>1</CommandValue>\n"
+      << "  </Command>\n";
+
+    s << "  <Boolean Name=\"AcquisitionFrameRateEnable\" NameSpace=\"Standard\">\n"
+      << "    <pValue>FrameRateEnableReg</pValue>\n    <OnValue>1</OnValue>\n    <OffValue>0</OffValue>\n"
+      << "  </Boolean>\n";
+    s << "  <Float Name=\"AcquisitionFrameRate\" NameSpace=\"Standard\">\n"
+      << "    <pValue>FrameRateReg</pValue>\n    <Min>1</Min>\n    <Max>10000</Max>\n"
+      << "  </Float>\n";
+
+    s << "  <Enumeration Name=\"ExposureMode\" NameSpace=\"Standard\">\n"
+      << "    <EnumEntry Name=\"Timed\" NameSpace=\"Standard\">\n      <Value>1</Value>\n    </EnumEntry>\n"
+      << "    <pValue>ExposureModeReg</pValue>\n"
+      << "  </Enumeration>\n";
+    s << "  <Float Name=\"ExposureTime\" NameSpace=\"Standard\">\n"
+      << "    <pValue>ExposureTimeReg</pValue>\n    <Min>10</Min>\n    <Max>1000000</Max>\n"
+      << "  </Float>\n";
+
+    s << intReg("WidthReg", regWidth, "RW")
+      << intReg("HeightReg", regHeight, "RW")
+      << intReg("WidthMaxReg", regWidthMax, "RO")
+      << intReg("HeightMaxReg", regHeightMax, "RO")
+      << intReg("PixelFormatReg", regPixelFormat, "RW")
+      << intReg("PayloadSizeReg", regPayloadSize, "RO")
+      << intReg("TLParamsLockedReg", regTLParamsLocked, "RW")
+      << intReg("AcquisitionStartReg", regAcquisitionStart, "WO")
+      << intReg("AcquisitionStopReg", regAcquisitionStop, "WO")
+      << intReg("FrameRateEnableReg", regFrameRateEnable, "RW")
+      << intReg("ExposureModeReg", regExposureMode, "RW")
+      << floatReg("FrameRateReg", regFrameRate)
+      << floatReg("ExposureTimeReg", regExposureTime);
+
+    s << "  <Port Name=\"Device\" NameSpace=\"Standard\"/>\n"
+      << "</RegisterDescription>\n";
+    return s.str();
+}
+
+Device::Device(int idx) :
+    HandleBase(hkDevice),
+    index(idx),
+    port(this)
+{
+    const Settings& cfg = settings();
+    id = "MockCamera" + std::to_string(idx);
+    xml = buildXml();
+
+    setReg32(regWidth, cfg.width);
+    setReg32(regHeight, cfg.height);
+    setReg32(regWidthMax, cfg.width);
+    setReg32(regHeightMax, cfg.height);
+    setReg32(regPixelFormat, cfg.formats.front().pfnc);
+    setReg32(regPayloadSize, uint32_t(payloadSize()));
+    setReg32(regFrameRateEnable, 1);
+    setReg32(regExposureMode, 1);
+    setRegDouble(regFrameRate, cfg.fps);
+    setRegDouble(regExposureTime, 1000.0 / cfg.fps * 1000.0);
+}
+
+GC_ERROR Device::read(uint64_t addr, void* buffer, size_t* size)
+{
+    std::lock_guard<std::mutex> l(regLock);
+    if(addr >= regXml)
+    {
+        const uint64_t off = addr - regXml;
+        if(off + *size > xml.size())
+            return fail(GC_ERR_INVALID_ADDRESS, "read beyond XML");
+        memcpy(buffer, xml.data() + off, *size);
+        return GC_ERR_SUCCESS;
+    }
+    if(addr + *size > regSize)
+        return fail(GC_ERR_INVALID_ADDRESS, "read beyond registers");
+    memcpy(buffer, regs + addr, *size);
+    return GC_ERR_SUCCESS;
+}
+
+GC_ERROR Device::write(uint64_t addr, const void* buffer, size_t* size)
+{
+    {
+        std::lock_guard<std::mutex> l(regLock);
+        if(addr + *size > regSize || addr == regWidthMax || addr == regHeightMax || addr == regPayloadSize)
+            return fail(GC_ERR_ACCESS_DENIED, "register is read only");
+
+        const bool locked = reg32(regTLParamsLocked) != 0;
+        if(locked && (addr == regWidth || addr == regHeight || addr == regPixelFormat))
+            return fail(GC_ERR_ACCESS_DENIED, "transport layer parameters are locked");
+
+        if(addr != regAcquisitionStart && addr != regAcquisitionStop)
+            memcpy(regs + addr, buffer, *size);
+
+        setReg32(regPayloadSize, uint32_t(payloadSize()));
+    }
+    return GC_ERR_SUCCESS;
+}
+
+///////////////////////////////////////////
+/// Frame generation
+
+///Writes 16 bit samples in the wire layout of the pixel format
+void packRow(uint32_t pfnc, const uint16_t* src, unsigned width, unsigned char* dst)
+{
+    const unsigned bits = pixelBits(pfnc);
+    if(bits == 8)
+    {
+        for(unsigned x = 0; x < width; x++)
+            dst[x] = static_cast<unsigned char>(src[x]);
+    }
+    else if(bits == 16)
+    {
+        memcpy(dst, src, width * sizeof(uint16_t));
+    }
+    else if(isGvspPacked(pfnc))
+    {
+        for(unsigned x = 0; x + 1 < width; x += 2, dst += 3)
+        {
+            dst[0] = static_cast<unsigned char>(src[x] >> 4);
+            dst[1] = static_cast<unsigned char>((src[x] & 0x0F) | ((src[x + 1] & 0x0F) << 4));
+            dst[2] = static_cast<unsigned char>(src[x + 1] >> 4);
+        }
+    }
+    else
+    {
+        //PFNC "p" formats are a LSB first bit stream
+        uint32_t acc = 0;
+        unsigned accBits = 0;
+        for(unsigned x = 0; x < width; x++)
+        {
+            acc |= uint32_t(src[x]) << accBits;
+            accBits += bits;
+            while(accBits >= 8)
+            {
+                *dst++ = static_cast<unsigned char>(acc);
+                acc >>= 8;
+                accBits -= 8;
+            }
+        }
+        if(accBits > 0)
+            *dst = static_cast<unsigned char>(acc);
+    }
+}
+
+///Pre-renders a few frames of a moving gradient, delivery only copies memory
+void Stream::render()
+{
+    const uint32_t pfnc = device->reg32(regPixelFormat);
+    const unsigned width = device->reg32(regWidth);
+    const unsigned height = device->reg32(regHeight);
+    const size_t pitch = size_t(width) * pixelBits(pfnc) / 8;
+    const uint32_t maxVal = (1u << sampleBits(pfnc)) - 1;
+
+    frames.assign(8, std::vector<unsigned char>(pitch * height));
+    std::vector<uint16_t> row(width);
+    for(size_t f = 0; f < frames.size(); f++)
+    {
+        for(unsigned y = 0; y < height; y++)
+        {
+            for(unsigned x = 0; x < width; x++)
+                row[x] = static_cast<uint16_t>(((x + y + f * 32) * maxVal / (width + height)) & maxVal);
+            packRow(pfnc, row.data(), width, frames[f].data() + y * pitch);
+        }
+    }
+}
+
+///////////////////////////////////////////
+/// Acquisition
+
+void Stream::start(uint64_t count)
+{
+    stop();
+    render();
+    toAcquire = count;
+    started = 0;
+    {
+        std::lock_guard<std::mutex> l(lock);
+        killed = false;
+    }
+    running = true;
+    thread = std::thread([this](){run();});
+}
+
+void Stream::stop()
+{
+    running = false;
+    if(thread.joinable())
+        thread.join();
+}
+
+void Stream::run()
+{
+    const Settings& cfg = settings();
+    auto next = std::chrono::steady_clock::now();
+    const auto t0 = next;
+
+    while(running && (toAcquire == 0 || started < toAcquire))
+    {
+        double fps = cfg.fps;
+        {
+            std::lock_guard<std::mutex> l(device->regLock);
+            if(device->reg32(regFrameRateEnable) != 0 && device->regDouble(regFrameRate) > 0)
+                fps = device->regDouble(regFrameRate);
+        }
+        next += std::chrono::microseconds(int64_t(1e6 / fps));
+        std::this_thread::sleep_until(next);
+
+        const uint64_t id = ++frameId;
+        if(cfg.lostEvery > 0 && id % uint64_t(cfg.lostEvery) == 0)
+            continue;
+
+        if(cfg.stallEvery > 0 && id % uint64_t(cfg.stallEvery) == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(cfg.stallMs));
+            next = std::chrono::steady_clock::now();
+        }
+
+        BufferEntry* buf = nullptr;
+        {
+            std::lock_guard<std::mutex> l(lock);
+            if(input.empty())
+            {
+                underrun++;
+                continue;
+            }
+            buf = input.front();
+            input.pop_front();
+        }
+
+        const std::vector<unsigned char>& frame = frames[id % frames.size()];
+        const bool incomplete = cfg.incompleteEvery > 0 && id % uint64_t(cfg.incompleteEvery) == 0;
+        size_t sz = std::min(buf->size, frame.size());
+        if(incomplete)
+            sz /= 2;
+        memcpy(buf->base, frame.data(), sz);
+
+        buf->filled = sz;
+        buf->incomplete = incomplete || buf->size < frame.size();
+        buf->frameId = id;
+        buf->timestampNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - t0).count());
+        {
+            std::lock_guard<std::mutex> l(device->regLock);
+            buf->pixelFormat = device->reg32(regPixelFormat);
+            buf->width = device->reg32(regWidth);
+            buf->height = device->reg32(regHeight);
+        }
+
+        {
+            std::lock_guard<std::mutex> l(lock);
+            buf->queued = false;
+            output.push_back(buf);
+            started++;
+        }
+        cv.notify_one();
+    }
+    running = false;
+}
+
+Device* findDevice(const char* id)
+{
+    if(!gSystem || id == nullptr)
+        return nullptr;
+    for(auto& d : gSystem->iface.devices)
+    {
+        if(d->id == id)
+            return d.get();
+    }
+    return nullptr;
+}
+
+GC_ERROR deviceInfo(Device* dev, DEVICE_INFO_CMD cmd, INFO_DATATYPE* type, void* buffer, size_t* size)
+{
+    switch(cmd)
+    {
+    case DEVICE_INFO_ID:
+        return putString(type, buffer, size, dev->id);
+    case DEVICE_INFO_VENDOR:
+        return putString(type, buffer, size, cVendor);
+    case DEVICE_INFO_MODEL:
+        return putString(type, buffer, size, cModel);
+    case DEVICE_INFO_TLTYPE:
+        return putString(type, buffer, size, cTLType);
+    case DEVICE_INFO_DISPLAYNAME:
+        return putString(type, buffer, size, std::string(cModel) + " " + std::to_string(dev->index));
+    case DEVICE_INFO_ACCESS_STATUS:
+        return putValue<int32_t>(type, buffer, size, INFO_DATATYPE_INT32,
+                                 dev->open ? DEVICE_ACCESS_STATUS_OPEN_READWRITE : DEVICE_ACCESS_STATUS_READWRITE);
+    case DEVICE_INFO_USER_DEFINED_NAME:
+        return putString(type, buffer, size, dev->id);
+    case DEVICE_INFO_SERIAL_NUMBER:
+        return putString(type, buffer, size, "MOCK" + std::to_string(1000 + dev->index));
+    case DEVICE_INFO_VERSION:
+        return putString(type, buffer, size, "1.0");
+    case DEVICE_INFO_TIMESTAMP_FREQUENCY:
+        return putValue<uint64_t>(type, buffer, size, INFO_DATATYPE_UINT64, 1000000000ull);
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "device info not available");
+    }
+}
+
+}
+
+///////////////////////////////////////////
+/// GenTL entry points
+
+extern "C" {
+namespace GenTL {
+
+GC_API GCGetInfo(TL_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    switch(iInfoCmd)
+    {
+    case TL_INFO_ID:
+        return putString(piType, pBuffer, piSize, "MockGenTL");
+    case TL_INFO_VENDOR:
+        return putString(piType, pBuffer, piSize, cVendor);
+    case TL_INFO_MODEL:
+        return putString(piType, pBuffer, piSize, "MockGenTL");
+    case TL_INFO_VERSION:
+        return putString(piType, pBuffer, piSize, "1.0");
+    case TL_INFO_TLTYPE:
+        return putString(piType, pBuffer, piSize, cTLType);
+    case TL_INFO_NAME:
+        return putString(piType, pBuffer, piSize, "MockGenTL.cti");
+    case TL_INFO_PATHNAME:
+        return putString(piType, pBuffer, piSize, "MockGenTL.cti");
+    case TL_INFO_DISPLAYNAME:
+        return putString(piType, pBuffer, piSize, "Mock GenTL producer");
+    case TL_INFO_CHAR_ENCODING:
+        return putValue<int32_t>(piType, pBuffer, piSize, INFO_DATATYPE_INT32, TL_CHAR_ENCODING_ASCII);
+    case TL_INFO_GENTL_VER_MAJOR:
+        return putValue<uint32_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT32, cGenTLMajor);
+    case TL_INFO_GENTL_VER_MINOR:
+        return putValue<uint32_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT32, cGenTLMinor);
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "system info not available");
+    }
+}
+
+GC_API GCGetLastError(GC_ERROR* piErrorCode, char* sErrText, size_t* piSize)
+{
+    if(piErrorCode != nullptr)
+        *piErrorCode = gLastError;
+    return putString(nullptr, sErrText, piSize, gLastErrorText);
+}
+
+GC_API GCInitLib(void)
+{
+    if(gInitialized)
+        return fail(GC_ERR_RESOURCE_IN_USE, "already initialized");
+    gInitialized = true;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API GCCloseLib(void)
+{
+    if(!gInitialized)
+        return fail(GC_ERR_NOT_INITIALIZED, "not initialized");
+    gSystem.reset();
+    gInitialized = false;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API GCReadPort(PORT_HANDLE hPort, uint64_t iAddress, void* pBuffer, size_t* piSize)
+{
+    auto* port = cast<RemotePort>(hPort, hkRemotePort);
+    if(port == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "not a remote device port");
+    if(pBuffer == nullptr || piSize == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "null buffer");
+    return port->device->read(iAddress, pBuffer, piSize);
+}
+
+GC_API GCWritePort(PORT_HANDLE hPort, uint64_t iAddress, const void* pBuffer, size_t* piSize)
+{
+    auto* port = cast<RemotePort>(hPort, hkRemotePort);
+    if(port == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "not a remote device port");
+    if(pBuffer == nullptr || piSize == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "null buffer");
+    return port->device->write(iAddress, pBuffer, piSize);
+}
+
+GC_API GCGetNumPortURLs(PORT_HANDLE hPort, uint32_t* piNumURLs)
+{
+    if(hPort == nullptr || piNumURLs == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "null parameter");
+    //Only the remote device has a description, the modules have none
+    *piNumURLs = cast<RemotePort>(hPort, hkRemotePort) != nullptr ? 1 : 0;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API GCGetPortURLInfo(PORT_HANDLE hPort, uint32_t iURLIndex, URL_INFO_CMD iInfoCmd,
+                        INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* port = cast<RemotePort>(hPort, hkRemotePort);
+    if(port == nullptr || iURLIndex != 0)
+        return fail(GC_ERR_INVALID_INDEX, "no such URL");
+
+    std::stringstream url;
+    url << "Local:MockCamera.xml;" << std::hex << uint64_t(regXml) << ";" << port->device->xml.size();
+
+    switch(iInfoCmd)
+    {
+    case URL_INFO_URL:
+        return putString(piType, pBuffer, piSize, url.str());
+    case URL_INFO_SCHEMA_VER_MAJOR:
+        return putValue<int32_t>(piType, pBuffer, piSize, INFO_DATATYPE_INT32, 1);
+    case URL_INFO_SCHEMA_VER_MINOR:
+        return putValue<int32_t>(piType, pBuffer, piSize, INFO_DATATYPE_INT32, 1);
+    case URL_INFO_FILE_VER_MAJOR:
+        return putValue<int32_t>(piType, pBuffer, piSize, INFO_DATATYPE_INT32, 1);
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "URL info not available");
+    }
+}
+
+GC_API GCGetPortURL(PORT_HANDLE hPort, char* sURL, size_t* piSize)
+{
+    return GCGetPortURLInfo(hPort, 0, URL_INFO_URL, nullptr, sURL, piSize);
+}
+
+GC_API GCGetPortInfo(PORT_HANDLE hPort, PORT_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    if(hPort == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "null port");
+
+    const bool remote = cast<RemotePort>(hPort, hkRemotePort) != nullptr;
+    switch(iInfoCmd)
+    {
+    case PORT_INFO_ID:
+        return putString(piType, pBuffer, piSize, remote ? "Device" : "Module");
+    case PORT_INFO_VENDOR:
+        return putString(piType, pBuffer, piSize, cVendor);
+    case PORT_INFO_MODEL:
+        return putString(piType, pBuffer, piSize, cModel);
+    case PORT_INFO_TLTYPE:
+        return putString(piType, pBuffer, piSize, cTLType);
+    case PORT_INFO_MODULE:
+        return putString(piType, pBuffer, piSize, remote ? "Device" : "TLSystem");
+    case PORT_INFO_LITTLE_ENDIAN:
+        return putBool(piType, pBuffer, piSize, true);
+    case PORT_INFO_BIG_ENDIAN:
+        return putBool(piType, pBuffer, piSize, false);
+    case PORT_INFO_ACCESS_READ:
+    case PORT_INFO_ACCESS_WRITE:
+        return putBool(piType, pBuffer, piSize, remote);
+    case PORT_INFO_ACCESS_NA:
+        return putBool(piType, pBuffer, piSize, !remote);
+    case PORT_INFO_ACCESS_NI:
+        return putBool(piType, pBuffer, piSize, false);
+    case PORT_INFO_VERSION:
+        return putString(piType, pBuffer, piSize, "1.0");
+    case PORT_INFO_PORTNAME:
+        return putString(piType, pBuffer, piSize, "Device");
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "port info not available");
+    }
+}
+
+GC_API GCReadPortStacked(PORT_HANDLE hPort, PORT_REGISTER_STACK_ENTRY* pEntries, size_t* piNumEntries)
+{
+    if(pEntries == nullptr || piNumEntries == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "null parameter");
+    for(size_t i = 0; i < *piNumEntries; i++)
+    {
+        size_t sz = pEntries[i].Size;
+        GC_ERROR err = GCReadPort(hPort, pEntries[i].Address, pEntries[i].pBuffer, &sz);
+        if(err != GC_ERR_SUCCESS)
+        {
+            *piNumEntries = i;
+            return err;
+        }
+    }
+    return GC_ERR_SUCCESS;
+}
+
+GC_API GCWritePortStacked(PORT_HANDLE hPort, PORT_REGISTER_STACK_ENTRY* pEntries, size_t* piNumEntries)
+{
+    if(pEntries == nullptr || piNumEntries == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "null parameter");
+    for(size_t i = 0; i < *piNumEntries; i++)
+    {
+        size_t sz = pEntries[i].Size;
+        GC_ERROR err = GCWritePort(hPort, pEntries[i].Address, pEntries[i].pBuffer, &sz);
+        if(err != GC_ERR_SUCCESS)
+        {
+            *piNumEntries = i;
+            return err;
+        }
+    }
+    return GC_ERR_SUCCESS;
+}
+
+GC_API GCRegisterEvent(EVENTSRC_HANDLE hEventSrc, EVENT_TYPE iEventID, EVENT_HANDLE* phEvent)
+{
+    auto* ds = cast<Stream>(hEventSrc, hkStream);
+    if(ds == nullptr || phEvent == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "events are only supported on streams");
+    if(iEventID != EVENT_NEW_BUFFER)
+        return fail(GC_ERR_NOT_IMPLEMENTED, "only new buffer events are supported");
+    if(ds->eventRegistered)
+        return fail(GC_ERR_RESOURCE_IN_USE, "event already registered");
+    ds->eventRegistered = true;
+    *phEvent = &ds->event;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API GCUnregisterEvent(EVENTSRC_HANDLE hEventSrc, EVENT_TYPE iEventID)
+{
+    auto* ds = cast<Stream>(hEventSrc, hkStream);
+    if(ds == nullptr || iEventID != EVENT_NEW_BUFFER)
+        return fail(GC_ERR_INVALID_HANDLE, "event not registered");
+    {
+        std::lock_guard<std::mutex> l(ds->lock);
+        ds->killed = true;
+    }
+    ds->cv.notify_all();
+    ds->eventRegistered = false;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API EventGetData(EVENT_HANDLE hEvent, void* pBuffer, size_t* piSize, uint64_t iTimeout)
+{
+    auto* ev = cast<Event>(hEvent, hkEvent);
+    if(ev == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid event");
+    if(pBuffer == nullptr || piSize == nullptr || *piSize < sizeof(EVENT_NEW_BUFFER_DATA))
+        return fail(GC_ERR_BUFFER_TOO_SMALL, "buffer too small");
+
+    Stream* ds = ev->stream;
+    std::unique_lock<std::mutex> l(ds->lock);
+    auto ready = [ds](){return ds->killed || !ds->output.empty();};
+    if(iTimeout == GENTL_INFINITE)
+        ds->cv.wait(l, ready);
+    else if(!ds->cv.wait_for(l, std::chrono::milliseconds(iTimeout), ready))
+        return fail(GC_ERR_TIMEOUT, "timeout");
+
+    if(ds->killed)
+    {
+        ds->killed = false;
+        return fail(GC_ERR_ABORT, "wait aborted");
+    }
+
+    BufferEntry* buf = ds->output.front();
+    ds->output.pop_front();
+    ds->delivered++;
+
+    auto* data = static_cast<EVENT_NEW_BUFFER_DATA*>(pBuffer);
+    data->BufferHandle = buf;
+    data->pUserPointer = buf->priv;
+    *piSize = sizeof(EVENT_NEW_BUFFER_DATA);
+    return GC_ERR_SUCCESS;
+}
+
+GC_API EventGetDataInfo(EVENT_HANDLE hEvent, const void* pInBuffer, size_t iInSize, EVENT_DATA_INFO_CMD iInfoCmd,
+                        INFO_DATATYPE* piType, void* pOutBuffer, size_t* piOutSize)
+{
+    if(cast<Event>(hEvent, hkEvent) == nullptr || pInBuffer == nullptr || iInSize < sizeof(EVENT_NEW_BUFFER_DATA))
+        return fail(GC_ERR_INVALID_PARAMETER, "invalid event data");
+    const auto* data = static_cast<const EVENT_NEW_BUFFER_DATA*>(pInBuffer);
+    if(iInfoCmd == EVENT_DATA_ID)
+        return putValue<BUFFER_HANDLE>(piType, pOutBuffer, piOutSize, INFO_DATATYPE_PTR, data->BufferHandle);
+    if(iInfoCmd == EVENT_DATA_VALUE)
+        return putValue<void*>(piType, pOutBuffer, piOutSize, INFO_DATATYPE_PTR, data->pUserPointer);
+    return fail(GC_ERR_NOT_AVAILABLE, "event data info not available");
+}
+
+GC_API EventGetInfo(EVENT_HANDLE hEvent, EVENT_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* ev = cast<Event>(hEvent, hkEvent);
+    if(ev == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid event");
+    switch(iInfoCmd)
+    {
+    case EVENT_EVENT_TYPE:
+        return putValue<int32_t>(piType, pBuffer, piSize, INFO_DATATYPE_INT32, EVENT_NEW_BUFFER);
+    case EVENT_NUM_IN_QUEUE:
+    {
+        std::lock_guard<std::mutex> l(ev->stream->lock);
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, ev->stream->output.size());
+    }
+    case EVENT_NUM_FIRED:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, ev->stream->started);
+    case EVENT_SIZE_MAX:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, sizeof(EVENT_NEW_BUFFER_DATA));
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "event info not available");
+    }
+}
+
+GC_API EventFlush(EVENT_HANDLE hEvent)
+{
+    auto* ev = cast<Event>(hEvent, hkEvent);
+    if(ev == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid event");
+    std::lock_guard<std::mutex> l(ev->stream->lock);
+    ev->stream->output.clear();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API EventKill(EVENT_HANDLE hEvent)
+{
+    auto* ev = cast<Event>(hEvent, hkEvent);
+    if(ev == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid event");
+    {
+        std::lock_guard<std::mutex> l(ev->stream->lock);
+        ev->stream->killed = true;
+    }
+    ev->stream->cv.notify_all();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API TLOpen(TL_HANDLE* phTL)
+{
+    if(!gInitialized)
+        return fail(GC_ERR_NOT_INITIALIZED, "not initialized");
+    if(phTL == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "null handle");
+    if(gSystem && gSystem->open)
+        return fail(GC_ERR_RESOURCE_IN_USE, "system already open");
+    if(!gSystem)
+        gSystem.reset(new System);
+    gSystem->open = true;
+    *phTL = gSystem.get();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API TLClose(TL_HANDLE hTL)
+{
+    auto* tl = cast<System>(hTL, hkSystem);
+    if(tl == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid system");
+    tl->open = false;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API TLGetInfo(TL_HANDLE hTL, TL_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    if(cast<System>(hTL, hkSystem) == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid system");
+    return GCGetInfo(iInfoCmd, piType, pBuffer, piSize);
+}
+
+GC_API TLGetNumInterfaces(TL_HANDLE hTL, uint32_t* piNumIfaces)
+{
+    if(cast<System>(hTL, hkSystem) == nullptr || piNumIfaces == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid system");
+    *piNumIfaces = 1;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API TLGetInterfaceID(TL_HANDLE hTL, uint32_t iIndex, char* sID, size_t* piSize)
+{
+    auto* tl = cast<System>(hTL, hkSystem);
+    if(tl == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid system");
+    if(iIndex != 0)
+        return fail(GC_ERR_INVALID_INDEX, "no such interface");
+    return putString(nullptr, sID, piSize, tl->iface.id);
+}
+
+GC_API TLGetInterfaceInfo(TL_HANDLE hTL, const char* sIfaceID, INTERFACE_INFO_CMD iInfoCmd,
+                          INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* tl = cast<System>(hTL, hkSystem);
+    if(tl == nullptr || sIfaceID == nullptr || tl->iface.id != sIfaceID)
+        return fail(GC_ERR_INVALID_ID, "no such interface");
+    switch(iInfoCmd)
+    {
+    case INTERFACE_INFO_ID:
+        return putString(piType, pBuffer, piSize, tl->iface.id);
+    case INTERFACE_INFO_DISPLAYNAME:
+        return putString(piType, pBuffer, piSize, "Mock interface");
+    case INTERFACE_INFO_TLTYPE:
+        return putString(piType, pBuffer, piSize, cTLType);
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "interface info not available");
+    }
+}
+
+GC_API TLOpenInterface(TL_HANDLE hTL, const char* sIfaceID, IF_HANDLE* phIface)
+{
+    auto* tl = cast<System>(hTL, hkSystem);
+    if(tl == nullptr || sIfaceID == nullptr || tl->iface.id != sIfaceID || phIface == nullptr)
+        return fail(GC_ERR_INVALID_ID, "no such interface");
+    tl->iface.open = true;
+    *phIface = &tl->iface;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API TLUpdateInterfaceList(TL_HANDLE hTL, bool8_t* pbChanged, uint64_t iTimeout)
+{
+    (void)iTimeout;
+    if(cast<System>(hTL, hkSystem) == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid system");
+    if(pbChanged != nullptr)
+        *pbChanged = 0;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API IFClose(IF_HANDLE hIface)
+{
+    auto* iface = cast<Interface>(hIface, hkInterface);
+    if(iface == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    iface->open = false;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API IFGetInfo(IF_HANDLE hIface, INTERFACE_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* iface = cast<Interface>(hIface, hkInterface);
+    if(iface == nullptr || !gSystem)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    return TLGetInterfaceInfo(gSystem.get(), iface->id.c_str(), iInfoCmd, piType, pBuffer, piSize);
+}
+
+GC_API IFUpdateDeviceList(IF_HANDLE hIface, bool8_t* pbChanged, uint64_t iTimeout)
+{
+    (void)iTimeout;
+    auto* iface = cast<Interface>(hIface, hkInterface);
+    if(iface == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    const bool changed = iface->devices.empty();
+    for(int i = int(iface->devices.size()); i < settings().devices; i++)
+        iface->devices.emplace_back(new Device(i));
+    if(pbChanged != nullptr)
+        *pbChanged = changed ? 1 : 0;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API IFGetNumDevices(IF_HANDLE hIface, uint32_t* piNumDevices)
+{
+    auto* iface = cast<Interface>(hIface, hkInterface);
+    if(iface == nullptr || piNumDevices == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    *piNumDevices = uint32_t(iface->devices.size());
+    return GC_ERR_SUCCESS;
+}
+
+GC_API IFGetDeviceID(IF_HANDLE hIface, uint32_t iIndex, char* sIDeviceID, size_t* piSize)
+{
+    auto* iface = cast<Interface>(hIface, hkInterface);
+    if(iface == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    if(iIndex >= iface->devices.size())
+        return fail(GC_ERR_INVALID_INDEX, "no such device");
+    return putString(nullptr, sIDeviceID, piSize, iface->devices[iIndex]->id);
+}
+
+GC_API IFGetDeviceInfo(IF_HANDLE hIface, const char* sDeviceID, DEVICE_INFO_CMD iInfoCmd,
+                       INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    if(cast<Interface>(hIface, hkInterface) == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    Device* dev = findDevice(sDeviceID);
+    if(dev == nullptr)
+        return fail(GC_ERR_INVALID_ID, "no such device");
+    return deviceInfo(dev, iInfoCmd, piType, pBuffer, piSize);
+}
+
+GC_API IFOpenDevice(IF_HANDLE hIface, const char* sDeviceID, DEVICE_ACCESS_FLAGS iOpenFlags, DEV_HANDLE* phDevice)
+{
+    (void)iOpenFlags;
+    if(cast<Interface>(hIface, hkInterface) == nullptr || phDevice == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    Device* dev = findDevice(sDeviceID);
+    if(dev == nullptr)
+        return fail(GC_ERR_INVALID_ID, "no such device");
+    if(dev->open)
+        return fail(GC_ERR_RESOURCE_IN_USE, "device already open");
+    dev->open = true;
+    *phDevice = dev;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API IFGetParentTL(IF_HANDLE hIface, TL_HANDLE* phSystem)
+{
+    if(cast<Interface>(hIface, hkInterface) == nullptr || phSystem == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid interface");
+    *phSystem = gSystem.get();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DevGetPort(DEV_HANDLE hDevice, PORT_HANDLE* phRemoteDevice)
+{
+    auto* dev = cast<Device>(hDevice, hkDevice);
+    if(dev == nullptr || phRemoteDevice == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    *phRemoteDevice = &dev->port;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DevGetNumDataStreams(DEV_HANDLE hDevice, uint32_t* piNumDataStreams)
+{
+    if(cast<Device>(hDevice, hkDevice) == nullptr || piNumDataStreams == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    *piNumDataStreams = 1;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DevGetDataStreamID(DEV_HANDLE hDevice, uint32_t iIndex, char* sDataStreamID, size_t* piSize)
+{
+    if(cast<Device>(hDevice, hkDevice) == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    if(iIndex != 0)
+        return fail(GC_ERR_INVALID_INDEX, "no such stream");
+    return putString(nullptr, sDataStreamID, piSize, "Stream0");
+}
+
+GC_API DevOpenDataStream(DEV_HANDLE hDevice, const char* sDataStreamID, DS_HANDLE* phDataStream)
+{
+    auto* dev = cast<Device>(hDevice, hkDevice);
+    if(dev == nullptr || phDataStream == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    if(sDataStreamID == nullptr || strcmp(sDataStreamID, "Stream0") != 0)
+        return fail(GC_ERR_INVALID_ID, "no such stream");
+    if(dev->stream)
+        return fail(GC_ERR_RESOURCE_IN_USE, "stream already open");
+    dev->stream.reset(new Stream(dev));
+    *phDataStream = dev->stream.get();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DevGetInfo(DEV_HANDLE hDevice, DEVICE_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* dev = cast<Device>(hDevice, hkDevice);
+    if(dev == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    return deviceInfo(dev, iInfoCmd, piType, pBuffer, piSize);
+}
+
+GC_API DevClose(DEV_HANDLE hDevice)
+{
+    auto* dev = cast<Device>(hDevice, hkDevice);
+    if(dev == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    dev->stream.reset();
+    dev->open = false;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DevGetParentIF(DEV_HANDLE hDevice, IF_HANDLE* phIface)
+{
+    if(cast<Device>(hDevice, hkDevice) == nullptr || phIface == nullptr || !gSystem)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid device");
+    *phIface = &gSystem->iface;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSAnnounceBuffer(DS_HANDLE hDataStream, void* pBuffer, size_t iSize, void* pPrivate, BUFFER_HANDLE* phBuffer)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr || pBuffer == nullptr || phBuffer == nullptr)
+        return fail(GC_ERR_INVALID_PARAMETER, "invalid stream or buffer");
+
+    std::unique_ptr<BufferEntry> buf(new BufferEntry);
+    buf->base = static_cast<unsigned char*>(pBuffer);
+    buf->size = iSize;
+    buf->priv = pPrivate;
+    *phBuffer = buf.get();
+
+    std::lock_guard<std::mutex> l(ds->lock);
+    ds->announced.push_back(std::move(buf));
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSAllocAndAnnounceBuffer(DS_HANDLE hDataStream, size_t iSize, void* pPrivate, BUFFER_HANDLE* phBuffer)
+{
+    auto* mem = new (std::nothrow) unsigned char[iSize];
+    if(mem == nullptr)
+        return fail(GC_ERR_OUT_OF_MEMORY, "out of memory");
+    GC_ERROR err = DSAnnounceBuffer(hDataStream, mem, iSize, pPrivate, phBuffer);
+    if(err != GC_ERR_SUCCESS)
+    {
+        delete[] mem;
+        return err;
+    }
+    static_cast<BufferEntry*>(*phBuffer)->owned = true;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSFlushQueue(DS_HANDLE hDataStream, ACQ_QUEUE_TYPE iOperation)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+
+    std::lock_guard<std::mutex> l(ds->lock);
+    switch(iOperation)
+    {
+    case ACQ_QUEUE_INPUT_TO_OUTPUT:
+        for(auto* b : ds->input)
+        {
+            b->queued = false;
+            b->filled = 0;
+            b->incomplete = true;
+            ds->output.push_back(b);
+        }
+        ds->input.clear();
+        break;
+    case ACQ_QUEUE_OUTPUT_DISCARD:
+        ds->output.clear();
+        break;
+    case ACQ_QUEUE_ALL_TO_INPUT:
+    case ACQ_QUEUE_UNQUEUED_TO_INPUT:
+        ds->input.clear();
+        ds->output.clear();
+        for(auto& b : ds->announced)
+        {
+            b->queued = true;
+            ds->input.push_back(b.get());
+        }
+        break;
+    case ACQ_QUEUE_ALL_DISCARD:
+        for(auto* b : ds->input)
+            b->queued = false;
+        ds->input.clear();
+        ds->output.clear();
+        break;
+    default:
+        return fail(GC_ERR_INVALID_PARAMETER, "unknown queue operation");
+    }
+    ds->cv.notify_all();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSStartAcquisition(DS_HANDLE hDataStream, ACQ_START_FLAGS iStartFlags, uint64_t iNumToAcquire)
+{
+    (void)iStartFlags;
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+    if(ds->running)
+        return fail(GC_ERR_RESOURCE_IN_USE, "acquisition already running");
+    ds->start(iNumToAcquire == GENTL_INFINITE ? 0 : iNumToAcquire);
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSStopAcquisition(DS_HANDLE hDataStream, ACQ_STOP_FLAGS iStopFlags)
+{
+    (void)iStopFlags;
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+    ds->stop();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSGetInfo(DS_HANDLE hDataStream, STREAM_INFO_CMD iInfoCmd, INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+
+    std::lock_guard<std::mutex> l(ds->lock);
+    switch(iInfoCmd)
+    {
+    case STREAM_INFO_ID:
+        return putString(piType, pBuffer, piSize, ds->id);
+    case STREAM_INFO_NUM_DELIVERED:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, ds->delivered);
+    case STREAM_INFO_NUM_UNDERRUN:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, ds->underrun);
+    case STREAM_INFO_NUM_ANNOUNCED:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, ds->announced.size());
+    case STREAM_INFO_NUM_QUEUED:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, ds->input.size());
+    case STREAM_INFO_NUM_AWAIT_DELIVERY:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, ds->output.size());
+    case STREAM_INFO_NUM_STARTED:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, ds->started);
+    case STREAM_INFO_PAYLOAD_SIZE:
+    {
+        std::lock_guard<std::mutex> r(ds->device->regLock);
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, ds->device->payloadSize());
+    }
+    case STREAM_INFO_IS_GRABBING:
+        return putBool(piType, pBuffer, piSize, ds->running);
+    case STREAM_INFO_DEFINES_PAYLOADSIZE:
+        return putBool(piType, pBuffer, piSize, true);
+    case STREAM_INFO_TLTYPE:
+        return putString(piType, pBuffer, piSize, cTLType);
+    case STREAM_INFO_NUM_CHUNKS_MAX:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, 0);
+    case STREAM_INFO_BUF_ANNOUNCE_MIN:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, 1);
+    case STREAM_INFO_BUF_ALIGNMENT:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, 1);
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "stream info not available");
+    }
+}
+
+GC_API DSGetBufferID(DS_HANDLE hDataStream, uint32_t iIndex, BUFFER_HANDLE* phBuffer)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr || phBuffer == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+    std::lock_guard<std::mutex> l(ds->lock);
+    if(iIndex >= ds->announced.size())
+        return fail(GC_ERR_INVALID_INDEX, "no such buffer");
+    *phBuffer = ds->announced[iIndex].get();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSClose(DS_HANDLE hDataStream)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+    ds->stop();
+    {
+        std::lock_guard<std::mutex> l(ds->lock);
+        for(auto& b : ds->announced)
+        {
+            if(b->owned)
+                delete[] b->base;
+        }
+    }
+    ds->device->stream.reset();
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSRevokeBuffer(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer, void** pBuffer, void** pPrivate)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    auto* buf = cast<BufferEntry>(hBuffer, hkBuffer);
+    if(ds == nullptr || buf == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream or buffer");
+
+    std::lock_guard<std::mutex> l(ds->lock);
+    if(buf->queued || std::find(ds->output.begin(), ds->output.end(), buf) != ds->output.end())
+        return fail(GC_ERR_BUSY, "buffer is queued");
+
+    for(auto it = ds->announced.begin(); it != ds->announced.end(); ++it)
+    {
+        if(it->get() != buf)
+            continue;
+        if(pBuffer != nullptr)
+            *pBuffer = buf->owned ? nullptr : buf->base;
+        if(pPrivate != nullptr)
+            *pPrivate = buf->priv;
+        if(buf->owned)
+            delete[] buf->base;
+        ds->announced.erase(it);
+        return GC_ERR_SUCCESS;
+    }
+    return fail(GC_ERR_INVALID_HANDLE, "buffer not announced");
+}
+
+GC_API DSQueueBuffer(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    auto* buf = cast<BufferEntry>(hBuffer, hkBuffer);
+    if(ds == nullptr || buf == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream or buffer");
+
+    std::lock_guard<std::mutex> l(ds->lock);
+    if(buf->queued)
+        return fail(GC_ERR_RESOURCE_IN_USE, "buffer already queued");
+    buf->queued = true;
+    buf->filled = 0;
+    ds->input.push_back(buf);
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSGetBufferInfo(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer, BUFFER_INFO_CMD iInfoCmd,
+                       INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    auto* buf = cast<BufferEntry>(hBuffer, hkBuffer);
+    if(ds == nullptr || buf == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream or buffer");
+
+    switch(iInfoCmd)
+    {
+    case BUFFER_INFO_BASE:
+        return putValue<void*>(piType, pBuffer, piSize, INFO_DATATYPE_PTR, buf->base);
+    case BUFFER_INFO_SIZE:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, buf->size);
+    case BUFFER_INFO_USER_PTR:
+        return putValue<void*>(piType, pBuffer, piSize, INFO_DATATYPE_PTR, buf->priv);
+    case BUFFER_INFO_TIMESTAMP:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, buf->timestampNs);
+    case BUFFER_INFO_TIMESTAMP_NS:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, buf->timestampNs);
+    case BUFFER_INFO_NEW_DATA:
+        return putBool(piType, pBuffer, piSize, buf->filled > 0);
+    case BUFFER_INFO_IS_QUEUED:
+        return putBool(piType, pBuffer, piSize, buf->queued);
+    case BUFFER_INFO_IS_ACQUIRING:
+        return putBool(piType, pBuffer, piSize, false);
+    case BUFFER_INFO_IS_INCOMPLETE:
+        return putBool(piType, pBuffer, piSize, buf->incomplete);
+    case BUFFER_INFO_TLTYPE:
+        return putString(piType, pBuffer, piSize, cTLType);
+    case BUFFER_INFO_SIZE_FILLED:
+    case BUFFER_INFO_DATA_SIZE:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, buf->filled);
+    case BUFFER_INFO_WIDTH:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, buf->width);
+    case BUFFER_INFO_HEIGHT:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, buf->height);
+    case BUFFER_INFO_DELIVERED_IMAGEHEIGHT:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, buf->incomplete ? buf->height / 2 : buf->height);
+    case BUFFER_INFO_XOFFSET:
+    case BUFFER_INFO_YOFFSET:
+    case BUFFER_INFO_XPADDING:
+    case BUFFER_INFO_YPADDING:
+    case BUFFER_INFO_IMAGEOFFSET:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, 0);
+    case BUFFER_INFO_FRAMEID:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, buf->frameId);
+    case BUFFER_INFO_IMAGEPRESENT:
+        return putBool(piType, pBuffer, piSize, true);
+    case BUFFER_INFO_PAYLOADTYPE:
+        return putValue<size_t>(piType, pBuffer, piSize, INFO_DATATYPE_SIZET, PAYLOAD_TYPE_IMAGE);
+    case BUFFER_INFO_PIXELFORMAT:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, buf->pixelFormat);
+    case BUFFER_INFO_PIXELFORMAT_NAMESPACE:
+        return putValue<uint64_t>(piType, pBuffer, piSize, INFO_DATATYPE_UINT64, PIXELFORMAT_NAMESPACE_PFNC_32BIT);
+    case BUFFER_INFO_PIXEL_ENDIANNESS:
+        return putValue<int32_t>(piType, pBuffer, piSize, INFO_DATATYPE_INT32, PIXELENDIANNESS_LITTLE);
+    case BUFFER_INFO_CONTAINS_CHUNKDATA:
+        return putBool(piType, pBuffer, piSize, false);
+    case BUFFER_INFO_DATA_LARGER_THAN_BUFFER:
+        return putBool(piType, pBuffer, piSize, buf->incomplete && buf->filled == buf->size);
+    default:
+        return fail(GC_ERR_NOT_AVAILABLE, "buffer info not available");
+    }
+}
+
+GC_API DSGetBufferChunkData(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer, SINGLE_CHUNK_DATA* pChunkData, size_t* piNumChunks)
+{
+    (void)hDataStream; (void)hBuffer; (void)pChunkData;
+    if(piNumChunks != nullptr)
+        *piNumChunks = 0;
+    return fail(GC_ERR_NOT_AVAILABLE, "no chunk data");
+}
+
+GC_API DSGetParentDev(DS_HANDLE hDataStream, DEV_HANDLE* phDevice)
+{
+    auto* ds = cast<Stream>(hDataStream, hkStream);
+    if(ds == nullptr || phDevice == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream");
+    *phDevice = ds->device;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSGetNumBufferParts(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer, uint32_t* piNumParts)
+{
+    if(cast<Stream>(hDataStream, hkStream) == nullptr || cast<BufferEntry>(hBuffer, hkBuffer) == nullptr || piNumParts == nullptr)
+        return fail(GC_ERR_INVALID_HANDLE, "invalid stream or buffer");
+    //Single part image payload
+    *piNumParts = 0;
+    return GC_ERR_SUCCESS;
+}
+
+GC_API DSGetBufferPartInfo(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer, uint32_t iPartIndex, BUFFER_PART_INFO_CMD iInfoCmd,
+                           INFO_DATATYPE* piType, void* pBuffer, size_t* piSize)
+{
+    (void)hDataStream; (void)hBuffer; (void)iPartIndex; (void)iInfoCmd; (void)piType; (void)pBuffer; (void)piSize;
+    return fail(GC_ERR_NOT_AVAILABLE, "buffers are not multi part");
+}
+
+}
+}
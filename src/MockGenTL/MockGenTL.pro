@@ -0,0 +1,19 @@
+CONFIG -= qt
+CONFIG += plugin c++11
+
+include(../common_defs.pri)
+
+TARGET = MockGenTL
+TEMPLATE = lib
+TARGET_EXT = .cti
+QMAKE_EXTENSION_SHLIB = cti
+CONFIG += no_plugin_name_prefix
+
+win32: OTHER_LIB_PATH = $$absolute_path($$PWD/../../OtherLibs)
+unix:  OTHER_LIB_PATH = $$absolute_path($$PWD/../../OtherLibsLinux)
+
+INCLUDEPATH += $$OTHER_LIB_PATH/GenICam/library/CPP/include
+
+unix: LIBS += -lpthread
+
+SOURCES += MockGenTL.cpp
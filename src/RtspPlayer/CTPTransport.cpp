@@ -6,7 +6,8 @@ CTPTransport::CTPTransport()
 
 }
 
-void CTPTransport::createPacket(const uchar *dataPtr, int len, std::vector<QByteArray> &output)
+void CTPTransport::createPacket(const uchar *dataPtr, int len, std::vector<QByteArray> &output,
+                                quint64 frameId, qint64 captureTimeUs)
 {
     output.clear();
     int size = len, off = 0, id = 0;
@@ -20,11 +21,15 @@ void CTPTransport::createPacket(const uchar *dataPtr, int len, std::vector<QByte
 #endif
         quint32 l = std::min(max_packet_data_size, static_cast<quint32>(size));
 
-        stream << (quint32)headerId;
+        stream << (quint32)(captureTimeUs ? headerIdTimed : headerId);
         stream << (quint32)m_SN;
         stream << (quint32)id++;
         stream << (quint32)off;
         stream << (quint32)len;
+        if(captureTimeUs){
+            stream << frameId;
+            stream << captureTimeUs;
+        }
         stream.writeRawData(pos, l);
         size -= l;
         pos += l;
@@ -45,6 +50,16 @@ quint32 CTPTransport::SN() const
     return m_SN;
 }
 
+quint64 CTPTransport::frameId() const
+{
+    return m_frameId;
+}
+
+qint64 CTPTransport::captureTimeUs() const
+{
+    return m_captureTimeUs;
+}
+
 bool CTPTransport::addUdpPacket(const uchar *dataPtr, int len)
 {
     QByteArray data((char*)dataPtr, len);
@@ -54,7 +69,7 @@ bool CTPTransport::addUdpPacket(const uchar *dataPtr, int len)
 
     stream >> header;
 
-    if(header != headerId)
+    if(header != headerId && header != headerIdTimed)
         return false;
 
     stream >> sn;
@@ -62,6 +77,13 @@ bool CTPTransport::addUdpPacket(const uchar *dataPtr, int len)
     stream >> off;
     stream >> size;
 
+    quint64 frameId = 0;
+    qint64 captureTimeUs = 0;
+    if(header == headerIdTimed){
+        stream >> frameId;
+        stream >> captureTimeUs;
+    }
+
     if(id == 0 && !m_udpPackets.empty()){
         qDebug("ctp: error of begin packet, current count of packets %d", static_cast<int>(m_udpPackets.size()));
         clearPacket();
@@ -73,6 +95,8 @@ bool CTPTransport::addUdpPacket(const uchar *dataPtr, int len)
 
     if(off == 0){
         m_SN = sn;
+        m_frameId = frameId;
+        m_captureTimeUs = captureTimeUs;
 		m_starttime = getNow();
     }
     if(sn != m_SN){
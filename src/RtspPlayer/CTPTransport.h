@@ -10,6 +10,8 @@
 #include "common_utils.h"
 
 const quint32 headerId = 0x01100110;
+/// same as headerId but followed by frame id and capture time of the frame
+const quint32 headerIdTimed = 0x01100111;
 const quint32 max_packet_data_size = 60000;
 const quint32 buffersize_udp = 5000000;
 
@@ -18,10 +20,16 @@ class CTPTransport
 public:
     CTPTransport();
 
-    void createPacket(const uchar *dataPtr, int len, std::vector<QByteArray> &output);
+    /// captureTimeUs is the host time the frame was received from the camera,
+    /// microseconds since epoch. When zero the old header without timing is used
+    void createPacket(const uchar *dataPtr, int len, std::vector<QByteArray> &output,
+                      quint64 frameId = 0, qint64 captureTimeUs = 0);
 
     QByteArray getPacket();
     quint32 SN() const;
+    /// frame id and capture time of the last packet, zero if the sender did not provide them
+    quint64 frameId() const;
+    qint64 captureTimeUs() const;
 
     bool addUdpPacket(const uchar *dataPtr, int len);
     bool isPacketAssembly() const;
@@ -31,6 +39,8 @@ public:
 
 private:
     qint32 m_SN = 0;
+    quint64 m_frameId = 0;
+    qint64 m_captureTimeUs = 0;
 
 	QMap<QString, double> m_durations;
     timepoint m_starttime;
@@ -4,9 +4,11 @@
 #include <QTime>
 #include <QFile>
 #include <QPoint>
+#include <QUrl>
 
 #include <thread>
 #include <chrono>
+#include <algorithm>
 
 #ifdef _MSC_VER
 #include <WinSock2.h>
@@ -274,10 +276,33 @@ QMap<QString, double> RTSPServer::durations()
 {
     mMutexDurs.lock();
     QMap<QString, double> durs = m_durations;
+    std::vector<double> lat = m_latencies;
     mMutexDurs.unlock();
+
+    if(!lat.empty()){
+        std::sort(lat.begin(), lat.end());
+        durs["glass_to_glass_p50"] = lat[lat.size() / 2];
+        durs["glass_to_glass_p99"] = lat[std::min(lat.size() - 1, lat.size() * 99 / 100)];
+    }
     return durs;
 }
 
+void RTSPServer::addLatency(qint64 captureTimeUs)
+{
+    using namespace std::chrono;
+    qint64 now = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    double latency = double(now - captureTimeUs) / 1000.;
+
+    std::lock_guard<std::mutex> lg(mMutexDurs);
+    if(m_latencies.size() < m_max_latencies){
+        m_latencies.push_back(latency);
+    }else{
+        m_latencies[m_latencyPos] = latency;
+    }
+    m_latencyPos = (m_latencyPos + 1) % m_max_latencies;
+    m_durations["glass_to_glass_last"] = latency;
+}
+
 bool RTSPServer::done() const
 {
     return m_done;
@@ -296,6 +321,11 @@ void RTSPServer::doServer()
     if(mVDecoder.get() == nullptr)
         return;
 
+    //Live streams are shown as soon as decoded, files keep frame threading
+    const QString scheme = QUrl(m_url).scheme().toLower();
+    mVDecoder->setLowDelay(scheme == QLatin1String("rtsp") || scheme == QLatin1String("rtp") ||
+                           scheme == QLatin1String("udp") || scheme == QLatin1String("tcp"));
+
     if(!mVDecoder->initContext(m_url, m_isClient)){
         m_playing = false;
         return;
@@ -645,7 +675,11 @@ void RTSPServer::sendSetup()
 
 void RTSPServer::sendPlay()
 {
-    if(mVDecoder.get() == nullptr || !mVDecoder->initDecoder()){
+    if(mVDecoder.get() == nullptr)
+        return;
+
+    mVDecoder->setLowDelay(true);
+    if(!mVDecoder->initDecoder()){
         return;
     }
 
@@ -725,15 +759,18 @@ void RTSPServer::doPlay()
             if(m_ctpTransport.isPacketAssembly()){
                 if(m_encodecPkts.size() < m_max_buffer_size){
                     m_mutexDec.lock();
-                    QByteArray data = m_ctpTransport.getPacket();
-                    m_encodecPkts.push(data);
+                    EncodedPacket pkt;
+                    pkt.data = m_ctpTransport.getPacket();
+                    pkt.frameId = m_ctpTransport.frameId();
+                    pkt.captureTimeUs = m_ctpTransport.captureTimeUs();
+                    m_encodecPkts.push(pkt);
                     m_mutexDec.unlock();
 
                     mMutexDurs.lock();
 					m_durations = mergeMaps(m_durations, m_ctpTransport.durations());
                     mMutexDurs.unlock();
 
-                    m_bytesReaded += data.size();
+                    m_bytesReaded += pkt.data.size();
                 }else{
                     qDebug("packet cannot show. overflow buffer. drop frames %d", ++m_dropFrames);
                 }
@@ -762,16 +799,16 @@ void RTSPServer::doDecode()
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }else{
             m_mutexDec.lock();
-            QByteArray enc = m_encodecPkts.front();
+            EncodedPacket enc = m_encodecPkts.front();
             m_encodecPkts.pop();
             m_mutexDec.unlock();
 
-            decode_packet(enc);
+            decode_packet(enc.data, enc.captureTimeUs);
         }
     }
 }
 
-void RTSPServer::decode_packet(const QByteArray &enc)
+void RTSPServer::decode_packet(const QByteArray &enc, qint64 captureTimeUs)
 {
     m_timerStartServer.restart();
     if(!m_isStartDecode)
@@ -793,6 +830,9 @@ void RTSPServer::decode_packet(const QByteArray &enc)
 
         updateRenderer();
 
+        if(captureTimeUs > 0)
+            addLatency(captureTimeUs);
+
         qDebug("decode duration(ms): %f         \r", duration);
     }
 
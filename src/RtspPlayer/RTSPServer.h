@@ -14,6 +14,7 @@
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "common.h"
 #include "CTPTransport.h"
@@ -143,7 +144,12 @@ private:
     int m_iCSec = 1;
     QString m_options;
 
-    std::queue<QByteArray> m_encodecPkts;
+    struct EncodedPacket{
+        QByteArray data;
+        quint64 frameId = 0;
+        qint64 captureTimeUs = 0;
+    };
+    std::queue<EncodedPacket> m_encodecPkts;
     std::mutex m_mutexDec;
 	size_t m_max_buffer_size = 2;
 
@@ -159,6 +165,12 @@ private:
 
     uint32_t m_dropFrames = 0;
 
+    /// glass to glass latency of the last decoded frames, ms. Needs synchronized clocks
+    std::vector<double> m_latencies;
+    size_t m_latencyPos = 0;
+    size_t m_max_latencies = 512;
+    void addLatency(qint64 captureTimeUs);
+
 	GLRenderer* mRenderer = nullptr;
 
     qint64 max_server_waiting_ms = 20000;
@@ -186,7 +198,12 @@ private:
      * decode images from m_encodecPkts
      */
     void doDecode();
-    void decode_packet(const QByteArray &enc);
+    /**
+     * @brief decode_packet
+     * @param enc
+     * @param captureTimeUs	host capture time of the frame on the sender, 0 if unknown
+     */
+    void decode_packet(const QByteArray &enc, qint64 captureTimeUs = 0);
     void decodePacket();
     /**
      * @brief writeToTcpSocket
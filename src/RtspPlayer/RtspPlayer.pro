@@ -22,6 +22,7 @@ SOURCES = main.cpp \
     common.cpp \
     fastvideo_decoder.cpp \
     jpegenc.cpp \
+    jpeg_rst_decoder.cpp \
     MainWindow.cpp \
     RTSPServer.cpp \
     vdecoder.cpp
@@ -40,6 +41,7 @@ HEADERS += \
     DialogOpenServer.h \
     fastvideo_decoder.h \
     jpegenc.h \
+    jpeg_rst_decoder.h \
     MainWindow.h \
     RTSPServer.h \
     common_utils.h \
@@ -69,6 +71,7 @@ win32{
     LIBS += -ljpeg
 
     QMAKE_CXXFLAGS += -fopenmp
+    QMAKE_LFLAGS += -fopenmp
 }
 
 win32: QMAKE_CXXFLAGS += /openmp
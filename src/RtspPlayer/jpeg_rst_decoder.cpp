@@ -0,0 +1,314 @@
+#include "jpeg_rst_decoder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <algorithm>
+
+#include "jpeglib.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace{
+
+struct error_mgr{
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+void error_exit_jump(j_common_ptr cinfo)
+{
+    error_mgr* err = reinterpret_cast<error_mgr*>(cinfo->err);
+    longjmp(err->jump, 1);
+}
+
+/// corrupted frames are dropped anyway, do not flood the console
+void output_message_quiet(j_common_ptr)
+{
+}
+
+inline int read_be16(const uint8_t* p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+int gcd(int a, int b)
+{
+    while(b){
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int max_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+}
+
+struct jpeg_rst_decoder::strip{
+    jpeg_decompress_struct cinfo;
+    error_mgr err;
+    bytearray data;
+    std::vector<JSAMPROW> rows;
+    int y0 = 0;
+    bool ok = false;
+
+    strip(){
+        cinfo.err = jpeg_std_error(&err.pub);
+        jpeg_create_decompress(&cinfo);
+        err.pub.error_exit = error_exit_jump;
+        err.pub.output_message = output_message_quiet;
+    }
+    ~strip(){
+        jpeg_destroy_decompress(&cinfo);
+    }
+};
+
+jpeg_rst_decoder::jpeg_rst_decoder()
+{
+}
+
+jpeg_rst_decoder::~jpeg_rst_decoder()
+{
+}
+
+bool jpeg_rst_decoder::decode(const bytearray &input, PImage &output)
+{
+    return decode(input.data(), uint32_t(input.size()), output);
+}
+
+bool jpeg_rst_decoder::decode(const uint8_t *input, uint32_t len, PImage &output)
+{
+    if(!input || len == 0)
+        return false;
+
+    frame_info info;
+    int count = parse(input, len, info)? split(input, info) : 0;
+
+    if(count < 2){
+        m_used = 1;
+        if(m_strips.empty())
+            m_strips.emplace_back(new strip);
+        m_strips[0]->y0 = 0;
+        return decode_strip(*m_strips[0], input, len, output, true);
+    }
+
+    if(!output.get() || output->width != info.width || output->height != info.height || output->type != RTSPImage::RGB){
+        output.reset(new RTSPImage);
+        output->setRGB(info.width, info.height);
+    }
+
+    m_used = count;
+#pragma omp parallel for
+    for(int i = 0; i < count; ++i){
+        strip& s = *m_strips[i];
+        s.ok = decode_strip(s, s.data.data(), s.data.size(), output, false);
+    }
+
+    for(int i = 0; i < count; ++i){
+        if(!m_strips[i]->ok)
+            return false;
+    }
+    return true;
+}
+
+bool jpeg_rst_decoder::parse(const uint8_t *input, uint32_t len, frame_info &info) const
+{
+    if(len < 4 || input[0] != 0xFF || input[1] != 0xD8)
+        return false;
+
+    int components = 0;
+    int hmax = 1;
+    int vmax = 1;
+    bool sof = false;
+
+    size_t pos = 2;
+    while(pos + 4 <= len && info.scan_offset == 0){
+        if(input[pos] != 0xFF)
+            return false;
+        uint8_t marker = input[pos + 1];
+        if(marker == 0xFF){
+            pos++;
+            continue;
+        }
+
+        const size_t size = size_t(read_be16(input + pos + 2));
+        if(size < 2 || pos + 2 + size > len)
+            return false;
+        const uint8_t* p = input + pos + 4;
+
+        if(marker == 0xC0 || marker == 0xC1){
+            if(size < 8)
+                return false;
+            info.sof_offset = pos + 5;
+            info.height = read_be16(p + 1);
+            info.width = read_be16(p + 3);
+            components = p[5];
+            if(components == 0 || size < size_t(8 + components * 3))
+                return false;
+            for(int i = 0; i < components; ++i){
+                hmax = std::max(hmax, p[7 + i * 3] >> 4);
+                vmax = std::max(vmax, p[7 + i * 3] & 0x0F);
+            }
+            sof = true;
+        }else if(marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC){
+            /// progressive, lossless and arithmetic coding
+            return false;
+        }else if(marker == 0xDD){
+            if(size < 4)
+                return false;
+            info.restart_interval = read_be16(p);
+        }else if(marker == 0xDA){
+            /// only single interleaved scan
+            if(!sof || p[0] != components)
+                return false;
+            info.scan_offset = pos + 2 + size;
+        }
+        pos += 2 + size;
+    }
+    if(info.scan_offset == 0 || info.width <= 0 || info.height <= 0)
+        return false;
+
+    if(components == 1){
+        info.mcu_width = 8;
+        info.mcu_height = 8;
+    }else{
+        info.mcu_width = 8 * hmax;
+        info.mcu_height = 8 * vmax;
+    }
+
+    size_t start = info.scan_offset;
+    for(size_t i = start; i + 1 < len; ++i){
+        if(input[i] != 0xFF)
+            continue;
+        uint8_t marker = input[i + 1];
+        if(marker == 0x00 || marker == 0xFF)
+            continue;
+        info.segments.push_back(std::make_pair(start, i));
+        if(marker < 0xD0 || marker > 0xD7)
+            return true;
+        start = i + 2;
+        ++i;
+    }
+    /// truncated frame, let libjpeg deal with it
+    return false;
+}
+
+int jpeg_rst_decoder::split(const uint8_t *input, const frame_info &info)
+{
+    const int ri = info.restart_interval;
+    const int mcus_per_row = (info.width + info.mcu_width - 1) / info.mcu_width;
+    const int mcu_rows = (info.height + info.mcu_height - 1) / info.mcu_height;
+    const int count = std::min(max_threads(), mcu_rows);
+    if(ri <= 0 || count < 2)
+        return 0;
+
+    const size_t expected = (size_t(mcus_per_row) * mcu_rows + ri - 1) / ri;
+    if(info.segments.size() != expected)
+        return 0;
+
+    /// strip can start only at a MCU row which begins a restart interval
+    const int step = ri / gcd(ri, mcus_per_row);
+    std::vector<int> starts;
+    for(int k = 0; k < count; ++k){
+        int row = (k * mcu_rows / count + step - 1) / step * step;
+        if(row >= mcu_rows)
+            break;
+        if(starts.empty() || row > starts.back())
+            starts.push_back(row);
+    }
+    if(starts.size() < 2)
+        return 0;
+
+    while(m_strips.size() < starts.size())
+        m_strips.emplace_back(new strip);
+
+    /// every strip is a complete JPEG: original header with the strip height,
+    /// its restart intervals renumbered from RST0 and EOI
+    const size_t header = info.scan_offset;
+    for(size_t k = 0; k < starts.size(); ++k){
+        strip& s = *m_strips[k];
+        const bool last_strip = k + 1 == starts.size();
+        const int r0 = starts[k];
+        const int r1 = last_strip? mcu_rows : starts[k + 1];
+        const size_t first = size_t(r0) * mcus_per_row / ri;
+        const size_t last = last_strip? info.segments.size() : size_t(r1) * mcus_per_row / ri;
+
+        s.y0 = r0 * info.mcu_height;
+        const int height = std::min(r1 * info.mcu_height, info.height) - s.y0;
+
+        size_t size = header;
+        for(size_t j = first; j < last; ++j)
+            size += info.segments[j].second - info.segments[j].first + 2;
+        s.data.resize(size);
+
+        uint8_t* dst = s.data.data();
+        memcpy(dst, input, header);
+        dst[info.sof_offset] = uint8_t(height >> 8);
+        dst[info.sof_offset + 1] = uint8_t(height & 0xFF);
+        dst += header;
+        for(size_t j = first; j < last; ++j){
+            const size_t seg = info.segments[j].second - info.segments[j].first;
+            memcpy(dst, input + info.segments[j].first, seg);
+            dst += seg;
+            *dst++ = 0xFF;
+            *dst++ = j + 1 < last? uint8_t(0xD0 + (j - first) % 8) : 0xD9;
+        }
+    }
+    return int(starts.size());
+}
+
+bool jpeg_rst_decoder::decode_strip(strip &s, const uint8_t *input, size_t len, PImage &output, bool whole)
+{
+    jpeg_decompress_struct& cinfo = s.cinfo;
+
+    if(setjmp(s.err.jump)){
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, (unsigned char*)input, (unsigned long)len);
+    jpeg_read_header(&cinfo, TRUE);
+
+    cinfo.out_color_space = JCS_RGB;
+    if(!whole){
+        /// same as TJFLAG_FASTUPSAMPLE | TJFLAG_FASTDCT, fancy upsampling would show strip seams
+        cinfo.do_fancy_upsampling = FALSE;
+        cinfo.dct_method = JDCT_IFAST;
+    }
+
+    jpeg_start_decompress(&cinfo);
+
+    const int w = int(cinfo.output_width);
+    const int h = int(cinfo.output_height);
+    if(whole && (!output.get() || output->width != w || output->height != h || output->type != RTSPImage::RGB)){
+        output.reset(new RTSPImage);
+        output->setRGB(w, h);
+    }
+    if(!output.get() || output->width != w || s.y0 + h > output->height){
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    const size_t pitch = size_t(w) * 3;
+    s.rows.resize(h);
+    for(int y = 0; y < h; ++y)
+        s.rows[y] = output->rgb.data() + size_t(s.y0 + y) * pitch;
+
+    while(cinfo.output_scanline < cinfo.output_height){
+        if(jpeg_read_scanlines(&cinfo, s.rows.data() + cinfo.output_scanline, cinfo.output_height - cinfo.output_scanline) == 0)
+            break;
+    }
+    jpeg_finish_decompress(&cinfo);
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef JPEG_RST_DECODER_H
+#define JPEG_RST_DECODER_H
+
+#include <memory>
+#include <vector>
+
+#include "common.h"
+#include "common_utils.h"
+
+/**
+ * @brief The jpeg_rst_decoder class
+ * CPU JPEG decoder for streams with restart markers. The entropy coded data
+ * is split at RST markers that fall on MCU row boundaries, every strip is
+ * decoded as a separate image by libjpeg(-turbo) on its own OpenMP thread.
+ * Strips use the fast IDCT without fancy upsampling so that seams do not show.
+ * Decoder objects and buffers are kept between frames.
+ * Images without a usable restart interval are decoded in one piece with
+ * the default libjpeg quality settings.
+ */
+class jpeg_rst_decoder
+{
+public:
+    jpeg_rst_decoder();
+    ~jpeg_rst_decoder();
+
+    bool decode(const uint8_t* input, uint32_t len, PImage &output);
+    bool decode(const bytearray& input, PImage &output);
+
+    /**
+     * @brief strips
+     * @return number of strips of the last frame
+     */
+    int strips() const { return m_used; }
+
+private:
+    struct frame_info{
+        int width = 0;
+        int height = 0;
+        int mcu_width = 0;
+        int mcu_height = 0;
+        int restart_interval = 0;
+        size_t sof_offset = 0;  /// position of the SOF height field
+        size_t scan_offset = 0; /// first byte of entropy coded data
+        std::vector<std::pair<size_t, size_t>> segments; /// entropy coded data between RST markers
+    };
+
+    struct strip;
+
+    std::vector<std::unique_ptr<strip>> m_strips;
+    int m_used = 0;
+
+    bool parse(const uint8_t* input, uint32_t len, frame_info& info) const;
+    int split(const uint8_t* input, const frame_info& info);
+    /// whole: single piece, output is allocated and default DCT and upsampling are used
+    bool decode_strip(strip& s, const uint8_t* input, size_t len, PImage& output, bool whole);
+};
+
+#endif // JPEG_RST_DECODER_H
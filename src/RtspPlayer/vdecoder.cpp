@@ -5,7 +5,7 @@
 #include <mutex>
 
 #include "fastvideo_decoder.h"
-#include "jpegenc.h"
+#include "jpeg_rst_decoder.h"
 
 #ifndef __ARM_ARCH
 #include "cuviddecoder.h"
@@ -39,17 +39,22 @@ int callback_layer(void* data)
 
 VDecoder::VDecoder()
 {
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
     av_register_all();
+#endif
     avformat_network_init();
-    av_init_packet(&m_pkt);
+    m_pkt = av_packet_alloc();
+    m_frame = av_frame_alloc();
 }
 
 VDecoder::~VDecoder()
 {
     m_done = true;
     waitUntilStopStreaming();
-    //av_packet_unref(&m_pkt);
     close();
+    av_packet_free(&m_pkt);
+    av_frame_free(&m_frame);
+    av_buffer_pool_uninit(&m_pktPool);
 }
 
 bool VDecoder::initDecoder(bool use_stream)
@@ -103,8 +108,12 @@ bool VDecoder::initDecoder(bool use_stream)
         }
     }
 
-    m_cdcctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    if(m_lowDelay)
+        m_cdcctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
     m_cdcctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    //libavcodec falls back to slice threads when low delay is set
+    m_cdcctx->thread_count = 0;
+    m_cdcctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 
     if(use_stream){
         m_codec = avcodec_find_decoder(m_cdcctx->codec_id);
@@ -234,15 +243,13 @@ int VDecoder::initStream()
 
 int VDecoder::readPacket()
 {
-    int res;
-    av_init_packet(&m_pkt);
-    res = av_read_frame(m_fmtctx, &m_pkt);
-    return res;
+    av_packet_unref(m_pkt);
+    return av_read_frame(m_fmtctx, m_pkt);
 }
 
 void VDecoder::freePacket()
 {
-    av_packet_unref(&m_pkt);
+    av_packet_unref(m_pkt);
 }
 
 void VDecoder::setH264Codec(const QString &codec)
@@ -271,47 +278,45 @@ bool VDecoder::decodePacket(PImage& image, QString& decodeName, quint64 &sizeRea
     auto starttime = getNow();
 
     if(m_idCodec != CODEC_JPEG){
-        int ret = 0;
-        int got = 0;
-
         if(!mUseNvDecoder){
             if(!m_cdcctx)
                 return false;
-            AVFrame *frame = av_frame_alloc();
 
-            ret = avcodec_decode_video2(m_cdcctx, frame, &got, &m_pkt);
+            bool sent = false;
+            while(!sent){
+                //EAGAIN means the decoder is full, it has a frame to take out first
+                int ret = avcodec_send_packet(m_cdcctx, m_pkt);
+                sent = ret != AVERROR(EAGAIN);
 
-            if(got > 0){
-                analyzeFrame(frame, image);
-                av_frame_unref(frame);
+                while(avcodec_receive_frame(m_cdcctx, m_frame) == 0){
+                    analyzeFrame(m_frame, image);
+                    av_frame_unref(m_frame);
 
-                decodeName = m_cdcctx->codec->name;
+                    decodeName = m_cdcctx->codec->name;
+                }
             }
-
-            av_frame_free(&frame);
         }else{
             if(!mCuvidDecoder.get()){
                 mCuvidDecoder.reset(new CuvidDecoder(m_idCodec == CODEC_H264? CuvidDecoder::eH264 : CuvidDecoder::eHEVC));
             }
 
             decodeName = "cuvid_nvcodec";
-            mCuvidDecoder->decode(m_pkt.data, m_pkt.size, image);
+            mCuvidDecoder->decode(m_pkt->data, m_pkt->size, image);
         }
     }else{
 //        PImage obj;
 
-        getEncodedData(&m_pkt, mEncodedData);
-
         std::lock_guard<std::mutex> lg(m_mutexDecoder);
         if(m_useFastvideo){
             decodeName = "Fastvideo";
             if(!m_decoderFv.get())
                 m_decoderFv.reset(new fastvideo_decoder);
-            m_decoderFv->decode(mEncodedData, image, true);
+            m_decoderFv->decode(m_pkt->data, uint32_t(m_pkt->size), image, true);
         }else{
             decodeName = "JpegTurbo";
-            jpegenc dec;
-            dec.decode(mEncodedData, image);
+            if(!m_decoderJpeg.get())
+                m_decoderJpeg.reset(new jpeg_rst_decoder);
+            m_decoderJpeg->decode(m_pkt->data, uint32_t(m_pkt->size), image);
         }
 
 
@@ -326,7 +331,7 @@ bool VDecoder::decodePacket(PImage& image, QString& decodeName, quint64 &sizeRea
         decodeName = "decode (" + decodeName + "):";
         duration = getDuration(starttime);
     }
-    sizeReaded += m_pkt.size;
+    sizeReaded += m_pkt->size;
     return true;
 }
 
@@ -342,8 +347,9 @@ bool VDecoder::decodePacket(const QByteArray &enc, PImage &image, QString &decod
             m_decoderFv->decode((uchar*)enc.data(), enc.size(), image, true);
         }else{
             decodeName = "JpegTurbo";
-            jpegenc dec;
-            dec.decode((uchar*)enc.data(), enc.size(), image);
+            if(!m_decoderJpeg.get())
+                m_decoderJpeg.reset(new jpeg_rst_decoder);
+            m_decoderJpeg->decode((uchar*)enc.data(), enc.size(), image);
         }
 
         if(!decodeName.isEmpty()){
@@ -354,11 +360,27 @@ bool VDecoder::decodePacket(const QByteArray &enc, PImage &image, QString &decod
     }else{
         quint64 tmp = 0;
         decodeName = "";
-        av_init_packet(&m_pkt);
-        av_new_packet(&m_pkt, enc.size());
-        std::copy(enc.data(), enc.data() + enc.size(), m_pkt.data);
+
+        //Decoders read past the end, copy into a padded buffer from the pool.
+        //Frame threads may still hold the previous one, the pool hands out another.
+        int size = enc.size() + AV_INPUT_BUFFER_PADDING_SIZE;
+        if(!m_pktPool || m_pktPoolSize < size){
+            av_buffer_pool_uninit(&m_pktPool);
+            m_pktPoolSize = size + size / 2;
+            m_pktPool = av_buffer_pool_init(m_pktPoolSize, av_buffer_allocz);
+        }
+
+        av_packet_unref(m_pkt);
+        m_pkt->buf = av_buffer_pool_get(m_pktPool);
+        if(!m_pkt->buf)
+            return false;
+        m_pkt->data = m_pkt->buf->data;
+        m_pkt->size = enc.size();
+        std::copy(enc.data(), enc.data() + enc.size(), m_pkt->data);
+        std::fill(m_pkt->data + enc.size(), m_pkt->data + size, 0);
+
         decodePacket(image, decodeName, tmp, duration);
-        av_packet_unref(&m_pkt);
+        av_packet_unref(m_pkt);
     }
     return true;
 }
@@ -413,8 +435,8 @@ void VDecoder::waitUntilStopStreaming()
         m_doStop = false;
         m_is_open = false;
 
-        if(m_cdcctx && avcodec_is_open(m_cdcctx)){
-            avcodec_close(m_cdcctx);
+        if(m_cdcctx){
+            avcodec_free_context(&m_cdcctx);
         }
 
         if(m_fmtctx){
@@ -13,6 +13,7 @@ extern "C"{
 
 class CuvidDecoder;
 class fastvideo_decoder;
+class jpeg_rst_decoder;
 
 class VDecoder
 {
@@ -60,6 +61,14 @@ public:
     bool isMJpeg() const;
 
     void setUseNvdecoder(bool val) {mUseNvDecoder = val;}
+    /**
+     * @brief setLowDelay
+     * output every frame as soon as it is decoded, for live streams. Frame
+     * threading of the software decoder is used only without low delay, off
+     * by default for files. Applied in initDecoder
+     * @param val
+     */
+    void setLowDelay(bool val) { m_lowDelay = val; }
 
     bool decodePacket(PImage &image, QString &decodeName, quint64 &sizeReaded, double &duration);
     bool decodePacket(const QByteArray& enc, PImage& image, QString& decodeName, double &duration);
@@ -82,20 +91,25 @@ private:
     AVFormatContext *m_fmtctx = nullptr;
     AVCodecContext *m_cdcctx = nullptr;
     AVInputFormat *m_inputfmt = nullptr;
-    AVPacket m_pkt;
-    bytearray mEncodedData;
+    AVPacket *m_pkt = nullptr;
+    AVFrame *m_frame = nullptr;
+    /// padded packet buffers for data that does not come from the demuxer
+    AVBufferPool *m_pktPool = nullptr;
+    int m_pktPoolSize = 0;
 
     bool m_useFastvideo = false;
     QString m_codecH264 = "h264_cuvid";
     int m_idCodec = NONE;
     QString m_error;
     bool mUseNvDecoder = false;
+    bool m_lowDelay = false;
 
     int m_bufferUdp = 5000000;
 
     std::mutex m_mutexDecoder;
 
     std::unique_ptr<fastvideo_decoder> m_decoderFv;
+    std::unique_ptr<jpeg_rst_decoder> m_decoderJpeg;
     std::unique_ptr<CuvidDecoder> mCuvidDecoder;
 
     bool m_done = false;
@@ -5,6 +5,10 @@
 #DEFINES += SUPPORT_LUCID
 #DEFINES += SUPPORT_BASLER
 
+#CI benchmarks the GenICam path against the mock producer (CameraSample --genicam-bench)
+CI_BUILD = $$(CI)
+!isEmpty(CI_BUILD): DEFINES += SUPPORT_GENICAM
+
 #DEFINES += SUPPORT_MIPI
 contains(DEFINES, SUPPORT_MIPI){
     #Uncomment for LI IMX477 MIPI camera support